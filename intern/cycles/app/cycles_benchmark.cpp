@@ -0,0 +1,852 @@
+/*
+ * Copyright 2011-2019 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Headless benchmark, rendering a set of procedurally generated scenes which
+ * each stress a different part of the renderer, and XML scenes passed on the
+ * command line. Timings and memory usage are reported as JSON, to compare
+ * builds against each other. */
+
+#include <stdio.h>
+
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "render/curves.h"
+#include "device/device.h"
+#include "render/graph.h"
+#include "render/integrator.h"
+#include "render/light.h"
+#include "render/mesh.h"
+#include "render/nodes.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/session.h"
+#include "render/shader.h"
+
+#include "util/util_args.h"
+#include "util/util_debug.h"
+#include "util/util_foreach.h"
+#include "util/util_guarded_allocator.h"
+#include "util/util_hash.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+#include "util/util_path.h"
+#include "util/util_string.h"
+#include "util/util_system.h"
+#include "util/util_time.h"
+#include "util/util_transform.h"
+#include "util/util_version.h"
+
+#include "app/cycles_xml.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct BenchmarkOptions {
+	int width, height;
+	int samples;
+	int threads;
+	int tile_size;
+	/* Multiplier for the amount of geometry and lights in the scenes. */
+	float scale;
+	string scenes;
+	vector<string> filepaths;
+	string output_path;
+	bool quiet;
+	/* Render every scene a second time with packet traversal of camera rays. */
+	bool packet_traversal;
+} options;
+
+struct BenchmarkResult {
+	string name;
+	bool packet_traversal;
+	double sync_time;
+	double update_time;
+	double bvh_build_time;
+	double render_time;
+	size_t device_mem_peak;
+	size_t system_mem_peak;
+	/* Combined pass of the rendered image, RGBA. */
+	vector<float> pixels;
+	/* Largest difference to the image rendered with single ray traversal,
+	 * negative when not compared. */
+	float max_difference;
+};
+
+/* Scene Building Utilities */
+
+static float benchmark_random(uint seed, uint i)
+{
+	return hash_int_01(hash_int_2d(seed, i));
+}
+
+static int benchmark_count(int count)
+{
+	return max((int)(count * options.scale), 1);
+}
+
+static Transform benchmark_look_at(const float3 eye, const float3 target)
+{
+	/* Cameras look along Z, with Y up. */
+	const float3 dir = normalize(target - eye);
+	const float3 right = normalize(cross(dir, make_float3(0.0f, 0.0f, 1.0f)));
+	const float3 up = cross(right, dir);
+
+	return make_transform(right.x, up.x, dir.x, eye.x,
+	                      right.y, up.y, dir.y, eye.y,
+	                      right.z, up.z, dir.z, eye.z);
+}
+
+static void benchmark_set_camera(Scene *scene, const float3 eye, const float3 target)
+{
+	Camera *cam = scene->camera;
+
+	cam->matrix = benchmark_look_at(eye, target);
+	cam->width = options.width;
+	cam->height = options.height;
+	cam->fov = DEG2RADF(50.0f);
+	cam->compute_auto_viewplane();
+	cam->need_update = true;
+}
+
+static void benchmark_set_background(Scene *scene, float3 color, float strength)
+{
+	ShaderGraph *graph = new ShaderGraph();
+
+	BackgroundNode *background = new BackgroundNode();
+	background->color = color;
+	background->strength = strength;
+	graph->add(background);
+
+	graph->connect(background->output("Background"), graph->output()->input("Surface"));
+
+	scene->default_background->set_graph(graph);
+	scene->default_background->tag_update(scene);
+}
+
+static Shader *benchmark_add_shader(Scene *scene, const char *name, ShaderGraph *graph)
+{
+	Shader *shader = new Shader();
+	shader->name = name;
+	shader->set_graph(graph);
+	scene->shaders.push_back(shader);
+
+	return shader;
+}
+
+static Shader *benchmark_add_diffuse_shader(Scene *scene, const char *name, float3 color)
+{
+	ShaderGraph *graph = new ShaderGraph();
+
+	DiffuseBsdfNode *diffuse = new DiffuseBsdfNode();
+	diffuse->color = color;
+	graph->add(diffuse);
+
+	graph->connect(diffuse->output("BSDF"), graph->output()->input("Surface"));
+
+	return benchmark_add_shader(scene, name, graph);
+}
+
+static Shader *benchmark_add_emission_shader(Scene *scene, const char *name, float strength)
+{
+	ShaderGraph *graph = new ShaderGraph();
+
+	EmissionNode *emission = new EmissionNode();
+	emission->color = make_float3(1.0f, 0.9f, 0.8f);
+	emission->strength = strength;
+	graph->add(emission);
+
+	graph->connect(emission->output("Emission"), graph->output()->input("Surface"));
+
+	return benchmark_add_shader(scene, name, graph);
+}
+
+static Mesh *benchmark_add_mesh(Scene *scene, Shader *shader)
+{
+	Mesh *mesh = new Mesh();
+	mesh->used_shaders.push_back(shader);
+	scene->meshes.push_back(mesh);
+
+	return mesh;
+}
+
+static Object *benchmark_add_object(Scene *scene, Mesh *mesh, const Transform& tfm)
+{
+	Object *object = new Object();
+	object->mesh = mesh;
+	object->tfm = tfm;
+	scene->objects.push_back(object);
+
+	return object;
+}
+
+static void benchmark_mesh_add_quad(Mesh *mesh, float3 a, float3 b, float3 c, float3 d)
+{
+	const int offset = mesh->verts.size();
+
+	mesh->verts.push_back_slow(a);
+	mesh->verts.push_back_slow(b);
+	mesh->verts.push_back_slow(c);
+	mesh->verts.push_back_slow(d);
+
+	mesh->add_triangle(offset, offset + 1, offset + 2, 0, false);
+	mesh->add_triangle(offset, offset + 2, offset + 3, 0, false);
+}
+
+static void benchmark_mesh_add_box(Mesh *mesh, float3 min, float3 max)
+{
+	const float3 p[8] = {
+		make_float3(min.x, min.y, min.z), make_float3(max.x, min.y, min.z),
+		make_float3(max.x, max.y, min.z), make_float3(min.x, max.y, min.z),
+		make_float3(min.x, min.y, max.z), make_float3(max.x, min.y, max.z),
+		make_float3(max.x, max.y, max.z), make_float3(min.x, max.y, max.z),
+	};
+
+	benchmark_mesh_add_quad(mesh, p[0], p[3], p[2], p[1]);
+	benchmark_mesh_add_quad(mesh, p[4], p[5], p[6], p[7]);
+	benchmark_mesh_add_quad(mesh, p[0], p[1], p[5], p[4]);
+	benchmark_mesh_add_quad(mesh, p[1], p[2], p[6], p[5]);
+	benchmark_mesh_add_quad(mesh, p[2], p[3], p[7], p[6]);
+	benchmark_mesh_add_quad(mesh, p[3], p[0], p[4], p[7]);
+}
+
+static void benchmark_mesh_add_sphere(Mesh *mesh, float3 center, float radius, int segments, int rings)
+{
+	const int offset = mesh->verts.size();
+
+	for(int j = 0; j <= rings; j++) {
+		const float theta = M_PI_F * j / rings;
+		for(int i = 0; i < segments; i++) {
+			const float phi = M_2PI_F * i / segments;
+			const float3 N = make_float3(sinf(theta)*cosf(phi), sinf(theta)*sinf(phi), cosf(theta));
+			mesh->verts.push_back_slow(center + radius*N);
+		}
+	}
+
+	for(int j = 0; j < rings; j++) {
+		for(int i = 0; i < segments; i++) {
+			const int v0 = offset + j*segments + i;
+			const int v1 = offset + j*segments + (i + 1) % segments;
+			const int v2 = v1 + segments;
+			const int v3 = v0 + segments;
+
+			if(j != 0) {
+				mesh->add_triangle(v0, v2, v1, 0, true);
+			}
+			if(j != rings - 1) {
+				mesh->add_triangle(v0, v3, v2, 0, true);
+			}
+		}
+	}
+}
+
+static void benchmark_add_floor(Scene *scene, float size)
+{
+	Shader *shader = benchmark_add_diffuse_shader(scene, "floor", make_float3(0.6f, 0.6f, 0.6f));
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+
+	benchmark_mesh_add_quad(mesh,
+	                        make_float3(-size, -size, 0.0f),
+	                        make_float3(size, -size, 0.0f),
+	                        make_float3(size, size, 0.0f),
+	                        make_float3(-size, size, 0.0f));
+
+	benchmark_add_object(scene, mesh, transform_identity());
+}
+
+static void benchmark_add_point_light(Scene *scene, Shader *shader, float3 co, float size)
+{
+	Light *light = new Light();
+	light->type = LIGHT_POINT;
+	light->co = co;
+	light->size = size;
+	light->shader = shader;
+	scene->lights.push_back(light);
+}
+
+/* Benchmark Scenes */
+
+/* Curves growing out of a sphere. */
+static void benchmark_scene_hair(Scene *scene)
+{
+	benchmark_set_background(scene, make_float3(0.8f, 0.9f, 1.0f), 1.0f);
+	benchmark_set_camera(scene, make_float3(0.0f, -4.5f, 2.0f), make_float3(0.0f, 0.0f, 1.0f));
+	benchmark_add_floor(scene, 10.0f);
+
+	Shader *skin = benchmark_add_diffuse_shader(scene, "skin", make_float3(0.8f, 0.6f, 0.5f));
+
+	ShaderGraph *graph = new ShaderGraph();
+	PrincipledHairBsdfNode *hair_bsdf = new PrincipledHairBsdfNode();
+	graph->add(hair_bsdf);
+	graph->connect(hair_bsdf->output("BSDF"), graph->output()->input("Surface"));
+	Shader *hair = benchmark_add_shader(scene, "hair", graph);
+
+	const float3 center = make_float3(0.0f, 0.0f, 1.0f);
+	const float radius = 0.8f;
+
+	Mesh *mesh = benchmark_add_mesh(scene, skin);
+	mesh->used_shaders.push_back(hair);
+	benchmark_mesh_add_sphere(mesh, center, radius, 64, 32);
+
+	const int num_curves = benchmark_count(200000);
+	const int num_keys = 5;
+	const float length = 0.4f;
+
+	mesh->reserve_curves(num_curves, num_curves*num_keys);
+
+	for(int i = 0; i < num_curves; i++) {
+		/* Uniformly distributed roots, with hair bending down under gravity. */
+		const float z = 1.0f - 2.0f*benchmark_random(0, i);
+		const float phi = M_2PI_F*benchmark_random(1, i);
+		const float r = safe_sqrtf(1.0f - z*z);
+		const float3 N = make_float3(r*cosf(phi), r*sinf(phi), z);
+
+		float3 co = center + radius*N;
+		float3 dir = N;
+
+		for(int k = 0; k < num_keys; k++) {
+			const float t = (float)k / (num_keys - 1);
+			mesh->add_curve_key(co, 0.004f*(1.0f - 0.8f*t));
+
+			dir = normalize(dir + make_float3(0.0f, 0.0f, -0.5f));
+			co += dir*(length / (num_keys - 1));
+		}
+
+		mesh->add_curve(i*num_keys, 1);
+	}
+
+	benchmark_add_object(scene, mesh, transform_identity());
+}
+
+/* Heterogeneous volume lit by a point light. */
+static void benchmark_scene_volume(Scene *scene)
+{
+	benchmark_set_background(scene, make_float3(0.8f, 0.9f, 1.0f), 0.2f);
+	benchmark_set_camera(scene, make_float3(0.0f, -5.0f, 2.0f), make_float3(0.0f, 0.0f, 1.0f));
+	benchmark_add_floor(scene, 10.0f);
+
+	ShaderGraph *graph = new ShaderGraph();
+
+	TextureCoordinateNode *texco = new TextureCoordinateNode();
+	graph->add(texco);
+
+	NoiseTextureNode *noise = new NoiseTextureNode();
+	noise->scale = 3.0f;
+	noise->detail = 4.0f;
+	graph->add(noise);
+
+	PrincipledVolumeNode *volume = new PrincipledVolumeNode();
+	volume->color = make_float3(0.8f, 0.8f, 0.8f);
+	graph->add(volume);
+
+	graph->connect(texco->output("Object"), noise->input("Vector"));
+	graph->connect(noise->output("Fac"), volume->input("Density"));
+	graph->connect(volume->output("Volume"), graph->output()->input("Volume"));
+
+	Shader *shader = benchmark_add_shader(scene, "smoke", graph);
+
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+	benchmark_mesh_add_box(mesh, make_float3(-1.5f, -1.5f, 0.01f), make_float3(1.5f, 1.5f, 2.5f));
+	benchmark_add_object(scene, mesh, transform_identity());
+
+	Shader *light_shader = benchmark_add_emission_shader(scene, "light", 1000.0f);
+	benchmark_add_point_light(scene, light_shader, make_float3(2.0f, -2.0f, 4.0f), 0.2f);
+}
+
+/* Subsurface scattering spheres. */
+static void benchmark_scene_sss(Scene *scene)
+{
+	benchmark_set_background(scene, make_float3(0.8f, 0.9f, 1.0f), 0.5f);
+	benchmark_set_camera(scene, make_float3(0.0f, -6.0f, 2.5f), make_float3(0.0f, 0.0f, 0.8f));
+	benchmark_add_floor(scene, 10.0f);
+
+	ShaderGraph *graph = new ShaderGraph();
+	SubsurfaceScatteringNode *sss = new SubsurfaceScatteringNode();
+	sss->color = make_float3(0.8f, 0.5f, 0.4f);
+	sss->scale = 0.2f;
+	sss->radius = make_float3(1.0f, 0.4f, 0.2f);
+	graph->add(sss);
+	graph->connect(sss->output("BSSRDF"), graph->output()->input("Surface"));
+
+	Shader *shader = benchmark_add_shader(scene, "skin", graph);
+
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+	for(int i = 0; i < 5; i++) {
+		const float3 center = make_float3(-2.4f + 1.2f*i, 0.6f*(i % 2), 0.5f);
+		benchmark_mesh_add_sphere(mesh, center, 0.5f, 64, 32);
+	}
+	benchmark_add_object(scene, mesh, transform_identity());
+
+	Shader *light_shader = benchmark_add_emission_shader(scene, "light", 1000.0f);
+	benchmark_add_point_light(scene, light_shader, make_float3(-1.0f, 2.0f, 3.0f), 0.5f);
+}
+
+/* City block lit by many small lights. */
+static void benchmark_scene_many_lights(Scene *scene)
+{
+	benchmark_set_background(scene, make_float3(0.0f, 0.0f, 0.0f), 0.0f);
+	benchmark_set_camera(scene, make_float3(-12.0f, -12.0f, 8.0f), make_float3(0.0f, 0.0f, 0.0f));
+	benchmark_add_floor(scene, 50.0f);
+
+	Shader *shader = benchmark_add_diffuse_shader(scene, "buildings", make_float3(0.7f, 0.7f, 0.7f));
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+
+	for(int j = 0; j < 8; j++) {
+		for(int i = 0; i < 8; i++) {
+			const float3 min = make_float3(-20.0f + 5.0f*i, -20.0f + 5.0f*j, 0.0f);
+			const float height = 2.0f + 8.0f*benchmark_random(2, j*8 + i);
+			benchmark_mesh_add_box(mesh, min, min + make_float3(3.0f, 3.0f, height));
+		}
+	}
+	benchmark_add_object(scene, mesh, transform_identity());
+
+	Shader *light_shader = benchmark_add_emission_shader(scene, "light", 20.0f);
+	const int num_lights = benchmark_count(2000);
+
+	for(int i = 0; i < num_lights; i++) {
+		/* Lights in the streets between the buildings. */
+		const float along = -20.0f + 40.0f*benchmark_random(3, i);
+		const float across = -21.0f + 5.0f*(int)(9.0f*benchmark_random(4, i));
+		const float3 co = (i % 2)? make_float3(along, across, 1.5f): make_float3(across, along, 1.5f);
+
+		benchmark_add_point_light(scene, light_shader, co, 0.05f);
+	}
+}
+
+/* Many instances of the same mesh. */
+static void benchmark_scene_instancing(Scene *scene)
+{
+	benchmark_set_background(scene, make_float3(0.8f, 0.9f, 1.0f), 1.0f);
+	benchmark_set_camera(scene, make_float3(-15.0f, -15.0f, 10.0f), make_float3(0.0f, 0.0f, 0.0f));
+	benchmark_add_floor(scene, 50.0f);
+
+	Shader *shader = benchmark_add_diffuse_shader(scene, "pebble", make_float3(0.5f, 0.6f, 0.7f));
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+	benchmark_mesh_add_sphere(mesh, make_float3(0.0f, 0.0f, 0.0f), 1.0f, 48, 24);
+
+	const int num_instances = benchmark_count(50000);
+
+	for(int i = 0; i < num_instances; i++) {
+		const float3 co = make_float3(-25.0f + 50.0f*benchmark_random(5, i),
+		                              -25.0f + 50.0f*benchmark_random(6, i),
+		                              0.0f);
+		const float size = 0.05f + 0.2f*benchmark_random(7, i);
+		const float angle = M_2PI_F*benchmark_random(8, i);
+
+		const Transform tfm = transform_translate(co + make_float3(0.0f, 0.0f, 0.5f*size)) *
+		                      transform_rotate(angle, make_float3(0.0f, 0.0f, 1.0f)) *
+		                      transform_scale(size, 0.7f*size, 0.5f*size);
+
+		benchmark_add_object(scene, mesh, tfm);
+	}
+}
+
+typedef void (*BenchmarkSceneFunc)(Scene *scene);
+
+/* Dense field of objects seen without any bounces, so render time is mostly
+ * spent intersecting camera rays. */
+static void benchmark_scene_camera_rays(Scene *scene)
+{
+	benchmark_set_background(scene, make_float3(0.8f, 0.9f, 1.0f), 1.0f);
+	benchmark_set_camera(scene, make_float3(-15.0f, -15.0f, 10.0f), make_float3(0.0f, 0.0f, 0.0f));
+	benchmark_add_floor(scene, 50.0f);
+
+	Shader *shader = benchmark_add_emission_shader(scene, "glow", 1.0f);
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+
+	const int num_spheres = benchmark_count(5000);
+
+	for(int i = 0; i < num_spheres; i++) {
+		const float3 co = make_float3(-25.0f + 50.0f*benchmark_random(9, i),
+		                              -25.0f + 50.0f*benchmark_random(10, i),
+		                              2.0f*benchmark_random(11, i));
+		const float radius = 0.1f + 0.4f*benchmark_random(12, i);
+
+		benchmark_mesh_add_sphere(mesh, co, radius, 16, 8);
+	}
+	benchmark_add_object(scene, mesh, transform_identity());
+
+	scene->integrator->max_bounce = 0;
+	scene->integrator->tag_update(scene);
+}
+
+static const struct {
+	const char *name;
+	BenchmarkSceneFunc func;
+} benchmark_scenes[] = {
+	{"hair", benchmark_scene_hair},
+	{"volume", benchmark_scene_volume},
+	{"sss", benchmark_scene_sss},
+	{"many_lights", benchmark_scene_many_lights},
+	{"instancing", benchmark_scene_instancing},
+	{"camera_rays", benchmark_scene_camera_rays},
+};
+
+/* Benchmark */
+
+static void benchmark_write_render_tile(RenderTile& rtile, BenchmarkResult *result, int width)
+{
+	RenderBuffers *buffers = rtile.buffers;
+	vector<float> pixels(rtile.w*rtile.h*4);
+
+	buffers->copy_from_device();
+	if(!buffers->get_pass_rect(PASS_COMBINED, 1.0f, rtile.sample, 4, &pixels[0], "Combined")) {
+		return;
+	}
+
+	for(int y = 0; y < rtile.h; y++) {
+		memcpy(&result->pixels[((rtile.y + y)*width + rtile.x)*4],
+		       &pixels[y*rtile.w*4],
+		       sizeof(float)*rtile.w*4);
+	}
+}
+
+/* Packets must find the same hits as single rays, so the images are expected
+ * to match up to float precision. */
+static float benchmark_max_difference(const vector<float>& a, const vector<float>& b)
+{
+	if(a.size() != b.size()) {
+		return FLT_MAX;
+	}
+
+	float max_difference = 0.0f;
+	for(size_t i = 0; i < a.size(); i++) {
+		max_difference = max(max_difference, fabsf(a[i] - b[i]));
+	}
+	return max_difference;
+}
+
+static BenchmarkResult benchmark_run(const string& name,
+                                     BenchmarkSceneFunc func,
+                                     const string& filepath,
+                                     bool packet_traversal)
+{
+	BenchmarkResult result;
+	result.name = name;
+	result.packet_traversal = packet_traversal;
+	result.max_difference = -1.0f;
+
+	if(!options.quiet) {
+		fprintf(stderr, "Rendering %s%s\n", name.c_str(), packet_traversal? " with packet traversal": "");
+	}
+
+	/* Read by the CPU device when it's created for the session. */
+	DebugFlags().cpu.packet_traversal = packet_traversal;
+
+	SessionParams session_params;
+	session_params.device = Device::available_devices(DEVICE_MASK_CPU).front();
+	session_params.background = true;
+	session_params.samples = options.samples;
+	session_params.threads = options.threads;
+	session_params.tile_size = make_int2(options.tile_size, options.tile_size);
+
+	Session *session = new Session(session_params);
+
+	/* Build the scene, as an application would sync it. */
+	scoped_timer sync_timer;
+
+	SceneParams scene_params;
+	scene_params.bvh_type = SceneParams::BVH_STATIC;
+	/* Same layout as Blender renders with, BVH8 on AVX2 CPUs. */
+	scene_params.bvh_layout = DebugFlags().cpu.bvh_layout;
+	Scene *scene = new Scene(scene_params, session->device);
+
+	if(func) {
+		func(scene);
+	}
+	else {
+		xml_read_file(scene, filepath.c_str());
+		scene->camera->width = options.width;
+		scene->camera->height = options.height;
+		scene->camera->compute_auto_viewplane();
+	}
+
+	result.sync_time = sync_timer.get_time();
+
+	BufferParams buffer_params;
+	buffer_params.width = scene->camera->width;
+	buffer_params.height = scene->camera->height;
+	buffer_params.full_width = scene->camera->width;
+	buffer_params.full_height = scene->camera->height;
+
+	result.pixels.resize(buffer_params.width*buffer_params.height*4, 0.0f);
+	session->write_render_tile_cb = function_bind(&benchmark_write_render_tile,
+	                                              _1,
+	                                              &result,
+	                                              buffer_params.width);
+
+	session->scene = scene;
+	session->reset(buffer_params, options.samples);
+	session->start();
+	session->wait();
+
+	double total_time;
+	session->progress.get_time(total_time, result.render_time);
+
+	result.update_time = scene->update_time;
+	result.bvh_build_time = scene->mesh_manager->bvh_build_time;
+	result.device_mem_peak = session->device->stats.mem_peak;
+	result.system_mem_peak = util_guarded_get_mem_peak();
+
+	if(session->progress.get_cancel()) {
+		fprintf(stderr, "Rendering %s failed: %s\n",
+		        name.c_str(),
+		        session->progress.get_cancel_message().c_str());
+		result.render_time = 0.0;
+	}
+
+	delete session;
+
+	return result;
+}
+
+/* Scene names come from file paths and the CPU brand from the system,
+ * either may contain quotes, backslashes or control characters. */
+static string benchmark_json_string(const string& str)
+{
+	string escaped = "\"";
+	foreach(const char c, str) {
+		switch(c) {
+			case '"':
+				escaped += "\\\"";
+				break;
+			case '\\':
+				escaped += "\\\\";
+				break;
+			case '\n':
+				escaped += "\\n";
+				break;
+			case '\r':
+				escaped += "\\r";
+				break;
+			case '\t':
+				escaped += "\\t";
+				break;
+			default:
+				if((unsigned char)c < 0x20) {
+					escaped += string_printf("\\u%04x", (int)(unsigned char)c);
+				}
+				else {
+					escaped += c;
+				}
+				break;
+		}
+	}
+	escaped += "\"";
+	return escaped;
+}
+
+static string benchmark_json(const vector<BenchmarkResult>& results)
+{
+	const int num_pixels = options.width*options.height;
+
+	string json = "{\n";
+	json += string_printf("  \"version\": %s,\n", benchmark_json_string(CYCLES_VERSION_STRING).c_str());
+	json += string_printf("  \"cpu\": %s,\n", benchmark_json_string(system_cpu_brand_string()).c_str());
+	json += string_printf("  \"threads\": %d,\n", (options.threads)? options.threads: system_cpu_thread_count());
+	json += string_printf("  \"samples\": %d,\n", options.samples);
+	json += string_printf("  \"resolution\": [%d, %d],\n", options.width, options.height);
+	json += "  \"scenes\": [\n";
+
+	for(size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+		const double samples_per_second =
+		        (result.render_time > 0.0)? options.samples / result.render_time: 0.0;
+
+		json += "    {\n";
+		json += string_printf("      \"name\": %s,\n", benchmark_json_string(result.name).c_str());
+		json += string_printf("      \"packet_traversal\": %s,\n", result.packet_traversal? "true": "false");
+		json += string_printf("      \"sync_time\": %.6f,\n", result.sync_time);
+		json += string_printf("      \"update_time\": %.6f,\n", result.update_time);
+		json += string_printf("      \"bvh_build_time\": %.6f,\n", result.bvh_build_time);
+		json += string_printf("      \"render_time\": %.6f,\n", result.render_time);
+		json += string_printf("      \"samples_per_second\": %.6f,\n", samples_per_second);
+		json += string_printf("      \"pixel_samples_per_second\": %.1f,\n", samples_per_second*num_pixels);
+		if(result.max_difference >= 0.0f) {
+			json += string_printf("      \"max_difference\": %g,\n", (double)result.max_difference);
+		}
+		json += string_printf("      \"device_memory_peak\": %zu,\n", result.device_mem_peak);
+		json += string_printf("      \"system_memory_peak\": %zu\n", result.system_mem_peak);
+		json += (i + 1 < results.size())? "    },\n": "    }\n";
+	}
+
+	json += "  ]\n";
+	json += "}\n";
+
+	return json;
+}
+
+static int files_parse(int argc, const char *argv[])
+{
+	for(int i = 0; i < argc; i++) {
+		options.filepaths.push_back(argv[i]);
+	}
+
+	return 0;
+}
+
+static void options_parse(int argc, const char **argv)
+{
+	options.width = 480;
+	options.height = 270;
+	options.samples = 16;
+	options.threads = 0;
+	options.tile_size = 32;
+	options.scale = 1.0f;
+	options.scenes = "all";
+	options.quiet = false;
+	options.packet_traversal = false;
+
+	string scene_names;
+	foreach(const auto& scene, benchmark_scenes) {
+		if(scene_names != "")
+			scene_names += ", ";
+		scene_names += scene.name;
+	}
+
+	ArgParse ap;
+	bool help = false, debug = false, version = false;
+	int verbosity = 1;
+
+	ap.options ("Usage: cycles_benchmark [options] [file.xml ...]",
+		"%*", files_parse, "",
+		"--scenes %s", &options.scenes, ("Comma separated built-in scenes to render, all or none: " + scene_names).c_str(),
+		"--scale %f", &options.scale, "Multiplier for the amount of geometry and lights in built-in scenes",
+		"--samples %d", &options.samples, "Number of samples to render",
+		"--threads %d", &options.threads, "CPU Rendering Threads",
+		"--width %d", &options.width, "Image width in pixels",
+		"--height %d", &options.height, "Image height in pixels",
+		"--tile-size %d", &options.tile_size, "Tile size in pixels",
+		"--output %s", &options.output_path, "File path to write JSON results to, instead of standard output",
+		"--quiet", &options.quiet, "Don't print progress messages",
+		"--packet-traversal", &options.packet_traversal, "Render every scene again with packet traversal of camera rays, to compare against single ray traversal",
+#ifdef WITH_CYCLES_LOGGING
+		"--debug", &debug, "Enable debug logging",
+		"--verbose %d", &verbosity, "Set verbosity of the logger",
+#endif
+		"--help", &help, "Print help message",
+		"--version", &version, "Print version number",
+		NULL);
+
+	if(ap.parse(argc, argv) < 0) {
+		fprintf(stderr, "%s\n", ap.geterror().c_str());
+		ap.usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if(debug) {
+		util_logging_start();
+		util_logging_verbosity_set(verbosity);
+	}
+
+	if(version) {
+		printf("%s\n", CYCLES_VERSION_STRING);
+		exit(EXIT_SUCCESS);
+	}
+	else if(help) {
+		ap.usage();
+		exit(EXIT_SUCCESS);
+	}
+
+	if(options.samples <= 0) {
+		fprintf(stderr, "Invalid number of samples: %d\n", options.samples);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.width <= 0 || options.height <= 0) {
+		fprintf(stderr, "Invalid resolution: %dx%d\n", options.width, options.height);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.tile_size <= 0) {
+		fprintf(stderr, "Invalid tile size: %d\n", options.tile_size);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.scale <= 0.0f) {
+		fprintf(stderr, "Invalid scale: %f\n", (double)options.scale);
+		exit(EXIT_FAILURE);
+	}
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+	util_logging_init(argv[0]);
+	path_init();
+	options_parse(argc, argv);
+
+	vector<string> names;
+	if(options.scenes == "all") {
+		foreach(const auto& scene, benchmark_scenes) {
+			names.push_back(scene.name);
+		}
+	}
+	else if(options.scenes != "none") {
+		string_split(names, options.scenes, ",");
+	}
+
+	vector<BenchmarkSceneFunc> funcs;
+	foreach(const string& name, names) {
+		BenchmarkSceneFunc func = NULL;
+		foreach(const auto& scene, benchmark_scenes) {
+			if(name == scene.name) {
+				func = scene.func;
+			}
+		}
+
+		if(!func) {
+			fprintf(stderr, "Unknown scene: %s\n", name.c_str());
+			exit(EXIT_FAILURE);
+		}
+
+		funcs.push_back(func);
+	}
+
+	vector<BenchmarkResult> results;
+
+	for(size_t i = 0; i < names.size(); i++) {
+		results.push_back(benchmark_run(names[i], funcs[i], "", false));
+		if(options.packet_traversal) {
+			results.push_back(benchmark_run(names[i], funcs[i], "", true));
+		}
+	}
+
+	foreach(const string& filepath, options.filepaths) {
+		results.push_back(benchmark_run(path_filename(filepath), NULL, filepath, false));
+		if(options.packet_traversal) {
+			results.push_back(benchmark_run(path_filename(filepath), NULL, filepath, true));
+		}
+	}
+
+	/* Compare packet traversal against the single ray render before it. */
+	for(size_t i = 1; i < results.size(); i++) {
+		if(results[i].packet_traversal) {
+			results[i].max_difference = benchmark_max_difference(results[i - 1].pixels,
+			                                                     results[i].pixels);
+		}
+	}
+
+	string json = benchmark_json(results);
+
+	if(options.output_path == "") {
+		printf("%s", json.c_str());
+	}
+	else if(!path_write_text(options.output_path, json)) {
+		fprintf(stderr, "Failed to write %s\n", options.output_path.c_str());
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
@@ -37,9 +37,9 @@ int main(int argc, const char **argv)
 	string devicelist = "";
 	string devicename = "cpu";
 	bool list = false, debug = false;
-	int threads = 0, verbosity = 1;
+	int threads = 0, verbosity = 1, port = 0;
 
-	vector<DeviceType>& types = Device::available_types();
+	vector<DeviceType> types = Device::available_types();
 
 	foreach(DeviceType type, types) {
 		if(devicelist != "")
@@ -55,6 +55,7 @@ int main(int argc, const char **argv)
 		"--device %s", &devicename, ("Devices to use: " + devicelist).c_str(),
 		"--list-devices", &list, "List information about all available devices",
 		"--threads %d", &threads, "Number of threads to use for CPU device",
+		"--port %d", &port, "Port to listen on, to run multiple servers on one machine",
 #ifdef WITH_CYCLES_LOGGING
 		"--debug", &debug, "Enable debug logging",
 		"--verbose %d", &verbosity, "Set verbosity of the logger",
@@ -73,7 +74,7 @@ int main(int argc, const char **argv)
 	}
 
 	if(list) {
-		vector<DeviceInfo>& devices = Device::available_devices();
+		vector<DeviceInfo> devices = Device::available_devices();
 
 		printf("Devices:\n");
 
@@ -88,7 +89,7 @@ int main(int argc, const char **argv)
 
 	/* find matching device */
 	DeviceType device_type = Device::type_from_string(devicename.c_str());
-	vector<DeviceInfo>& devices = Device::available_devices();
+	vector<DeviceInfo> devices = Device::available_devices();
 	DeviceInfo device_info;
 
 	foreach(DeviceInfo& device, devices) {
@@ -102,9 +103,10 @@ int main(int argc, const char **argv)
 
 	while(1) {
 		Stats stats;
-		Device *device = Device::create(device_info, stats, true);
+		Profiler profiler;
+		Device *device = Device::create(device_info, stats, profiler, true);
 		printf("Cycles Server with device: %s\n", device->info.description.c_str());
-		device->server_run();
+		device->server_run(port);
 		delete device;
 	}
 
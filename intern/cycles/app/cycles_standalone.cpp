@@ -455,7 +455,15 @@ static void options_parse(int argc, const char **argv)
 
 	bool device_available = false;
 	if (!devices.empty()) {
-		options.session_params.device = devices.front();
+		if(device_type == DEVICE_NETWORK) {
+			/* Render on all configured servers at once. */
+			options.session_params.device = Device::get_multi_device(devices,
+			                                                         options.session_params.threads,
+			                                                         options.session_params.background);
+		}
+		else {
+			options.session_params.device = devices.front();
+		}
 		device_available = true;
 	}
 
@@ -263,6 +263,27 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=1,
     )
 
+    use_adaptive_sampling: BoolProperty(
+        name="Adaptive Sampling",
+        description="Stop sampling pixels once their noise is below the threshold, "
+        "only used for final CPU renders without progressive refine",
+        default=False,
+    )
+    adaptive_threshold: FloatProperty(
+        name="Adaptive Sampling Threshold",
+        description="Noise level at which a pixel stops being sampled, lower values give less noise and longer renders",
+        min=0.0, max=1.0,
+        soft_min=0.001,
+        default=0.01,
+        precision=4,
+    )
+    adaptive_min_samples: IntProperty(
+        name="Adaptive Min Samples",
+        description="Minimum number of samples taken by every pixel, before testing whether it converged",
+        min=1, max=4096,
+        default=16,
+    )
+
     sampling_pattern: EnumProperty(
         name="Sampling Pattern",
         description="Random sampling pattern used by the integrator",
@@ -295,6 +316,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         min=0.0, max=1.0,
         default=0.01,
     )
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Pick lights by their estimated contribution to the shading point, faster to converge in scenes "
+        "with many lights. Not used when sampling all lights",
+        default=False,
+    )
 
     caustics_reflective: BoolProperty(
         name="Reflective Caustics",
@@ -553,6 +580,20 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=0,
         min=0, max=16,
     )
+    use_bvh_refit: BoolProperty(
+        name="Refit BVH",
+        description="Update the bounds of the scene BVH instead of rebuilding it, when only vertices "
+        "moved since the previous frame (needs Persistent Images for final renders, keeps a copy of "
+        "the BVH in memory)",
+        default=False,
+    )
+    bvh_refit_threshold: FloatProperty(
+        name="Rebuild Threshold",
+        description="Rebuild the BVH when refitting made it this many times more expensive to "
+        "traverse than when it was built, 0 always refits",
+        default=1.5,
+        min=0.0, soft_max=4.0,
+    )
     tile_order: EnumProperty(
         name="Tile Order",
         description="Tile order for rendering",
@@ -661,6 +702,20 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_texture_limit
     )
 
+    use_texture_cache: BoolProperty(
+        name="Texture Cache",
+        description="Read image files on demand while rendering, instead of loading them "
+        "into memory entirely (CPU only, untiled files are tiled on the fly)",
+        default=False,
+    )
+    texture_cache_size: IntProperty(
+        name="Cache Size",
+        description="Memory budget of the texture cache in megabytes, least recently used tiles "
+        "are evicted to stay within it",
+        min=16, max=1048576,
+        default=4096,
+    )
+
     ao_bounces: IntProperty(
         name="AO Bounces",
         default=0,
@@ -693,6 +748,11 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default='BVH8',
     )
     debug_use_cpu_split_kernel: BoolProperty(name="Split Kernel", default=False)
+    debug_use_cpu_packet_traversal: BoolProperty(
+        name="Packet Traversal",
+        description="Trace camera rays in packets of 8 rays, on CPUs with AVX2 (not used for baking)",
+        default=False,
+    )
 
     debug_use_cuda_adaptive_compile: BoolProperty(name="Adaptive Compile", default=False)
     debug_use_cuda_split_kernel: BoolProperty(name="Split Kernel", default=False)
@@ -1268,6 +1328,12 @@ class CyclesRenderLayerSettings(bpy.types.PropertyGroup):
         default=False,
         update=update_render_passes,
     )
+    pass_debug_sample_count: BoolProperty(
+        name="Debug Sample Count",
+        description="Number of samples taken by each pixel, when using adaptive sampling",
+        default=False,
+        update=update_render_passes,
+    )
     use_pass_volume_direct: BoolProperty(
         name="Volume Direct",
         description="Deliver direct volumetric scattering pass",
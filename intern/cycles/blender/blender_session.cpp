@@ -422,6 +422,14 @@ void BlenderSession::stamp_view_layer_metadata(Scene *scene, const string& view_
 		        to_string(session->tile_manager.range_num_samples).c_str());
 	}
 
+	/* Store average number of samples per pixel taken with adaptive sampling. */
+	const float adaptive_samples = session->progress.get_adaptive_samples();
+	if(adaptive_samples > 0.0f) {
+		b_rr.stamp_data_add_field(
+		        (prefix + "effective_samples").c_str(),
+		        string_printf("%.2f", adaptive_samples).c_str());
+	}
+
 	/* Write cryptomatte metadata. */
 	if(scene->film->cryptomatte_passes & CRYPT_OBJECT) {
 		add_cryptomatte_layer(b_rr, view_layer_name + ".CryptoObject",
@@ -280,6 +280,10 @@ void BlenderSync::sync_integrator()
 	integrator->sample_all_lights_direct = get_boolean(cscene, "sample_all_lights_direct");
 	integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
 	integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
+	integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+
+	integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+	integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
 
 	int diffuse_samples = get_int(cscene, "diffuse_samples");
 	int glossy_samples = get_int(cscene, "glossy_samples");
@@ -471,6 +475,7 @@ PassType BlenderSync::get_pass_type(BL::RenderPass& b_pass)
 	MAP_PASS("Debug Ray Bounces", PASS_RAY_BOUNCES);
 #endif
 	MAP_PASS("Debug Render Time", PASS_RENDER_TIME);
+	MAP_PASS("Debug Sample Count", PASS_SAMPLE_COUNT);
 	if(string_startswith(name, cryptomatte_prefix)) {
 		return PASS_CRYPTOMATTE;
 	}
@@ -576,6 +581,10 @@ vector<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 		Pass::add(PASS_RAY_BOUNCES, passes);
 	}
 #endif
+	if(session_params.adaptive_sampling) {
+		Pass::add(PASS_ADAPTIVE_AUX_BUFFER, passes);
+		Pass::add(PASS_SAMPLE_COUNT, passes);
+	}
 	if(get_boolean(crp, "pass_debug_render_time")) {
 		b_engine.add_pass("Debug Render Time", 1, "X", b_view_layer.name().c_str());
 		Pass::add(PASS_RENDER_TIME, passes);
@@ -672,6 +681,8 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_unaligned_nodes = RNA_boolean_get(&cscene, "debug_use_hair_bvh");
 	params.num_bvh_time_steps = RNA_int_get(&cscene, "debug_bvh_time_steps");
+	params.use_bvh_refit = RNA_boolean_get(&cscene, "use_bvh_refit");
+	params.bvh_refit_threshold = RNA_float_get(&cscene, "bvh_refit_threshold");
 
 	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
 		params.persistent_data = r.use_persistent_data();
@@ -692,6 +703,13 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.texture_limit = 0;
 	}
 
+	if(RNA_boolean_get(&cscene, "use_texture_cache")) {
+		params.texture_cache_size = RNA_int_get(&cscene, "texture_cache_size");
+	}
+	else {
+		params.texture_cache_size = 0;
+	}
+
 	/* TODO(sergey): Once OSL supports per-microarchitecture optimization get
 	 * rid of this.
 	 */
@@ -831,6 +849,13 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 	else
 		params.progressive = true;
 
+	/* Progressive rendering goes over all tiles for every sample, a tile
+	 * doesn't know whether it is done before the last one. The convergence
+	 * test only runs on the CPU, GPU devices always take all samples. */
+	params.adaptive_sampling = get_boolean(cscene, "use_adaptive_sampling") &&
+	                           !params.progressive &&
+	                           params.device.type == DEVICE_CPU;
+
 	/* shading system - scene level needs full refresh */
 	const bool shadingsystem = RNA_boolean_get(&cscene, "shading_system");
 
@@ -172,7 +172,9 @@ void BVH::build(Progress& progress, Stats*)
 void BVH::refit(Progress& progress)
 {
 	progress.set_substatus("Packing BVH primitives");
-	pack_primitives();
+	/* Primitive indices of the top level BVH point into the global arrays
+	 * since the instances were packed. */
+	pack_primitives(params.top_level);
 
 	if(progress.get_cancel()) return;
 
@@ -180,6 +182,32 @@ void BVH::refit(Progress& progress)
 	refit_nodes();
 }
 
+float BVH::leaf_cost()
+{
+	BoundBox bounds = BoundBox::empty;
+	double cost = 0.0;
+
+	/* Leaves are stored as a single int4 in all layouts. */
+	for(size_t i = 0; i < pack.leaf_nodes.size(); i++) {
+		const int4 c = pack.leaf_nodes[i];
+
+		/* Skip object instances. */
+		if(c.x < 0 || c.x >= c.y) {
+			continue;
+		}
+
+		BoundBox leaf_bounds = BoundBox::empty;
+		uint visibility = 0;
+		refit_primitives(c.x, c.y, leaf_bounds, visibility);
+
+		cost += (double)leaf_bounds.safe_area() * (c.y - c.x);
+		bounds.grow(leaf_bounds);
+	}
+
+	const float area = bounds.safe_area();
+	return (area > 0.0f)? (float)(cost / (double)area): 0.0f;
+}
+
 void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
 {
 	/* Refit range of primitives. */
@@ -250,13 +278,13 @@ void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
 
 /* Triangles */
 
-void BVH::pack_triangle(int idx, float4 tri_verts[3])
+void BVH::pack_triangle(int idx, int tri_offset, float4 tri_verts[3])
 {
 	int tob = pack.prim_object[idx];
 	assert(tob >= 0 && tob < objects.size());
 	const Mesh *mesh = objects[tob]->mesh;
 
-	int tidx = pack.prim_index[idx];
+	int tidx = pack.prim_index[idx] - tri_offset;
 	Mesh::Triangle t = mesh->get_triangle(tidx);
 	const float3 *vpos = &mesh->verts[0];
 	float3 v0 = vpos[t.v[0]];
@@ -268,7 +296,7 @@ void BVH::pack_triangle(int idx, float4 tri_verts[3])
 	tri_verts[2] = float3_to_float4(v2);
 }
 
-void BVH::pack_primitives()
+void BVH::pack_primitives(bool global_prim_index)
 {
 	const size_t tidx_size = pack.prim_index.size();
 	size_t num_prim_triangles = 0;
@@ -294,7 +322,8 @@ void BVH::pack_primitives()
 			int tob = pack.prim_object[i];
 			Object *ob = objects[tob];
 			if((pack.prim_type[i] & PRIMITIVE_ALL_TRIANGLE) != 0) {
-				pack_triangle(i, (float4*)&pack.prim_tri_verts[3 * prim_triangle_index]);
+				int tri_offset = (global_prim_index)? ob->mesh->tri_offset: 0;
+				pack_triangle(i, tri_offset, (float4*)&pack.prim_tri_verts[3 * prim_triangle_index]);
 				pack.prim_tri_index[i] = 3 * prim_triangle_index;
 				++prim_triangle_index;
 			}
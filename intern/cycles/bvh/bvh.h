@@ -94,6 +94,10 @@ public:
 	virtual void build(Progress& progress, Stats *stats=NULL);
 	void refit(Progress& progress);
 
+	/* Surface area cost of the leaves relative to the bounds of the BVH,
+	 * grows when refitting to primitives that moved apart. */
+	float leaf_cost();
+
 protected:
 	BVH(const BVHParams& params, const vector<Object*>& objects);
 
@@ -101,8 +105,8 @@ protected:
 	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
 
 	/* triangles and strands */
-	void pack_primitives();
-	void pack_triangle(int idx, float4 storage[3]);
+	void pack_primitives(bool global_prim_index = false);
+	void pack_triangle(int idx, int tri_offset, float4 storage[3]);
 
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
@@ -380,7 +380,7 @@ Device *Device::create(DeviceInfo& info, Stats &stats, Profiler &profiler, bool
 #endif
 #ifdef WITH_NETWORK
 		case DEVICE_NETWORK:
-			device = device_network_create(info, stats, profiler, "127.0.0.1");
+			device = device_network_create(info, stats, profiler, NULL);
 			break;
 #endif
 #ifdef WITH_OPENCL
@@ -554,6 +554,7 @@ DeviceInfo Device::get_multi_device(const vector<DeviceInfo>& subdevices, int th
 	info.num = 0;
 
 	info.has_half_images = true;
+	info.has_sparse_grids = true;
 	info.has_volume_decoupled = true;
 	info.has_osl = true;
 	info.has_profiling = true;
@@ -589,6 +590,7 @@ DeviceInfo Device::get_multi_device(const vector<DeviceInfo>& subdevices, int th
 
 		/* Accumulate device info. */
 		info.has_half_images &= device.has_half_images;
+		info.has_sparse_grids &= device.has_sparse_grids;
 		info.has_volume_decoupled &= device.has_volume_decoupled;
 		info.has_osl &= device.has_osl;
 		info.has_profiling &= device.has_profiling;
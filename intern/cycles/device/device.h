@@ -67,6 +67,7 @@ public:
 	bool display_device;            /* GPU is used as a display device. */
 	bool advanced_shading;          /* Supports full shading system. */
 	bool has_half_images;           /* Support half-float textures. */
+	bool has_sparse_grids;          /* Support 3D textures stored as sparse tiles. */
 	bool has_volume_decoupled;      /* Decoupled volume shading. */
 	bool has_osl;                   /* Support Open Shading Language. */
 	bool use_split_kernel;          /* Use split or mega kernel. */
@@ -83,6 +84,7 @@ public:
 		display_device = false;
 		advanced_shading = true;
 		has_half_images = false;
+		has_sparse_grids = false;
 		has_volume_decoupled = false;
 		has_osl = false;
 		use_split_kernel = false;
@@ -347,8 +349,8 @@ public:
 	    bool transparent, const DeviceDrawParams &draw_params);
 
 #ifdef WITH_NETWORK
-	/* networking */
-	void server_run();
+	/* networking, port 0 uses the default server port */
+	void server_run(int port = 0);
 #endif
 
 	/* multi device */
@@ -382,6 +384,12 @@ protected:
 
 	virtual void mem_alloc(device_memory& mem) = 0;
 	virtual void mem_copy_to(device_memory& mem) = 0;
+	/* Copy a byte range of host memory already on the device. Devices
+	 * without support for it copy all memory. */
+	virtual void mem_copy_to_range(device_memory& mem, size_t /*offset*/, size_t /*size*/)
+	{
+		mem_copy_to(mem);
+	}
 	virtual void mem_copy_from(device_memory& mem,
 		int y, int w, int h, int elem) = 0;
 	virtual void mem_zero(device_memory& mem) = 0;
@@ -166,16 +166,23 @@ public:
 
 	device_vector<TextureInfo> texture_info;
 	bool need_texture_info;
+	int texture_cache_users;
 
 #ifdef WITH_OSL
 	OSLGlobals osl_globals;
 #endif
 
 	bool use_split_kernel;
+	bool use_packet_traversal;
 
 	DeviceRequestedFeatures requested_features;
 
 	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>             path_trace_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int, int)>        path_trace_packet_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int)>                  adaptive_stopping_kernel;
+	KernelFunctions<bool(*)(KernelGlobals *, float *, int, int, int, int, int)>             adaptive_filter_x_kernel;
+	KernelFunctions<bool(*)(KernelGlobals *, float *, int, int, int, int, int)>             adaptive_filter_y_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>             adaptive_adjust_samples_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_half_float_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_byte_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uint4 *, float4 *, int, int, int, int, int)>   shader_kernel;
@@ -214,6 +221,11 @@ public:
 	  texture_info(this, "__texture_info", MEM_TEXTURE),
 #define REGISTER_KERNEL(name) name ## _kernel(KERNEL_FUNCTIONS(name))
 	  REGISTER_KERNEL(path_trace),
+	  REGISTER_KERNEL(path_trace_packet),
+	  REGISTER_KERNEL(adaptive_stopping),
+	  REGISTER_KERNEL(adaptive_filter_x),
+	  REGISTER_KERNEL(adaptive_filter_y),
+	  REGISTER_KERNEL(adaptive_adjust_samples),
 	  REGISTER_KERNEL(convert_to_half_float),
 	  REGISTER_KERNEL(convert_to_byte),
 	  REGISTER_KERNEL(shader),
@@ -240,10 +252,16 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		kernel_globals.texture_system = NULL;
+		texture_cache_users = 0;
 		use_split_kernel = DebugFlags().cpu.split_kernel;
 		if(use_split_kernel) {
 			VLOG(1) << "Will be using split kernel.";
 		}
+		use_packet_traversal = DebugFlags().cpu.packet_traversal;
+		if(use_packet_traversal) {
+			VLOG(1) << "Will be using packet traversal for camera rays.";
+		}
 		need_texture_info = false;
 
 #define REGISTER_SPLIT_KERNEL(name) split_kernels[#name] = KernelFunctions<void(*)(KernelGlobals*, KernelData*)>(KERNEL_FUNCTIONS(name))
@@ -347,6 +365,15 @@ public:
 		}
 	}
 
+	void mem_copy_to_range(device_memory& mem, size_t /*offset*/, size_t /*size*/)
+	{
+		if(mem.type == MEM_TEXTURE && mem.interpolation != INTERPOLATION_NONE) {
+			mem_copy_to(mem);
+		}
+
+		/* Kernel reads host memory directly, copy is no-op. */
+	}
+
 	void mem_copy_from(device_memory& /*mem*/,
 	                   int /*y*/, int /*w*/, int /*h*/,
 	                   int /*elem*/)
@@ -428,6 +455,18 @@ public:
 			info.width = mem.data_width;
 			info.height = mem.data_height;
 			info.depth = mem.data_depth;
+			info.use_texture_cache = 0;
+			info.sparse_grid = mem.sparse_grid;
+			info.ignore_alpha = 0;
+
+			if(mem.texture_handle) {
+				/* Pixels are read on demand by the kernel. */
+				info.data = (uint64_t)mem.texture_handle;
+				info.use_texture_cache = 1;
+				info.ignore_alpha = mem.texture_ignore_alpha;
+				kernel_globals.texture_system = (OIIO::TextureSystem*)mem.texture_system;
+				texture_cache_users++;
+			}
 
 			need_texture_info = true;
 		}
@@ -440,6 +479,9 @@ public:
 	void tex_free(device_memory& mem)
 	{
 		if(mem.device_pointer) {
+			if(mem.texture_handle && --texture_cache_users == 0) {
+				kernel_globals.texture_system = NULL;
+			}
 			mem.device_pointer = 0;
 			stats.mem_free(mem.device_size);
 			mem.device_size = 0;
@@ -746,9 +788,53 @@ public:
 		return true;
 	}
 
+	/* Flag converged pixels, returns true if all pixels of the tile converged. */
+	bool adaptive_sampling_filter(KernelGlobals *kg, RenderTile &tile)
+	{
+		float *render_buffer = (float*)tile.buffer;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				adaptive_stopping_kernel()(kg, render_buffer, x, y, tile.offset, tile.stride);
+			}
+		}
+
+		bool any = false;
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			any |= adaptive_filter_x_kernel()(kg, render_buffer, y, tile.x, tile.w, tile.offset, tile.stride);
+		}
+		if(any) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				adaptive_filter_y_kernel()(kg, render_buffer, x, tile.y, tile.h, tile.offset, tile.stride);
+			}
+		}
+
+		return !any;
+	}
+
+	/* Scale pixels that stopped early up to the sample count of the tile. */
+	void adaptive_sampling_post(KernelGlobals *kg, RenderTile &tile)
+	{
+		float *render_buffer = (float*)tile.buffer;
+		const int pass_stride = kernel_data.film.pass_stride;
+		const int pass_sample_count = kernel_data.film.pass_sample_count;
+
+		tile.pixel_samples = 0;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				const int index = tile.offset + x + y*tile.stride;
+				tile.pixel_samples += (uint64_t)render_buffer[index*pass_stride + pass_sample_count];
+
+				adaptive_adjust_samples_kernel()(kg, render_buffer, tile.sample, x, y, tile.offset, tile.stride);
+			}
+		}
+	}
+
 	void path_trace(DeviceTask &task, RenderTile &tile, KernelGlobals *kg)
 	{
 		const bool use_coverage = kernel_data.film.cryptomatte_passes & CRYPT_ACCURATE;
+		const bool use_adaptive_sampling = kernel_data.film.pass_adaptive_aux_buffer != 0;
 
 		scoped_timer timer(&tile.buffers->render_time);
 
@@ -771,6 +857,14 @@ public:
 			}
 
 			for(int y = tile.y; y < tile.y + tile.h; y++) {
+				/* Cryptomatte coverage is gathered per pixel, so it can't
+				 * be used with packets spanning multiple pixels. */
+				if(use_packet_traversal && !use_coverage) {
+					path_trace_packet_kernel()(kg, render_buffer,
+					                           sample, tile.x, y, tile.w, tile.offset, tile.stride);
+					continue;
+				}
+
 				for(int x = tile.x; x < tile.x + tile.w; x++) {
 					if(use_coverage) {
 						coverage.init_pixel(x, y);
@@ -782,11 +876,28 @@ public:
 
 			tile.sample = sample + 1;
 
+			/* Convergence is tested at fixed sample numbers, for the result
+			 * to be the same no matter how the tiles are scheduled. */
+			if(use_adaptive_sampling &&
+			   tile.sample >= kernel_data.integrator.adaptive_min_samples &&
+			   tile.sample % kernel_data.integrator.adaptive_step == 0)
+			{
+				if(adaptive_sampling_filter(kg, tile)) {
+					/* All pixels converged, the remaining samples are done. */
+					tile.sample = end_sample;
+					task.update_progress(&tile, tile.w*tile.h*(end_sample - sample));
+					break;
+				}
+			}
+
 			task.update_progress(&tile, tile.w*tile.h);
 		}
 		if(use_coverage) {
 			coverage.finalize();
 		}
+		if(use_adaptive_sampling) {
+			adaptive_sampling_post(kg, tile);
+		}
 	}
 
 	void denoise(DenoisingTask& denoising, RenderTile &tile)
@@ -969,6 +1080,7 @@ protected:
 		}
 		kg.decoupled_volume_steps_index = 0;
 		kg.coverage_asset = kg.coverage_object = kg.coverage_material = NULL;
+		kg.texture_thread_info = (kg.texture_system)? kg.texture_system->get_perthread_info(): NULL;
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
@@ -1127,6 +1239,7 @@ void device_cpu_info(vector<DeviceInfo>& devices)
 	info.has_volume_decoupled = true;
 	info.has_osl = true;
 	info.has_half_images = true;
+	info.has_sparse_grids = true;
 	info.has_profiling = true;
 
 	devices.insert(devices.begin(), info);
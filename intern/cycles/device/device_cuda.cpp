@@ -947,6 +947,22 @@ public:
 		}
 	}
 
+	void mem_copy_to_range(device_memory& mem, size_t offset, size_t size)
+	{
+		/* Image textures are stored in arrays, copy all of them. */
+		if(mem.type == MEM_PIXELS ||
+		   (mem.type == MEM_TEXTURE && mem.interpolation != INTERPOLATION_NONE))
+		{
+			mem_copy_to(mem);
+		}
+		else if(mem.host_pointer != mem.shared_pointer) {
+			CUDAContextScope scope(this);
+			cuda_assert(cuMemcpyHtoD(cuda_device_ptr(mem.device_pointer) + offset,
+			                         (char*)mem.host_pointer + offset,
+			                         size));
+		}
+	}
+
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
 	{
 		if(mem.type == MEM_PIXELS && !background) {
@@ -1227,6 +1243,9 @@ public:
 		info.width = mem.data_width;
 		info.height = mem.data_height;
 		info.depth = mem.data_depth;
+		info.use_texture_cache = 0;
+		info.sparse_grid = 0;
+		info.ignore_alpha = 0;
 		need_texture_info = true;
 	}
 
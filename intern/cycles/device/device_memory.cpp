@@ -33,6 +33,10 @@ device_memory::device_memory(Device *device, const char *name, MemoryType type)
   name(name),
   interpolation(INTERPOLATION_NONE),
   extension(EXTENSION_REPEAT),
+  texture_system(NULL),
+  texture_handle(NULL),
+  texture_ignore_alpha(false),
+  sparse_grid(false),
   device(device),
   device_pointer(0),
   host_pointer(0),
@@ -91,6 +95,18 @@ void device_memory::device_copy_to()
 	}
 }
 
+void device_memory::device_copy_to(size_t offset, size_t size)
+{
+	if(host_pointer) {
+		if(device_pointer) {
+			device->mem_copy_to_range(*this, offset, size);
+		}
+		else {
+			device->mem_copy_to(*this);
+		}
+	}
+}
+
 void device_memory::device_copy_from(int y, int w, int h, int elem)
 {
 	assert(type != MEM_TEXTURE && type != MEM_READ_ONLY);
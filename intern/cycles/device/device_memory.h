@@ -205,6 +205,16 @@ public:
 	InterpolationType interpolation;
 	ExtensionType extension;
 
+	/* Image texture read on demand through a texture cache rather than from
+	 * host memory, only supported by the CPU device. */
+	void *texture_system;
+	void *texture_handle;
+	bool texture_ignore_alpha;
+
+	/* 3D image stored as sparse tiles, see util_texture.h. Dimensions are
+	 * those of the dense image. Only supported by the CPU device. */
+	bool sparse_grid;
+
 	/* Pointers. */
 	Device *device;
 	device_ptr device_pointer;
@@ -236,6 +246,7 @@ protected:
 	void device_alloc();
 	void device_free();
 	void device_copy_to();
+	void device_copy_to(size_t offset, size_t size);
 	void device_copy_from(int y, int w, int h, int elem);
 	void device_zero();
 
@@ -421,6 +432,14 @@ public:
 		device_copy_to();
 	}
 
+	/* Copy only a range of elements, when the rest of the memory on the
+	 * device is already up to date. */
+	void copy_to_device(size_t offset, size_t num)
+	{
+		assert(offset + num <= data_size);
+		device_copy_to(offset*sizeof(T), num*sizeof(T));
+	}
+
 	void copy_from_device(int y, int w, int h)
 	{
 		device_copy_from(y, w, h, sizeof(T));
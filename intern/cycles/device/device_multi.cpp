@@ -62,16 +62,23 @@ public:
 		}
 
 #ifdef WITH_NETWORK
-		/* try to add network devices */
-		ServerDiscovery discovery(true);
-		time_sleep(1.0);
+		/* try to add network devices, unless servers were given explicitly */
+		bool have_network_devices = false;
+		foreach(DeviceInfo& subinfo, info.multi_devices) {
+			have_network_devices |= (subinfo.type == DEVICE_NETWORK);
+		}
 
-		vector<string> servers = discovery.get_server_list();
+		if(!have_network_devices) {
+			ServerDiscovery discovery(true);
+			time_sleep(1.0);
 
-		foreach(string& server, servers) {
-			Device *device = device_network_create(info, stats, profiler, server.c_str());
-			if(device)
-				devices.push_back(SubDevice(device));
+			vector<string> servers = discovery.get_server_list();
+
+			foreach(string& server, servers) {
+				Device *device = device_network_create(info, stats, profiler, server.c_str());
+				if(device)
+					devices.push_back(SubDevice(device));
+			}
 		}
 #endif
 	}
@@ -158,6 +165,25 @@ public:
 		stats.mem_alloc(mem.device_size - existing_size);
 	}
 
+	void mem_copy_to_range(device_memory& mem, size_t offset, size_t size)
+	{
+		device_ptr key = mem.device_pointer;
+		size_t existing_size = mem.device_size;
+
+		foreach(SubDevice& sub, devices) {
+			mem.device = sub.device;
+			mem.device_pointer = sub.ptr_map[key];
+			mem.device_size = existing_size;
+
+			sub.device->mem_copy_to_range(mem, offset, size);
+			sub.ptr_map[key] = mem.device_pointer;
+		}
+
+		mem.device = this;
+		mem.device_pointer = key;
+		stats.mem_alloc(mem.device_size - existing_size);
+	}
+
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
 	{
 		device_ptr key = mem.device_pointer;
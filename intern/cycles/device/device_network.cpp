@@ -20,6 +20,10 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_murmurhash.h"
+#include "util/util_set.h"
+#include "util/util_string.h"
+#include "util/util_thread.h"
 
 #if defined(WITH_NETWORK)
 
@@ -32,6 +36,13 @@ typedef map<device_ptr, DataVector> DataMap;
 /* tile list */
 typedef vector<RenderTile> TileList;
 
+/* buffers smaller than this are always sent, the cache query round trip
+ * is not worth it for them */
+static const size_t NETWORK_CACHE_MIN_SIZE = 64 * 1024;
+
+/* memory a server spends on keeping scene data for later clients */
+static const size_t SERVER_CACHE_SIZE = (size_t)1024 * 1024 * 1024;
+
 /* search a list of tiles and find the one that matches the passed render tile */
 static TileList::iterator tile_list_find(TileList& tile_list, RenderTile& tile)
 {
@@ -41,6 +52,45 @@ static TileList::iterator tile_list_find(TileList& tile_list, RenderTile& tile)
 	return tile_list.end();
 }
 
+/* buffer index of the first pixel in row y of a tile */
+static int tile_row_index(const RenderTile& tile, int y)
+{
+	return tile.offset + tile.x + (tile.y + y)*tile.stride;
+}
+
+/* content hash of a buffer, two murmur hashes with different seeds to make
+ * collisions between different scene data practically impossible */
+static uint64_t network_data_hash(const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t*)data;
+	const size_t chunk_size = (size_t)1 << 30;
+	uint32_t a = (uint32_t)size;
+	uint32_t b = (uint32_t)(size >> 32) ^ 0x9e3779b9;
+
+	for(size_t offset = 0; offset < size; offset += chunk_size) {
+		int len = (int)((size - offset < chunk_size)? size - offset: chunk_size);
+		a = util_murmur_hash3(bytes + offset, len, a);
+		b = util_murmur_hash3(bytes + offset, len, b);
+	}
+
+	return ((uint64_t)a << 32) | b;
+}
+
+/* split host[:port] into its parts, using the default server port if none is given */
+static void network_split_address(const string& address, string& host, string& port)
+{
+	size_t pos = address.rfind(':');
+
+	if(pos == string::npos) {
+		host = address;
+		port = string_printf("%d", SERVER_PORT);
+	}
+	else {
+		host = address.substr(0, pos);
+		port = address.substr(pos + 1);
+	}
+}
+
 class NetworkDevice : public Device
 {
 public:
@@ -49,22 +99,45 @@ public:
 	device_ptr mem_counter;
 	DeviceTask the_task; /* todo: handle multiple tasks */
 
+	/* Held for every request along with its response, so that no other
+	 * thread writes to or reads from the socket in between. */
 	thread_mutex rpc_lock;
 
+	/* Tiles are serviced in their own thread, so that multiple network
+	 * devices in a multi device all render at the same time. While the
+	 * task is active, this thread is the only one receiving from the socket
+	 * and the server only answers tile requests. */
+	thread *task_thread;
+	bool task_active;
+
+	/* Hash of the data last uploaded for read only buffers, to skip
+	 * uploads of scene data that did not change. */
+	map<device_ptr, uint64_t> mem_hash;
+
+	/* Released tiles whose pixels were sent along with the release, by
+	 * render buffer. Reading back rows covered by them needs no round trip
+	 * to the server. Index and width are in floats. */
+	struct SyncedTile {
+		int index, w, h;
+	};
+	map<device_ptr, vector<SyncedTile> > mem_host_synced;
+	thread_mutex mem_host_synced_lock;
+
 	virtual bool show_samples() const
 	{
 		return false;
 	}
 
 	NetworkDevice(DeviceInfo& info, Stats &stats, Profiler &profiler, const char *address)
-	: Device(info, stats, profiler, true), socket(io_service)
+	: Device(info, stats, profiler, true), socket(io_service), task_thread(NULL), task_active(false)
 	{
 		error_func = NetworkError();
-		stringstream portstr;
-		portstr << SERVER_PORT;
+
+		string host, port;
+		network_split_address(address, host, port);
 
 		tcp::resolver resolver(io_service);
-		tcp::resolver::query query(address, portstr.str());
+		tcp::resolver::query query(host, port);
 		tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
 		tcp::resolver::iterator end;
 
@@ -77,12 +150,18 @@ public:
 
 		if(error)
 			error_func.network_error(error.message());
+		else
+			socket.set_option(tcp::no_delay(true));
+
+		VLOG(1) << "Connected to render server " << host << ":" << port;
 
 		mem_counter = 0;
 	}
 
 	~NetworkDevice()
 	{
+		task_wait();
+
 		RPCSend snd(socket, &error_func, "stop");
 		snd.write();
 	}
@@ -91,6 +170,61 @@ public:
 		return BVH_LAYOUT_BVH2;
 	}
 
+	void mem_host_synced_erase(device_ptr pointer)
+	{
+		thread_scoped_lock synced_lock(mem_host_synced_lock);
+		mem_host_synced.erase(pointer);
+	}
+
+	/* Tile is rendered again, its pixels on the client are outdated. */
+	void mem_host_synced_erase(const RenderTile& tile, int pass_stride)
+	{
+		thread_scoped_lock synced_lock(mem_host_synced_lock);
+		vector<SyncedTile>& tiles = mem_host_synced[tile.buffer];
+		const int index = tile_row_index(tile, 0) * pass_stride;
+
+		for(size_t i = 0; i < tiles.size(); i++) {
+			if(tiles[i].index == index) {
+				tiles.erase(tiles.begin() + i);
+				break;
+			}
+		}
+	}
+
+	void mem_host_synced_insert(const RenderTile& tile, int pass_stride)
+	{
+		thread_scoped_lock synced_lock(mem_host_synced_lock);
+		SyncedTile synced = {tile_row_index(tile, 0) * pass_stride, tile.w * pass_stride, tile.h};
+		mem_host_synced[tile.buffer].push_back(synced);
+	}
+
+	/* Check whether rows y to y + h of a buffer with rows of the given
+	 * width are fully covered by released tiles. */
+	bool mem_host_synced_covers(device_ptr pointer, int y, int h, int width)
+	{
+		thread_scoped_lock synced_lock(mem_host_synced_lock);
+		map<device_ptr, vector<SyncedTile> >::iterator it = mem_host_synced.find(pointer);
+		if(it == mem_host_synced.end() || width == 0) {
+			return false;
+		}
+
+		for(int row = y; row < y + h; row++) {
+			int covered = 0;
+			foreach(const SyncedTile& synced, it->second) {
+				const int first_row = synced.index / width;
+				const int x = synced.index - first_row * width;
+				if(row >= first_row && row < first_row + synced.h) {
+					covered += min(synced.w, width - x);
+				}
+			}
+			if(covered < width) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	void mem_alloc(device_memory& mem)
 	{
 		if(mem.name) {
@@ -110,19 +244,68 @@ public:
 
 	void mem_copy_to(device_memory& mem)
 	{
+		size_t data_size = mem.memory_size();
+		bool read_only = (mem.type == MEM_READ_ONLY || mem.type == MEM_TEXTURE);
+		uint64_t hash = (read_only)? network_data_hash(mem.host_pointer, data_size): 0;
+
 		thread_scoped_lock lock(rpc_lock);
 
+		if(mem.device_pointer) {
+			mem_host_synced_erase(mem.device_pointer);
+
+			/* The server still has this data, nothing to send. */
+			map<device_ptr, uint64_t>::iterator it = mem_hash.find(mem.device_pointer);
+			if(read_only && it != mem_hash.end() && it->second == hash) {
+				return;
+			}
+		}
+		else {
+			mem.device_pointer = ++mem_counter;
+		}
+
+		if(read_only) {
+			mem_hash[mem.device_pointer] = hash;
+		}
+
+		/* Ask whether the server already has the data from an earlier
+		 * session. Only done outside of tasks, while a task runs the server
+		 * can send tile requests at any time. */
+		bool query = read_only && data_size >= NETWORK_CACHE_MIN_SIZE && !task_active;
+
 		RPCSend snd(socket, &error_func, "mem_copy_to");
 
 		snd.add(mem);
+		snd.add(hash);
+		snd.add(query);
 		snd.write();
-		snd.write_buffer(mem.host_pointer, mem.memory_size());
+
+		bool send_data = true;
+
+		if(query) {
+			RPCReceive rcv(socket, &error_func);
+			rcv.read(send_data);
+		}
+
+		if(send_data) {
+			snd.write_buffer(mem.host_pointer, data_size);
+		}
 	}
 
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
 	{
+		/* Released tiles already brought the data along. */
+		if(mem_host_synced_covers(mem.device_pointer, y, h, w)) {
+			return;
+		}
+
 		thread_scoped_lock lock(rpc_lock);
 
+		if(task_active) {
+			/* The server would take the request for a tile request answer. */
+			VLOG(1) << "Network device can't read back unreleased tiles while rendering.";
+			return;
+		}
+
 		size_t data_size = mem.memory_size();
 
 		RPCSend snd(socket, &error_func, "mem_copy_from");
@@ -142,6 +325,14 @@ public:
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		if(mem.device_pointer) {
+			mem_host_synced_erase(mem.device_pointer);
+			mem_hash.erase(mem.device_pointer);
+		}
+		else {
+			mem.device_pointer = ++mem_counter;
+		}
+
 		RPCSend snd(socket, &error_func, "mem_zero");
 
 		snd.add(mem);
@@ -153,6 +344,9 @@ public:
 		if(mem.device_pointer) {
 			thread_scoped_lock lock(rpc_lock);
 
+			mem_host_synced_erase(mem.device_pointer);
+			mem_hash.erase(mem.device_pointer);
+
 			RPCSend snd(socket, &error_func, "mem_free");
 
 			snd.add(mem);
@@ -181,13 +375,13 @@ public:
 		if(error_func.have_error())
 			return false;
 
+		/* No kernels can be loaded while a task is being rendered. */
+		task_wait();
+
 		thread_scoped_lock lock(rpc_lock);
 
 		RPCSend snd(socket, &error_func, "load_kernels");
-		snd.add(requested_features.experimental);
-		snd.add(requested_features.max_closure);
-		snd.add(requested_features.max_nodes_group);
-		snd.add(requested_features.nodes_features);
+		snd.add(requested_features);
 		snd.write();
 
 		bool result;
@@ -199,94 +393,123 @@ public:
 
 	void task_add(DeviceTask& task)
 	{
+		/* Only one task at a time can be serviced. */
+		task_wait();
+
 		thread_scoped_lock lock(rpc_lock);
 
 		the_task = task;
+		task_active = true;
 
 		RPCSend snd(socket, &error_func, "task_add");
 		snd.add(task);
 		snd.write();
+
+		/* Let the server start waiting right away, it only answers our
+		 * requests for data while doing so. */
+		RPCSend snd_wait(socket, &error_func, "task_wait");
+		snd_wait.write();
+
+		task_thread = new thread(function_bind(&NetworkDevice::task_service, this));
 	}
 
 	void task_wait()
 	{
-		thread_scoped_lock lock(rpc_lock);
+		if(task_thread) {
+			task_thread->join();
+			delete task_thread;
+			task_thread = NULL;
+		}
+	}
 
-		RPCSend snd(socket, &error_func, "task_wait");
+	void task_cancel()
+	{
+		thread_scoped_lock lock(rpc_lock);
+		RPCSend snd(socket, &error_func, "task_cancel");
 		snd.write();
+	}
 
-		lock.unlock();
+	int get_split_task_count(DeviceTask&)
+	{
+		return 1;
+	}
 
+protected:
+	/* Hand out tiles to the server and take finished ones back, until
+	 * the server reports the task as done. Tiles come from the same tile
+	 * manager as for all other devices, so faster servers simply acquire
+	 * more of them. */
+	void task_service()
+	{
 		TileList the_tiles;
 
-		/* todo: run this threaded for connecting to multiple clients */
 		for(;;) {
 			if(error_func.have_error())
 				break;
 
-			RenderTile tile;
-
-			lock.lock();
+			/* Only this thread receives while the task is active, so the
+			 * lock is only needed for the response. */
 			RPCReceive rcv(socket, &error_func);
 
 			if(rcv.name == "acquire_tile") {
-				lock.unlock();
+				RenderTile tile;
+
+				if(the_task.acquire_tile(this, tile)) {
+					int pass_stride = tile.buffers->params.get_passes_size();
 
-				/* todo: watch out for recursive calls! */
-				if(the_task.acquire_tile(this, tile)) { /* write return as bool */
 					the_tiles.push_back(tile);
+					mem_host_synced_erase(tile, pass_stride);
 
-					lock.lock();
+					thread_scoped_lock lock(rpc_lock);
 					RPCSend snd(socket, &error_func, "acquire_tile");
 					snd.add(tile);
+					snd.add(pass_stride);
 					snd.write();
-					lock.unlock();
 				}
 				else {
-					lock.lock();
+					thread_scoped_lock lock(rpc_lock);
 					RPCSend snd(socket, &error_func, "acquire_tile_none");
 					snd.write();
-					lock.unlock();
 				}
 			}
 			else if(rcv.name == "release_tile") {
+				RenderTile tile;
 				rcv.read(tile);
-				lock.unlock();
 
 				TileList::iterator it = tile_list_find(the_tiles, tile);
-				if(it != the_tiles.end()) {
-					tile.buffers = it->buffers;
-					the_tiles.erase(it);
+				if(it == the_tiles.end()) {
+					error_func.network_error("Network receive error: release of unknown tile");
+					break;
 				}
 
-				assert(tile.buffers != NULL);
+				tile.buffers = it->buffers;
+				tile.task = it->task;
+				tile.device_size = it->device_size;
+				the_tiles.erase(it);
+
+				/* The rendered pixels of the tile follow the release, copy them
+				 * straight into the host memory of the tile buffers. Only the
+				 * pixels of this tile are sent, other tiles of a shared buffer
+				 * may be rendered by other devices. */
+				device_vector<float>& buffer = tile.buffers->buffer;
+				size_t pass_stride = tile.buffers->params.get_passes_size();
+
+				for(int y = 0; y < tile.h; y++) {
+					float *row = buffer.data() + tile_row_index(tile, y) * pass_stride;
+					rcv.read_buffer(row, tile.w * pass_stride * sizeof(float));
+				}
 
-				the_task.release_tile(tile);
+				mem_host_synced_insert(tile, pass_stride);
 
-				lock.lock();
-				RPCSend snd(socket, &error_func, "release_tile");
-				snd.write();
-				lock.unlock();
+				the_task.release_tile(tile);
 			}
 			else if(rcv.name == "task_wait_done") {
-				lock.unlock();
 				break;
 			}
-			else
-				lock.unlock();
 		}
-	}
 
-	void task_cancel()
-	{
 		thread_scoped_lock lock(rpc_lock);
-		RPCSend snd(socket, &error_func, "task_cancel");
-		snd.write();
-	}
-
-	int get_split_task_count(DeviceTask&)
-	{
-		return 1;
+		task_active = false;
 	}
 
 private:
@@ -295,26 +518,114 @@ private:
 
 Device *device_network_create(DeviceInfo& info, Stats &stats, Profiler &profiler, const char *address)
 {
-	return new NetworkDevice(info, stats, profiler, address);
+	/* Servers from the device list carry their address in the device id. */
+	string server = "127.0.0.1";
+
+	if(address) {
+		server = address;
+	}
+	else if(string_startswith(info.id, "NETWORK_")) {
+		server = info.id.substr(strlen("NETWORK_"));
+	}
+
+	return new NetworkDevice(info, stats, profiler, server.c_str());
 }
 
 void device_network_info(vector<DeviceInfo>& devices)
 {
-	DeviceInfo info;
+	/* Render servers are given as a comma separated list of host[:port],
+	 * without it a single server on the local machine is used. */
+	vector<string> servers;
+	const char *servers_env = getenv("CYCLES_NETWORK_SERVERS");
+
+	if(servers_env) {
+		string_split(servers, servers_env, ",");
+	}
+
+	if(servers.empty()) {
+		servers.push_back("");
+	}
+
+	int num = 0;
+
+	foreach(const string& server, servers) {
+		DeviceInfo info;
+
+		info.type = DEVICE_NETWORK;
+		info.description = "Network Device";
+		info.id = "NETWORK";
+		info.num = num++;
 
-	info.type = DEVICE_NETWORK;
-	info.description = "Network Device";
-	info.id = "NETWORK";
-	info.num = 0;
+		if(server != "") {
+			info.description += " (" + server + ")";
+			info.id += "_" + server;
+		}
 
-	/* todo: get this info from device */
-	info.advanced_shading = true;
-	info.has_volume_decoupled = false;
-	info.has_osl = false;
+		/* todo: get this info from device */
+		info.advanced_shading = true;
+		info.has_volume_decoupled = false;
+		info.has_osl = false;
 
-	devices.push_back(info);
+		devices.push_back(info);
+	}
 }
 
+/* Scene data received by a server, by content hash. It outlives the client
+ * connections, so that rendering the same scene again does not transfer
+ * the data again. */
+class DataCache {
+public:
+	explicit DataCache(size_t max_size_)
+	: max_size(max_size_), size(0)
+	{
+	}
+
+	/* fill data with the cached content, data must already have the right size */
+	bool lookup(uint64_t hash, DataVector& data)
+	{
+		thread_scoped_lock lock(mutex);
+
+		map<uint64_t, DataVector>::iterator it = entries.find(hash);
+		if(it == entries.end() || it->second.size() != data.size())
+			return false;
+
+		if(data.size())
+			memcpy(&data[0], &it->second[0], data.size());
+
+		return true;
+	}
+
+	void insert(uint64_t hash, const DataVector& data)
+	{
+		if(data.size() > max_size)
+			return;
+
+		thread_scoped_lock lock(mutex);
+
+		if(entries.find(hash) != entries.end())
+			return;
+
+		/* drop the oldest entries until the new one fits */
+		while(size + data.size() > max_size) {
+			map<uint64_t, DataVector>::iterator it = entries.find(order.front());
+			size -= it->second.size();
+			entries.erase(it);
+			order.pop_front();
+		}
+
+		entries[hash] = data;
+		order.push_back(hash);
+		size += data.size();
+	}
+
+protected:
+	size_t max_size;
+	size_t size;
+	map<uint64_t, DataVector> entries;
+	std::deque<uint64_t> order;
+	thread_mutex mutex;
+};
+
 class DeviceServer {
 public:
 	thread_mutex rpc_lock;
@@ -325,8 +636,8 @@ public:
 
 	bool have_error() { return error_func.have_error(); }
 
-	DeviceServer(Device *device_, tcp::socket& socket_)
-	: device(device_), socket(socket_), stop(false), blocked_waiting(false)
+	DeviceServer(Device *device_, tcp::socket& socket_, DataCache& data_cache_)
+	: device(device_), socket(socket_), data_cache(data_cache_), stop(false), blocked_waiting(false)
 	{
 		error_func = NetworkError();
 	}
@@ -453,16 +764,20 @@ protected:
 		else if(rcv.name == "mem_copy_to") {
 			string name;
 			network_device_memory mem(device);
+			uint64_t hash;
+			bool query;
 			rcv.read(mem, name);
-			lock.unlock();
+			rcv.read(hash);
+			rcv.read(query);
 
 			size_t data_size = mem.memory_size();
 			device_ptr client_pointer = mem.device_pointer;
+			bool is_new = (mem_data.find(client_pointer) == mem_data.end());
 
-			if(client_pointer) {
+			if(!is_new) {
 				/* Lookup existing host side data buffer. */
 				DataVector &data_v = data_vector_find(client_pointer);
-				mem.host_pointer = (void*)&data_v[0];
+				mem.host_pointer = (data_size)? (void*)&data_v[0]: 0;
 
 				/* Translate the client pointer to a real device pointer. */
 				mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
@@ -471,15 +786,35 @@ protected:
 				/* Allocate host side data buffer. */
 				DataVector &data_v = data_vector_insert(client_pointer, data_size);
 				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
+				mem.device_pointer = 0;
+			}
+
+			DataVector &data_v = data_vector_find(client_pointer);
+			bool need_data = true;
+
+			if(query) {
+				/* Tell the client whether we still have this data. */
+				need_data = !data_cache.lookup(hash, data_v);
+
+				RPCSend snd(socket, &error_func, "mem_copy_to");
+				snd.add(need_data);
+				snd.write();
+			}
+
+			if(need_data) {
+				/* Copy data from network into memory buffer. */
+				rcv.read_buffer((uint8_t*)mem.host_pointer, data_size);
+
+				if(query)
+					data_cache.insert(hash, data_v);
 			}
 
-			/* Copy data from network into memory buffer. */
-			rcv.read_buffer((uint8_t*)mem.host_pointer, data_size);
+			lock.unlock();
 
 			/* Copy the data from the memory buffer to the device buffer. */
 			device->mem_copy_to(mem);
 
-			if(!client_pointer) {
+			if(is_new) {
 				/* Store a mapping to/from client_pointer and real device pointer. */
 				pointer_mapping_insert(client_pointer, mem.device_pointer);
 			}
@@ -500,7 +835,7 @@ protected:
 
 			DataVector &data_v = data_vector_find(client_pointer);
 
-			mem.host_pointer = (device_ptr)&(data_v[0]);
+			mem.host_pointer = (void*)&(data_v[0]);
 
 			device->mem_copy_from(mem, y, w, h, elem);
 
@@ -519,11 +854,12 @@ protected:
 
 			size_t data_size = mem.memory_size();
 			device_ptr client_pointer = mem.device_pointer;
+			bool is_new = (mem_data.find(client_pointer) == mem_data.end());
 
-			if(client_pointer) {
+			if(!is_new) {
 				/* Lookup existing host side data buffer. */
 				DataVector &data_v = data_vector_find(client_pointer);
-				mem.host_pointer = (void*)&data_v[0];
+				mem.host_pointer = (data_size)? (void*)&data_v[0]: 0;
 
 				/* Translate the client pointer to a real device pointer. */
 				mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
@@ -531,13 +867,14 @@ protected:
 			else {
 				/* Allocate host side data buffer. */
 				DataVector &data_v = data_vector_insert(client_pointer, data_size);
-				mem.host_pointer = (void*)? (device_ptr)&(data_v[0]): 0;
+				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
+				mem.device_pointer = 0;
 			}
 
 			/* Zero memory. */
 			device->mem_zero(mem);
 
-			if(!client_pointer) {
+			if(is_new) {
 				/* Store a mapping to/from client_pointer and real device pointer. */
 				pointer_mapping_insert(client_pointer, mem.device_pointer);
 			}
@@ -552,6 +889,7 @@ protected:
 			device_ptr client_pointer = mem.device_pointer;
 
 			mem.device_pointer = device_ptr_from_client_pointer_erase(client_pointer);
+			tile_pass_stride.erase(mem.device_pointer);
 
 			device->mem_free(mem);
 		}
@@ -570,10 +908,7 @@ protected:
 		}
 		else if(rcv.name == "load_kernels") {
 			DeviceRequestedFeatures requested_features;
-			rcv.read(requested_features.experimental);
-			rcv.read(requested_features.max_closure);
-			rcv.read(requested_features.max_nodes_group);
-			rcv.read(requested_features.nodes_features);
+			rcv.read(requested_features);
 
 			bool result;
 			result = device->load_kernels(requested_features);
@@ -631,6 +966,7 @@ protected:
 			AcquireEntry entry;
 			entry.name = rcv.name;
 			rcv.read(entry.tile);
+			rcv.read(entry.pass_stride);
 			acquire_queue.push_back(entry);
 			lock.unlock();
 		}
@@ -640,12 +976,6 @@ protected:
 			acquire_queue.push_back(entry);
 			lock.unlock();
 		}
-		else if(rcv.name == "release_tile") {
-			AcquireEntry entry;
-			entry.name = rcv.name;
-			acquire_queue.push_back(entry);
-			lock.unlock();
-		}
 		else {
 			cout << "Error: unexpected RPC receive call \"" + rcv.name + "\"\n";
 			lock.unlock();
@@ -658,8 +988,11 @@ protected:
 
 		bool result = false;
 
-		RPCSend snd(socket, &error_func, "acquire_tile");
-		snd.write();
+		{
+			thread_scoped_lock lock(rpc_lock);
+			RPCSend snd(socket, &error_func, "acquire_tile");
+			snd.write();
+		}
 
 		do {
 			if(blocked_waiting)
@@ -677,6 +1010,8 @@ protected:
 
 					if(tile.buffer) tile.buffer = ptr_map[tile.buffer];
 
+					tile_pass_stride[tile.buffer] = entry.pass_stride;
+
 					result = true;
 					break;
 				}
@@ -706,36 +1041,40 @@ protected:
 	{
 		thread_scoped_lock acquire_lock(acquire_mutex);
 
-		if(tile.buffer) tile.buffer = ptr_imap[tile.buffer];
+		/* Read back the rows of the tile, its pixels are sent along with the
+		 * release so the client needs no extra round trip to get them. */
+		device_ptr real_pointer = tile.buffer;
+		device_ptr client_pointer = ptr_imap[real_pointer];
+		DataVector &data_v = data_vector_find(client_pointer);
 
-		{
-			thread_scoped_lock lock(rpc_lock);
-			RPCSend snd(socket, &error_func, "release_tile");
-			snd.add(tile);
-			snd.write();
-			lock.unlock();
-		}
+		size_t pass_stride = tile_pass_stride[real_pointer];
+		size_t row_size = (size_t)tile.stride * pass_stride;
+		int row = tile_row_index(tile, 0) / tile.stride;
 
-		do {
-			if(blocked_waiting)
-				listen_step();
+		network_device_memory mem(device);
+		mem.data_type = TYPE_FLOAT;
+		mem.data_elements = 1;
+		mem.data_size = data_v.size() / sizeof(float);
+		mem.data_width = mem.data_size;
+		mem.device_pointer = real_pointer;
+		mem.host_pointer = (void*)&data_v[0];
 
-			/* todo: avoid busy wait loop */
-			thread_scoped_lock lock(rpc_lock);
+		device->mem_copy_from(mem, row, row_size, tile.h, sizeof(float));
 
-			if(!acquire_queue.empty()) {
-				AcquireEntry entry = acquire_queue.front();
-				acquire_queue.pop_front();
+		tile.buffer = client_pointer;
 
-				if(entry.name == "release_tile") {
-					lock.unlock();
-					break;
-				}
-				else {
-					cout << "Error: unexpected release RPC receive call \"" + entry.name + "\"\n";
-				}
-			}
-		} while(acquire_queue.empty() && !stop);
+		/* No acknowledgment is awaited, the render thread can go on with
+		 * its next tile while this one is still in flight. */
+		thread_scoped_lock lock(rpc_lock);
+		RPCSend snd(socket, &error_func, "release_tile");
+		snd.add(tile);
+		snd.write();
+
+		float *pixels = (float*)&data_v[0];
+		for(int y = 0; y < tile.h; y++) {
+			snd.write_buffer(pixels + tile_row_index(tile, y) * pass_stride,
+			                 tile.w * pass_stride * sizeof(float));
+		}
 	}
 
 	bool task_get_cancel()
@@ -755,8 +1094,15 @@ protected:
 	struct AcquireEntry {
 		string name;
 		RenderTile tile;
+		int pass_stride;
 	};
 
+	/* content of previously received scene data */
+	DataCache& data_cache;
+
+	/* number of floats per pixel in tile buffers, by real device pointer */
+	map<device_ptr, int> tile_pass_stride;
+
 	thread_mutex acquire_mutex;
 	list<AcquireEntry> acquire_queue;
 
@@ -769,24 +1115,29 @@ private:
 
 };
 
-void Device::server_run()
+void Device::server_run(int port)
 {
+	if(port == 0)
+		port = SERVER_PORT;
+
 	try {
 		/* starts thread that responds to discovery requests */
 		ServerDiscovery discovery;
+		DataCache data_cache(SERVER_CACHE_SIZE);
 
 		for(;;) {
 			/* accept connection */
 			boost::asio::io_service io_service;
-			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
+			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), port));
 
 			tcp::socket socket(io_service);
 			acceptor.accept(socket);
+			socket.set_option(tcp::no_delay(true));
 
 			string remote_address = socket.remote_endpoint().address().to_string();
 			printf("Connected to remote client at: %s\n", remote_address.c_str());
 
-			DeviceServer server(this, socket);
+			DeviceServer server(this, socket, data_cache);
 			server.listen();
 
 			printf("Disconnected.\n");
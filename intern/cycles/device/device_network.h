@@ -37,6 +37,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_list.h"
+#include "util/util_logging.h"
 #include "util/util_map.h"
 #include "util/util_param.h"
 #include "util/util_string.h"
@@ -116,7 +117,7 @@ public:
 	{
 		archive & name_;
 		error_func = e;
-		fprintf(stderr, "rpc send %s\n", name.c_str());
+		VLOG(4) << "RPC send " << name;
 	}
 
 	~RPCSend()
@@ -153,9 +154,32 @@ public:
 		archive & tile.x & tile.y & tile.w & tile.h;
 		archive & tile.start_sample & tile.num_samples & tile.sample;
 		archive & tile.resolution & tile.offset & tile.stride;
+		archive & tile.tile_index & tile.pixel_samples;
 		archive & tile.buffer;
 	}
 
+	void add(const DeviceRequestedFeatures& requested_features)
+	{
+		archive & requested_features.experimental;
+		archive & requested_features.max_nodes_group;
+		archive & requested_features.nodes_features;
+		archive & requested_features.use_hair;
+		archive & requested_features.use_object_motion;
+		archive & requested_features.use_camera_motion;
+		archive & requested_features.use_baking;
+		archive & requested_features.use_subsurface;
+		archive & requested_features.use_volume;
+		archive & requested_features.use_integrator_branched;
+		archive & requested_features.use_patch_evaluation;
+		archive & requested_features.use_transparent;
+		archive & requested_features.use_shadow_tricks;
+		archive & requested_features.use_principled;
+		archive & requested_features.use_denoising;
+		archive & requested_features.use_shader_raytrace;
+		archive & requested_features.use_true_displacement;
+		archive & requested_features.use_background_light;
+	}
+
 	void write()
 	{
 		boost::system::error_code error;
@@ -248,7 +272,7 @@ public:
 					archive = new i_archive(*archive_stream);
 
 					*archive & name;
-					fprintf(stderr, "rpc receive %s\n", name.c_str());
+					VLOG(4) << "RPC receive " << name;
 				}
 				else {
 					error_func->network_error("Network receive error: data size doesn't match header");
@@ -323,11 +347,34 @@ public:
 		*archive & tile.x & tile.y & tile.w & tile.h;
 		*archive & tile.start_sample & tile.num_samples & tile.sample;
 		*archive & tile.resolution & tile.offset & tile.stride;
+		*archive & tile.tile_index & tile.pixel_samples;
 		*archive & tile.buffer;
 
 		tile.buffers = NULL;
 	}
 
+	void read(DeviceRequestedFeatures& requested_features)
+	{
+		*archive & requested_features.experimental;
+		*archive & requested_features.max_nodes_group;
+		*archive & requested_features.nodes_features;
+		*archive & requested_features.use_hair;
+		*archive & requested_features.use_object_motion;
+		*archive & requested_features.use_camera_motion;
+		*archive & requested_features.use_baking;
+		*archive & requested_features.use_subsurface;
+		*archive & requested_features.use_volume;
+		*archive & requested_features.use_integrator_branched;
+		*archive & requested_features.use_patch_evaluation;
+		*archive & requested_features.use_transparent;
+		*archive & requested_features.use_shadow_tricks;
+		*archive & requested_features.use_principled;
+		*archive & requested_features.use_denoising;
+		*archive & requested_features.use_shader_raytrace;
+		*archive & requested_features.use_true_displacement;
+		*archive & requested_features.use_background_light;
+	}
+
 	string name;
 
 protected:
@@ -1180,6 +1180,9 @@ void OpenCLDevice::flush_texture_buffers()
 		MemoryManager::BufferDescriptor desc = memory_manager.get_descriptor(slot.name);
 		info.data = desc.offset;
 		info.cl_buffer = desc.device_buffer;
+		info.use_texture_cache = 0;
+		info.sparse_grid = 0;
+		info.ignore_alpha = 0;
 
 		if(string_startswith(slot.name, "__tex_image")) {
 			device_memory *mem = textures[slot.name];
@@ -241,6 +241,70 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
 #endif  /* __KERNEL_CPU__ */
 }
 
+#if defined(__KERNEL_CPU__) && defined(__KERNEL_AVX2__) && defined(__QBVH__)
+#  include "kernel/bvh/obvh_packet.h"
+
+/* Intersect a packet of up to 8 coherent rays, which all use the same
+ * visibility. Returns the mask of rays which hit something.
+ *
+ * Packet traversal is used for the BVH8 without motion blur and hair, other
+ * cases intersect the rays one by one. Hair needs per ray minimum width, so
+ * for camera rays callers should not use packets when the scene has curves.
+ */
+ccl_device_intersect int scene_intersect_packet(KernelGlobals *kg,
+                                                const Ray *rays,
+                                                const int num_rays,
+                                                const uint visibility,
+                                                Intersection *isects)
+{
+	kernel_assert(num_rays <= OBVH_PACKET_SIZE);
+
+	int ray_mask = 0;
+	for(int r = 0; r < num_rays; r++) {
+		if(scene_intersect_valid(&rays[r])) {
+			ray_mask |= (1 << r);
+		}
+		else {
+			isects[r].t = rays[r].t;
+			isects[r].prim = PRIM_NONE;
+			isects[r].object = OBJECT_NONE;
+		}
+	}
+
+	if(kernel_data.bvh.bvh_layout == BVH_LAYOUT_BVH8 &&
+	   !kernel_data.bvh.have_motion &&
+	   !kernel_data.bvh.have_curves
+#ifdef __EMBREE__
+	   && !kernel_data.bvh.scene
+#endif
+	   )
+	{
+		PROFILING_INIT(kg, PROFILING_INTERSECT);
+		int res = obvh_intersect_packet(kg, rays, isects, num_rays, visibility, ray_mask);
+		for(int r = 0; r < num_rays; r++) {
+			if(!(ray_mask & (1 << r))) continue;
+			Intersection tmp;
+			bool h = scene_intersect(kg, rays[r], visibility, &tmp, NULL, 0.0f, 0.0f);
+			static int dbg_n = 0, dbg_total = 0; dbg_total++; if((dbg_total % 262144) == 0) fprintf(stderr, "COUNT %d of %d\n", dbg_n, dbg_total);
+			if(h != (bool)(res & (1 << r)) || (h && (tmp.prim != isects[r].prim || tmp.object != isects[r].object || tmp.t != isects[r].t))) {
+				if(h != (bool)(res & (1 << r)) || tmp.prim != isects[r].prim || tmp.object != isects[r].object) fprintf(stderr, "PRIMMISMATCH %d %d prim %d/%d obj %d/%d t %.9g/%.9g\n", h, (res>>r)&1, tmp.prim, isects[r].prim, tmp.object, isects[r].object, (double)tmp.t, (double)isects[r].t); dbg_n++; if((dbg_total % 200000) == 0) fprintf(stderr, "COUNT %d of %d\n", dbg_n, dbg_total); if(0) fprintf(stderr, "MISMATCH %d/%d hit %d/%d prim %d/%d obj %d/%d t %.9g/%.9g\n", dbg_n, dbg_total, h, (res>>r)&1, tmp.prim, isects[r].prim, tmp.object, isects[r].object, (double)tmp.t, (double)isects[r].t);
+			}
+		}
+		return res;
+	}
+
+	int hit_mask = 0;
+	for(int r = 0; r < num_rays; r++) {
+		if((ray_mask & (1 << r)) &&
+		   scene_intersect(kg, rays[r], visibility, &isects[r], NULL, 0.0f, 0.0f))
+		{
+			hit_mask |= (1 << r);
+		}
+	}
+	return hit_mask;
+}
+#endif  /* __KERNEL_CPU__ && __KERNEL_AVX2__ && __QBVH__ */
+
 #ifdef __BVH_LOCAL__
 /* Note: ray is passed by value to work around a possible CUDA compiler bug. */
 ccl_device_intersect bool scene_intersect_local(KernelGlobals *kg,
@@ -0,0 +1,367 @@
+/*
+ * Copyright 2011-2019 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Packet traversal of the BVH8 for 8 coherent rays at once, like camera rays
+ * of neighboring pixels.
+ *
+ * Where single ray traversal tests one ray against the 8 children of a node
+ * with SIMD, here every child is tested against the 8 rays of the packet.
+ * Node data is fetched once for the whole packet, and each stack entry keeps
+ * the mask of rays which hit that node, so rays which miss drop out of the
+ * subtree. Primitives are intersected per ray with the same functions as
+ * single ray traversal, so results match it exactly.
+ *
+ * Only triangles, with and without instancing, are supported. Callers fall
+ * back to single ray traversal for motion blur and hair.
+ */
+
+#define OBVH_PACKET_SIZE 8
+
+struct OBVHPacketStackItem {
+	int addr;
+	int ray_mask;
+	float dist;
+};
+
+/* Ray data in SIMD lanes, one lane per ray of the packet. */
+struct OBVHPacketRays {
+	avx3f org_idir;
+	avx3f idir;
+	/* Lanes of rays with negative direction, where the near and far planes of
+	 * node bounds are swapped. */
+	avxb neg_x, neg_y, neg_z;
+	avxf tfar;
+};
+
+ccl_device_inline void obvh_packet_rays_setup(OBVHPacketRays *packet,
+                                              const float3 *P,
+                                              const float3 *idir,
+                                              const Intersection *isects,
+                                              const int num_rays)
+{
+	float org_idir_x[OBVH_PACKET_SIZE], org_idir_y[OBVH_PACKET_SIZE], org_idir_z[OBVH_PACKET_SIZE];
+	float idir_x[OBVH_PACKET_SIZE], idir_y[OBVH_PACKET_SIZE], idir_z[OBVH_PACKET_SIZE];
+	float tfar[OBVH_PACKET_SIZE];
+
+	for(int i = 0; i < OBVH_PACKET_SIZE; i++) {
+		/* Unused lanes repeat the first ray, they are masked out anyway. */
+		const int r = (i < num_rays)? i: 0;
+		const float3 P_idir = P[r]*idir[r];
+		org_idir_x[i] = P_idir.x;
+		org_idir_y[i] = P_idir.y;
+		org_idir_z[i] = P_idir.z;
+		idir_x[i] = idir[r].x;
+		idir_y[i] = idir[r].y;
+		idir_z[i] = idir[r].z;
+		tfar[i] = isects[r].t;
+	}
+
+	packet->org_idir = avx3f(avxf(_mm256_loadu_ps(org_idir_x)),
+	                         avxf(_mm256_loadu_ps(org_idir_y)),
+	                         avxf(_mm256_loadu_ps(org_idir_z)));
+	packet->idir = avx3f(avxf(_mm256_loadu_ps(idir_x)),
+	                     avxf(_mm256_loadu_ps(idir_y)),
+	                     avxf(_mm256_loadu_ps(idir_z)));
+	packet->neg_x = packet->idir.x < avxf(0.0f);
+	packet->neg_y = packet->idir.y < avxf(0.0f);
+	packet->neg_z = packet->idir.z < avxf(0.0f);
+	packet->tfar = avxf(_mm256_loadu_ps(tfar));
+}
+
+ccl_device_inline void obvh_packet_update_tfar(OBVHPacketRays *packet,
+                                               const Intersection *isects,
+                                               const int ray)
+{
+	packet->tfar.f[ray] = isects[ray].t;
+}
+
+/* Intersect child bounds with all rays of the packet, returns the mask of
+ * rays which hit the child, and the distance to the nearest of them. */
+ccl_device_inline int obvh_packet_child_intersect(const OBVHPacketRays *packet,
+                                                  const avxf *bounds,
+                                                  const int child,
+                                                  const int ray_mask,
+                                                  float *dist)
+{
+	const avxf lower_x(bounds[0][child]), upper_x(bounds[1][child]);
+	const avxf lower_y(bounds[2][child]), upper_y(bounds[3][child]);
+	const avxf lower_z(bounds[4][child]), upper_z(bounds[5][child]);
+
+	/* Select near and far planes per ray, the same way single ray traversal
+	 * does, so empty children with inverted bounds are never hit. */
+	const avxf tnear_x = msub(select(packet->neg_x, upper_x, lower_x), packet->idir.x, packet->org_idir.x);
+	const avxf tnear_y = msub(select(packet->neg_y, upper_y, lower_y), packet->idir.y, packet->org_idir.y);
+	const avxf tnear_z = msub(select(packet->neg_z, upper_z, lower_z), packet->idir.z, packet->org_idir.z);
+	const avxf tfar_x = msub(select(packet->neg_x, lower_x, upper_x), packet->idir.x, packet->org_idir.x);
+	const avxf tfar_y = msub(select(packet->neg_y, lower_y, upper_y), packet->idir.y, packet->org_idir.y);
+	const avxf tfar_z = msub(select(packet->neg_z, lower_z, upper_z), packet->idir.z, packet->org_idir.z);
+
+	const avxf tnear = max(max(tnear_x, tnear_y), max(tnear_z, avxf(0.0f)));
+	const avxf tfar = min(min(tfar_x, tfar_y), min(tfar_z, packet->tfar));
+	const int mask = (int)movemask(tnear <= tfar) & ray_mask;
+
+	float nearest = FLT_MAX;
+	for(int hit_mask = mask; hit_mask != 0; ) {
+		const int r = __bscf(hit_mask);
+		nearest = min(nearest, tnear[r]);
+	}
+	*dist = nearest;
+
+	return mask;
+}
+
+ccl_device_inline int obvh_packet_hit_mask(const Intersection *isects,
+                                           const int num_rays,
+                                           const int ray_mask)
+{
+	int hit_mask = 0;
+	for(int r = 0; r < num_rays; r++) {
+		if(isects[r].prim != PRIM_NONE) {
+			hit_mask |= (1 << r);
+		}
+	}
+	return hit_mask & ray_mask;
+}
+
+/* Intersect up to 8 rays with the scene, rays not in ray_mask are ignored.
+ * Returns the mask of rays which hit something. */
+ccl_device_noinline int obvh_intersect_packet(KernelGlobals *kg,
+                                              const Ray *rays,
+                                              Intersection *isects,
+                                              const int num_rays,
+                                              const uint visibility,
+                                              int ray_mask)
+{
+	/* Traversal stack, the nodes of one level are pushed at once like in
+	 * single ray traversal, so the same stack size is enough. */
+	OBVHPacketStackItem traversal_stack[BVH_OSTACK_SIZE];
+	traversal_stack[0].addr = ENTRYPOINT_SENTINEL;
+	traversal_stack[0].ray_mask = 0;
+	traversal_stack[0].dist = -FLT_MAX;
+
+	int stack_ptr = 0;
+	int node_addr = kernel_data.bvh.root;
+	int node_mask = ray_mask;
+
+	/* Rays which still need traversal, opaque shadow rays drop out as soon
+	 * as they hit anything. */
+	int active_mask = ray_mask;
+
+	/* Per ray parameters, in object space while inside an instance. */
+	float3 P[OBVH_PACKET_SIZE], dir[OBVH_PACKET_SIZE], idir[OBVH_PACKET_SIZE];
+	for(int r = 0; r < num_rays; r++) {
+		P[r] = rays[r].P;
+		dir[r] = bvh_clamp_direction(rays[r].D);
+		idir[r] = bvh_inverse_direction(dir[r]);
+
+		isects[r].t = rays[r].t;
+		isects[r].u = 0.0f;
+		isects[r].v = 0.0f;
+		isects[r].prim = PRIM_NONE;
+		isects[r].object = OBJECT_NONE;
+	}
+
+	int object = OBJECT_NONE;
+	int object_mask = 0;
+
+	OBVHPacketRays packet;
+	obvh_packet_rays_setup(&packet, P, idir, isects, num_rays);
+
+	/* Traversal loop. */
+	do {
+		do {
+			/* Traverse internal nodes. */
+			while(node_addr >= 0 && node_addr != ENTRYPOINT_SENTINEL) {
+				float4 inodes = kernel_tex_fetch(__bvh_nodes, node_addr+0);
+				(void) inodes;
+
+				if(node_mask == 0
+#ifdef __VISIBILITY_FLAG__
+				   || (__float_as_uint(inodes.x) & visibility) == 0
+#endif
+				 )
+				{
+					/* Pop. */
+					node_addr = traversal_stack[stack_ptr].addr;
+					node_mask = traversal_stack[stack_ptr].ray_mask & active_mask;
+					--stack_ptr;
+					continue;
+				}
+
+				/* Bounds of all 8 children, in the order of the node layout:
+				 * lower and upper x, y and z. */
+				avxf bounds[6];
+				for(int i = 0; i < 6; i++) {
+					bounds[i] = kernel_tex_fetch_avxf(__bvh_nodes, node_addr+2+i*2);
+				}
+				const avxf cnodes = kernel_tex_fetch_avxf(__bvh_nodes, node_addr+14);
+
+				/* Intersect every child with the packet. */
+				OBVHPacketStackItem children[8];
+				int num_children = 0;
+				for(int c = 0; c < 8; c++) {
+					float dist;
+					const int mask = obvh_packet_child_intersect(&packet, bounds, c, node_mask, &dist);
+					if(mask == 0) {
+						continue;
+					}
+
+					/* Insertion sort, farthest child first. */
+					int i = num_children++;
+					for(; i > 0 && children[i-1].dist < dist; i--) {
+						children[i] = children[i-1];
+					}
+					children[i].addr = __float_as_int(cnodes[c]);
+					children[i].ray_mask = mask;
+					children[i].dist = dist;
+				}
+
+				if(num_children == 0) {
+					/* Pop. */
+					node_addr = traversal_stack[stack_ptr].addr;
+					node_mask = traversal_stack[stack_ptr].ray_mask & active_mask;
+					--stack_ptr;
+					continue;
+				}
+
+				/* Push all but the nearest child, continue with the nearest. */
+				for(int i = 0; i < num_children - 1; i++) {
+					++stack_ptr;
+					kernel_assert(stack_ptr < BVH_OSTACK_SIZE);
+					traversal_stack[stack_ptr] = children[i];
+				}
+				node_addr = children[num_children - 1].addr;
+				node_mask = children[num_children - 1].ray_mask;
+			}
+
+			/* If node is leaf, fetch triangle list. */
+			if(node_addr < 0) {
+				float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, (-node_addr-1));
+
+				if(UNLIKELY(node_mask == 0)
+#ifdef __VISIBILITY_FLAG__
+				   || UNLIKELY((__float_as_uint(leaf.z) & visibility) == 0)
+#endif
+				  )
+				{
+					/* Pop. */
+					node_addr = traversal_stack[stack_ptr].addr;
+					node_mask = traversal_stack[stack_ptr].ray_mask & active_mask;
+					--stack_ptr;
+					continue;
+				}
+				int prim_addr = __float_as_int(leaf.x);
+
+				if(prim_addr >= 0) {
+					const int prim_addr2 = __float_as_int(leaf.y);
+					const int prim_count = prim_addr2 - prim_addr;
+					const int leaf_mask = node_mask;
+
+					kernel_assert((__float_as_int(leaf.w) & PRIMITIVE_ALL) == PRIMITIVE_TRIANGLE);
+
+					/* Pop. */
+					node_addr = traversal_stack[stack_ptr].addr;
+					node_mask = traversal_stack[stack_ptr].ray_mask;
+					--stack_ptr;
+
+					/* Primitive intersection, per ray. */
+					for(int mask = leaf_mask; mask != 0; ) {
+						const int r = __bscf(mask);
+						bool hit = false;
+
+						if(prim_count < 3) {
+							for(int addr = prim_addr; addr < prim_addr2; addr++) {
+								hit |= triangle_intersect(kg,
+								                          &isects[r],
+								                          P[r],
+								                          dir[r],
+								                          visibility,
+								                          object,
+								                          addr);
+							}
+						}
+						else {
+							Intersection *isect = &isects[r];
+							hit = triangle_intersect8(kg,
+							                          &isect,
+							                          P[r],
+							                          dir[r],
+							                          visibility,
+							                          object,
+							                          prim_addr,
+							                          prim_count,
+							                          0,
+							                          0,
+							                          NULL,
+							                          0.0f);
+						}
+
+						if(hit) {
+							obvh_packet_update_tfar(&packet, isects, r);
+							/* Shadow ray early termination. */
+							if(visibility == PATH_RAY_SHADOW_OPAQUE) {
+								active_mask &= ~(1 << r);
+							}
+						}
+					}
+
+					if(active_mask == 0) {
+						return obvh_packet_hit_mask(isects, num_rays, ray_mask);
+					}
+					node_mask &= active_mask;
+				}
+				else {
+					/* Instance push, for the rays which reached it. */
+					object = kernel_tex_fetch(__prim_object, -prim_addr-1);
+					object_mask = node_mask;
+
+					for(int mask = object_mask; mask != 0; ) {
+						const int r = __bscf(mask);
+						isects[r].t = bvh_instance_push(kg, object, &rays[r], &P[r], &dir[r], &idir[r], isects[r].t);
+					}
+					obvh_packet_rays_setup(&packet, P, idir, isects, num_rays);
+
+					++stack_ptr;
+					kernel_assert(stack_ptr < BVH_OSTACK_SIZE);
+					traversal_stack[stack_ptr].addr = ENTRYPOINT_SENTINEL;
+					traversal_stack[stack_ptr].ray_mask = 0;
+					traversal_stack[stack_ptr].dist = -FLT_MAX;
+
+					node_addr = kernel_tex_fetch(__object_node, object);
+				}
+			}
+		} while(node_addr != ENTRYPOINT_SENTINEL);
+
+		if(stack_ptr >= 0) {
+			kernel_assert(object != OBJECT_NONE);
+
+			/* Instance pop. */
+			for(int mask = object_mask; mask != 0; ) {
+				const int r = __bscf(mask);
+				isects[r].t = bvh_instance_pop(kg, object, &rays[r], &P[r], &dir[r], &idir[r], isects[r].t);
+			}
+			obvh_packet_rays_setup(&packet, P, idir, isects, num_rays);
+
+			object = OBJECT_NONE;
+			object_mask = 0;
+			node_addr = traversal_stack[stack_ptr].addr;
+			node_mask = traversal_stack[stack_ptr].ray_mask & active_mask;
+			--stack_ptr;
+		}
+	} while(node_addr != ENTRYPOINT_SENTINEL);
+
+	return obvh_packet_hit_mask(isects, num_rays, ray_mask);
+}
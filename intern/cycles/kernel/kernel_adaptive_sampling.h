@@ -0,0 +1,191 @@
+/*
+ * Copyright 2011-2019 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Adaptive Sampling
+ *
+ * Pixels stop being sampled once their estimated error is below the threshold.
+ * The error is the difference between the combined pass and the auxiliary pass,
+ * which only holds every other sample, following "A Hierarchical Automatic
+ * Stopping Condition for Monte Carlo Global Illumination", Dammertz et al. 2009.
+ *
+ * The w component of the auxiliary pass flags converged pixels, and the sample
+ * count pass holds the number of samples taken by each pixel. Convergence is
+ * only tested at fixed sample numbers and within a tile, so the result does not
+ * depend on timing or on the number of threads. */
+
+/* Except for the filters, buffers point to the pixel rather than the tile. */
+
+ccl_device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg,
+                                                      ccl_global float *buffer)
+{
+	return kernel_data.film.pass_adaptive_aux_buffer &&
+	       buffer[kernel_data.film.pass_adaptive_aux_buffer + 3] != 0.0f;
+}
+
+ccl_device_inline void kernel_write_sample_count(KernelGlobals *kg,
+                                                 ccl_global float *buffer)
+{
+	if(kernel_data.film.pass_sample_count) {
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_count, 1.0f);
+	}
+}
+
+ccl_device void kernel_adaptive_stopping(KernelGlobals *kg, ccl_global float *buffer)
+{
+	ccl_global float4 *aux = (ccl_global float4*)(buffer + kernel_data.film.pass_adaptive_aux_buffer);
+	if(aux->w != 0.0f) {
+		return;
+	}
+
+	const float num_samples = buffer[kernel_data.film.pass_sample_count];
+	if(num_samples == 0.0f) {
+		return;
+	}
+
+	const float4 I = *((ccl_global float4*)buffer);
+	const float4 A = *aux;
+
+	/* Difference of the two estimates, relative to the square root of the
+	 * intensity to approximate perceived noise. The small offset avoids dark
+	 * pixels never converging. */
+	const float inv_num_samples = 1.0f/num_samples;
+	const float error = (fabsf(I.x - A.x) + fabsf(I.y - A.y) + fabsf(I.z - A.z)) * inv_num_samples;
+	const float intensity = max((I.x + I.y + I.z) * inv_num_samples, 0.0f);
+
+	if(error < kernel_data.integrator.adaptive_threshold * (sqrtf(intensity) + 1e-4f)) {
+		aux->w = 1.0f;
+	}
+}
+
+/* Pixels next to ones that have not converged are sampled as well, so noise
+ * detected in a single pixel also reduces noise around it. This is done as a
+ * separable dilation, first along rows and then along columns. Both return
+ * whether any pixel of the row or column has not converged. */
+
+ccl_device bool kernel_adaptive_filter_x(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         int y, int x, int w,
+                                         int offset, int stride)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int aux_offset = kernel_data.film.pass_adaptive_aux_buffer + 3;
+
+	bool any = false;
+	bool prev = false;
+
+	for(int dx = x; dx < x + w; dx++) {
+		ccl_global float *flag = buffer + (offset + dx + y*stride)*pass_stride + aux_offset;
+
+		if(*flag == 0.0f) {
+			any = true;
+			if(dx > x && !prev) {
+				*(flag - pass_stride) = 0.0f;
+			}
+			prev = true;
+		}
+		else {
+			if(prev) {
+				*flag = 0.0f;
+			}
+			prev = false;
+		}
+	}
+
+	return any;
+}
+
+ccl_device bool kernel_adaptive_filter_y(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         int x, int y, int h,
+                                         int offset, int stride)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int aux_offset = kernel_data.film.pass_adaptive_aux_buffer + 3;
+
+	bool any = false;
+	bool prev = false;
+
+	for(int dy = y; dy < y + h; dy++) {
+		ccl_global float *flag = buffer + (offset + x + dy*stride)*pass_stride + aux_offset;
+
+		if(*flag == 0.0f) {
+			any = true;
+			if(dy > y && !prev) {
+				*(flag - stride*pass_stride) = 0.0f;
+			}
+			prev = true;
+		}
+		else {
+			if(prev) {
+				*flag = 0.0f;
+			}
+			prev = false;
+		}
+	}
+
+	return any;
+}
+
+/* Once a tile is done, rescale the passes of pixels that stopped early as if
+ * they had taken all samples, so the buffers can be used as usual. Depth and
+ * IDs are written once instead of accumulated, and are left as they are. */
+ccl_device void kernel_adaptive_adjust_samples(KernelGlobals *kg,
+                                               ccl_global float *buffer,
+                                               int num_samples)
+{
+	/* Pixels next to noisy ones may have resumed sampling after missing some
+	 * samples, so the sample count is used rather than the converged flag. */
+	buffer[kernel_data.film.pass_adaptive_aux_buffer + 3] = 0.0f;
+
+	const float pixel_samples = buffer[kernel_data.film.pass_sample_count];
+	if(pixel_samples == 0.0f || pixel_samples >= (float)num_samples) {
+		return;
+	}
+
+	const float sample_multiplier = (float)num_samples / pixel_samples;
+	const int pass_flag = kernel_data.film.pass_flag;
+
+	int cryptomatte_end = kernel_data.film.pass_cryptomatte;
+	if(kernel_data.film.cryptomatte_passes) {
+		int num_types = 0;
+		num_types += (kernel_data.film.cryptomatte_passes & CRYPT_OBJECT) ? 1 : 0;
+		num_types += (kernel_data.film.cryptomatte_passes & CRYPT_MATERIAL) ? 1 : 0;
+		num_types += (kernel_data.film.cryptomatte_passes & CRYPT_ASSET) ? 1 : 0;
+		cryptomatte_end += num_types * kernel_data.film.cryptomatte_depth * 4;
+	}
+
+	for(int i = 0; i < kernel_data.film.pass_stride; i++) {
+		if(i == kernel_data.film.pass_sample_count ||
+		   ((pass_flag & PASSMASK(DEPTH)) && i == kernel_data.film.pass_depth) ||
+		   ((pass_flag & PASSMASK(OBJECT_ID)) && i == kernel_data.film.pass_object_id) ||
+		   ((pass_flag & PASSMASK(MATERIAL_ID)) && i == kernel_data.film.pass_material_id))
+		{
+			continue;
+		}
+		/* Cryptomatte stores pairs of ID and weight. */
+		if(i >= kernel_data.film.pass_cryptomatte && i < cryptomatte_end &&
+		   ((i - kernel_data.film.pass_cryptomatte) & 1) == 0)
+		{
+			continue;
+		}
+
+		buffer[i] *= sample_multiplier;
+	}
+}
+
+CCL_NAMESPACE_END
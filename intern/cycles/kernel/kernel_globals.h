@@ -24,6 +24,7 @@
 #ifdef __KERNEL_CPU__
 #  include "util/util_vector.h"
 #  include "util/util_map.h"
+#  include <OpenImageIO/texture.h>
 #endif
 
 #ifdef __KERNEL_OPENCL__
@@ -64,8 +65,14 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #  endif
 
+	/* Texture cache for image textures read on demand. */
+	OIIO::TextureSystem *texture_system;
+
 	/* **** Run-time data ****  */
 
+	/* Per-thread state of the texture cache. */
+	OIIO::TextureSystem::Perthread *texture_thread_info;
+
 	/* Heap-allocated storage for transparent shadows intersections. */
 	Intersection *transparent_shadow_intersections;
 
@@ -1111,6 +1111,270 @@ ccl_device int light_distribution_sample(KernelGlobals *kg, float *randu)
 	return index;
 }
 
+/* Light Tree
+ *
+ * Local lamps and emissive triangles are grouped in a bounding volume hierarchy
+ * storing the energy and the bounds of emission directions of every node. Lights
+ * are picked by traversing it, choosing children proportional to their estimated
+ * importance for the shading point. Only the position is used for the estimate, so
+ * the same probability can be computed for multiple importance sampling of lights
+ * hit by a ray. Distant and background lights are picked uniformly outside of the tree. */
+
+ccl_device float light_tree_importance(float3 P,
+                                       float3 bbox_min,
+                                       float3 bbox_max,
+                                       float3 axis,
+                                       float theta_o,
+                                       float theta_e,
+                                       float energy)
+{
+	if(energy == 0.0f) {
+		return 0.0f;
+	}
+
+	const float3 centroid = 0.5f*(bbox_min + bbox_max);
+	const float radius = 0.5f*len(bbox_max - bbox_min);
+	float distance;
+	const float3 D = normalize_len(P - centroid, &distance);
+
+	if(distance <= radius) {
+		/* Inside the bounding sphere, light may come from any direction. */
+		return (radius > 0.0f) ? energy/(radius*radius) : energy;
+	}
+
+	float cos_theta_prime = 1.0f;
+
+	if(theta_o < M_PI_F) {
+		/* Smallest angle between the emission bounds and a direction towards P,
+		 * taking the extent of the bounds into account. */
+		const float theta = safe_acosf(dot(axis, D));
+		const float theta_u = safe_asinf(radius/distance);
+		const float theta_prime = theta - theta_o - theta_u;
+
+		if(theta_prime >= theta_e) {
+			return 0.0f;
+		}
+		if(theta_prime > 0.0f) {
+			cos_theta_prime = cosf(theta_prime);
+		}
+	}
+
+	return energy*cos_theta_prime/(distance*distance);
+}
+
+ccl_device float light_tree_node_importance(KernelGlobals *kg, float3 P, int index)
+{
+	const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+
+	return light_tree_importance(P,
+	                             make_float3(knode->bbox_min[0], knode->bbox_min[1], knode->bbox_min[2]),
+	                             make_float3(knode->bbox_max[0], knode->bbox_max[1], knode->bbox_max[2]),
+	                             make_float3(knode->axis[0], knode->axis[1], knode->axis[2]),
+	                             knode->theta_o,
+	                             knode->theta_e,
+	                             knode->energy);
+}
+
+ccl_device float light_tree_emitter_importance(KernelGlobals *kg, float3 P, int index)
+{
+	const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters, index);
+
+	return light_tree_importance(P,
+	                             make_float3(kemitter->bbox_min[0], kemitter->bbox_min[1], kemitter->bbox_min[2]),
+	                             make_float3(kemitter->bbox_max[0], kemitter->bbox_max[1], kemitter->bbox_max[2]),
+	                             make_float3(kemitter->axis[0], kemitter->axis[1], kemitter->axis[2]),
+	                             kemitter->theta_o,
+	                             kemitter->theta_e,
+	                             kemitter->energy);
+}
+
+ccl_device_inline float light_tree_leaf_importance(KernelGlobals *kg,
+                                                   float3 P,
+                                                   const ccl_global KernelLightTreeNode *knode)
+{
+	float importance = 0.0f;
+
+	for(int i = 0; i < knode->num_emitters; i++) {
+		importance += light_tree_emitter_importance(kg, P, knode->first_emitter + i);
+	}
+
+	return importance;
+}
+
+/* Pick an emitter for shading point P, returns -1 when no light contributes. */
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float *randu, float *pdf)
+{
+	const int num_emitters = kernel_data.integrator.light_tree_num_emitters;
+	const int num_distant = kernel_data.integrator.light_tree_num_distant;
+	const float distant_prob = kernel_data.integrator.light_tree_distant_prob;
+	float r = *randu;
+
+	if(r < distant_prob) {
+		r /= distant_prob;
+		const int i = min((int)(r*num_distant), num_distant - 1);
+		*randu = r*num_distant - i;
+		*pdf = distant_prob/num_distant;
+		return num_emitters + i;
+	}
+
+	r = (r - distant_prob)/(1.0f - distant_prob);
+	*pdf = 1.0f - distant_prob;
+
+	/* Traverse down to a leaf. */
+	int node_index = 0;
+	const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, node_index);
+
+	while(knode->num_emitters == 0) {
+		const int left = node_index + 1;
+		const int right = knode->child_index;
+		const float importance_left = light_tree_node_importance(kg, P, left);
+		const float importance_right = light_tree_node_importance(kg, P, right);
+		const float importance = importance_left + importance_right;
+
+		if(importance == 0.0f) {
+			return -1;
+		}
+
+		const float prob_left = importance_left/importance;
+
+		if(r < prob_left) {
+			r /= prob_left;
+			*pdf *= prob_left;
+			node_index = left;
+		}
+		else {
+			r = (r - prob_left)/(1.0f - prob_left);
+			*pdf *= 1.0f - prob_left;
+			node_index = right;
+		}
+
+		knode = &kernel_tex_fetch(__light_tree_nodes, node_index);
+	}
+
+	/* Pick an emitter in the leaf. */
+	const float importance = light_tree_leaf_importance(kg, P, knode);
+
+	if(importance == 0.0f) {
+		return -1;
+	}
+
+	r *= importance;
+
+	int emitter = -1;
+	float emitter_importance = 0.0f;
+
+	for(int i = 0; i < knode->num_emitters; i++) {
+		const float importance_i = light_tree_emitter_importance(kg, P, knode->first_emitter + i);
+
+		if(importance_i == 0.0f) {
+			continue;
+		}
+
+		emitter = knode->first_emitter + i;
+		emitter_importance = importance_i;
+
+		if(r < importance_i) {
+			break;
+		}
+		r -= importance_i;
+	}
+
+	/* Rescale to reuse random number, as for the light distribution. */
+	*randu = saturate(r/emitter_importance);
+	*pdf *= emitter_importance/importance;
+
+	return emitter;
+}
+
+/* Probability of picking an emitter for shading point P. */
+ccl_device float light_tree_pdf(KernelGlobals *kg, float3 P, int emitter)
+{
+	const int num_emitters = kernel_data.integrator.light_tree_num_emitters;
+	const float distant_prob = kernel_data.integrator.light_tree_distant_prob;
+
+	if(emitter >= num_emitters) {
+		return distant_prob/kernel_data.integrator.light_tree_num_distant;
+	}
+
+	float pdf = 1.0f - distant_prob;
+	uint bit_trail = kernel_tex_fetch(__light_tree_emitters, emitter).bit_trail;
+
+	/* Follow the same path as sampling. */
+	int node_index = 0;
+	const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, node_index);
+
+	while(knode->num_emitters == 0) {
+		const int left = node_index + 1;
+		const int right = knode->child_index;
+		const float importance_left = light_tree_node_importance(kg, P, left);
+		const float importance_right = light_tree_node_importance(kg, P, right);
+		const float importance = importance_left + importance_right;
+
+		if(importance == 0.0f) {
+			return 0.0f;
+		}
+
+		const float prob_left = importance_left/importance;
+
+		if(bit_trail & 1) {
+			pdf *= 1.0f - prob_left;
+			node_index = right;
+		}
+		else {
+			pdf *= prob_left;
+			node_index = left;
+		}
+		bit_trail >>= 1;
+
+		knode = &kernel_tex_fetch(__light_tree_nodes, node_index);
+	}
+
+	const float importance = light_tree_leaf_importance(kg, P, knode);
+
+	if(importance == 0.0f) {
+		return 0.0f;
+	}
+
+	return pdf*light_tree_emitter_importance(kg, P, emitter)/importance;
+}
+
+/* Light functions compute the pdf of the light distribution, these give the
+ * factor to turn it into the pdf of the light tree for a lamp or triangle. */
+ccl_device float light_tree_emitter_pdf_factor(KernelGlobals *kg, float3 P, uint emitter)
+{
+	if(emitter == LIGHT_TREE_NONE) {
+		return 0.0f;
+	}
+
+	const float distribution_pdf = kernel_tex_fetch(__light_tree_emitters, emitter).distribution_pdf;
+	return light_tree_pdf(kg, P, emitter)/distribution_pdf;
+}
+
+ccl_device float light_tree_lamp_pdf_factor(KernelGlobals *kg, float3 P, int lamp)
+{
+	const uint emitter = kernel_tex_fetch(__light_tree_emitter_map,
+	                                      kernel_data.integrator.light_tree_lamp_offset + lamp);
+	return light_tree_emitter_pdf_factor(kg, P, emitter);
+}
+
+ccl_device float light_tree_triangle_pdf_factor(KernelGlobals *kg, float3 P, int object, int prim)
+{
+	const uint2 kobject = kernel_tex_fetch(__light_tree_objects, object);
+
+	if(kobject.x == LIGHT_TREE_NONE) {
+		return 0.0f;
+	}
+
+	const uint emitter = kernel_tex_fetch(__light_tree_emitter_map, kobject.x + (prim - kobject.y));
+	return light_tree_emitter_pdf_factor(kg, P, emitter);
+}
+
+ccl_device float light_tree_background_pdf_factor(KernelGlobals *kg)
+{
+	return kernel_data.integrator.light_tree_distant_prob /
+	       (kernel_data.integrator.light_tree_num_distant * kernel_data.integrator.pdf_lights);
+}
+
 /* Generic Light */
 
 ccl_device bool light_select_reached_max_bounces(KernelGlobals *kg, int index, int bounce)
@@ -1127,7 +1391,24 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       LightSample *ls)
 {
 	/* sample index */
-	int index = light_distribution_sample(kg, &randu);
+	int index;
+	float pdf_factor = 1.0f;
+
+	if(kernel_data.integrator.use_light_tree) {
+		float tree_pdf;
+		const int emitter = light_tree_sample(kg, P, &randu, &tree_pdf);
+
+		if(emitter < 0) {
+			return false;
+		}
+
+		const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters, emitter);
+		index = kemitter->distribution_index;
+		pdf_factor = tree_pdf/kemitter->distribution_pdf;
+	}
+	else {
+		index = light_distribution_sample(kg, &randu);
+	}
 
 	/* fetch light data */
 	const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(__light_distribution, index);
@@ -1139,6 +1420,7 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
 
 		triangle_light_sample(kg, prim, object, randu, randv, time, ls, P);
 		ls->shader |= shader_flag;
+		ls->pdf *= pdf_factor;
 		return (ls->pdf > 0.0f);
 	}
 	else {
@@ -1148,7 +1430,12 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
 			return false;
 		}
 
-		return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+		if(!lamp_light_sample(kg, lamp, randu, randv, P, ls)) {
+			return false;
+		}
+
+		ls->pdf *= pdf_factor;
+		return true;
 	}
 }
 
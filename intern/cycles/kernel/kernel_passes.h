@@ -371,6 +371,19 @@ ccl_device_inline void kernel_write_light_passes(KernelGlobals *kg, ccl_global f
 #endif
 }
 
+/* Every other sample is accumulated a second time with double weight, the
+ * difference to the combined pass estimates the error of the pixel. */
+ccl_device_inline void kernel_write_adaptive_buffer(KernelGlobals *kg,
+                                                    ccl_global float *buffer,
+                                                    int sample,
+                                                    float3 L_sum)
+{
+	if(kernel_data.film.pass_adaptive_aux_buffer && (sample & 1)) {
+		kernel_write_pass_float4(buffer + kernel_data.film.pass_adaptive_aux_buffer,
+		                         make_float4(2.0f*L_sum.x, 2.0f*L_sum.y, 2.0f*L_sum.z, 0.0f));
+	}
+}
+
 ccl_device_inline void kernel_write_result(KernelGlobals *kg,
                                            ccl_global float *buffer,
                                            int sample,
@@ -383,6 +396,7 @@ ccl_device_inline void kernel_write_result(KernelGlobals *kg,
 	float3 L_sum = path_radiance_clamp_and_sum(kg, L, &alpha);
 
 	kernel_write_pass_float4(buffer, make_float4(L_sum.x, L_sum.y, L_sum.z, alpha));
+	kernel_write_adaptive_buffer(kg, buffer, sample, L_sum);
 
 	kernel_write_light_passes(kg, buffer, L);
 
@@ -31,6 +31,7 @@
 #include "kernel/kernel_shader.h"
 #include "kernel/kernel_light.h"
 #include "kernel/kernel_passes.h"
+#include "kernel/kernel_adaptive_sampling.h"
 
 #if defined(__VOLUME__) || defined(__SUBSURFACE__)
 #  include "kernel/kernel_volume.h"
@@ -576,7 +577,8 @@ ccl_device_forceinline void kernel_path_integrate(
 	Ray *ray,
 	PathRadiance *L,
 	ccl_global float *buffer,
-	ShaderData *emission_sd)
+	ShaderData *emission_sd,
+	const Intersection *first_isect)
 {
 	PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
 
@@ -592,9 +594,21 @@ ccl_device_forceinline void kernel_path_integrate(
 
 	/* path iteration */
 	for(;;) {
-		/* Find intersection with objects in scene. */
+		/* Find intersection with objects in scene, unless it was already
+		 * found for the camera ray by packet traversal. */
 		Intersection isect;
-		bool hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		bool hit;
+		if(first_isect != NULL) {
+			isect = *first_isect;
+			hit = (isect.prim != PRIM_NONE);
+			first_isect = NULL;
+#ifdef __KERNEL_DEBUG__
+			L->debug_data.num_ray_bounces++;
+#endif
+		}
+		else {
+			hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		}
 
 		/* Find intersection with lamps and compute emission for MIS. */
 		kernel_path_lamp_emission(kg, state, ray, throughput, &isect, &sd, L);
@@ -739,6 +753,11 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 
 	buffer += index*pass_stride;
 
+	if(kernel_adaptive_pixel_converged(kg, buffer)) {
+		return;
+	}
+	kernel_write_sample_count(kg, buffer);
+
 	/* Initialize random numbers and sample ray. */
 	uint rng_hash;
 	Ray ray;
@@ -768,11 +787,87 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	                      &ray,
 	                      &L,
 	                      buffer,
-	                      emission_sd);
+	                      emission_sd,
+	                      NULL);
 
 	kernel_write_result(kg, buffer, sample, &L);
 }
 
+#if defined(__KERNEL_CPU__) && defined(__KERNEL_AVX2__) && defined(__QBVH__)
+/* Path trace a row of up to 8 pixels, finding the intersections of their
+ * camera rays with packet traversal. The rest of the paths is traced one by
+ * one, as their rays are no longer coherent. */
+ccl_device void kernel_path_trace_packet(KernelGlobals *kg,
+	ccl_global float *buffer,
+	int sample, int x, int y, int w, int offset, int stride)
+{
+	PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
+	kernel_assert(w <= OBVH_PACKET_SIZE);
+
+	int pass_stride = kernel_data.film.pass_stride;
+
+	ccl_global float *pixel_buffer[OBVH_PACKET_SIZE];
+	Ray rays[OBVH_PACKET_SIZE];
+	PathState states[OBVH_PACKET_SIZE];
+	int num_rays = 0;
+
+	ShaderDataTinyStorage emission_sd_storage;
+	ShaderData *emission_sd = AS_SHADER_DATA(&emission_sd_storage);
+
+	/* Initialize random numbers, sample rays and initialize state. */
+	for(int i = 0; i < w; i++) {
+		ccl_global float *pixel = buffer + (offset + x + i + y*stride)*pass_stride;
+
+		if(kernel_adaptive_pixel_converged(kg, pixel)) {
+			continue;
+		}
+		kernel_write_sample_count(kg, pixel);
+
+		uint rng_hash;
+		Ray *ray = &rays[num_rays];
+		kernel_path_trace_setup(kg, sample, x + i, y, &rng_hash, ray);
+
+		if(ray->t == 0.0f) {
+			continue;
+		}
+
+		path_state_init(kg, emission_sd, &states[num_rays], rng_hash, sample, ray);
+		pixel_buffer[num_rays] = pixel;
+		num_rays++;
+	}
+
+	if(num_rays == 0) {
+		return;
+	}
+
+	/* All camera rays start with the same state flags. */
+	const uint visibility = path_state_ray_visibility(kg, &states[0]);
+
+	Intersection isects[OBVH_PACKET_SIZE];
+	scene_intersect_packet(kg, rays, num_rays, visibility, isects);
+
+	/* Integrate. */
+	for(int r = 0; r < num_rays; r++) {
+		float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
+
+		PathRadiance L;
+		path_radiance_init(&L, kernel_data.film.use_light_pass);
+
+		kernel_path_integrate(kg,
+		                      &states[r],
+		                      throughput,
+		                      &rays[r],
+		                      &L,
+		                      pixel_buffer[r],
+		                      emission_sd,
+		                      &isects[r]);
+
+		kernel_write_result(kg, pixel_buffer[r], sample, &L);
+	}
+}
+#endif  /* __KERNEL_CPU__ && __KERNEL_AVX2__ && __QBVH__ */
+
 #endif  /* __SPLIT_KERNEL__ */
 
 CCL_NAMESPACE_END
@@ -59,6 +59,7 @@ CCL_NAMESPACE_BEGIN
 #define OBJECT_NONE				(~0)
 #define PRIM_NONE				(~0)
 #define LAMP_NONE				(~0)
+#define LIGHT_TREE_NONE			(~0)
 #define ID_NONE					(0.0f)
 
 #define VOLUME_STACK_SIZE		32
@@ -423,6 +424,8 @@ typedef enum PassType {
 #endif
 	PASS_RENDER_TIME,
 	PASS_CRYPTOMATTE,
+	PASS_ADAPTIVE_AUX_BUFFER,
+	PASS_SAMPLE_COUNT,
 	PASS_CATEGORY_MAIN_END = 31,
 
 	PASS_MIST = 32,
@@ -1301,6 +1304,10 @@ typedef struct KernelFilm {
 	int pass_denoising_clean;
 	int denoising_flags;
 
+	int pass_adaptive_aux_buffer;
+	int pass_sample_count;
+	int pad1, pad2;
+
 	/* XYZ to rendering color space transform. float4 instead of float3 to
 	 * ensure consistent padding/alignment across devices. */
 	float4 xyz_to_r;
@@ -1404,6 +1411,18 @@ typedef struct KernelIntegrator {
 
 	int max_closures;
 
+	/* light tree */
+	int use_light_tree;
+	int light_tree_num_emitters;
+	int light_tree_num_distant;
+	float light_tree_distant_prob;
+	int light_tree_lamp_offset;
+
+	/* adaptive sampling */
+	float adaptive_threshold;
+	int adaptive_min_samples;
+	int adaptive_step;
+
 	int pad1, pad2, pad3;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
@@ -1566,6 +1585,39 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Node of the light tree, bounding the position, orientation and energy of its emitters. */
+typedef struct KernelLightTreeNode {
+	float bbox_min[3];
+	float energy;
+	float bbox_max[3];
+	float theta_o;
+	float axis[3];
+	float theta_e;
+	/* Index of the right child of inner nodes, the left child follows its parent. */
+	int child_index;
+	/* Emitters of leaf nodes, inner nodes have none. */
+	int first_emitter;
+	int num_emitters;
+	int pad;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+typedef struct KernelLightTreeEmitter {
+	float bbox_min[3];
+	float energy;
+	float bbox_max[3];
+	float theta_o;
+	float axis[3];
+	float theta_e;
+	/* Index in the light distribution, and the probability of picking it there. */
+	int distribution_index;
+	float distribution_pdf;
+	/* Bit N is set when the path from the root takes the right child at depth N. */
+	uint bit_trail;
+	int pad;
+} KernelLightTreeEmitter;
+static_assert_align(KernelLightTreeEmitter, 16);
+
 typedef struct KernelParticle {
 	int index;
 	float age;
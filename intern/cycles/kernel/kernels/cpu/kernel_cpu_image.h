@@ -256,6 +256,34 @@ template<typename T> struct TextureInterpolator  {
 
 	/* ********  3D interpolation ******** */
 
+	static ccl_always_inline float4 read_voxel(const TextureInfo& info,
+	                                           int x, int y, int z)
+	{
+		const T *data = (const T*)info.data;
+
+		if(info.sparse_grid) {
+			/* Index of tiles at the start of the data, followed by the
+			 * voxels of non-empty tiles. */
+			const int tiles_x = (info.width + TEX_SPARSE_TILE_MASK) >> TEX_SPARSE_TILE_SHIFT;
+			const int tiles_y = (info.height + TEX_SPARSE_TILE_MASK) >> TEX_SPARSE_TILE_SHIFT;
+			const int tile = (x >> TEX_SPARSE_TILE_SHIFT) +
+			                 tiles_x*((y >> TEX_SPARSE_TILE_SHIFT) +
+			                          tiles_y*(z >> TEX_SPARSE_TILE_SHIFT));
+			const int offset = ((const int*)data)[tile];
+
+			if(offset == -1) {
+				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+			}
+
+			return read(data[offset +
+			                 (x & TEX_SPARSE_TILE_MASK) +
+			                 TEX_SPARSE_TILE_SIZE*((y & TEX_SPARSE_TILE_MASK) +
+			                                       TEX_SPARSE_TILE_SIZE*(z & TEX_SPARSE_TILE_MASK))]);
+		}
+
+		return read(data[x + info.width*(y + info.height*z)]);
+	}
+
 	static ccl_always_inline float4 interp_3d_closest(const TextureInfo& info,
 	                                                  float x, float y, float z)
 	{
@@ -291,8 +319,7 @@ template<typename T> struct TextureInterpolator  {
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
 
-		const T *data = (const T*)info.data;
-		return read(data[ix + iy*width + iz*width*height]);
+		return read_voxel(info, ix, iy, iz);
 	}
 
 	static ccl_always_inline float4 interp_3d_linear(const TextureInfo& info,
@@ -339,18 +366,17 @@ template<typename T> struct TextureInterpolator  {
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
 
-		const T *data = (const T*)info.data;
 		float4 r;
 
-		r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + iz*width*height]);
-		r += (1.0f - tz)*(1.0f - ty)*tx*read(data[nix + iy*width + iz*width*height]);
-		r += (1.0f - tz)*ty*(1.0f - tx)*read(data[ix + niy*width + iz*width*height]);
-		r += (1.0f - tz)*ty*tx*read(data[nix + niy*width + iz*width*height]);
+		r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read_voxel(info, ix, iy, iz);
+		r += (1.0f - tz)*(1.0f - ty)*tx*read_voxel(info, nix, iy, iz);
+		r += (1.0f - tz)*ty*(1.0f - tx)*read_voxel(info, ix, niy, iz);
+		r += (1.0f - tz)*ty*tx*read_voxel(info, nix, niy, iz);
 
-		r += tz*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + niz*width*height]);
-		r += tz*(1.0f - ty)*tx*read(data[nix + iy*width + niz*width*height]);
-		r += tz*ty*(1.0f - tx)*read(data[ix + niy*width + niz*width*height]);
-		r += tz*ty*tx*read(data[nix + niy*width + niz*width*height]);
+		r += tz*(1.0f - ty)*(1.0f - tx)*read_voxel(info, ix, iy, niz);
+		r += tz*(1.0f - ty)*tx*read_voxel(info, nix, iy, niz);
+		r += tz*ty*(1.0f - tx)*read_voxel(info, ix, niy, niz);
+		r += tz*ty*tx*read_voxel(info, nix, niy, niz);
 
 		return r;
 	}
@@ -427,20 +453,14 @@ template<typename T> struct TextureInterpolator  {
 		}
 
 		const int xc[4] = {pix, ix, nix, nnix};
-		const int yc[4] = {width * piy,
-		                   width * iy,
-		                   width * niy,
-		                   width * nniy};
-		const int zc[4] = {width * height * piz,
-		                   width * height * iz,
-		                   width * height * niz,
-		                   width * height * nniz};
+		const int yc[4] = {piy, iy, niy, nniy};
+		const int zc[4] = {piz, iz, niz, nniz};
 		float u[4], v[4], w[4];
 
 		/* Some helper macro to keep code reasonable size,
 		 * let compiler to inline all the matrix multiplications.
 		 */
-#define DATA(x, y, z) (read(data[xc[x] + yc[y] + zc[z]]))
+#define DATA(x, y, z) (read_voxel(info, xc[x], yc[y], zc[z]))
 #define COL_TERM(col, row) \
 		(v[col] * (u[0] * DATA(0, col, row) + \
 		           u[1] * DATA(1, col, row) + \
@@ -457,7 +477,6 @@ template<typename T> struct TextureInterpolator  {
 		SET_CUBIC_SPLINE_WEIGHTS(w, tz);
 
 		/* Actual interpolation. */
-		const T *data = (const T*)info.data;
 		return ROW_TERM(0) + ROW_TERM(1) + ROW_TERM(2) + ROW_TERM(3);
 
 #undef COL_TERM
@@ -484,10 +503,75 @@ template<typename T> struct TextureInterpolator  {
 #undef SET_CUBIC_SPLINE_WEIGHTS
 };
 
+/* Lookup in an image read on demand through the texture cache. The MIP level
+ * is picked by the cache from the texture coordinate differentials. */
+ccl_device float4 kernel_tex_image_interp_cache(KernelGlobals *kg,
+                                                const TextureInfo& info,
+                                                float x, float y,
+                                                float2 dx, float2 dy)
+{
+	OIIO::TextureOpt options;
+
+	switch(info.interpolation) {
+		case INTERPOLATION_CLOSEST:
+			options.interpmode = OIIO::TextureOpt::InterpClosest;
+			break;
+		case INTERPOLATION_CUBIC:
+			options.interpmode = OIIO::TextureOpt::InterpBicubic;
+			break;
+		case INTERPOLATION_SMART:
+			options.interpmode = OIIO::TextureOpt::InterpSmartBicubic;
+			break;
+		default:
+			options.interpmode = OIIO::TextureOpt::InterpBilinear;
+			break;
+	}
+
+	switch(info.extension) {
+		case EXTENSION_EXTEND:
+			options.swrap = options.twrap = OIIO::TextureOpt::WrapClamp;
+			break;
+		case EXTENSION_CLIP:
+			options.swrap = options.twrap = OIIO::TextureOpt::WrapBlack;
+			break;
+		default:
+			options.swrap = options.twrap = OIIO::TextureOpt::WrapPeriodic;
+			break;
+	}
+
+	/* Missing alpha channel is opaque. */
+	options.fill = 1.0f;
+
+	/* Images are stored bottom to top in Cycles, and top to bottom in files. */
+	float result[4];
+	if(!kg->texture_system->texture((OIIO::TextureSystem::TextureHandle*)info.data,
+	                                kg->texture_thread_info,
+	                                options,
+	                                x, 1.0f - y,
+	                                dx.x, -dx.y,
+	                                dy.x, -dy.y,
+	                                4, result))
+	{
+		return make_float4(TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+	}
+
+	if(info.ignore_alpha) {
+		result[3] = 1.0f;
+	}
+
+	return make_float4(result[0], result[1], result[2], result[3]);
+}
+
 ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, float y)
 {
 	const TextureInfo& info = kernel_tex_fetch(__texture_info, id);
 
+	if(info.use_texture_cache) {
+		return kernel_tex_image_interp_cache(kg, info, x, y,
+		                                     make_float2(0.0f, 0.0f),
+		                                     make_float2(0.0f, 0.0f));
+	}
+
 	switch(kernel_tex_type(id)) {
 		case IMAGE_DATA_TYPE_HALF:
 			return TextureInterpolator<half>::interp(info, x, y);
@@ -511,6 +595,18 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
 	}
 }
 
+/* Same as above, with differentials of the texture coordinate for filtering. */
+ccl_device float4 kernel_tex_image_interp_d(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy)
+{
+	const TextureInfo& info = kernel_tex_fetch(__texture_info, id);
+
+	if(info.use_texture_cache) {
+		return kernel_tex_image_interp_cache(kg, info, x, y, dx, dy);
+	}
+
+	return kernel_tex_image_interp(kg, id, x, y);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg, int id, float x, float y, float z, InterpolationType interp)
 {
 	const TextureInfo& info = kernel_tex_fetch(__texture_info, id);
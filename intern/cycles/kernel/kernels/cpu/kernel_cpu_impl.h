@@ -100,6 +100,100 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 #endif  /* KERNEL_STUB */
 }
 
+/* Path tracing a row of pixels, with packet traversal for camera rays where
+ * the instruction set and scene support it. */
+
+void KERNEL_FUNCTION_FULL_NAME(path_trace_packet)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y, int w,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, path_trace_packet);
+#else
+#  if defined(__KERNEL_AVX2__) && defined(__QBVH__)
+	if(!kernel_data.integrator.branched && !kernel_data.bvh.have_curves) {
+		for(int i = 0; i < w; i += OBVH_PACKET_SIZE) {
+			kernel_path_trace_packet(kg,
+			                         buffer,
+			                         sample,
+			                         x + i, y,
+			                         min(w - i, OBVH_PACKET_SIZE),
+			                         offset,
+			                         stride);
+		}
+		return;
+	}
+#  endif
+	for(int i = 0; i < w; i++) {
+		KERNEL_FUNCTION_FULL_NAME(path_trace)(kg, buffer, sample, x + i, y, offset, stride);
+	}
+#endif  /* KERNEL_STUB */
+}
+
+/* Adaptive Sampling */
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_stopping)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int x, int y,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_stopping);
+#else
+	kernel_adaptive_stopping(kg, buffer + (offset + x + y*stride)*kernel_data.film.pass_stride);
+#endif  /* KERNEL_STUB */
+}
+
+bool KERNEL_FUNCTION_FULL_NAME(adaptive_filter_x)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int y,
+                                                  int x, int w,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_filter_x);
+	return false;
+#else
+	return kernel_adaptive_filter_x(kg, buffer, y, x, w, offset, stride);
+#endif  /* KERNEL_STUB */
+}
+
+bool KERNEL_FUNCTION_FULL_NAME(adaptive_filter_y)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int x,
+                                                  int y, int h,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_filter_y);
+	return false;
+#else
+	return kernel_adaptive_filter_y(kg, buffer, x, y, h, offset, stride);
+#endif  /* KERNEL_STUB */
+}
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_adjust_samples)(KernelGlobals *kg,
+                                                        float *buffer,
+                                                        int num_samples,
+                                                        int x, int y,
+                                                        int offset,
+                                                        int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_adjust_samples);
+#else
+	kernel_adaptive_adjust_samples(kg,
+	                               buffer + (offset + x + y*stride)*kernel_data.film.pass_stride,
+	                               num_samples);
+#endif  /* KERNEL_STUB */
+}
+
 /* Film */
 
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
@@ -48,6 +48,7 @@ ccl_device void kernel_path_init(KernelGlobals *kg) {
 	/* Store buffer offset for writing to passes. */
 	uint buffer_offset = (tile->offset + x + y*tile->stride) * kernel_data.film.pass_stride;
 	kernel_split_state.buffer_offset[ray_index] = buffer_offset;
+	kernel_write_sample_count(kg, kernel_split_params.tile.buffer + buffer_offset);
 
 	/* Initialize random numbers and ray. */
 	uint rng_hash;
@@ -16,9 +16,13 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb, uint use_alpha)
 {
+#ifdef __KERNEL_CPU__
+	float4 r = kernel_tex_image_interp_d(kg, id, x, y, dx, dy);
+#else
 	float4 r = kernel_tex_image_interp(kg, id, x, y);
+#endif
 	const float alpha = r.w;
 
 	if(use_alpha && alpha != 1.0f && alpha != 0.0f) {
@@ -46,28 +50,67 @@ ccl_device_inline float3 texco_remap_square(float3 co)
 	return (co - make_float3(0.5f, 0.5f, 0.5f)) * 2.0f;
 }
 
+ccl_device_inline float2 svm_image_texco(float3 co, uint projection)
+{
+	if(projection == NODE_IMAGE_PROJ_SPHERE) {
+		return map_to_sphere(texco_remap_square(co));
+	}
+	else if(projection == NODE_IMAGE_PROJ_TUBE) {
+		return map_to_tube(texco_remap_square(co));
+	}
+	else {
+		return make_float2(co.x, co.y);
+	}
+}
+
+/* Texture coordinate differential from the coordinate at a neighboring pixel.
+ * Sphere and tube projections wrap around in u, take the shortest way. */
+ccl_device_inline float2 svm_image_texco_differential(float2 tex_co, float3 co_d, uint projection)
+{
+	float2 d = svm_image_texco(co_d, projection) - tex_co;
+	if(projection == NODE_IMAGE_PROJ_SPHERE || projection == NODE_IMAGE_PROJ_TUBE) {
+		d.x -= floorf(d.x + 0.5f);
+	}
+	return d;
+}
+
+/* Texture coordinate of one side of box projection, mapped so that no
+ * textures are flipped, rotation is somewhat arbitrary. */
+ccl_device_inline float2 svm_image_box_texco(float3 co, float3 signed_N, int side)
+{
+	if(side == 0) {
+		return make_float2((signed_N.x < 0.0f)? 1.0f - co.y: co.y, co.z);
+	}
+	else if(side == 1) {
+		return make_float2((signed_N.y > 0.0f)? 1.0f - co.x: co.x, co.z);
+	}
+	else {
+		return make_float2((signed_N.z > 0.0f)? 1.0f - co.y: co.y, co.x);
+	}
+}
+
 ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
 {
 	uint id = node.y;
 	uint co_offset, out_offset, alpha_offset, srgb;
+	uint projection, dx_offset, dy_offset;
 
 	decode_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &srgb);
+	decode_node_uchar4(node.w, &projection, &dx_offset, &dy_offset, NULL);
 
 	float3 co = stack_load_float3(stack, co_offset);
-	float2 tex_co;
+	float2 tex_co = svm_image_texco(co, projection);
+	float2 tex_dx = make_float2(0.0f, 0.0f);
+	float2 tex_dy = make_float2(0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
-	if(node.w == NODE_IMAGE_PROJ_SPHERE) {
-		co = texco_remap_square(co);
-		tex_co = map_to_sphere(co);
-	}
-	else if(node.w == NODE_IMAGE_PROJ_TUBE) {
-		co = texco_remap_square(co);
-		tex_co = map_to_tube(co);
-	}
-	else {
-		tex_co = make_float2(co.x, co.y);
+
+	/* Texture coordinates at the neighboring pixels, for filtering. */
+	if(stack_valid(dx_offset)) {
+		tex_dx = svm_image_texco_differential(tex_co, stack_load_float3(stack, dx_offset), projection);
+		tex_dy = svm_image_texco_differential(tex_co, stack_load_float3(stack, dy_offset), projection);
 	}
-	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, srgb, use_alpha);
+
+	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, tex_dx, tex_dy, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -75,8 +118,10 @@ ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *sta
 		stack_store_float(stack, alpha_offset, f.w);
 }
 
-ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
+ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node, int *offset)
 {
+	uint4 node2 = read_node(kg, offset);
+
 	/* get object space normal */
 	float3 N = sd->N;
 
@@ -152,21 +197,24 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
 	float3 co = stack_load_float3(stack, co_offset);
 	uint id = node.y;
 
+	/* Texture coordinates at the neighboring pixels, for filtering. */
+	uint dx_offset = node2.x;
+	uint dy_offset = node2.y;
+	bool use_differentials = stack_valid(dx_offset);
+	float3 co_dx = (use_differentials)? stack_load_float3(stack, dx_offset): co;
+	float3 co_dy = (use_differentials)? stack_load_float3(stack, dy_offset): co;
+
 	float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
-
-	/* Map so that no textures are flipped, rotation is somewhat arbitrary. */
-	if(weight.x > 0.0f) {
-		float2 uv = make_float2((signed_N.x < 0.0f)? 1.0f - co.y: co.y, co.z);
-		f += weight.x*svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
-	}
-	if(weight.y > 0.0f) {
-		float2 uv = make_float2((signed_N.y > 0.0f)? 1.0f - co.x: co.x, co.z);
-		f += weight.y*svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
-	}
-	if(weight.z > 0.0f) {
-		float2 uv = make_float2((signed_N.z > 0.0f)? 1.0f - co.y: co.y, co.x);
-		f += weight.z*svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	float side_weight[3] = {weight.x, weight.y, weight.z};
+
+	for(int side = 0; side < 3; side++) {
+		if(side_weight[side] > 0.0f) {
+			float2 uv = svm_image_box_texco(co, signed_N, side);
+			float2 uv_dx = svm_image_box_texco(co_dx, signed_N, side) - uv;
+			float2 uv_dy = svm_image_box_texco(co_dy, signed_N, side) - uv;
+			f += side_weight[side]*svm_image_texture(kg, id, uv.x, uv.y, uv_dx, uv_dy, srgb, use_alpha);
+		}
 	}
 
 	if(stack_valid(out_offset))
@@ -194,7 +242,8 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, floa
 		uv = direction_to_mirrorball(co);
 
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	float2 zero = make_float2(0.0f, 0.0f);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, zero, zero, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -121,6 +121,8 @@ RenderTile::RenderTile()
 	offset = 0;
 	stride = 0;
 
+	pixel_samples = 0;
+
 	buffer = 0;
 
 	buffers = NULL;
@@ -141,6 +141,10 @@ public:
 	int stride;
 	int tile_index;
 
+	/* Samples taken over all pixels, fewer than w*h*num_samples when adaptive
+	 * sampling stopped pixels early. Zero if the device does not count them. */
+	uint64_t pixel_samples;
+
 	device_ptr buffer;
 	int device_size;
 
@@ -16,6 +16,7 @@
 
 #include "render/attribute.h"
 #include "render/graph.h"
+#include "render/image.h"
 #include "render/nodes.h"
 #include "render/scene.h"
 #include "render/shader.h"
@@ -324,6 +325,10 @@ void ShaderGraph::simplify(Scene *scene)
 		clean(scene);
 		refine_bump_nodes();
 
+		if(scene->image_manager->use_texture_cache() && !scene->shader_manager->use_osl()) {
+			refine_image_texture_nodes();
+		}
+
 		simplified = true;
 	}
 }
@@ -894,6 +899,47 @@ void ShaderGraph::refine_bump_nodes()
 	}
 }
 
+void ShaderGraph::refine_image_texture_nodes()
+{
+	/* images read through the texture cache are filtered with the differentials
+	 * of their texture coordinates. like for bump nodes, we copy the sub-graph
+	 * defined from the "vector" input, to evaluate the texture coordinates at
+	 * the neighboring pixels into the "vector_dx" and "vector_dy" inputs. */
+
+	foreach(ShaderNode *node, nodes) {
+		if(node->type != ImageTextureNode::node_type || node->bump != SHADER_BUMP_NONE)
+			continue;
+
+		ShaderInput *vector_input = node->input("Vector");
+
+		if(!vector_input->link)
+			continue;
+
+		ShaderNodeSet nodes_vector;
+		ShaderNodeMap nodes_dx;
+		ShaderNodeMap nodes_dy;
+
+		find_dependencies(nodes_vector, vector_input);
+
+		copy_nodes(nodes_vector, nodes_dx);
+		copy_nodes(nodes_vector, nodes_dy);
+
+		foreach(NodePair& pair, nodes_dx)
+			pair.second->bump = SHADER_BUMP_DX;
+		foreach(NodePair& pair, nodes_dy)
+			pair.second->bump = SHADER_BUMP_DY;
+
+		ShaderOutput *out = vector_input->link;
+		connect(nodes_dx[out->parent]->output(out->name()), node->input("VectorDX"));
+		connect(nodes_dy[out->parent]->output(out->name()), node->input("VectorDY"));
+
+		foreach(NodePair& pair, nodes_dx)
+			add(pair.second);
+		foreach(NodePair& pair, nodes_dy)
+			add(pair.second);
+	}
+}
+
 void ShaderGraph::bump_from_displacement(bool use_object_space)
 {
 	/* generate bump mapping automatically from displacement. bump mapping is
@@ -19,6 +19,7 @@
 #include "render/scene.h"
 #include "render/stats.h"
 
+#include "util/util_array.h"
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
@@ -63,6 +64,89 @@ int flattened_slot_to_type_index(int flat_slot, ImageDataType *type)
 	return flat_slot >> IMAGE_DATA_TYPE_SHIFT;
 }
 
+/* Convert dense 3D voxels to sparse tiles, when that saves at least half of
+ * the memory. Mostly empty volumes like smoke and fire simulations only have
+ * a small fraction of non-empty tiles. Only reads the voxels, so it's done
+ * without holding the device mutex. */
+template<typename T>
+bool image_sparse_grid_create(const T *voxels,
+                              const size_t width,
+                              const size_t height,
+                              const size_t depth,
+                              array<T>& sparse)
+{
+	const size_t tiles_x = divide_up(width, TEX_SPARSE_TILE_SIZE);
+	const size_t tiles_y = divide_up(height, TEX_SPARSE_TILE_SIZE);
+	const size_t tiles_z = divide_up(depth, TEX_SPARSE_TILE_SIZE);
+	const size_t num_tiles = tiles_x * tiles_y * tiles_z;
+	const size_t tile_voxels = TEX_SPARSE_TILE_SIZE * TEX_SPARSE_TILE_SIZE * TEX_SPARSE_TILE_SIZE;
+	const size_t dense_size = width * height * depth;
+
+	/* Find non-empty tiles, with any voxel not exactly zero. */
+	vector<int> offsets(num_tiles, -1);
+	const size_t index_size = divide_up(num_tiles * sizeof(int), sizeof(T));
+	size_t sparse_size = index_size;
+
+	for(size_t z = 0; z < depth; z++) {
+		for(size_t y = 0; y < height; y++) {
+			for(size_t x = 0; x < width; x++) {
+				const size_t tile = (x / TEX_SPARSE_TILE_SIZE) +
+				                    tiles_x * ((y / TEX_SPARSE_TILE_SIZE) +
+				                               tiles_y * (z / TEX_SPARSE_TILE_SIZE));
+				if(offsets[tile] != -1) {
+					continue;
+				}
+
+				const uchar *voxel = (const uchar*)&voxels[x + width * (y + height * z)];
+				for(size_t i = 0; i < sizeof(T); i++) {
+					if(voxel[i] != 0) {
+						offsets[tile] = 0;
+						sparse_size += tile_voxels;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if(sparse_size * 2 > dense_size || sparse_size > INT_MAX) {
+		return false;
+	}
+
+	/* Pack non-empty tiles after the index, voxels outside of the image
+	 * are zero. */
+	sparse.resize(sparse_size);
+	memset((void*)sparse.data(), 0, sparse_size * sizeof(T));
+
+	size_t offset = index_size;
+	for(size_t tile = 0; tile < num_tiles; tile++) {
+		if(offsets[tile] == -1) {
+			continue;
+		}
+
+		offsets[tile] = offset;
+
+		const size_t tile_x = (tile % tiles_x) * TEX_SPARSE_TILE_SIZE;
+		const size_t tile_y = ((tile / tiles_x) % tiles_y) * TEX_SPARSE_TILE_SIZE;
+		const size_t tile_z = (tile / (tiles_x * tiles_y)) * TEX_SPARSE_TILE_SIZE;
+
+		for(size_t z = 0; z < TEX_SPARSE_TILE_SIZE && tile_z + z < depth; z++) {
+			for(size_t y = 0; y < TEX_SPARSE_TILE_SIZE && tile_y + y < height; y++) {
+				for(size_t x = 0; x < TEX_SPARSE_TILE_SIZE && tile_x + x < width; x++) {
+					sparse[offset + x + TEX_SPARSE_TILE_SIZE * (y + TEX_SPARSE_TILE_SIZE * z)] =
+					        voxels[(tile_x + x) + width * ((tile_y + y) + height * (tile_z + z))];
+				}
+			}
+		}
+
+		offset += tile_voxels;
+	}
+
+	memcpy((void*)sparse.data(), &offsets[0], num_tiles * sizeof(int));
+
+	return true;
+}
+
 const char* name_from_type(ImageDataType type)
 {
 	switch(type) {
@@ -90,9 +174,15 @@ ImageManager::ImageManager(const DeviceInfo& info)
 	osl_texture_system = NULL;
 	animation_frame = 0;
 
+	/* Texture cache lookups are done by the CPU kernel. */
+	texture_cache_supported = (info.type == DEVICE_CPU);
+	texture_cache_size = 0;
+	texture_system = NULL;
+
 	/* Set image limits */
 	max_num_images = TEX_NUM_MAX;
 	has_half_images = info.has_half_images;
+	has_sparse_grids = info.has_sparse_grids;
 
 	for(size_t type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		tex_num_images[type] = 0;
@@ -105,6 +195,10 @@ ImageManager::~ImageManager()
 		for(size_t slot = 0; slot < images[type].size(); slot++)
 			assert(!images[type][slot]);
 	}
+
+	if(texture_system) {
+		TextureSystem::destroy(texture_system);
+	}
 }
 
 void ImageManager::set_osl_texture_system(void *texture_system)
@@ -112,6 +206,16 @@ void ImageManager::set_osl_texture_system(void *texture_system)
 	osl_texture_system = texture_system;
 }
 
+void ImageManager::set_texture_cache_size(int size)
+{
+	texture_cache_size = size;
+}
+
+bool ImageManager::use_texture_cache() const
+{
+	return texture_cache_supported && texture_cache_size > 0;
+}
+
 bool ImageManager::set_animation_frame_update(int frame)
 {
 	if(frame != animation_frame) {
@@ -210,7 +314,6 @@ bool ImageManager::get_image_metadata(const string& filename,
 	metadata.height = spec.height;
 	metadata.depth = spec.depth;
 
-
 	/* Check the main format, and channel formats. */
 	size_t channel_size = spec.format.basesize();
 
@@ -379,6 +482,7 @@ int ImageManager::add_image(const string& filename,
 	img->users = 1;
 	img->use_alpha = use_alpha;
 	img->mem = NULL;
+	img->use_texture_cache = false;
 
 	images[type][slot] = img;
 
@@ -709,9 +813,82 @@ bool ImageManager::file_load_image(Image *img,
 		       &scaled_pixels[0],
 		       scaled_pixels.size() * sizeof(StorageType));
 	}
+	/* Store mostly empty volumes sparsely. */
+	array<DeviceType> sparse;
+	if(has_sparse_grids &&
+	   tex_img.data_depth > 1 &&
+	   image_sparse_grid_create(tex_img.data(),
+	                            tex_img.data_width,
+	                            tex_img.data_height,
+	                            tex_img.data_depth,
+	                            sparse))
+	{
+		VLOG(1) << "Storing " << tex_img.name << " as sparse grid, "
+		        << string_human_readable_size(sparse.size() * sizeof(DeviceType)) << " instead of "
+		        << string_human_readable_size(tex_img.size() * sizeof(DeviceType)) << ".";
+
+		const size_t width = tex_img.data_width;
+		const size_t height = tex_img.data_height;
+		const size_t depth = tex_img.data_depth;
+
+		thread_scoped_lock device_lock(device_mutex);
+		tex_img.steal_data(sparse);
+		tex_img.data_width = width;
+		tex_img.data_height = height;
+		tex_img.data_depth = depth;
+		tex_img.sparse_grid = true;
+	}
 	return true;
 }
 
+bool ImageManager::texture_cache_image(Image *img, int texture_limit)
+{
+	/* Untiled files are split into tiles and MIP levels by the cache. Builtin
+	 * images don't come from files, and loading is still needed to resize
+	 * images to the texture limit and to convert gray with alpha, which the
+	 * cache would read as red and green. */
+	return use_texture_cache() &&
+	       !img->builtin_data &&
+	       img->metadata.depth <= 1 &&
+	       (img->metadata.channels == 1 ||
+	        img->metadata.channels == 3 ||
+	        img->metadata.channels == 4) &&
+	       texture_limit == 0;
+}
+
+void ImageManager::device_load_texture_cache_image(Device *device, Image *img)
+{
+	thread_scoped_lock device_lock(device_mutex);
+
+	if(!texture_system) {
+		texture_system = TextureSystem::create(false);
+		texture_system->attribute("max_memory_MB", (float)texture_cache_size);
+		texture_system->attribute("gray_to_rgb", 1);
+		texture_system->attribute("autotile", 64);
+		texture_system->attribute("automip", 1);
+	}
+
+	ustring filename(img->filename);
+	texture_system->invalidate(filename);
+
+	/* The device texture only holds the handle, pixels are read on demand by
+	 * the kernel. */
+	device_vector<uchar> *tex_img
+		= new device_vector<uchar>(device, img->mem_name.c_str(), MEM_TEXTURE);
+	tex_img->alloc(1, 1);
+	tex_img->data()[0] = 0;
+	tex_img->texture_system = texture_system;
+	tex_img->texture_handle = texture_system->get_texture_handle(filename);
+	tex_img->texture_ignore_alpha = !img->use_alpha;
+
+	img->mem = tex_img;
+	img->mem->interpolation = img->interpolation;
+	img->mem->extension = img->extension;
+	img->use_texture_cache = true;
+
+	tex_img->copy_to_device();
+}
+
 void ImageManager::device_load_image(Device *device,
                                      Scene *scene,
                                      ImageDataType type,
@@ -742,6 +919,14 @@ void ImageManager::device_load_image(Device *device,
 		delete img->mem;
 		img->mem = NULL;
 	}
+	img->use_texture_cache = false;
+
+	/* Read tiles on demand while rendering. */
+	if(texture_cache_image(img, texture_limit)) {
+		device_load_texture_cache_image(device, img);
+		img->need_load = false;
+		return;
+	}
 
 	/* Create new texture. */
 	if(type == IMAGE_DATA_TYPE_FLOAT4) {
@@ -950,6 +1135,11 @@ void ImageManager::device_free_image(Device *, ImageDataType type, int slot)
 #endif
 		}
 
+		if(img->use_texture_cache) {
+			thread_scoped_lock device_lock(device_mutex);
+			texture_system->invalidate(ustring(img->filename));
+		}
+
 		if(img->mem) {
 			thread_scoped_lock device_lock(device_mutex);
 			delete img->mem;
@@ -1077,11 +1267,36 @@ void ImageManager::collect_statistics(RenderStats *stats)
 {
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		foreach(const Image *image, images[type]) {
+			if(image->use_texture_cache) {
+				stats->image.texture_cache.num_images++;
+				continue;
+			}
 			stats->image.textures.add_entry(
 			        NamedSizeEntry(path_filename(image->filename),
 			                       image->mem->memory_size()));
 		}
 	}
+
+	if(texture_system) {
+		TextureCacheStats& cache_stats = stats->image.texture_cache;
+		long long memory_used = 0, bytes_read = 0, lookups = 0;
+		int tiles_created = 0, tiles_current = 0, misses = 0;
+
+		texture_system->getattribute("stat:cache_memory_used", TypeDesc::INT64, &memory_used);
+		texture_system->getattribute("stat:bytes_read", TypeDesc::INT64, &bytes_read);
+		texture_system->getattribute("stat:find_tile_calls", TypeDesc::INT64, &lookups);
+		texture_system->getattribute("stat:tiles_created", tiles_created);
+		texture_system->getattribute("stat:tiles_current", tiles_current);
+		texture_system->getattribute("stat:find_tile_cache_misses", misses);
+
+		cache_stats.memory_limit = (size_t)texture_cache_size * 1024 * 1024;
+		cache_stats.memory_used = memory_used;
+		cache_stats.bytes_read = bytes_read;
+		cache_stats.tiles_read = tiles_created;
+		cache_stats.tiles_evicted = tiles_created - tiles_current;
+		cache_stats.lookups = lookups;
+		cache_stats.misses = misses;
+	}
 }
 
 CCL_NAMESPACE_END
@@ -26,6 +26,8 @@
 #include "util/util_unique_ptr.h"
 #include "util/util_vector.h"
 
+#include <OpenImageIO/texture.h>
+
 CCL_NAMESPACE_BEGIN
 
 class Device;
@@ -105,6 +107,12 @@ public:
 	void set_osl_texture_system(void *texture_system);
 	bool set_animation_frame_update(int frame);
 
+	/* Image files are read on demand through a texture cache with the
+	 * given memory budget in megabytes, instead of being loaded entirely.
+	 * Only supported on the CPU device, zero disables the cache. */
+	void set_texture_cache_size(int size);
+	bool use_texture_cache() const;
+
 	device_memory *image_memory(int flat_slot);
 
 	void collect_statistics(RenderStats *stats);
@@ -143,6 +151,7 @@ public:
 
 		string mem_name;
 		device_memory *mem;
+		bool use_texture_cache;
 
 		int users;
 	};
@@ -151,6 +160,7 @@ private:
 	int tex_num_images[IMAGE_DATA_NUM_TYPES];
 	int max_num_images;
 	bool has_half_images;
+	bool has_sparse_grids;
 
 	thread_mutex device_mutex;
 	int animation_frame;
@@ -158,6 +168,12 @@ private:
 	vector<Image*> images[IMAGE_DATA_NUM_TYPES];
 	void *osl_texture_system;
 
+	bool texture_cache_supported;
+	int texture_cache_size;
+	TextureSystem *texture_system;
+
+	bool texture_cache_image(Image *img, int texture_limit);
+
 	bool file_load_image_generic(Image *img, unique_ptr<ImageInput> *in);
 
 	template<TypeDesc::BASETYPE FileFormat,
@@ -173,6 +189,7 @@ private:
 	                       ImageDataType type,
 	                       int slot,
 	                       Progress *progress);
+	void device_load_texture_cache_image(Device *device, Image *img);
 	void device_free_image(Device *device,
 	                       ImageDataType type,
 	                       int slot);
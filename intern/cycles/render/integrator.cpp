@@ -67,6 +67,10 @@ NODE_DEFINE(Integrator)
 	SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
 	SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
 	SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+	SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+
+	SOCKET_FLOAT(adaptive_threshold, "Adaptive Threshold", 0.01f);
+	SOCKET_INT(adaptive_min_samples, "Adaptive Min Samples", 16);
 
 	static NodeEnum method_enum;
 	method_enum.insert("path", PATH);
@@ -165,9 +169,22 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 		kintegrator->sample_all_lights_indirect = false;
 	}
 
+	/* Sampling all lights doesn't pick lights, the light tree is only used
+	 * when a single light is picked for both direct and indirect samples. */
+	kintegrator->use_light_tree = scene->light_manager->use_light_tree &&
+	                              !kintegrator->sample_all_lights_direct &&
+	                              !kintegrator->sample_all_lights_indirect;
+
 	kintegrator->sampling_pattern = sampling_pattern;
 	kintegrator->aa_samples = aa_samples;
 
+	/* Adaptive sampling is enabled by the passes it needs, only the stopping
+	 * criteria are set here. Convergence is tested every few samples, testing
+	 * after every sample costs more than the samples it saves. */
+	kintegrator->adaptive_threshold = adaptive_threshold;
+	kintegrator->adaptive_min_samples = max(adaptive_min_samples, 1);
+	kintegrator->adaptive_step = 4;
+
 	if(light_sampling_threshold > 0.0f) {
 		kintegrator->light_inv_rr_threshold = 1.0f / light_sampling_threshold;
 	}
@@ -232,6 +249,9 @@ void Integrator::tag_update(Scene *scene)
 			break;
 		}
 	}
+	if(use_light_tree != scene->light_manager->use_light_tree) {
+		scene->light_manager->tag_update(scene);
+	}
 	need_update = true;
 }
 
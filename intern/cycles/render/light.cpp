@@ -20,6 +20,7 @@
 #include "render/film.h"
 #include "render/graph.h"
 #include "render/light.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/nodes.h"
 #include "render/object.h"
@@ -173,6 +174,7 @@ LightManager::LightManager()
 {
 	need_update = true;
 	use_light_visibility = false;
+	use_light_tree = false;
 }
 
 LightManager::~LightManager()
@@ -224,6 +226,53 @@ void LightManager::disable_ineffective_light(Device *device, Scene *scene)
 	}
 }
 
+/* Estimate of the radiance emitted by a shader, for the light tree. Emission
+ * that varies over the surface can't be known in advance, unit strength is
+ * assumed then. */
+static float light_tree_shader_emission(Shader *shader)
+{
+	float3 emission;
+	if(shader->is_constant_emission(&emission)) {
+		return fabsf(average(emission));
+	}
+	return 1.0f;
+}
+
+static LightTreeEmitter light_tree_lamp_emitter(Scene *scene, Light *light, int distribution_index)
+{
+	Shader *shader = (light->shader) ? light->shader : scene->default_light;
+	LightTreeEmitter emitter;
+
+	emitter.energy = light_tree_shader_emission(shader);
+	emitter.distribution_index = distribution_index;
+	emitter.distribution_pdf = 0.0f;
+
+	if(light->type == LIGHT_AREA) {
+		float3 axisu = light->axisu*(light->sizeu*light->size);
+		float3 axisv = light->axisv*(light->sizev*light->size);
+		float3 half_extent = 0.5f*(fabs(axisu) + fabs(axisv));
+
+		emitter.bbox = BoundBox(light->co - half_extent, light->co + half_extent);
+		/* One sided. */
+		emitter.cone = LightTreeCone(safe_normalize(light->dir), 0.0f, M_PI_2_F);
+		/* Power emitted for a given strength, relative to point lights. */
+		emitter.energy *= M_PI_4_F;
+	}
+	else {
+		float3 radius = make_float3(light->size, light->size, light->size);
+
+		emitter.bbox = BoundBox(light->co - radius, light->co + radius);
+		if(light->type == LIGHT_SPOT) {
+			emitter.cone = LightTreeCone(safe_normalize(light->dir), 0.0f, 0.5f*light->spot_angle);
+		}
+		else {
+			emitter.cone = LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+		}
+	}
+
+	return emitter;
+}
+
 bool LightManager::object_usable_as_light(Object *object) {
 	Mesh *mesh = object->mesh;
 	/* Skip objects with NaNs */
@@ -292,6 +341,18 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 	size_t num_distribution = num_triangles + num_lights;
 	VLOG(1) << "Total " << num_distribution << " of light distribution primitives.";
 
+	/* light tree, mapping the triangles of emissive objects and lamps to
+	 * their distribution index, replaced by the emitter index after building */
+	bool build_light_tree = scene->integrator->use_light_tree;
+	vector<LightTreeEmitter> tree_emitters;
+	vector<int> tree_distant;
+	vector<int> tree_map;
+	vector<uint2> tree_objects;
+
+	if(build_light_tree) {
+		tree_objects.resize(scene->objects.size(), make_uint2(LIGHT_TREE_NONE, 0));
+	}
+
 	/* emission area */
 	KernelLightDistribution *distribution = dscene->light_distribution.alloc(num_distribution + 1);
 	float totarea = 0.0f;
@@ -332,6 +393,17 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		}
 
 		size_t mesh_num_triangles = mesh->num_triangles();
+		vector<float> shader_emission;
+
+		if(build_light_tree) {
+			tree_objects[object_id] = make_uint2(tree_map.size(), mesh->tri_offset);
+			tree_map.resize(tree_map.size() + mesh_num_triangles, LIGHT_TREE_NONE);
+
+			foreach(Shader *shader, mesh->used_shaders) {
+				shader_emission.push_back(light_tree_shader_emission(shader));
+			}
+		}
+
 		for(size_t i = 0; i < mesh_num_triangles; i++) {
 			int shader_index = mesh->shader[i];
 			Shader *shader = (shader_index < mesh->used_shaders.size())
@@ -339,6 +411,10 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 			                         : scene->default_surface;
 
 			if(shader->use_mis && shader->has_surface_emission) {
+				if(build_light_tree) {
+					tree_map[tree_objects[object_id].x + i] = offset;
+				}
+
 				distribution[offset].totarea = totarea;
 				distribution[offset].prim = i + mesh->tri_offset;
 				distribution[offset].mesh_light.shader_flag = shader_flag;
@@ -359,7 +435,24 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 					p3 = transform_point(&tfm, p3);
 				}
 
-				totarea += triangle_area(p1, p2, p3);
+				float area = triangle_area(p1, p2, p3);
+				totarea += area;
+
+				if(build_light_tree) {
+					LightTreeEmitter emitter;
+					emitter.bbox = BoundBox(p1);
+					emitter.bbox.grow(p2);
+					emitter.bbox.grow(p3);
+					/* Triangles emit from both sides. */
+					emitter.cone = LightTreeCone(safe_normalize(cross(p2 - p1, p3 - p1)), M_PI_F, M_PI_2_F);
+					emitter.energy = M_2PI_F*area*((shader_index < shader_emission.size())
+					                                   ? shader_emission[shader_index]
+					                                   : light_tree_shader_emission(shader));
+					emitter.distribution_index = offset - 1;
+					/* Area until the pdf of triangles is known. */
+					emitter.distribution_pdf = area;
+					tree_emitters.push_back(emitter);
+				}
 			}
 		}
 
@@ -377,6 +470,15 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		if(!light->is_enabled)
 			continue;
 
+		if(build_light_tree) {
+			if(light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND) {
+				tree_distant.push_back(offset);
+			}
+			else {
+				tree_emitters.push_back(light_tree_lamp_emitter(scene, light, offset));
+			}
+		}
+
 		distribution[offset].totarea = totarea;
 		distribution[offset].prim = ~light_index;
 		distribution[offset].lamp.pad = 1.0f;
@@ -451,6 +553,80 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		/* CDF */
 		dscene->light_distribution.copy_to_device();
 
+		/* Light tree */
+		if(build_light_tree) {
+			foreach(LightTreeEmitter& emitter, tree_emitters) {
+				if(distribution[emitter.distribution_index].prim >= 0) {
+					emitter.distribution_pdf *= kintegrator->pdf_triangles;
+				}
+				else {
+					emitter.distribution_pdf = kintegrator->pdf_lights;
+				}
+			}
+
+			int num_local = tree_emitters.size();
+			int num_distant = tree_distant.size();
+			LightTree tree(tree_emitters);
+
+			/* Local emitters in tree order, followed by distant ones. */
+			KernelLightTreeEmitter *kemitters = dscene->light_tree_emitters.alloc(num_local + num_distant);
+			vector<uint> distribution_emitter(num_distribution, LIGHT_TREE_NONE);
+
+			for(int i = 0; i < num_local; i++) {
+				kemitters[i] = tree.emitters[i];
+			}
+			for(int i = 0; i < num_distant; i++) {
+				KernelLightTreeEmitter& kemitter = kemitters[num_local + i];
+				memset(&kemitter, 0, sizeof(kemitter));
+				kemitter.distribution_index = tree_distant[i];
+				kemitter.distribution_pdf = kintegrator->pdf_lights;
+			}
+			for(int i = 0; i < num_local + num_distant; i++) {
+				distribution_emitter[kemitters[i].distribution_index] = i;
+			}
+
+			if(num_local) {
+				KernelLightTreeNode *knodes = dscene->light_tree_nodes.alloc(tree.nodes.size());
+				memcpy(knodes, &tree.nodes[0], sizeof(KernelLightTreeNode)*tree.nodes.size());
+				dscene->light_tree_nodes.copy_to_device();
+			}
+
+			/* Emitter of every triangle of emissive objects, then of every lamp. */
+			uint *kmap = dscene->light_tree_emitter_map.alloc(tree_map.size() + num_lights);
+
+			for(size_t i = 0; i < tree_map.size(); i++) {
+				kmap[i] = (tree_map[i] == LIGHT_TREE_NONE) ? LIGHT_TREE_NONE : distribution_emitter[tree_map[i]];
+			}
+			for(size_t i = 0; i < num_lights; i++) {
+				kmap[tree_map.size() + i] = distribution_emitter[num_triangles + i];
+			}
+
+			if(tree_objects.size()) {
+				uint2 *kobjects = dscene->light_tree_objects.alloc(tree_objects.size());
+				memcpy(kobjects, &tree_objects[0], sizeof(uint2)*tree_objects.size());
+				dscene->light_tree_objects.copy_to_device();
+			}
+
+			dscene->light_tree_emitters.copy_to_device();
+			dscene->light_tree_emitter_map.copy_to_device();
+
+			kintegrator->light_tree_num_emitters = num_local;
+			kintegrator->light_tree_num_distant = num_distant;
+			kintegrator->light_tree_distant_prob = (num_distant == 0) ? 0.0f : (num_local) ? 0.5f : 1.0f;
+			kintegrator->light_tree_lamp_offset = tree_map.size();
+
+			use_light_tree = true;
+
+			VLOG(1) << "Light tree with " << tree.nodes.size() << " nodes, "
+			        << num_local << " local and " << num_distant << " distant emitters.";
+		}
+		else {
+			kintegrator->light_tree_num_emitters = 0;
+			kintegrator->light_tree_num_distant = 0;
+			kintegrator->light_tree_distant_prob = 0.0f;
+			kintegrator->light_tree_lamp_offset = 0;
+		}
+
 		/* Portals */
 		if(num_portals > 0) {
 			kintegrator->portal_offset = light_index;
@@ -474,6 +650,10 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		kintegrator->num_portals = 0;
 		kintegrator->portal_offset = 0;
 		kintegrator->portal_pdf = 0.0f;
+		kintegrator->light_tree_num_emitters = 0;
+		kintegrator->light_tree_num_distant = 0;
+		kintegrator->light_tree_distant_prob = 0.0f;
+		kintegrator->light_tree_lamp_offset = 0;
 
 		kfilm->pass_shadow_scale = 1.0f;
 	}
@@ -880,6 +1060,8 @@ void LightManager::device_update(Device *device, DeviceScene *dscene, Scene *sce
 	device_free(device, dscene);
 
 	use_light_visibility = false;
+	bool prev_use_light_tree = use_light_tree;
+	use_light_tree = false;
 
 	disable_ineffective_light(device, scene);
 
@@ -900,6 +1082,10 @@ void LightManager::device_update(Device *device, DeviceScene *dscene, Scene *sce
 		scene->film->tag_update(scene);
 	}
 
+	if(use_light_tree != prev_use_light_tree) {
+		scene->integrator->tag_update(scene);
+	}
+
 	need_update = false;
 }
 
@@ -909,6 +1095,10 @@ void LightManager::device_free(Device *, DeviceScene *dscene)
 	dscene->lights.free();
 	dscene->light_background_marginal_cdf.free();
 	dscene->light_background_conditional_cdf.free();
+	dscene->light_tree_nodes.free();
+	dscene->light_tree_emitters.free();
+	dscene->light_tree_emitter_map.free();
+	dscene->light_tree_objects.free();
 	dscene->ies_lights.free();
 }
 
@@ -84,6 +84,8 @@ public:
 class LightManager {
 public:
 	bool use_light_visibility;
+	/* Light tree was built for the current lights. */
+	bool use_light_tree;
 	bool need_update;
 
 	LightManager();
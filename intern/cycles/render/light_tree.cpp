@@ -0,0 +1,287 @@
+/*
+ * Copyright 2011-2019 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+#include "util/util_transform.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* The bit trail of an emitter has one bit per level. */
+#define LIGHT_TREE_MAX_DEPTH 32
+#define LIGHT_TREE_MAX_LEAF_SIZE 8
+#define LIGHT_TREE_NUM_BUCKETS 12
+
+/* Light Tree Cone */
+
+LightTreeCone LightTreeCone::merge(const LightTreeCone& cone_a, const LightTreeCone& cone_b)
+{
+	if(cone_a.is_empty()) {
+		return cone_b;
+	}
+	if(cone_b.is_empty()) {
+		return cone_a;
+	}
+
+	/* Let a be the wider cone. */
+	const LightTreeCone& a = (cone_a.theta_o >= cone_b.theta_o) ? cone_a : cone_b;
+	const LightTreeCone& b = (cone_a.theta_o >= cone_b.theta_o) ? cone_b : cone_a;
+
+	const float theta_d = safe_acosf(dot(a.axis, b.axis));
+	const float theta_e = max(a.theta_e, b.theta_e);
+
+	if(min(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+		/* a already contains b. */
+		return LightTreeCone(a.axis, a.theta_o, theta_e);
+	}
+
+	const float theta_o = 0.5f*(a.theta_o + theta_d + b.theta_o);
+	if(theta_o >= M_PI_F) {
+		return LightTreeCone(a.axis, M_PI_F, theta_e);
+	}
+
+	/* Rotate the axis of a towards the axis of b. */
+	const float3 rotation_axis = cross(a.axis, b.axis);
+	if(len_squared(rotation_axis) < 1e-12f) {
+		/* Opposite axes. */
+		return LightTreeCone(a.axis, M_PI_F, theta_e);
+	}
+
+	const Transform rotation = transform_rotate(theta_o - a.theta_o, normalize(rotation_axis));
+	const float3 axis = normalize(transform_direction(&rotation, a.axis));
+
+	return LightTreeCone(axis, theta_o, theta_e);
+}
+
+float LightTreeCone::measure() const
+{
+	if(is_empty()) {
+		return 0.0f;
+	}
+
+	/* "Importance Sampling of Many Lights with Adaptive Tree Splitting", Conty and Kulla 2018. */
+	const float theta_w = min(theta_o + theta_e, M_PI_F);
+	const float cos_theta_o = cosf(theta_o);
+	const float sin_theta_o = sinf(theta_o);
+
+	return M_2PI_F*(1.0f - cos_theta_o) +
+	       M_PI_2_F*(2.0f*theta_w*sin_theta_o -
+	                 cosf(theta_o - 2.0f*theta_w) -
+	                 2.0f*theta_o*sin_theta_o +
+	                 cos_theta_o);
+}
+
+/* Light Tree */
+
+struct LightTreeBucket {
+	int count;
+	float energy;
+	BoundBox bbox;
+	LightTreeCone cone;
+
+	LightTreeBucket()
+	: count(0), energy(0.0f), bbox(BoundBox::empty)
+	{
+	}
+
+	void add(const LightTreeBucket& other)
+	{
+		count += other.count;
+		energy += other.energy;
+		bbox.grow(other.bbox);
+		cone = LightTreeCone::merge(cone, other.cone);
+	}
+
+	void add(const LightTreeEmitter& emitter)
+	{
+		count++;
+		energy += emitter.energy;
+		bbox.grow(emitter.bbox);
+		cone = LightTreeCone::merge(cone, emitter.cone);
+	}
+
+	/* Surface area orientation heuristic. */
+	float cost() const
+	{
+		return energy * bbox.safe_area() * cone.measure();
+	}
+};
+
+static int light_tree_bucket(const LightTreeEmitter& emitter,
+                             int axis,
+                             const BoundBox& centroid_bbox)
+{
+	const float extent = centroid_bbox.max[axis] - centroid_bbox.min[axis];
+	const float offset = emitter.bbox.center()[axis] - centroid_bbox.min[axis];
+	const int bucket = (int)(offset / extent * LIGHT_TREE_NUM_BUCKETS);
+
+	return clamp(bucket, 0, LIGHT_TREE_NUM_BUCKETS - 1);
+}
+
+LightTree::LightTree(vector<LightTreeEmitter>& prims)
+{
+	if(prims.empty()) {
+		return;
+	}
+
+	nodes.reserve(2*prims.size());
+	emitters.reserve(prims.size());
+
+	recursive_build(prims, 0, prims.size(), 0, 0);
+}
+
+int LightTree::recursive_build(vector<LightTreeEmitter>& prims,
+                               int start,
+                               int end,
+                               int depth,
+                               uint bit_trail)
+{
+	LightTreeBucket node_bounds;
+	BoundBox centroid_bbox = BoundBox::empty;
+
+	for(int i = start; i < end; i++) {
+		node_bounds.add(prims[i]);
+		centroid_bbox.grow(prims[i].bbox.center());
+	}
+
+	const int node_index = nodes.size();
+	nodes.push_back(KernelLightTreeNode());
+
+	KernelLightTreeNode& knode = nodes[node_index];
+	knode.bbox_min[0] = node_bounds.bbox.min.x;
+	knode.bbox_min[1] = node_bounds.bbox.min.y;
+	knode.bbox_min[2] = node_bounds.bbox.min.z;
+	knode.bbox_max[0] = node_bounds.bbox.max.x;
+	knode.bbox_max[1] = node_bounds.bbox.max.y;
+	knode.bbox_max[2] = node_bounds.bbox.max.z;
+	knode.energy = node_bounds.energy;
+	knode.axis[0] = node_bounds.cone.axis.x;
+	knode.axis[1] = node_bounds.cone.axis.y;
+	knode.axis[2] = node_bounds.cone.axis.z;
+	knode.theta_o = node_bounds.cone.theta_o;
+	knode.theta_e = node_bounds.cone.theta_e;
+	knode.child_index = -1;
+	knode.first_emitter = -1;
+	knode.num_emitters = 0;
+	knode.pad = 0;
+
+	const int num_prims = end - start;
+
+	/* Find the split with the lowest cost, over all axes. */
+	int split_axis = -1;
+	int split_bucket = 0;
+	float split_cost = FLT_MAX;
+
+	if(num_prims > 1 && depth < LIGHT_TREE_MAX_DEPTH) {
+		const float3 extent = centroid_bbox.size();
+		const float max_extent = max3(extent);
+
+		for(int axis = 0; axis < 3; axis++) {
+			if(extent[axis] <= 0.0f) {
+				continue;
+			}
+
+			LightTreeBucket buckets[LIGHT_TREE_NUM_BUCKETS];
+			for(int i = start; i < end; i++) {
+				buckets[light_tree_bucket(prims[i], axis, centroid_bbox)].add(prims[i]);
+			}
+
+			/* Favor splitting along the longest axis. */
+			const float regularization = max_extent / extent[axis];
+
+			for(int split = 1; split < LIGHT_TREE_NUM_BUCKETS; split++) {
+				LightTreeBucket left, right;
+				for(int i = 0; i < split; i++) {
+					left.add(buckets[i]);
+				}
+				for(int i = split; i < LIGHT_TREE_NUM_BUCKETS; i++) {
+					right.add(buckets[i]);
+				}
+
+				if(left.count == 0 || right.count == 0) {
+					continue;
+				}
+
+				const float cost = regularization*(left.cost() + right.cost());
+				if(cost < split_cost) {
+					split_cost = cost;
+					split_axis = axis;
+					split_bucket = split;
+				}
+			}
+		}
+	}
+
+	int middle = -1;
+
+	if(split_axis != -1) {
+		if(split_cost < node_bounds.cost() || num_prims > LIGHT_TREE_MAX_LEAF_SIZE) {
+			vector<LightTreeEmitter>::iterator mid = std::partition(
+			        prims.begin() + start, prims.begin() + end,
+			        [split_axis, split_bucket, &centroid_bbox](const LightTreeEmitter& emitter) {
+			            return light_tree_bucket(emitter, split_axis, centroid_bbox) < split_bucket;
+			        });
+			middle = mid - prims.begin();
+		}
+	}
+	else if(num_prims > LIGHT_TREE_MAX_LEAF_SIZE && depth < LIGHT_TREE_MAX_DEPTH) {
+		/* All centroids coincide, split in the middle to keep leaves small. */
+		middle = (start + end) / 2;
+	}
+
+	if(middle == -1) {
+		/* Leaf. */
+		knode.first_emitter = emitters.size();
+		knode.num_emitters = num_prims;
+
+		for(int i = start; i < end; i++) {
+			const LightTreeEmitter& prim = prims[i];
+			KernelLightTreeEmitter kemitter;
+
+			kemitter.bbox_min[0] = prim.bbox.min.x;
+			kemitter.bbox_min[1] = prim.bbox.min.y;
+			kemitter.bbox_min[2] = prim.bbox.min.z;
+			kemitter.bbox_max[0] = prim.bbox.max.x;
+			kemitter.bbox_max[1] = prim.bbox.max.y;
+			kemitter.bbox_max[2] = prim.bbox.max.z;
+			kemitter.energy = prim.energy;
+			kemitter.axis[0] = prim.cone.axis.x;
+			kemitter.axis[1] = prim.cone.axis.y;
+			kemitter.axis[2] = prim.cone.axis.z;
+			kemitter.theta_o = prim.cone.theta_o;
+			kemitter.theta_e = prim.cone.theta_e;
+			kemitter.distribution_index = prim.distribution_index;
+			kemitter.distribution_pdf = prim.distribution_pdf;
+			kemitter.bit_trail = bit_trail;
+			kemitter.pad = 0;
+
+			emitters.push_back(kemitter);
+		}
+
+		return node_index;
+	}
+
+	/* The node reference is invalidated by building the children. */
+	recursive_build(prims, start, middle, depth + 1, bit_trail);
+	const int right_index = recursive_build(prims, middle, end, depth + 1, bit_trail | (1u << depth));
+	nodes[node_index].child_index = right_index;
+
+	return node_index;
+}
+
+CCL_NAMESPACE_END
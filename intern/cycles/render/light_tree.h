@@ -0,0 +1,93 @@
+/*
+ * Copyright 2011-2019 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Bounds of the directions light is emitted into: surface normals are within
+ * theta_o of the axis, and light leaves the surface within theta_e of its normal. */
+struct LightTreeCone {
+	float3 axis;
+	float theta_o;
+	float theta_e;
+
+	LightTreeCone()
+	: axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(-1.0f), theta_e(0.0f)
+	{
+	}
+
+	LightTreeCone(const float3& axis_, float theta_o_, float theta_e_)
+	: axis(axis_), theta_o(theta_o_), theta_e(theta_e_)
+	{
+	}
+
+	bool is_empty() const
+	{
+		return theta_o < 0.0f;
+	}
+
+	/* Smallest cone containing both cones. */
+	static LightTreeCone merge(const LightTreeCone& a, const LightTreeCone& b);
+
+	/* Solid angle measure of the cone, used by the build heuristic. */
+	float measure() const;
+};
+
+/* Lamp with a position or emissive triangle to be placed in the tree. */
+struct LightTreeEmitter {
+	BoundBox bbox;
+	LightTreeCone cone;
+	/* Estimated emitted power, only used relative to other emitters. */
+	float energy;
+
+	/* Index in the light distribution, and the probability of picking it there. */
+	int distribution_index;
+	float distribution_pdf;
+};
+
+/* Bounding volume hierarchy over emitters, storing the total energy and the
+ * orientation bounds of every node, so the kernel can pick lights by their
+ * estimated contribution to a shading point.
+ *
+ * Nodes are stored depth first, the left child right after its parent. Leaves
+ * refer to a range of emitters, which are stored in the order of the leaves. */
+class LightTree {
+public:
+	/* Builds the tree, reordering the emitters. */
+	explicit LightTree(vector<LightTreeEmitter>& emitters);
+
+	vector<KernelLightTreeNode> nodes;
+	vector<KernelLightTreeEmitter> emitters;
+
+protected:
+	int recursive_build(vector<LightTreeEmitter>& prims,
+	                    int start,
+	                    int end,
+	                    int depth,
+	                    uint bit_trail);
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __LIGHT_TREE_H__ */
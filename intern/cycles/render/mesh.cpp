@@ -38,6 +38,7 @@
 #include "util/util_logging.h"
 #include "util/util_progress.h"
 #include "util/util_set.h"
+#include "util/util_time.h"
 
 #ifdef WITH_EMBREE
 #  include "bvh/bvh_embree.h"
@@ -1150,10 +1151,17 @@ MeshManager::MeshManager()
 {
 	need_update = true;
 	need_flags_update = true;
+	need_full_update = true;
+	bvh_build_time = 0.0;
+	device_data_reused = false;
+	bvh = NULL;
+	bvh_build_cost = 0.0f;
+	need_bvh_rebuild = true;
 }
 
 MeshManager::~MeshManager()
 {
+	delete bvh;
 }
 
 void MeshManager::update_osl_attributes(Device *device, Scene *scene, vector<AttributeRequestSet>& mesh_attributes)
@@ -1865,11 +1873,35 @@ void MeshManager::device_update_mesh(Device *,
 	}
 }
 
-void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+bool MeshManager::can_refit_bvh(Scene *scene, const BVHParams& bparams)
 {
-	/* bvh build */
-	progress.set_status("Updating Scene BVH", "Building");
+	if(bvh == NULL || need_bvh_rebuild) {
+		return false;
+	}
+
+	if(bvh->params.bvh_layout != bparams.bvh_layout ||
+	   bvh->params.use_unaligned_nodes != bparams.use_unaligned_nodes ||
+	   bvh->params.curve_flags != bparams.curve_flags ||
+	   bvh->params.curve_subdivisions != bparams.curve_subdivisions)
+	{
+		return false;
+	}
+
+	if(bvh->objects != scene->objects) {
+		return false;
+	}
 
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		if(scene->objects[i]->mesh != bvh_meshes[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+{
 	BVHParams bparams;
 	bparams.top_level = true;
 	bparams.bvh_layout = BVHParams::best_bvh_layout(
@@ -1884,21 +1916,57 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	bparams.curve_flags = dscene->data.curve.curveflags;
 	bparams.curve_subdivisions = dscene->data.curve.subdivisions;
 
-	VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout)
-	        << " layout.";
+	/* Refitting only updates the nodes of the scene BVH, instanced meshes
+	 * are merged into it with their own BVH. */
+	bool use_refit = scene->params.use_bvh_refit &&
+	                 bparams.bvh_layout != BVH_LAYOUT_EMBREE;
+	foreach(Mesh *mesh, scene->meshes) {
+		if(mesh->need_build_bvh()) {
+			use_refit = false;
+			break;
+		}
+	}
 
-#ifdef WITH_EMBREE
-	if(bparams.bvh_layout == BVH_LAYOUT_EMBREE) {
-		if(dscene->data.bvh.scene) {
-			BVHEmbree::destroy(dscene->data.bvh.scene);
+	BVH *bvh = NULL;
+
+	if(use_refit && can_refit_bvh(scene, bparams)) {
+		progress.set_status("Updating Scene BVH", "Refitting");
+
+		bvh = this->bvh;
+		this->bvh = NULL;
+		bvh->refit(progress);
+
+		if(progress.get_cancel()) {
+			delete bvh;
+			return;
+		}
+
+		if(scene->params.bvh_refit_threshold > 0.0f) {
+			const float cost = bvh->leaf_cost();
+			if(cost > bvh_build_cost * scene->params.bvh_refit_threshold) {
+				VLOG(1) << "Refitted BVH cost " << cost << " exceeds threshold of build cost "
+				        << bvh_build_cost << ", rebuilding.";
+				delete bvh;
+				bvh = NULL;
+			}
+		}
+
+		if(bvh) {
+			VLOG(1) << "Refitted scene BVH.";
 		}
 	}
-#endif
+	else {
+		delete this->bvh;
+		this->bvh = NULL;
+	}
+
+	if(bvh == NULL) {
+		/* bvh build */
+		progress.set_status("Updating Scene BVH", "Building");
 
-	BVH *bvh = BVH::create(bparams, scene->objects);
-	bvh->build(progress, &device->stats);
+		VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout)
+		        << " layout.";
 
-	if(progress.get_cancel()) {
 #ifdef WITH_EMBREE
 		if(bparams.bvh_layout == BVH_LAYOUT_EMBREE) {
 			if(dscene->data.bvh.scene) {
@@ -1906,8 +1974,25 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 			}
 		}
 #endif
-		delete bvh;
-		return;
+
+		bvh = BVH::create(bparams, scene->objects);
+		bvh->build(progress, &device->stats);
+
+		if(progress.get_cancel()) {
+#ifdef WITH_EMBREE
+			if(bparams.bvh_layout == BVH_LAYOUT_EMBREE) {
+				if(dscene->data.bvh.scene) {
+					BVHEmbree::destroy(dscene->data.bvh.scene);
+				}
+			}
+#endif
+			delete bvh;
+			return;
+		}
+
+		if(use_refit) {
+			bvh_build_cost = bvh->leaf_cost();
+		}
 	}
 
 	/* copy to device */
@@ -1915,6 +2000,20 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 
 	PackedBVH& pack = bvh->pack;
 
+	/* The BVH kept for refitting needs its nodes and primitive mapping, the
+	 * remaining arrays are packed again when refitting. */
+	PackedBVH refit_pack;
+	if(use_refit) {
+		refit_pack.nodes = pack.nodes;
+		refit_pack.leaf_nodes = pack.leaf_nodes;
+		refit_pack.object_node = pack.object_node;
+		refit_pack.prim_type = pack.prim_type;
+		refit_pack.prim_index = pack.prim_index;
+		refit_pack.prim_object = pack.prim_object;
+		refit_pack.prim_time = pack.prim_time;
+		refit_pack.root_index = pack.root_index;
+	}
+
 	if(pack.nodes.size()) {
 		dscene->bvh_nodes.steal_data(pack.nodes);
 		dscene->bvh_nodes.copy_to_device();
@@ -1970,7 +2069,18 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	}
 #endif
 
-	delete bvh;
+	if(use_refit) {
+		pack = refit_pack;
+		this->bvh = bvh;
+
+		bvh_meshes.clear();
+		foreach(Object *object, scene->objects) {
+			bvh_meshes.push_back(object->mesh);
+		}
+	}
+	else {
+		delete bvh;
+	}
 }
 
 void MeshManager::device_update_preprocess(Device *device,
@@ -2100,6 +2210,46 @@ void MeshManager::device_update_volume_images(Device *device,
 	pool.wait_work();
 }
 
+bool MeshManager::can_reuse_device_data(Device *device, Scene *scene)
+{
+	if(need_full_update) {
+		return false;
+	}
+
+	/* Embree and meshes with transform applied put primitives in the scene
+	 * BVH, where their order depends on the object transforms. */
+	BVHLayout bvh_layout = BVHParams::best_bvh_layout(
+	        scene->params.bvh_layout,
+	        device->get_bvh_layout_mask());
+	if(bvh_layout == BVH_LAYOUT_EMBREE) {
+		return false;
+	}
+
+	foreach(Mesh *mesh, scene->meshes) {
+		if(mesh->need_update || !mesh->need_build_bvh()) {
+			return false;
+		}
+	}
+
+	if(device_meshes != scene->meshes ||
+	   device_shaders != scene->shaders ||
+	   device_objects != scene->objects)
+	{
+		return false;
+	}
+
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		if(scene->objects[i]->mesh != device_object_meshes[i]) {
+			return false;
+		}
+	}
+
+	AttributeRequestSet global_attributes;
+	scene->need_global_attributes(global_attributes);
+
+	return !global_attributes.modified(device_global_attributes);
+}
+
 void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	if(!need_update)
@@ -2142,6 +2292,29 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	/* Only the scene BVH needs to be updated when just objects changed,
+	 * the primitives of instanced meshes keep their place in it. */
+	device_data_reused = can_reuse_device_data(device, scene);
+
+	if(device_data_reused) {
+		VLOG(1) << "Mesh data unchanged, only updating scene BVH.";
+
+		scoped_timer bvh_timer;
+
+		foreach(Object *object, scene->objects) {
+			object->compute_bounds(scene->need_motion() == Scene::MOTION_BLUR);
+		}
+
+		device_free_bvh(dscene);
+		device_update_bvh(device, dscene, scene, progress);
+		if(progress.get_cancel()) return;
+
+		bvh_build_time = bvh_timer.get_time();
+
+		need_update = false;
+		return;
+	}
+
 	/* Tessellate meshes that are using subdivision */
 	if(total_tess_needed) {
 		size_t i = 0;
@@ -2201,6 +2374,10 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update) {
+			if(mesh->need_update_rebuild) {
+				need_bvh_rebuild = true;
+			}
+
 			if(displace(device, dscene, scene, mesh, progress)) {
 				displacement_done = true;
 			}
@@ -2221,6 +2398,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		if(progress.get_cancel()) return;
 	}
 
+	scoped_timer bvh_timer;
 	TaskPool pool;
 
 	size_t i = 0;
@@ -2263,10 +2441,25 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	device_update_bvh(device, dscene, scene, progress);
 	if(progress.get_cancel()) return;
 
+	bvh_build_time = bvh_timer.get_time();
+
+	need_bvh_rebuild = false;
+
 	device_update_mesh(device, dscene, scene, false, progress);
 	if(progress.get_cancel()) return;
 
 	need_update = false;
+	need_full_update = false;
+
+	device_objects = scene->objects;
+	device_meshes = scene->meshes;
+	device_shaders = scene->shaders;
+	device_object_meshes.clear();
+	foreach(Object *object, scene->objects) {
+		device_object_meshes.push_back(object->mesh);
+	}
+	device_global_attributes = AttributeRequestSet();
+	scene->need_global_attributes(device_global_attributes);
 
 	if(true_displacement_used) {
 		/* Re-tag flags for update, so they're re-evaluated
@@ -2279,7 +2472,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	}
 }
 
-void MeshManager::device_free(Device *device, DeviceScene *dscene)
+void MeshManager::device_free_bvh(DeviceScene *dscene)
 {
 	dscene->bvh_nodes.free();
 	dscene->bvh_leaf_nodes.free();
@@ -2291,6 +2484,13 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->prim_index.free();
 	dscene->prim_object.free();
 	dscene->prim_time.free();
+}
+
+void MeshManager::device_free(Device *device, DeviceScene *dscene)
+{
+	need_full_update = true;
+
+	device_free_bvh(dscene);
 	dscene->tri_shader.free();
 	dscene->tri_vnormal.free();
 	dscene->tri_vindex.free();
@@ -2321,6 +2521,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 void MeshManager::tag_update(Scene *scene)
 {
 	need_update = true;
+	need_full_update = true;
 	scene->object_manager->need_update = true;
 }
 
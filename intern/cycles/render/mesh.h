@@ -35,9 +35,11 @@ CCL_NAMESPACE_BEGIN
 
 class Attribute;
 class BVH;
+class BVHParams;
 class Device;
 class DeviceScene;
 class Mesh;
+class Object;
 class Progress;
 class RenderStats;
 class Scene;
@@ -333,6 +335,14 @@ class MeshManager {
 public:
 	bool need_update;
 	bool need_flags_update;
+	/* Changes affecting the mesh data of all meshes on the device. */
+	bool need_full_update;
+
+	/* Time spent building and refitting BVHs in the last update. */
+	double bvh_build_time;
+	/* Mesh data on the device was kept in the last update, only the scene
+	 * BVH was updated. */
+	bool device_data_reused;
 
 	MeshManager();
 	~MeshManager();
@@ -347,6 +357,7 @@ public:
 	void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 
 	void device_free(Device *device, DeviceScene *dscene);
+	void device_free_bvh(DeviceScene *dscene);
 
 	void tag_update(Scene *scene);
 
@@ -379,6 +390,28 @@ protected:
 	                       Scene *scene,
 	                       Progress& progress);
 
+	/* Scene BVH kept from the previous update for refitting, when the
+	 * topology of the meshes doesn't change. */
+	bool can_refit_bvh(Scene *scene, const BVHParams& bparams);
+
+	BVH *bvh;
+	/* Meshes of the objects the BVH was built for. */
+	vector<Mesh*> bvh_meshes;
+	/* Leaf cost of the BVH right after building. */
+	float bvh_build_cost;
+	/* Some mesh changed its triangles or curves since the last update. */
+	bool need_bvh_rebuild;
+
+	/* Mesh data on the device can be kept when no mesh changed, and objects
+	 * still use the same meshes as when it was packed. */
+	bool can_reuse_device_data(Device *device, Scene *scene);
+
+	vector<Object*> device_objects;
+	vector<Mesh*> device_object_meshes;
+	vector<Mesh*> device_meshes;
+	vector<Shader*> device_shaders;
+	AttributeRequestSet device_global_attributes;
+
 	void device_update_displacement_images(Device *device,
 	                                       Scene *scene,
 	                                       Progress& progress);
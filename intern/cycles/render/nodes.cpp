@@ -238,6 +238,8 @@ NODE_DEFINE(ImageTextureNode)
 	SOCKET_FLOAT(projection_blend, "Projection Blend", 0.0f);
 
 	SOCKET_IN_POINT(vector, "Vector", make_float3(0.0f, 0.0f, 0.0f), SocketType::LINK_TEXTURE_UV);
+	SOCKET_IN_POINT(vector_dx, "VectorDX", make_float3(0.0f, 0.0f, 0.0f), SocketType::SVM_INTERNAL);
+	SOCKET_IN_POINT(vector_dy, "VectorDY", make_float3(0.0f, 0.0f, 0.0f), SocketType::SVM_INTERNAL);
 
 	SOCKET_OUT_COLOR(color, "Color");
 	SOCKET_OUT_FLOAT(alpha, "Alpha");
@@ -317,6 +319,19 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 		int srgb = (is_linear || color_space != NODE_COLOR_SPACE_COLOR)? 0: 1;
 		int vector_offset = tex_mapping.compile_begin(compiler, vector_in);
 
+		/* Texture coordinates at the neighboring pixels, only linked when
+		 * filtering through the texture cache. */
+		ShaderInput *vector_dx_in = input("VectorDX");
+		ShaderInput *vector_dy_in = input("VectorDY");
+		const bool use_differentials = vector_dx_in->link && vector_dy_in->link;
+		int vector_dx_offset = SVM_STACK_INVALID;
+		int vector_dy_offset = SVM_STACK_INVALID;
+
+		if(use_differentials) {
+			vector_dx_offset = tex_mapping.compile_begin(compiler, vector_dx_in);
+			vector_dy_offset = tex_mapping.compile_begin(compiler, vector_dy_in);
+		}
+
 		if(projection != NODE_IMAGE_PROJ_BOX) {
 			compiler.add_node(NODE_TEX_IMAGE,
 				slot,
@@ -325,7 +340,10 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 					compiler.stack_assign_if_linked(color_out),
 					compiler.stack_assign_if_linked(alpha_out),
 					srgb),
-				projection);
+				compiler.encode_uchar4(
+					projection,
+					vector_dx_offset,
+					vector_dy_offset));
 		}
 		else {
 			compiler.add_node(NODE_TEX_IMAGE_BOX,
@@ -336,6 +354,12 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 					compiler.stack_assign_if_linked(alpha_out),
 					srgb),
 				__float_as_int(projection_blend));
+			compiler.add_node(vector_dx_offset, vector_dy_offset);
+		}
+
+		if(use_differentials) {
+			tex_mapping.compile_end(compiler, vector_dy_in, vector_dy_offset);
+			tex_mapping.compile_end(compiler, vector_dx_in, vector_dx_offset);
 		}
 
 		tex_mapping.compile_end(compiler, vector_in, vector_offset);
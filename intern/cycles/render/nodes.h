@@ -99,6 +99,7 @@ public:
 	float projection_blend;
 	bool animated;
 	float3 vector;
+	float3 vector_dx, vector_dy;
 
 	virtual bool equals(const ShaderNode& other)
 	{
@@ -109,6 +109,7 @@ Object::Object()
 	particle_system = NULL;
 	particle_index = 0;
 	bounds = BoundBox::empty;
+	need_update = true;
 }
 
 Object::~Object()
@@ -275,6 +276,8 @@ void Object::apply_transform(bool apply_to_motion)
 
 void Object::tag_update(Scene *scene)
 {
+	need_update = true;
+
 	if(mesh) {
 		if(mesh->transform_applied)
 			mesh->need_update = true;
@@ -346,6 +349,8 @@ ObjectManager::ObjectManager()
 {
 	need_update = true;
 	need_flags_update = true;
+	need_full_update = true;
+	num_updated_objects = 0;
 }
 
 ObjectManager::~ObjectManager()
@@ -547,16 +552,30 @@ void ObjectManager::device_update_object_transform_task(
 	}
 }
 
+void ObjectManager::init_transform_state(UpdateObjectTransformState *state, Scene *scene)
+{
+	state->need_motion = scene->need_motion();
+	state->have_motion = false;
+	state->have_curves = false;
+	state->scene = scene;
+	state->queue_start_object = 0;
+
+	/* Particle system device offsets
+	 * 0 is dummy particle, index starts at 1.
+	 */
+	int numparticles = 1;
+	foreach(ParticleSystem *psys, scene->particle_systems) {
+		state->particle_offset[psys] = numparticles;
+		numparticles += psys->particles.size();
+	}
+}
+
 void ObjectManager::device_update_transforms(DeviceScene *dscene,
                                              Scene *scene,
                                              Progress& progress)
 {
 	UpdateObjectTransformState state;
-	state.need_motion = scene->need_motion();
-	state.have_motion = false;
-	state.have_curves = false;
-	state.scene = scene;
-	state.queue_start_object = 0;
+	init_transform_state(&state, scene);
 
 	state.objects = dscene->objects.alloc(scene->objects.size());
 	state.object_flag = dscene->object_flag.alloc(scene->objects.size());
@@ -583,15 +602,6 @@ void ObjectManager::device_update_transforms(DeviceScene *dscene,
 		state.object_motion = dscene->object_motion.alloc(motion_offset);
 	}
 
-	/* Particle system device offsets
-	 * 0 is dummy particle, index starts at 1.
-	 */
-	int numparticles = 1;
-	foreach(ParticleSystem *psys, scene->particle_systems) {
-		state.particle_offset[psys] = numparticles;
-		numparticles += psys->particles.size();
-	}
-
 	/* NOTE: If it's just a handful of objects we deal with them in a single
 	 * thread to avoid threading overhead. However, this threshold is might
 	 * need some tweaks to make mid-complex scenes optimal.
@@ -632,6 +642,91 @@ void ObjectManager::device_update_transforms(DeviceScene *dscene,
 	dscene->data.bvh.have_instancing = true;
 }
 
+bool ObjectManager::can_update_changed_objects(DeviceScene *dscene, Scene *scene)
+{
+	/* Static BVH bakes transforms into the meshes. Motion blur and the
+	 * motion pass store object motion in arrays which are only packed as
+	 * a whole, so objects with motion always get a full update. */
+	if(need_full_update ||
+	   scene->params.bvh_type == SceneParams::BVH_STATIC ||
+	   scene->need_motion() != Scene::MOTION_NONE ||
+	   scene->particle_system_manager->need_update)
+	{
+		return false;
+	}
+
+	if(dscene->objects.size() != scene->objects.size() ||
+	   device_objects != scene->objects)
+	{
+		return false;
+	}
+
+	/* Changed meshes change surface area and offsets of all their users. */
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		Mesh *mesh = scene->objects[i]->mesh;
+		if(mesh != device_object_meshes[i] || mesh->need_update) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ObjectManager::device_update_changed_transforms(DeviceScene *dscene,
+                                                     Scene *scene,
+                                                     Progress& progress)
+{
+	UpdateObjectTransformState state;
+	init_transform_state(&state, scene);
+
+	state.objects = dscene->objects.data();
+	state.object_flag = dscene->object_flag.data();
+	/* No motion arrays, see can_update_changed_objects(). */
+	state.object_motion = NULL;
+	state.object_motion_pass = NULL;
+
+	/* Pack changed objects in place, and only copy the range of objects
+	 * spanning them to the device. */
+	size_t first = scene->objects.size();
+	size_t last = 0;
+
+	num_updated_objects = 0;
+
+	foreach(Object *ob, scene->objects) {
+		if(!ob->need_update) {
+			continue;
+		}
+
+		/* Offsets into mesh data are filled in by the mesh manager, and
+		 * did not change. */
+		KernelObject& kobject = state.objects[ob->index];
+		uint patch_map_offset = kobject.patch_map_offset;
+		uint attribute_map_offset = kobject.attribute_map_offset;
+
+		device_update_object_transform(&state, ob);
+
+		kobject.patch_map_offset = patch_map_offset;
+		kobject.attribute_map_offset = attribute_map_offset;
+
+		first = min(first, (size_t)ob->index);
+		last = max(last, (size_t)ob->index);
+		num_updated_objects++;
+
+		if(progress.get_cancel()) {
+			return;
+		}
+	}
+
+	/* Flags are packed along with the transform. */
+	if(num_updated_objects) {
+		dscene->objects.copy_to_device(first, last - first + 1);
+		dscene->object_flag.copy_to_device(first, last - first + 1);
+	}
+
+	VLOG(1) << "Updated " << num_updated_objects << " of "
+	        << scene->objects.size() << " objects.";
+}
+
 void ObjectManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	if(!need_update)
@@ -639,8 +734,27 @@ void ObjectManager::device_update(Device *device, DeviceScene *dscene, Scene *sc
 
 	VLOG(1) << "Total " << scene->objects.size() << " objects.";
 
+	/* Only pack objects that changed, when the scene is otherwise the same
+	 * as in the last update. */
+	if(can_update_changed_objects(dscene, scene)) {
+		progress.set_status("Updating Objects", "Copying Transformations to device");
+		device_update_changed_transforms(dscene, scene, progress);
+
+		if(progress.get_cancel()) return;
+
+		foreach(Object *object, scene->objects) {
+			object->need_update = false;
+		}
+
+		return;
+	}
+
 	device_free(device, dscene);
 
+	device_objects.clear();
+	device_object_meshes.clear();
+	num_updated_objects = scene->objects.size();
+
 	if(scene->objects.size() == 0)
 		return;
 
@@ -656,6 +770,13 @@ void ObjectManager::device_update(Device *device, DeviceScene *dscene, Scene *sc
 
 	if(progress.get_cancel()) return;
 
+	foreach(Object *object, scene->objects) {
+		object->need_update = false;
+		device_objects.push_back(object);
+		device_object_meshes.push_back(object->mesh);
+	}
+	need_full_update = false;
+
 	/* prepare for static BVH building */
 	/* todo: do before to support getting object level coords? */
 	if(scene->params.bvh_type == SceneParams::BVH_STATIC) {
@@ -774,6 +895,8 @@ void ObjectManager::device_update_mesh_offsets(Device *, DeviceScene *dscene, Sc
 
 void ObjectManager::device_free(Device *, DeviceScene *dscene)
 {
+	need_full_update = true;
+
 	dscene->objects.free();
 	dscene->object_motion_pass.free();
 	dscene->object_motion.free();
@@ -843,6 +966,7 @@ void ObjectManager::apply_static_transforms(DeviceScene *dscene, Scene *scene, P
 void ObjectManager::tag_update(Scene *scene)
 {
 	need_update = true;
+	need_full_update = true;
 	scene->curve_system_manager->need_update = true;
 	scene->mesh_manager->need_update = true;
 	scene->light_manager->need_update = true;
@@ -65,6 +65,9 @@ public:
 	ParticleSystem *particle_system;
 	int particle_index;
 
+	/* Changed since the last device update. */
+	bool need_update;
+
 	Object();
 	~Object();
 
@@ -107,6 +110,11 @@ class ObjectManager {
 public:
 	bool need_update;
 	bool need_flags_update;
+	/* Changes affecting all objects, which can't be updated per object. */
+	bool need_full_update;
+
+	/* Number of objects packed in the last device update. */
+	int num_updated_objects;
 
 	ObjectManager();
 	~ObjectManager();
@@ -136,10 +144,19 @@ protected:
 	void device_update_object_transform(UpdateObjectTransformState *state,
 	                                    Object *ob);
 	void device_update_object_transform_task(UpdateObjectTransformState *state);
+	void device_update_changed_transforms(DeviceScene *dscene,
+	                                      Scene *scene,
+	                                      Progress& progress);
+	bool can_update_changed_objects(DeviceScene *dscene, Scene *scene);
+	void init_transform_state(UpdateObjectTransformState *state, Scene *scene);
 	bool device_update_object_transform_pop_work(
 	        UpdateObjectTransformState *state,
 	        int *start_index,
 	        int *num_objects);
+
+	/* Objects and their meshes at the last full update, in device order. */
+	vector<Object*> device_objects;
+	vector<Mesh*> device_object_meshes;
 };
 
 CCL_NAMESPACE_END
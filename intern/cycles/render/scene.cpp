@@ -30,6 +30,7 @@
 #include "render/particles.h"
 #include "render/scene.h"
 #include "render/shader.h"
+#include "render/stats.h"
 #include "render/svm.h"
 #include "render/tables.h"
 
@@ -37,6 +38,7 @@
 #include "util/util_guarded_allocator.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -73,6 +75,10 @@ DeviceScene::DeviceScene(Device *device)
   lights(device, "__lights", MEM_TEXTURE),
   light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_TEXTURE),
   light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_TEXTURE),
+  light_tree_nodes(device, "__light_tree_nodes", MEM_TEXTURE),
+  light_tree_emitters(device, "__light_tree_emitters", MEM_TEXTURE),
+  light_tree_emitter_map(device, "__light_tree_emitter_map", MEM_TEXTURE),
+  light_tree_objects(device, "__light_tree_objects", MEM_TEXTURE),
   particles(device, "__particles", MEM_TEXTURE),
   svm_nodes(device, "__svm_nodes", MEM_TEXTURE),
   shaders(device, "__shaders", MEM_TEXTURE),
@@ -91,6 +97,8 @@ Scene::Scene(const SceneParams& params_, Device *device)
 {
 	memset((void *)&dscene.data, 0, sizeof(dscene.data));
 
+	update_time = 0.0;
+
 	camera = new Camera();
 	dicing_camera = new Camera();
 	lookup_tables = new LookupTables();
@@ -101,6 +109,7 @@ Scene::Scene(const SceneParams& params_, Device *device)
 	object_manager = new ObjectManager();
 	integrator = new Integrator();
 	image_manager = new ImageManager(device->info);
+	image_manager->set_texture_cache_size(params.texture_cache_size);
 	particle_system_manager = new ParticleSystemManager();
 	curve_system_manager = new CurveSystemManager();
 	bake_manager = new BakeManager();
@@ -183,6 +192,11 @@ void Scene::device_update(Device *device_, Progress& progress)
 	if(!device)
 		device = device_;
 
+	scoped_timer timer(&update_time);
+
+	update_step_times.clear();
+	double step_start = time_dt();
+
 	bool print_stats = need_data_update();
 
 	/* The order of updates is important, because there's dependencies between
@@ -198,85 +212,102 @@ void Scene::device_update(Device *device_, Progress& progress)
 
 	progress.set_status("Updating Shaders");
 	shader_manager->device_update(device, &dscene, this, progress);
+	update_step_done("Shaders", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Background");
 	background->device_update(device, &dscene, this);
+	update_step_done("Background", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Camera");
 	camera->device_update(device, &dscene, this);
+	update_step_done("Camera", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	mesh_manager->device_update_preprocess(device, this, progress);
+	update_step_done("Mesh Preprocess", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Objects");
 	object_manager->device_update(device, &dscene, this, progress);
+	update_step_done("Objects", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Hair Systems");
 	curve_system_manager->device_update(device, &dscene, this, progress);
+	update_step_done("Hair Systems", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Particle Systems");
 	particle_system_manager->device_update(device, &dscene, this, progress);
+	update_step_done("Particle Systems", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Meshes");
 	mesh_manager->device_update(device, &dscene, this, progress);
+	update_step_done("Meshes", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Objects Flags");
 	object_manager->device_update_flags(device, &dscene, this, progress);
+	update_step_done("Objects Flags", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Images");
 	image_manager->device_update(device, this, progress);
+	update_step_done("Images", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Camera Volume");
 	camera->device_update_volume(device, &dscene, this);
+	update_step_done("Camera Volume", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Lookup Tables");
 	lookup_tables->device_update(device, &dscene);
+	update_step_done("Lookup Tables", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Lights");
 	light_manager->device_update(device, &dscene, this, progress);
+	update_step_done("Lights", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Integrator");
 	integrator->device_update(device, &dscene, this);
+	update_step_done("Integrator", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Film");
 	film->device_update(device, &dscene, this);
+	update_step_done("Film", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Lookup Tables");
 	lookup_tables->device_update(device, &dscene);
+	update_step_done("Lookup Tables", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Baking");
 	bake_manager->device_update(device, &dscene, this, progress);
+	update_step_done("Baking", step_start);
 
 	if(progress.get_cancel() || device->have_error()) return;
 
@@ -297,6 +328,13 @@ void Scene::device_update(Device *device_, Progress& progress)
 	}
 }
 
+void Scene::update_step_done(const char *name, double& step_start)
+{
+	double now = time_dt();
+	update_step_times.push_back(pair<string, double>(name, now - step_start));
+	step_start = now;
+}
+
 Scene::MotionType Scene::need_motion()
 {
 	if(integrator->motion_blur)
@@ -387,6 +425,12 @@ void Scene::collect_statistics(RenderStats *stats)
 {
 	mesh_manager->collect_statistics(this, stats);
 	image_manager->collect_statistics(stats);
+
+	stats->scene_update.total_time = update_time;
+	stats->scene_update.step_times = update_step_times;
+	stats->scene_update.num_objects = objects.size();
+	stats->scene_update.num_updated_objects = object_manager->num_updated_objects;
+	stats->scene_update.mesh_data_reused = mesh_manager->device_data_reused;
 }
 
 CCL_NAMESPACE_END
@@ -24,6 +24,7 @@
 
 #include "device/device_memory.h"
 
+#include "util/util_map.h"
 #include "util/util_param.h"
 #include "util/util_string.h"
 #include "util/util_system.h"
@@ -107,6 +108,10 @@ public:
 	device_vector<KernelLight> lights;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<KernelLightTreeNode> light_tree_nodes;
+	device_vector<KernelLightTreeEmitter> light_tree_emitters;
+	device_vector<uint> light_tree_emitter_map;
+	device_vector<uint2> light_tree_objects;
 
 	/* particles */
 	device_vector<KernelParticle> particles;
@@ -167,8 +172,15 @@ public:
 	bool use_bvh_spatial_split;
 	bool use_bvh_unaligned_nodes;
 	int num_bvh_time_steps;
+	/* Refit the scene BVH instead of rebuilding it when only vertices moved,
+	 * rebuilding once its cost grew by more than the threshold factor. */
+	bool use_bvh_refit;
+	float bvh_refit_threshold;
 	bool persistent_data;
 	int texture_limit;
+	/* Memory budget in megabytes of the cache reading tiled images on demand,
+	 * zero loads all images into memory. */
+	int texture_cache_size;
 
 	SceneParams()
 	{
@@ -178,8 +190,11 @@ public:
 		use_bvh_spatial_split = false;
 		use_bvh_unaligned_nodes = true;
 		num_bvh_time_steps = 0;
+		use_bvh_refit = false;
+		bvh_refit_threshold = 0.0f;
 		persistent_data = false;
 		texture_limit = 0;
+		texture_cache_size = 0;
 	}
 
 	bool modified(const SceneParams& params)
@@ -189,8 +204,11 @@ public:
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes
 		&& num_bvh_time_steps == params.num_bvh_time_steps
+		&& use_bvh_refit == params.use_bvh_refit
+		&& bvh_refit_threshold == params.bvh_refit_threshold
 		&& persistent_data == params.persistent_data
-		&& texture_limit == params.texture_limit); }
+		&& texture_limit == params.texture_limit
+		&& texture_cache_size == params.texture_cache_size); }
 };
 
 /* Scene */
@@ -238,6 +256,12 @@ public:
 	/* parameters */
 	SceneParams params;
 
+	/* Time spent in the last device update. */
+	double update_time;
+
+	/* Time spent in each step of the last device update. */
+	vector<pair<string, double> > update_step_times;
+
 	/* mutex must be locked manually by callers */
 	thread_mutex mutex;
 
@@ -268,6 +292,9 @@ protected:
 	bool need_data_update();
 
 	void free_memory(bool final);
+
+	/* Record time spent in a step of device_update() and start the next one. */
+	void update_step_done(const char *name, double& step_start);
 };
 
 CCL_NAMESPACE_END
@@ -53,6 +53,8 @@ Session::Session(const SessionParams& params_)
 {
 	device_use_gl = ((params.device.type != DEVICE_CPU) && !params.background);
 
+	tile_manager.adaptive_sampling = params.adaptive_sampling;
+
 	TaskScheduler::init(params.threads);
 
 	device = Device::create(params.device, stats, profiler, params.background);
@@ -381,6 +383,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.resolution = tile_manager.state.resolution_divider;
 	rtile.tile_index = tile->index;
 	rtile.task = (tile->state == Tile::DENOISE)? RenderTile::DENOISE: RenderTile::PATH_TRACE;
+	rtile.pixel_samples = 0;
 
 	tile_lock.unlock();
 
@@ -446,6 +449,14 @@ void Session::release_tile(RenderTile& rtile)
 
 	progress.add_finished_tile(rtile.task == RenderTile::DENOISE);
 
+	if(rtile.task == RenderTile::PATH_TRACE && rtile.pixel_samples != 0) {
+		const uint64_t num_pixels = (uint64_t)rtile.w*rtile.h;
+		progress.add_adaptive_samples(num_pixels, rtile.pixel_samples);
+		VLOG(2) << "Tile " << rtile.tile_index << " rendered with "
+		        << (double)rtile.pixel_samples / num_pixels
+		        << " effective samples per pixel, out of " << rtile.sample << ".";
+	}
+
 	bool delete_tile;
 
 	if(tile_manager.finish_tile(rtile.tile_index, delete_tile)) {
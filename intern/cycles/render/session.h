@@ -65,6 +65,10 @@ public:
 	bool full_denoising;
 	DenoiseParams denoising;
 
+	/* Stop sampling pixels once they converged, only supported when rendering
+	 * each tile to the end at once. */
+	bool adaptive_sampling;
+
 	double cancel_timeout;
 	double reset_timeout;
 	double text_timeout;
@@ -96,6 +100,8 @@ public:
 		write_denoising_passes = false;
 		full_denoising = false;
 
+		adaptive_sampling = false;
+
 		display_buffer_linear = false;
 
 		cancel_timeout = 0.1;
@@ -120,6 +126,7 @@ public:
 		&& threads == params.threads
 		&& use_profiling == params.use_profiling
 		&& display_buffer_linear == params.display_buffer_linear
+		&& adaptive_sampling == params.adaptive_sampling
 		&& cancel_timeout == params.cancel_timeout
 		&& reset_timeout == params.reset_timeout
 		&& text_timeout == params.text_timeout
@@ -208,6 +208,43 @@ string MeshStats::full_report(int indent_level)
 	return result;
 }
 
+/* Texture cache statistics. */
+
+TextureCacheStats::TextureCacheStats()
+    : num_images(0),
+      memory_limit(0),
+      memory_used(0),
+      bytes_read(0),
+      tiles_read(0),
+      tiles_evicted(0),
+      lookups(0),
+      misses(0) {
+}
+
+string TextureCacheStats::full_report(int indent_level)
+{
+	const string indent(indent_level * kIndentNumSpaces, ' ');
+	string result = "";
+	result += string_printf("%sImages: %d\n", indent.c_str(), num_images);
+	result += string_printf("%sMemory: %s of %s\n",
+	                        indent.c_str(),
+	                        string_human_readable_size(memory_used).c_str(),
+	                        string_human_readable_size(memory_limit).c_str());
+	result += string_printf("%sRead from files: %s\n",
+	                        indent.c_str(),
+	                        string_human_readable_size(bytes_read).c_str());
+	result += string_printf("%sTiles read: %s, evicted: %s\n",
+	                        indent.c_str(),
+	                        string_human_readable_number(tiles_read).c_str(),
+	                        string_human_readable_number(tiles_evicted).c_str());
+	result += string_printf("%sTile lookups: %s, misses: %s (%.2f%%)\n",
+	                        indent.c_str(),
+	                        string_human_readable_number(lookups).c_str(),
+	                        string_human_readable_number(misses).c_str(),
+	                        (lookups > 0)? 100.0 * misses / lookups: 0.0);
+	return result;
+}
+
 /* Image statistics. */
 
 ImageStats::ImageStats() {
@@ -218,11 +255,45 @@ string ImageStats::full_report(int indent_level)
 	const string indent(indent_level * kIndentNumSpaces, ' ');
 	string result = "";
 	result += indent + "Textures:\n" + textures.full_report(indent_level + 1);
+	if(texture_cache.num_images > 0) {
+		result += indent + "Texture cache:\n" + texture_cache.full_report(indent_level + 1);
+	}
 	return result;
 }
 
 /* Overall statistics. */
 
+/* Scene update stats. */
+
+SceneUpdateStats::SceneUpdateStats()
+    : total_time(0.0),
+      num_objects(0),
+      num_updated_objects(0),
+      mesh_data_reused(false) {
+}
+
+string SceneUpdateStats::full_report(int indent_level)
+{
+	const string indent(indent_level * kIndentNumSpaces, ' ');
+	const string double_indent = indent + indent;
+	string result = "";
+	result += string_printf("%sTotal time: %.4fs\n", indent.c_str(), total_time);
+	for(size_t i = 0; i < step_times.size(); i++) {
+		result += string_printf("%s%-20s %.4fs\n",
+		                        double_indent.c_str(),
+		                        (step_times[i].first + ":").c_str(),
+		                        step_times[i].second);
+	}
+	result += string_printf("%sObjects: %d, packed: %d\n",
+	                        indent.c_str(),
+	                        num_objects,
+	                        num_updated_objects);
+	result += string_printf("%sMesh data reused: %s\n",
+	                        indent.c_str(),
+	                        mesh_data_reused ? "yes" : "no");
+	return result;
+}
+
 RenderStats::RenderStats() {
 	has_profiling = false;
 }
@@ -297,6 +368,7 @@ string RenderStats::full_report()
 	string result = "";
 	result += "Mesh statistics:\n" + mesh.full_report(1);
 	result += "Image statistics:\n" + image.full_report(1);
+	result += "Scene update statistics:\n" + scene_update.full_report(1);
 	if(has_profiling) {
 		result += "Kernel statistics:\n" + kernel.full_report(1);
 		result += "Shader statistics:\n" + shaders.full_report(1);
@@ -124,6 +124,30 @@ public:
 	NamedSizeStats geometry;
 };
 
+/* Statistics about images read on demand through the texture cache. */
+class TextureCacheStats {
+public:
+	TextureCacheStats();
+
+	/* Generate full human-readable report. */
+	string full_report(int indent_level = 0);
+
+	int num_images;
+
+	/* Memory budget and memory used by tiles currently in the cache. */
+	size_t memory_limit;
+	size_t memory_used;
+
+	/* Data read from files, and tiles dropped to stay within the budget. */
+	uint64_t bytes_read;
+	uint64_t tiles_read;
+	uint64_t tiles_evicted;
+
+	/* Tile lookups, and the ones which were not in the cache. */
+	uint64_t lookups;
+	uint64_t misses;
+};
+
 /* Statistics about images held in memory. */
 class ImageStats {
 public:
@@ -133,6 +157,31 @@ public:
 	string full_report(int indent_level = 0);
 
 	NamedSizeStats textures;
+	TextureCacheStats texture_cache;
+};
+
+/* Statistics about the last scene device update. */
+class SceneUpdateStats {
+public:
+	SceneUpdateStats();
+
+	/* Generate full human-readable report. */
+	string full_report(int indent_level = 0);
+
+	/* Total time and time spent in each step, in seconds. */
+	double total_time;
+	vector<pair<string, double> > step_times;
+
+	/* Objects in the scene and the ones packed in the last update, which is
+	 * all of them unless only some transforms changed.
+	 */
+	int num_objects;
+	int num_updated_objects;
+
+	/* Mesh data on the device was kept from the previous update and only
+	 * the BVH was rebuilt.
+	 */
+	bool mesh_data_reused;
 };
 
 /* Render process statistics. */
@@ -150,6 +199,7 @@ public:
 
 	MeshStats mesh;
 	ImageStats image;
+	SceneUpdateStats scene_update;
 	NamedNestedSampleStats kernel;
 	NamedSampleCountStats shaders;
 	NamedSampleCountStats objects;
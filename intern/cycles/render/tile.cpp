@@ -79,6 +79,12 @@ inline int2 hilbert_index_to_pos(int n, int d)
 	return xy;
 }
 
+/* Tiles are not split below this size. */
+const int TILE_SPLIT_MIN_SIZE = 16;
+/* Maximum number of tiles added by splitting, storage for them is reserved
+ * up front since tiles are referenced by pointer while rendering. */
+const int TILE_SPLIT_MAX_TILES = 1024;
+
 enum SpiralDirection {
 	DIRECTION_UP,
 	DIRECTION_LEFT,
@@ -102,6 +108,8 @@ TileManager::TileManager(bool progressive_, int num_samples_, int2 tile_size_, i
 	preserve_tile_device = preserve_tile_device_;
 	background = background_;
 	schedule_denoising = false;
+	adaptive_sampling = false;
+	split_tiles = true;
 
 	range_start_sample = 0;
 	range_num_samples = -1;
@@ -150,6 +158,7 @@ void TileManager::reset(BufferParams& params_, int num_samples_)
 	state.sample = range_start_sample - 1;
 	state.num_tiles = 0;
 	state.num_samples = 0;
+	state.num_rendering_tiles = 0;
 	state.resolution_divider = get_divider(params.width, params.height, start_resolution);
 	state.render_tiles.clear();
 	state.denoising_tiles.clear();
@@ -363,6 +372,11 @@ void TileManager::set_tiles()
 	int image_h = max(1, params.height/resolution);
 
 	state.num_tiles = gen_tiles(!background);
+	state.num_rendering_tiles = 0;
+
+	if(can_split_tiles()) {
+		state.tiles.reserve(state.tiles.size() + TILE_SPLIT_MAX_TILES);
+	}
 
 	state.buffer.width = image_w;
 	state.buffer.height = image_h;
@@ -419,6 +433,7 @@ bool TileManager::finish_tile(int index, bool &delete_tile)
 	switch(state.tiles[index].state) {
 		case Tile::RENDER:
 		{
+			state.num_rendering_tiles--;
 			if(!schedule_denoising) {
 				state.tiles[index].state = Tile::DONE;
 				delete_tile = true;
@@ -479,12 +494,80 @@ bool TileManager::next_tile(Tile* &tile, int device)
 	if(state.render_tiles[logical_device].empty())
 		return false;
 
+	if(can_split_tiles()) {
+		split_tail_tiles(state.render_tiles[logical_device]);
+	}
+
 	int idx = state.render_tiles[logical_device].front();
 	state.render_tiles[logical_device].pop_front();
 	tile = &state.tiles[idx];
+	state.num_rendering_tiles++;
 	return true;
 }
 
+/* Splitting changes the tile layout, so it's only done when tiles are rendered
+ * once and not needed for anything else afterwards. Neighbor lookups for
+ * denoising and the per-sample tile regeneration of progressive rendering
+ * rely on the original tile grid. Adaptive sampling spreads the convergence
+ * test over the tile, smaller tiles would change which pixels stop early. */
+bool TileManager::can_split_tiles()
+{
+	return split_tiles && background && !progressive && !schedule_denoising &&
+	       !adaptive_sampling && !preserve_tile_device;
+}
+
+/* Near the end of the render fewer tiles are left than there are threads
+ * rendering, and the last few (often expensive) tiles keep some threads
+ * busy while the others idle. Split the largest remaining tiles in half
+ * until every rendering thread can get another tile, so the work left at
+ * the end gets finer grained and is spread over all threads. */
+void TileManager::split_tail_tiles(list<int>& tiles)
+{
+	const int min_size = max(TILE_SPLIT_MIN_SIZE, min(tile_size.x, tile_size.y)/4);
+
+	while((int)tiles.size() <= state.num_rendering_tiles) {
+		if(state.tiles.size() == state.tiles.capacity()) {
+			/* Never reallocate, tiles handed out are referenced by pointer. */
+			break;
+		}
+
+		list<int>::iterator largest = tiles.end();
+		int largest_area = 0;
+		for(list<int>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+			const Tile& tile = state.tiles[*it];
+			if(max(tile.w, tile.h) >= 2*min_size && tile.w*tile.h > largest_area) {
+				largest = it;
+				largest_area = tile.w*tile.h;
+			}
+		}
+
+		if(largest == tiles.end()) {
+			break;
+		}
+
+		/* Split along the longer side, the new tile is rendered right after
+		 * the remaining part of the original one. */
+		Tile& tile = state.tiles[*largest];
+		Tile half = tile;
+		half.index = state.tiles.size();
+
+		if(tile.w >= tile.h) {
+			half.w = tile.w/2;
+			half.x = tile.x + tile.w - half.w;
+			tile.w -= half.w;
+		}
+		else {
+			half.h = tile.h/2;
+			half.y = tile.y + tile.h - half.h;
+			tile.h -= half.h;
+		}
+
+		state.tiles.push_back(half);
+		tiles.insert(++largest, half.index);
+		state.num_tiles++;
+	}
+}
+
 bool TileManager::done()
 {
 	int end_sample = (range_num_samples == -1)
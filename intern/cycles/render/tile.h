@@ -83,6 +83,9 @@ public:
 		 * Each list in each vector is for one logical device. */
 		vector<list<int> > render_tiles;
 		vector<list<int> > denoising_tiles;
+
+		/* Number of tiles handed out for rendering and not finished yet. */
+		int num_rendering_tiles;
 	} state;
 
 	int num_samples;
@@ -114,6 +117,13 @@ public:
 
 	/* Schedule tiles for denoising after they've been rendered. */
 	bool schedule_denoising;
+
+	/* Tiles stop sampling pixels once they converged. */
+	bool adaptive_sampling;
+
+	/* Split the remaining tiles near the end of the render, so threads which
+	 * run out of work get a share of it instead of idling. */
+	bool split_tiles;
 protected:
 
 	void set_tiles();
@@ -148,6 +158,9 @@ protected:
 	int gen_tiles(bool sliced);
 	void gen_render_tiles();
 
+	bool can_split_tiles();
+	void split_tail_tiles(list<int>& tiles);
+
 	int get_neighbor_index(int index, int neighbor);
 	bool check_neighbor_state(int index, Tile::State state);
 };
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2011-2019 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/light_tree.h"
+
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernel_color.h"
+#include "kernel/kernels/cpu/kernel_cpu_image.h"
+#include "kernel/kernel_film.h"
+#include "kernel/kernel_path.h"
+
+#include "util/util_hash.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Number of random numbers the sampling is integrated over. Emitters cover
+ * intervals of the random number proportional to their pdf, so the midpoint
+ * rule is exact up to the intervals cut at their ends. */
+const int NUM_STEPS = 1 << 16;
+
+class LightTreeTest : public testing::Test {
+protected:
+	void build(int num_emitters)
+	{
+		vector<LightTreeEmitter> emitters;
+		uint seed = 0;
+
+		for(int i = 0; i < num_emitters; i++) {
+			const float3 co = make_float3(20.0f*hash_int_01(seed++) - 10.0f,
+			                              20.0f*hash_int_01(seed++) - 10.0f,
+			                              20.0f*hash_int_01(seed++) - 10.0f);
+			const float size = 0.01f + 0.5f*hash_int_01(seed++);
+
+			LightTreeEmitter emitter;
+			emitter.bbox = BoundBox(co - make_float3(size, size, size),
+			                        co + make_float3(size, size, size));
+			emitter.energy = 0.1f + 10.0f*hash_int_01(seed++);
+			emitter.distribution_index = i;
+			emitter.distribution_pdf = 1.0f/num_emitters;
+
+			/* Mix of point lights, and area lights facing random directions. */
+			if(i % 3 == 0) {
+				emitter.cone = LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+			}
+			else {
+				const float3 axis = normalize(make_float3(hash_int_01(seed++) - 0.5f,
+				                                          hash_int_01(seed++) - 0.5f,
+				                                          hash_int_01(seed++) - 0.5f));
+				emitter.cone = LightTreeCone(axis, 0.0f, M_PI_2_F);
+			}
+
+			emitters.push_back(emitter);
+		}
+
+		tree.reset(new LightTree(emitters));
+
+		memset(&kg, 0, sizeof(kg));
+		kg.__light_tree_nodes.data = &tree->nodes[0];
+		kg.__light_tree_nodes.width = tree->nodes.size();
+		kg.__light_tree_emitters.data = &tree->emitters[0];
+		kg.__light_tree_emitters.width = tree->emitters.size();
+
+		kg.__data.integrator.use_light_tree = 1;
+		kg.__data.integrator.light_tree_num_emitters = num_emitters;
+		kg.__data.integrator.light_tree_num_distant = 0;
+		kg.__data.integrator.light_tree_distant_prob = 0.0f;
+	}
+
+	/* Integrate the probability of sampling every emitter over the random
+	 * number, and compare it with the evaluated pdf. */
+	void check_pdf(const float3 P)
+	{
+		const int num_emitters = tree->emitters.size();
+		vector<int> count(num_emitters, 0);
+		int num_none = 0;
+
+		for(int step = 0; step < NUM_STEPS; step++) {
+			float randu = (step + 0.5f)/NUM_STEPS;
+			float pdf;
+			const int emitter = light_tree_sample(&kg, P, &randu, &pdf);
+
+			if(emitter == -1) {
+				num_none++;
+				continue;
+			}
+
+			ASSERT_GE(emitter, 0);
+			ASSERT_LT(emitter, num_emitters);
+			EXPECT_GE(randu, 0.0f);
+			EXPECT_LE(randu, 1.0f);
+
+			/* Multiple importance sampling needs the same pdf for lights hit
+			 * by rays. */
+			EXPECT_NEAR(pdf, light_tree_pdf(&kg, P, emitter), 1e-5f*pdf);
+			count[emitter]++;
+		}
+
+		float pdf_sum = 0.0f;
+
+		for(int i = 0; i < num_emitters; i++) {
+			const float pdf = light_tree_pdf(&kg, P, i);
+			const float integral = (float)count[i]/NUM_STEPS;
+
+			EXPECT_NEAR(integral, pdf, 4.0f/NUM_STEPS) << "emitter " << i;
+
+			/* Lights that may contribute must never be culled. */
+			if(light_tree_emitter_importance(&kg, P, i) > 0.0f) {
+				EXPECT_GT(pdf, 0.0f) << "emitter " << i;
+			}
+
+			pdf_sum += pdf;
+		}
+
+		if(num_none == 0) {
+			EXPECT_NEAR(pdf_sum, 1.0f, 1e-4f);
+		}
+		else {
+			EXPECT_EQ(num_none, NUM_STEPS);
+			EXPECT_EQ(pdf_sum, 0.0f);
+		}
+	}
+
+	KernelGlobals kg;
+	unique_ptr<LightTree> tree;
+};
+
+}  // namespace
+
+TEST_F(LightTreeTest, single_emitter)
+{
+	build(1);
+	check_pdf(make_float3(0.0f, 0.0f, 20.0f));
+}
+
+TEST_F(LightTreeTest, pdf_integral)
+{
+	build(500);
+
+	/* Shading points outside of and in between the emitters. */
+	check_pdf(make_float3(0.0f, 0.0f, 0.0f));
+	check_pdf(make_float3(5.0f, -3.0f, 1.0f));
+	check_pdf(make_float3(40.0f, 10.0f, -25.0f));
+	check_pdf(make_float3(-9.5f, 9.5f, 9.5f));
+}
+
+CCL_NAMESPACE_END
@@ -228,6 +228,14 @@ __forceinline const avxb operator <=(const avxf& a, const avxf& b) {
 	return _mm256_cmp_ps(a.m256, b.m256, _CMP_LE_OS);
 }
 
+__forceinline const avxb operator <(const avxf& a, const avxf& b) {
+	return _mm256_cmp_ps(a.m256, b.m256, _CMP_LT_OS);
+}
+
+__forceinline const avxf select(const avxb& m, const avxf& t, const avxf& f) {
+	return _mm256_blendv_ps(f, t, m);
+}
+
 #endif
 
 #ifndef _mm256_set_m128
@@ -32,7 +32,8 @@ DebugFlags::CPU::CPU()
     sse3(true),
     sse2(true),
     bvh_layout(BVH_LAYOUT_DEFAULT),
-    split_kernel(false)
+    split_kernel(false),
+    packet_traversal(false)
 {
 	reset();
 }
@@ -71,6 +72,7 @@ void DebugFlags::CPU::reset()
 	}
 
 	split_kernel = false;
+	packet_traversal = (getenv("CYCLES_CPU_PACKET_TRAVERSAL") != NULL);
 }
 
 DebugFlags::CUDA::CUDA()
@@ -150,7 +152,8 @@ std::ostream& operator <<(std::ostream &os,
 	   << "  SSE3       : " << string_from_bool(debug_flags.cpu.sse3) << "\n"
 	   << "  SSE2       : " << string_from_bool(debug_flags.cpu.sse2) << "\n"
 	   << "  BVH layout : " << bvh_layout_name(debug_flags.cpu.bvh_layout) << "\n"
-	   << "  Split      : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n";
+	   << "  Split      : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n"
+	   << "  Packets    : " << string_from_bool(debug_flags.cpu.packet_traversal) << "\n";
 
 	os << "CUDA flags:\n"
 	   << " Adaptive Compile: " << string_from_bool(debug_flags.cuda.adaptive_compile) << "\n";
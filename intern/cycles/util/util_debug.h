@@ -65,6 +65,10 @@ public:
 
 		/* Whether split kernel is used */
 		bool split_kernel;
+
+		/* Whether camera rays are traced in packets of 8 rays, on CPUs
+		 * with AVX2. */
+		bool packet_traversal;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
@@ -39,6 +39,8 @@ public:
 		current_tile_sample = 0;
 		rendered_tiles = 0;
 		denoised_tiles = 0;
+		adaptive_pixels = 0;
+		adaptive_pixel_samples = 0;
 		start_time = time_dt();
 		render_start_time = time_dt();
 		end_time = 0.0;
@@ -79,6 +81,8 @@ public:
 		current_tile_sample = 0;
 		rendered_tiles = 0;
 		denoised_tiles = 0;
+		adaptive_pixels = 0;
+		adaptive_pixel_samples = 0;
 		start_time = time_dt();
 		render_start_time = time_dt();
 		end_time = 0.0;
@@ -191,6 +195,8 @@ public:
 		current_tile_sample = 0;
 		rendered_tiles = 0;
 		denoised_tiles = 0;
+		adaptive_pixels = 0;
+		adaptive_pixel_samples = 0;
 	}
 
 	void set_total_pixel_samples(uint64_t total_pixel_samples_)
@@ -234,6 +240,26 @@ public:
 		}
 	}
 
+	void add_adaptive_samples(uint64_t pixels, uint64_t pixel_samples_)
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		adaptive_pixels += pixels;
+		adaptive_pixel_samples += pixel_samples_;
+	}
+
+	/* Average number of samples taken per pixel by adaptive sampling, zero if
+	 * no tile used it. */
+	float get_adaptive_samples()
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		if(adaptive_pixels == 0) {
+			return 0.0f;
+		}
+		return (float)((double)adaptive_pixel_samples / adaptive_pixels);
+	}
+
 	int get_current_sample()
 	{
 		thread_scoped_lock lock(progress_mutex);
@@ -345,6 +371,8 @@ protected:
 	/* Stores the number of tiles that's already finished.
 	 * Used to determine whether all but the last tile are finished rendering, in which case the current_tile_sample is displayed. */
 	int rendered_tiles, denoised_tiles;
+	/* Pixels and samples taken by them in tiles rendered with adaptive sampling. */
+	uint64_t adaptive_pixels, adaptive_pixel_samples;
 
 	double start_time, render_start_time;
 	/* End time written when render is done, so it doesn't keep increasing on redraws. */
@@ -62,6 +62,13 @@ typedef enum ImageDataType {
 #define IMAGE_DATA_TYPE_SHIFT 3
 #define IMAGE_DATA_TYPE_MASK 0x7
 
+/* Sparse 3D images are split into tiles of TEX_SPARSE_TILE_SIZE^3 voxels.
+ * The data starts with the offset of every tile, in voxels from the start of
+ * the data or -1 for empty tiles, followed by the voxels of non-empty tiles. */
+#define TEX_SPARSE_TILE_SHIFT 3
+#define TEX_SPARSE_TILE_SIZE (1 << TEX_SPARSE_TILE_SHIFT)
+#define TEX_SPARSE_TILE_MASK (TEX_SPARSE_TILE_SIZE - 1)
+
 /* Extension types for textures.
  *
  * Defines how the image is extrapolated past its original bounds. */
@@ -85,6 +92,17 @@ typedef struct TextureInfo {
 	uint interpolation, extension;
 	/* Dimensions. */
 	uint width, height, depth;
+	/* Pixels are read on demand through the texture cache, data is the
+	 * handle of the image in the cache (CPU only). */
+	uint use_texture_cache;
+	/* 3D image stored as sparse tiles, dimensions are those of the dense
+	 * image (CPU only). */
+	uint sparse_grid;
+	/* Alpha channel of the file is not used, read as opaque (texture cache
+	 * only). */
+	uint ignore_alpha;
+	/* Keep 16 byte aligned for OpenCL. */
+	uint pad;
 } TextureInfo;
 
 CCL_NAMESPACE_END
@@ -121,14 +121,17 @@ void *mmap(void *UNUSED(start), size_t len, int prot, int flags, int fd, off_t o
 		}
 	}
 
-	/* note len is passed to a 32 bit DWORD, so can't be > 4 GB */
-	maphandle = CreateFileMapping(fhandle, NULL, prot_flags, 0, len, NULL);
+	/* Length and offset are passed as high and low 32 bit DWORDs, so mappings
+	 * larger than 4 GB work. */
+	maphandle = CreateFileMapping(fhandle, NULL, prot_flags,
+	                              (DWORD)((uint64_t)len >> 32), (DWORD)((uint64_t)len & 0xFFFFFFFF), NULL);
 	if (maphandle == 0) {
 		errno = EBADF;
 		return MAP_FAILED;
 	}
 
-	ptr = MapViewOfFile(maphandle, access_flags, 0, offset, 0);
+	ptr = MapViewOfFile(maphandle, access_flags,
+	                    (DWORD)((uint64_t)offset >> 32), (DWORD)((uint64_t)offset & 0xFFFFFFFF), 0);
 	if (ptr == NULL) {
 		DWORD dwLastErr = GetLastError();
 		if (dwLastErr == ERROR_MAPPED_ALIGNMENT)
@@ -673,6 +673,7 @@ class USERPREF_PT_system_memory(PreferencePanel):
         flow = layout.grid_flow(row_major=False, columns=0, even_columns=True, even_rows=False, align=False)
 
         flow.prop(system, "memory_cache_limit", text="Sequencer Cache Limit")
+        flow.prop(system, "sequencer_disk_cache_limit", text="Sequencer Disk Cache Limit")
         flow.prop(system, "scrollback", text="Console Scrollback Lines")
 
         layout.separator()
@@ -1181,6 +1182,7 @@ class USERPREF_PT_file_paths_render(FilePathsPanel):
         col = self.layout.column()
         col.prop(paths, "render_output_directory", text="Render Output")
         col.prop(paths, "render_cache_directory", text="Render Cache")
+        col.prop(paths, "sequencer_disk_cache_directory", text="Sequencer Disk Cache")
 
 
 class USERPREF_PT_file_paths_applications(FilePathsPanel):
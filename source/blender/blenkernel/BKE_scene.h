@@ -194,6 +194,7 @@ void BKE_scene_ensure_depsgraph_hash(struct Scene *scene);
 void BKE_scene_free_depsgraph_hash(struct Scene *scene);
 
 struct Depsgraph *BKE_scene_get_depsgraph(struct Scene *scene, struct ViewLayer *view_layer, bool allocate);
+void BKE_scene_depsgraphs_move(struct Scene *scene_dst, struct Scene *scene_src);
 
 void BKE_scene_transform_orientation_remove(
         struct Scene *scene, struct TransformOrientation *orientation);
@@ -61,7 +61,11 @@
 
 #define UNDO_DISK   0
 
-bool BKE_memfile_undo_decode(MemFileUndoData *mfu, bContext *C)
+/**
+ * \param mfu_current: The undo step matching the current state (can be NULL),
+ * data-blocks unchanged since it was written and identical in \a mfu are kept as they are.
+ */
+bool BKE_memfile_undo_decode(MemFileUndoData *mfu, MemFileUndoData *mfu_current, bContext *C)
 {
 	Main *bmain = CTX_data_main(C);
 	char mainstr[sizeof(bmain->name)];
@@ -77,7 +81,7 @@ bool BKE_memfile_undo_decode(MemFileUndoData *mfu, bContext *C)
 	}
 	else {
 		success = BKE_blendfile_read_from_memfile(
-		        C, &mfu->memfile,
+		        C, &mfu->memfile, mfu_current ? &mfu_current->memfile : NULL,
 		        &(const struct BlendFileReadParams){0},
 		        NULL);
 	}
@@ -119,6 +123,13 @@ MemFileUndoData *BKE_memfile_undo_encode(Main *bmain, MemFileUndoData *mfu_prev)
 	}
 	else {
 		MemFile *prevfile = (mfu_prev) ? &(mfu_prev->memfile) : NULL;
+		/* The written state is the new reference for changes, see BKE_memfile_undo_decode(). */
+		ID *id;
+		FOREACH_MAIN_ID_BEGIN(bmain, id)
+		{
+			id->recalc_after_undo_push = 0;
+		}
+		FOREACH_MAIN_ID_END;
 		/* success = */ /* UNUSED */ BLO_write_file_mem(bmain, prevfile, &mfu->memfile, G.fileflags);
 		mfu->undo_size = mfu->memfile.size;
 	}
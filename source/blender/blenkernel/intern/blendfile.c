@@ -47,6 +47,7 @@
 #include "BKE_ipo.h"
 #include "BKE_layer.h"
 #include "BKE_library.h"
+#include "BKE_library_query.h"
 #include "BKE_main.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
@@ -56,6 +57,9 @@
 #include "BLO_readfile.h"
 #include "BLO_writefile.h"
 
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+
 #include "RNA_access.h"
 
 #include "RE_pipeline.h"
@@ -98,6 +102,76 @@ static bool wm_scene_is_visible(wmWindowManager *wm, Scene *scene)
 	return false;
 }
 
+static int undo_id_uses_read_id_cb(void *user_data, ID *UNUSED(id_self), ID **id_pointer, int UNUSED(cb_flag))
+{
+	if (*id_pointer && ((*id_pointer)->tag & LIB_TAG_UNDO_OLD_ID_REUSED) == 0) {
+		*(bool *)user_data = true;
+		return IDWALK_RET_STOP_ITER;
+	}
+	return IDWALK_RET_NOP;
+}
+
+/**
+ * Keep depsgraphs of the old main on undo, so evaluated copies of the data-blocks undo kept
+ * as they are (see BLO_read_from_memfile()) are not copied again.
+ *
+ * Relations are built while both mains exist: addresses of the old data-blocks
+ * can't be reused yet, so only the kept ones find their evaluated copy.
+ */
+static void setup_app_data_undo_depsgraphs_keep(Main *bmain_old, Main *bmain_new)
+{
+	bool has_reused_ids = false;
+	ID *id;
+	FOREACH_MAIN_ID_BREAKABLE_BEGIN(bmain_new, id, has_reused_ids)
+	{
+		if (id->tag & LIB_TAG_UNDO_OLD_ID_REUSED) {
+			has_reused_ids = true;
+			break;
+		}
+	}
+	FOREACH_MAIN_ID_BREAKABLE_END;
+	if (!has_reused_ids) {
+		return;
+	}
+
+	for (Scene *scene_old = bmain_old->scenes.first; scene_old; scene_old = scene_old->id.next) {
+		Scene *scene_new = BLI_findstring(&bmain_new->scenes, scene_old->id.name, offsetof(ID, name));
+		if (scene_new != NULL) {
+			BKE_scene_depsgraphs_move(scene_new, scene_old);
+		}
+	}
+
+	for (Scene *scene = bmain_new->scenes.first; scene; scene = scene->id.next) {
+		for (ViewLayer *view_layer = scene->view_layers.first; view_layer; view_layer = view_layer->next) {
+			Depsgraph *depsgraph = BKE_scene_get_depsgraph(scene, view_layer, false);
+			if (depsgraph == NULL) {
+				continue;
+			}
+			DEG_graph_build_from_view_layer(depsgraph, bmain_new, scene, view_layer);
+
+			/* Evaluated copies point to the evaluated copies of the data-blocks they use,
+			 * copy again the ones using data-blocks which were read again. */
+			FOREACH_MAIN_ID_BEGIN(bmain_new, id)
+			{
+				if (id->tag & LIB_TAG_UNDO_OLD_ID_REUSED) {
+					bool uses_read_id = false;
+					BKE_library_foreach_ID_link(NULL, id, undo_id_uses_read_id_cb, &uses_read_id, IDWALK_READONLY);
+					if (uses_read_id) {
+						DEG_graph_id_tag_update(bmain_new, depsgraph, id, ID_RECALC_COPY_ON_WRITE);
+					}
+				}
+			}
+			FOREACH_MAIN_ID_END;
+		}
+	}
+
+	FOREACH_MAIN_ID_BEGIN(bmain_new, id)
+	{
+		id->tag &= ~LIB_TAG_UNDO_OLD_ID_REUSED;
+	}
+	FOREACH_MAIN_ID_END;
+}
+
 /**
  * Context matching, handle no-ui case
  *
@@ -226,6 +300,10 @@ static void setup_app_data(
 		}
 	}
 
+	if (mode == LOAD_UNDO) {
+		setup_app_data_undo_depsgraphs_keep(bmain, bfd->main);
+	}
+
 	/* free G_MAIN Main database */
 //	CTX_wm_manager_set(C, NULL);
 	BKE_blender_globals_clear();
@@ -429,14 +507,15 @@ bool BKE_blendfile_read_from_memory(
 
 /* memfile is the undo buffer */
 bool BKE_blendfile_read_from_memfile(
-        bContext *C, struct MemFile *memfile,
+        bContext *C, struct MemFile *memfile, struct MemFile *memfile_current,
         const struct BlendFileReadParams *params,
         ReportList *reports)
 {
 	Main *bmain = CTX_data_main(C);
 	BlendFileData *bfd;
 
-	bfd = BLO_read_from_memfile(bmain, BKE_main_blendfile_path(bmain), memfile, params->skip_flags, reports);
+	bfd = BLO_read_from_memfile(
+	        bmain, BKE_main_blendfile_path(bmain), memfile, memfile_current, params->skip_flags, reports);
 	if (bfd) {
 		/* remove the unused screens and wm */
 		while (bfd->main->wm.first)
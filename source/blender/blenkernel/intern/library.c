@@ -846,6 +846,8 @@ void BKE_libblock_management_main_add(Main *bmain, void *idv)
 	BKE_id_new_name_validate(lb, id, NULL);
 	/* alphabetic insertion: is in new_id */
 	id->tag &= ~(LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT);
+	/* Not in any undo memfile yet. */
+	id->recalc_after_undo_push = ID_RECALC_ALL;
 	bmain->is_memfile_undo_written = false;
 	BKE_main_unlock(bmain);
 }
@@ -1126,6 +1128,8 @@ void *BKE_libblock_alloc(Main *bmain, short type, const char *name, const int fl
 			BKE_main_lock(bmain);
 			BLI_addtail(lb, id);
 			BKE_id_new_name_validate(lb, id, name);
+			/* Not in any undo memfile yet. */
+			id->recalc_after_undo_push = ID_RECALC_ALL;
 			bmain->is_memfile_undo_written = false;
 			/* alphabetic insertion: is in new_id */
 			BKE_main_unlock(bmain);
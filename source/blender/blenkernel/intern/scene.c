@@ -2147,6 +2147,40 @@ void BKE_scene_ensure_depsgraph_hash(Scene *scene)
 	}
 }
 
+/**
+ * Move depsgraphs of \a scene_src to \a scene_dst, for view layers found by name in both.
+ * Used on undo, so evaluated copies of data-blocks kept from the previous state are not
+ * copied again, relations are to be built again.
+ */
+void BKE_scene_depsgraphs_move(Scene *scene_dst, Scene *scene_src)
+{
+	if (scene_src->depsgraph_hash == NULL) {
+		return;
+	}
+	for (ViewLayer *view_layer_src = scene_src->view_layers.first;
+	     view_layer_src != NULL;
+	     view_layer_src = view_layer_src->next)
+	{
+		ViewLayer *view_layer_dst = BLI_findstring(
+		        &scene_dst->view_layers, view_layer_src->name, offsetof(ViewLayer, name));
+		if ((view_layer_dst == NULL) || BKE_scene_get_depsgraph(scene_dst, view_layer_dst, false)) {
+			continue;
+		}
+		DepsgraphKey key;
+		key.view_layer = view_layer_src;
+		Depsgraph *depsgraph = BLI_ghash_popkey(scene_src->depsgraph_hash, &key, depsgraph_key_free);
+		if (depsgraph == NULL) {
+			continue;
+		}
+		DEG_graph_replace_owners(depsgraph, scene_dst, view_layer_dst);
+
+		BKE_scene_ensure_depsgraph_hash(scene_dst);
+		DepsgraphKey *key_dst = MEM_mallocN(sizeof(DepsgraphKey), __func__);
+		key_dst->view_layer = view_layer_dst;
+		BLI_ghash_insert(scene_dst->depsgraph_hash, key_dst, depsgraph);
+	}
+}
+
 void BKE_scene_free_depsgraph_hash(Scene *scene)
 {
 	if (scene->depsgraph_hash == NULL) {
@@ -21,23 +21,45 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "zlib.h"
 
 #include "BLI_sys_types.h"  /* for intptr_t */
 
 #include "MEM_guardedalloc.h"
 
+#include "DNA_color_types.h"
 #include "DNA_sequence_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 
+#include "IMB_colormanagement.h"
 #include "IMB_moviecache.h"
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
 
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_system.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
 
+#include "BKE_main.h"
 #include "BKE_sequencer.h"
 #include "BKE_scene.h"
 
+#include BLI_SYSTEM_PID_H
+
 typedef struct SeqCacheKey {
 	struct Sequence *seq;
 	SeqRenderData context;
@@ -61,6 +83,8 @@ typedef struct SeqPreprocessCache {
 } SeqPreprocessCache;
 
 static struct MovieCache *moviecache = NULL;
+/* Guards creating and freeing #moviecache. */
+static ThreadMutex moviecache_lock = BLI_MUTEX_INITIALIZER;
 static struct SeqPreprocessCache *preprocess_cache = NULL;
 
 static void preprocessed_cache_destruct(void);
@@ -115,20 +139,855 @@ static bool seqcache_hashcmp(const void *a_, const void *b_)
 	        seq_cmp_render_data(&a->context, &b->context));
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Disk Cache
+ *
+ * Optional persistent tier below the memory cache, enabled by setting the sequencer
+ * disk cache directory in the preferences. Only final images of strips are stored.
+ *
+ * Pointers to strips and scenes change between sessions, so files are named after a hash
+ * of the strip content instead: its settings, the settings of its inputs and modifiers,
+ * and the path, size and modification time of source files. Editing a strip changes
+ * its hash, stale files are never read and get removed once the size limit is reached,
+ * least recently used first.
+ *
+ * Strips depending on other data-blocks (scenes, clips, masks) are never stored.
+ *
+ * Files are compressed and written by a background thread, the rendering thread only
+ * computes the hash and queues the image. Each file in the index is locked on its own:
+ * it's not read before it's written, and not removed while being read.
+ * \{ */
+
+#define SEQ_DISK_CACHE_VERSION 1
+#define SEQ_DISK_CACHE_EXT ".bseq"
+/* Length of the file name without extension: a 64 bit key in hexadecimal. */
+#define SEQ_DISK_CACHE_KEY_LEN 16
+/* Images waiting to be written, more are not stored on disk (they hold memory meanwhile). */
+#define SEQ_DISK_CACHE_WRITES_MAX 8
+
+typedef struct SeqDiskCacheHeader {
+	char magic[4];
+	int version;
+	uint64_t key;
+	int x, y;
+	int planes, channels;
+	/** Compressed size of the byte and float buffers, zero when the buffer doesn't exist. */
+	uint64_t rect_size, rect_float_size;
+	char rect_colorspace[64];
+	char float_colorspace[64];
+} SeqDiskCacheHeader;
+
+typedef struct SeqDiskCacheFile {
+	uint64_t key;
+	size_t size;
+	/** Modification time, updated when the file is read. */
+	int64_t time;
+	/** Threads reading the file, it's not removed meanwhile. */
+	int readers;
+	/** Queued or being written, it's not read meanwhile. */
+	bool is_writing;
+} SeqDiskCacheFile;
+
+typedef struct SeqDiskCacheWrite {
+	uint64_t key;
+	/** Index the file belongs to, see #SeqDiskCacheIndex.generation. */
+	int generation;
+	char filepath[FILE_MAX];
+	ImBuf *ibuf;
+} SeqDiskCacheWrite;
+
+/* Index of files in the cache directory, built on first use. Only accessed with
+ * #seq_disk_cache_lock held, the lock is never held while reading or writing files. */
+static struct SeqDiskCacheIndex {
+	char dirpath[FILE_MAX];
+	GSet *files;
+	size_t size_total;
+	/** Incremented when the index is built again, files of another index are left alone. */
+	int generation;
+
+	/** Files are written by a single thread, from the queue. */
+	ListBase write_thread;
+	ThreadQueue *write_queue;
+	ThreadCondition write_cond;
+	int writes_pending;
+} seq_disk_cache = {{0}};
+static ThreadMutex seq_disk_cache_lock = BLI_MUTEX_INITIALIZER;
+
+static bool seq_disk_cache_is_enabled(const SeqRenderData *context)
+{
+	return (U.sequencer_disk_cache_dir[0] != '\0' &&
+	        context->skip_cache == false &&
+	        context->is_proxy_render == false);
+}
+
+static unsigned int seq_disk_cache_file_hash(const void *file_v)
+{
+	const SeqDiskCacheFile *file = file_v;
+
+	return (unsigned int)(file->key ^ (file->key >> 32));
+}
+
+static bool seq_disk_cache_file_cmp(const void *a_v, const void *b_v)
+{
+	const SeqDiskCacheFile *a = a_v;
+	const SeqDiskCacheFile *b = b_v;
+
+	return a->key != b->key;
+}
+
+static void seq_disk_cache_filepath_get(uint64_t key, char r_filepath[FILE_MAX])
+{
+	char filename[FILE_MAXFILE];
+
+	BLI_snprintf(filename, sizeof(filename), "%016" PRIx64 SEQ_DISK_CACHE_EXT, key);
+	BLI_join_dirfile(r_filepath, FILE_MAX, seq_disk_cache.dirpath, filename);
+}
+
+static bool seq_disk_cache_filename_parse(const char *filename, uint64_t *r_key)
+{
+	char *end;
+
+	if (strlen(filename) != SEQ_DISK_CACHE_KEY_LEN + strlen(SEQ_DISK_CACHE_EXT) ||
+	    !BLI_str_endswith(filename, SEQ_DISK_CACHE_EXT))
+	{
+		return false;
+	}
+
+	*r_key = strtoull(filename, &end, 16);
+	return (end == filename + SEQ_DISK_CACHE_KEY_LEN);
+}
+
+static void seq_disk_cache_index_free(void)
+{
+	if (seq_disk_cache.files) {
+		BLI_gset_free(seq_disk_cache.files, MEM_freeN);
+		seq_disk_cache.files = NULL;
+	}
+	seq_disk_cache.dirpath[0] = '\0';
+	seq_disk_cache.size_total = 0;
+	seq_disk_cache.generation++;
+}
+
+/* Returns NULL if the file is already in the index. */
+static SeqDiskCacheFile *seq_disk_cache_index_add(uint64_t key, size_t size, int64_t time)
+{
+	SeqDiskCacheFile *file = MEM_callocN(sizeof(SeqDiskCacheFile), __func__);
+	SeqDiskCacheFile **file_p;
+
+	file->key = key;
+	file->size = size;
+	file->time = time;
+
+	if (BLI_gset_ensure_p_ex(seq_disk_cache.files, file, (void ***)&file_p)) {
+		MEM_freeN(file);
+		return NULL;
+	}
+	*file_p = file;
+	seq_disk_cache.size_total += size;
+	return file;
+}
+
+static SeqDiskCacheFile *seq_disk_cache_index_lookup(uint64_t key, int generation)
+{
+	SeqDiskCacheFile file_key;
+
+	if (seq_disk_cache.files == NULL || seq_disk_cache.generation != generation) {
+		return NULL;
+	}
+	file_key.key = key;
+	return BLI_gset_lookup(seq_disk_cache.files, &file_key);
+}
+
+static void seq_disk_cache_index_remove(SeqDiskCacheFile *file)
+{
+	char filepath[FILE_MAX];
+
+	seq_disk_cache_filepath_get(file->key, filepath);
+	BLI_delete(filepath, false, false);
+
+	seq_disk_cache.size_total -= file->size;
+	BLI_gset_remove(seq_disk_cache.files, file, MEM_freeN);
+}
+
+/* Must be called with #seq_disk_cache_lock held. */
+static void seq_disk_cache_index_ensure(void)
+{
+	struct direntry *filelist;
+	unsigned int filelist_num;
+
+	if (seq_disk_cache.files && STREQ(seq_disk_cache.dirpath, U.sequencer_disk_cache_dir)) {
+		return;
+	}
+
+	seq_disk_cache_index_free();
+
+	BLI_strncpy(seq_disk_cache.dirpath, U.sequencer_disk_cache_dir, sizeof(seq_disk_cache.dirpath));
+	seq_disk_cache.files = BLI_gset_new(seq_disk_cache_file_hash, seq_disk_cache_file_cmp, __func__);
+
+	BLI_dir_create_recursive(seq_disk_cache.dirpath);
+
+	filelist_num = BLI_filelist_dir_contents(seq_disk_cache.dirpath, &filelist);
+	for (unsigned int i = 0; i < filelist_num; i++) {
+		uint64_t key;
+
+		if (S_ISREG(filelist[i].s.st_mode) && seq_disk_cache_filename_parse(filelist[i].relname, &key)) {
+			seq_disk_cache_index_add(key, (size_t)filelist[i].s.st_size, (int64_t)filelist[i].s.st_mtime);
+		}
+	}
+	BLI_filelist_free(filelist, filelist_num);
+}
+
+static int seq_disk_cache_file_cmp_time(const void *a_v, const void *b_v)
+{
+	const SeqDiskCacheFile *a = *(SeqDiskCacheFile *const *)a_v;
+	const SeqDiskCacheFile *b = *(SeqDiskCacheFile *const *)b_v;
+
+	return (a->time > b->time) - (a->time < b->time);
+}
+
+/* Remove least recently used files until the cache uses 90% of the limit,
+ * so files don't have to be sorted again for every frame written. */
+static void seq_disk_cache_enforce_limit(void)
+{
+	const size_t size_limit = (size_t)U.sequencer_disk_cache_size_limit * 1024 * 1024 * 1024;
+	SeqDiskCacheFile **files;
+	unsigned int files_num, i = 0;
+	GSetIterator gs_iter;
+
+	if (seq_disk_cache.size_total <= size_limit) {
+		return;
+	}
+
+	files_num = BLI_gset_len(seq_disk_cache.files);
+	files = MEM_mallocN(sizeof(*files) * files_num, __func__);
+	GSET_ITER_INDEX (gs_iter, seq_disk_cache.files, i) {
+		files[i] = BLI_gsetIterator_getKey(&gs_iter);
+	}
+	qsort(files, files_num, sizeof(*files), seq_disk_cache_file_cmp_time);
+
+	for (i = 0; i < files_num && seq_disk_cache.size_total > size_limit / 10 * 9; i++) {
+		if (files[i]->readers == 0 && !files[i]->is_writing) {
+			seq_disk_cache_index_remove(files[i]);
+		}
+	}
+
+	MEM_freeN(files);
+}
+
+/* Two independent 32 bit hashes, so collisions are unlikely even for long edits. */
+typedef struct SeqDiskCacheHash {
+	BLI_HashMurmur2A mm2[2];
+} SeqDiskCacheHash;
+
+static void seq_disk_cache_hash_add(SeqDiskCacheHash *hash, const void *data, size_t len)
+{
+	BLI_hash_mm2a_add(&hash->mm2[0], data, len);
+	BLI_hash_mm2a_add(&hash->mm2[1], data, len);
+}
+
+static void seq_disk_cache_hash_add_int(SeqDiskCacheHash *hash, int data)
+{
+	seq_disk_cache_hash_add(hash, &data, sizeof(data));
+}
+
+static void seq_disk_cache_hash_add_float(SeqDiskCacheHash *hash, float data)
+{
+	seq_disk_cache_hash_add(hash, &data, sizeof(data));
+}
+
+static void seq_disk_cache_hash_add_string(SeqDiskCacheHash *hash, const char *str)
+{
+	seq_disk_cache_hash_add(hash, str, strlen(str) + 1);
+}
+
+/* Source files can be replaced while the edit stays the same. */
+static void seq_disk_cache_hash_add_file(SeqDiskCacheHash *hash, const char *dir, const char *filename)
+{
+	char filepath[FILE_MAX];
+	BLI_stat_t st;
+
+	BLI_join_dirfile(filepath, sizeof(filepath), dir, filename);
+	BLI_path_abs(filepath, BKE_main_blendfile_path_from_global());
+	seq_disk_cache_hash_add_string(hash, filepath);
+
+	if (BLI_stat(filepath, &st) == 0) {
+		const int64_t mtime = (int64_t)st.st_mtime;
+		const int64_t size = (int64_t)st.st_size;
+		seq_disk_cache_hash_add(hash, &mtime, sizeof(mtime));
+		seq_disk_cache_hash_add(hash, &size, sizeof(size));
+	}
+}
+
+static void seq_disk_cache_hash_add_curve_mapping(SeqDiskCacheHash *hash, const CurveMapping *cumap)
+{
+	seq_disk_cache_hash_add_int(hash, cumap->flag);
+	seq_disk_cache_hash_add(hash, &cumap->clipr, sizeof(cumap->clipr));
+	seq_disk_cache_hash_add(hash, cumap->black, sizeof(cumap->black));
+	seq_disk_cache_hash_add(hash, cumap->white, sizeof(cumap->white));
+
+	for (int i = 0; i < CM_TOT; i++) {
+		const CurveMap *cuma = &cumap->cm[i];
+
+		seq_disk_cache_hash_add_int(hash, cuma->flag);
+		seq_disk_cache_hash_add(hash, cuma->ext_in, sizeof(cuma->ext_in));
+		seq_disk_cache_hash_add(hash, cuma->ext_out, sizeof(cuma->ext_out));
+		if (cuma->curve) {
+			seq_disk_cache_hash_add(hash, cuma->curve, sizeof(*cuma->curve) * cuma->totpoint);
+		}
+	}
+}
+
+static bool seq_disk_cache_hash_strip(SeqDiskCacheHash *hash, Sequence *seq, float cfra);
+
+static bool seq_disk_cache_hash_modifier(SeqDiskCacheHash *hash, SequenceModifierData *smd, float cfra)
+{
+	const SequenceModifierTypeInfo *smti = BKE_sequence_modifier_type_info_get(smd->type);
+
+	if (smti == NULL) {
+		return false;
+	}
+
+	seq_disk_cache_hash_add_int(hash, smd->type);
+	seq_disk_cache_hash_add_int(hash, smd->flag & ~SEQUENCE_MODIFIER_EXPANDED);
+
+	if (smd->mask_input_type == SEQUENCE_MASK_INPUT_ID) {
+		if (smd->mask_id) {
+			return false;
+		}
+	}
+	else if (smd->mask_sequence) {
+		seq_disk_cache_hash_add_int(hash, smd->mask_time);
+		if (!seq_disk_cache_hash_strip(hash, smd->mask_sequence, cfra)) {
+			return false;
+		}
+	}
+
+	if (ELEM(smd->type, seqModifierType_Curves, seqModifierType_HueCorrect)) {
+		/* Both store a single curve mapping after the modifier. */
+		seq_disk_cache_hash_add_curve_mapping(hash, &((CurvesModifierData *)smd)->curve_mapping);
+	}
+	else {
+		/* Others only store plain values. */
+		seq_disk_cache_hash_add(hash, smd + 1, (size_t)smti->struct_size - sizeof(*smd));
+	}
+
+	return true;
+}
+
+/* Returns false if the image of the strip can't be identified by its content. */
+static bool seq_disk_cache_hash_strip(SeqDiskCacheHash *hash, Sequence *seq, float cfra)
+{
+	const int flag_ignore = (SEQ_ALLSEL | SEQ_OVERLAP | SEQ_LOCK | SEQ_FLAG_DELETE | SEQ_IPO_FRAME_LOCKED |
+	                         SEQ_EFFECT_NOT_LOADED |
+	                         SEQ_AUDIO_VOLUME_ANIMATED | SEQ_AUDIO_PITCH_ANIMATED | SEQ_AUDIO_PAN_ANIMATED |
+	                         SEQ_AUDIO_DRAW_WAVEFORM);
+	Strip *strip = seq->strip;
+
+	seq_disk_cache_hash_add_int(hash, seq->type);
+	seq_disk_cache_hash_add_int(hash, seq->flag & ~flag_ignore);
+	/* Relative to the strip, moving strips with their inputs keeps their files valid. */
+	seq_disk_cache_hash_add_float(hash, cfra - seq->start);
+	seq_disk_cache_hash_add_int(hash, seq->len);
+	seq_disk_cache_hash_add_int(hash, seq->startofs);
+	seq_disk_cache_hash_add_int(hash, seq->endofs);
+	seq_disk_cache_hash_add_int(hash, seq->startstill);
+	seq_disk_cache_hash_add_int(hash, seq->endstill);
+	seq_disk_cache_hash_add_int(hash, seq->anim_startofs);
+	seq_disk_cache_hash_add_int(hash, seq->anim_endofs);
+	seq_disk_cache_hash_add_int(hash, seq->streamindex);
+	seq_disk_cache_hash_add_float(hash, seq->sat);
+	seq_disk_cache_hash_add_float(hash, seq->mul);
+	/* Initialized on first use, see #give_stripelem_index. */
+	seq_disk_cache_hash_add_float(hash, max_ff(seq->strobe, 1.0f));
+	seq_disk_cache_hash_add_float(hash, seq->effect_fader);
+	seq_disk_cache_hash_add_float(hash, seq->speed_fader);
+	seq_disk_cache_hash_add_int(hash, seq->alpha_mode);
+	seq_disk_cache_hash_add_int(hash, seq->views_format);
+
+	if (strip) {
+		seq_disk_cache_hash_add_string(hash, strip->colorspace_settings.name);
+		if ((seq->flag & SEQ_USE_CROP) && strip->crop) {
+			seq_disk_cache_hash_add(hash, strip->crop, sizeof(*strip->crop));
+		}
+		if ((seq->flag & SEQ_USE_TRANSFORM) && strip->transform) {
+			seq_disk_cache_hash_add(hash, strip->transform, sizeof(*strip->transform));
+		}
+		if ((seq->flag & SEQ_USE_PROXY) && strip->proxy) {
+			const StripProxy *proxy = strip->proxy;
+			seq_disk_cache_hash_add_string(hash, proxy->dir);
+			seq_disk_cache_hash_add_string(hash, proxy->file);
+			seq_disk_cache_hash_add_int(hash, proxy->tc);
+			seq_disk_cache_hash_add_int(hash, proxy->quality);
+			seq_disk_cache_hash_add_int(hash, proxy->storage);
+		}
+	}
+
+	switch (seq->type) {
+		case SEQ_TYPE_IMAGE:
+		{
+			StripElem *s_elem = BKE_sequencer_give_stripelem(seq, cfra);
+			if (s_elem) {
+				seq_disk_cache_hash_add_file(hash, strip->dir, s_elem->name);
+			}
+			break;
+		}
+		case SEQ_TYPE_MOVIE:
+			seq_disk_cache_hash_add_file(hash, strip->dir, strip->stripdata->name);
+			break;
+		case SEQ_TYPE_META:
+		{
+			for (Sequence *seq_iter = seq->seqbase.first; seq_iter; seq_iter = seq_iter->next) {
+				seq_disk_cache_hash_add_int(hash, seq_iter->machine);
+				seq_disk_cache_hash_add_int(hash, seq_iter->blend_mode);
+				seq_disk_cache_hash_add_float(hash, seq_iter->blend_opacity);
+				if (!seq_disk_cache_hash_strip(hash, seq_iter, cfra)) {
+					return false;
+				}
+			}
+			break;
+		}
+		case SEQ_TYPE_SCENE:
+		case SEQ_TYPE_MOVIECLIP:
+		case SEQ_TYPE_MASK:
+		case SEQ_TYPE_SOUND_RAM:
+		case SEQ_TYPE_SOUND_HD:
+		/* Depend on strips that aren't inputs, or on frames other than the current one. */
+		case SEQ_TYPE_SPEED:
+		case SEQ_TYPE_MULTICAM:
+		case SEQ_TYPE_ADJUSTMENT:
+			return false;
+		default:
+		{
+			if ((seq->type & SEQ_TYPE_EFFECT) == 0) {
+				return false;
+			}
+			if (seq->type == SEQ_TYPE_TEXT) {
+				TextVars data = *(TextVars *)seq->effectdata;
+				if (data.text_font) {
+					return false;
+				}
+				/* Runtime font handle. */
+				data.text_blf_id = 0;
+				seq_disk_cache_hash_add(hash, &data, sizeof(data));
+			}
+			else if (seq->effectdata) {
+				/* Effect settings only store plain values. */
+				seq_disk_cache_hash_add(hash, seq->effectdata, MEM_allocN_len(seq->effectdata));
+			}
+
+			/* Unused inputs point to the first one. */
+			Sequence *inputs[3] = {seq->seq1, seq->seq2, seq->seq3};
+			const int inputs_num = BKE_sequence_effect_get_num_inputs(seq->type);
+			for (int i = 0; i < inputs_num; i++) {
+				if (inputs[i] && !seq_disk_cache_hash_strip(hash, inputs[i], cfra)) {
+					return false;
+				}
+			}
+			break;
+		}
+	}
+
+	for (SequenceModifierData *smd = seq->modifiers.first; smd; smd = smd->next) {
+		if (!seq_disk_cache_hash_modifier(hash, smd, cfra)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool seq_disk_cache_key_get(const SeqRenderData *context, Sequence *seq, float cfra, uint64_t *r_key)
+{
+	const Scene *scene = context->scene;
+	SeqDiskCacheHash hash;
+
+	if ((seq->flag & SEQ_USE_VIEWS) && (scene->r.scemode & R_MULTIVIEW)) {
+		/* Source files differ per view. */
+		return false;
+	}
+
+	BLI_hash_mm2a_init(&hash.mm2[0], 0);
+	BLI_hash_mm2a_init(&hash.mm2[1], SEQ_DISK_CACHE_VERSION);
+
+	seq_disk_cache_hash_add_int(&hash, context->rectx);
+	seq_disk_cache_hash_add_int(&hash, context->recty);
+	seq_disk_cache_hash_add_int(&hash, context->preview_render_size);
+	seq_disk_cache_hash_add_int(&hash, context->for_render);
+	seq_disk_cache_hash_add_int(&hash, context->motion_blur_samples);
+	seq_disk_cache_hash_add_float(&hash, context->motion_blur_shutter);
+	seq_disk_cache_hash_add_int(&hash, context->view_id);
+	seq_disk_cache_hash_add_int(&hash, scene->r.views_format);
+	seq_disk_cache_hash_add_string(&hash, scene->sequencer_colorspace_settings.name);
+
+	if (!seq_disk_cache_hash_strip(&hash, seq, cfra)) {
+		return false;
+	}
+
+	*r_key = ((uint64_t)BLI_hash_mm2a_end(&hash.mm2[0]) << 32) | BLI_hash_mm2a_end(&hash.mm2[1]);
+	return true;
+}
+
+/* Floats compress much better with their bytes grouped by significance. */
+static void seq_disk_cache_float_shuffle(const unsigned char *src, unsigned char *dst, size_t num, bool inverse)
+{
+	for (size_t i = 0; i < num; i++) {
+		for (size_t b = 0; b < sizeof(float); b++) {
+			if (inverse) {
+				dst[i * sizeof(float) + b] = src[b * num + i];
+			}
+			else {
+				dst[b * num + i] = src[i * sizeof(float) + b];
+			}
+		}
+	}
+}
+
+static void *seq_disk_cache_compress(const void *data, size_t size, bool is_float, uint64_t *r_size)
+{
+	uLongf size_compressed = compressBound(size);
+	void *data_compressed = MEM_mallocN(size_compressed, __func__);
+	void *data_shuffled = NULL;
+	int err;
+
+	if (is_float) {
+		data_shuffled = MEM_mallocN(size, __func__);
+		seq_disk_cache_float_shuffle(data, data_shuffled, size / sizeof(float), false);
+		data = data_shuffled;
+	}
+
+	/* Fastest level, writing a frame shouldn't take much longer than rendering it. */
+	err = compress2(data_compressed, &size_compressed, data, size, Z_BEST_SPEED);
+
+	MEM_SAFE_FREE(data_shuffled);
+
+	if (err != Z_OK) {
+		MEM_freeN(data_compressed);
+		return NULL;
+	}
+
+	*r_size = size_compressed;
+	return data_compressed;
+}
+
+static bool seq_disk_cache_decompress(FILE *fp, uint64_t size_compressed, void *data, size_t size, bool is_float)
+{
+	void *data_compressed = MEM_mallocN(size_compressed, __func__);
+	void *data_shuffled = is_float ? MEM_mallocN(size, __func__) : NULL;
+	uLongf size_read = size;
+	bool ok;
+
+	ok = (fread(data_compressed, 1, size_compressed, fp) == size_compressed &&
+	      uncompress(is_float ? data_shuffled : data, &size_read, data_compressed, size_compressed) == Z_OK &&
+	      size_read == size);
+
+	if (ok && is_float) {
+		seq_disk_cache_float_shuffle(data_shuffled, data, size / sizeof(float), true);
+	}
+
+	MEM_freeN(data_compressed);
+	MEM_SAFE_FREE(data_shuffled);
+	return ok;
+}
+
+static ImBuf *seq_disk_cache_read_file(const char *filepath, uint64_t key)
+{
+	SeqDiskCacheHeader header;
+	ImBuf *ibuf = NULL;
+	FILE *fp = BLI_fopen(filepath, "rb");
+	bool ok;
+
+	if (fp == NULL) {
+		return NULL;
+	}
+
+	ok = (fread(&header, sizeof(header), 1, fp) == 1 &&
+	      memcmp(header.magic, "BSEQ", 4) == 0 &&
+	      header.version == SEQ_DISK_CACHE_VERSION &&
+	      header.key == key &&
+	      header.x > 0 && header.y > 0);
+
+	if (ok) {
+		const size_t pixels = (size_t)header.x * (size_t)header.y;
+
+		ibuf = IMB_allocImBuf(header.x, header.y, header.planes, 0);
+		ibuf->channels = header.channels;
+
+		if (header.rect_size) {
+			ok = (imb_addrectImBuf(ibuf) &&
+			      seq_disk_cache_decompress(fp, header.rect_size, ibuf->rect, pixels * 4, false));
+		}
+		if (ok && header.rect_float_size) {
+			ok = (imb_addrectfloatImBuf(ibuf) &&
+			      seq_disk_cache_decompress(fp, header.rect_float_size, ibuf->rect_float,
+			                                pixels * 4 * sizeof(float), true));
+		}
+	}
+
+	fclose(fp);
+
+	if (!ok) {
+		IMB_freeImBuf(ibuf);
+		return NULL;
+	}
+
+	header.rect_colorspace[sizeof(header.rect_colorspace) - 1] = '\0';
+	header.float_colorspace[sizeof(header.float_colorspace) - 1] = '\0';
+	if (ibuf->rect) {
+		IMB_colormanagement_assign_rect_colorspace(ibuf, header.rect_colorspace);
+	}
+	if (ibuf->rect_float) {
+		IMB_colormanagement_assign_float_colorspace(ibuf, header.float_colorspace);
+	}
+
+	return ibuf;
+}
+
+static ImBuf *seq_disk_cache_get(const SeqRenderData *context, Sequence *seq, float cfra)
+{
+	SeqDiskCacheFile *file;
+	char filepath[FILE_MAX];
+	uint64_t key;
+	int generation;
+	ImBuf *ibuf;
+
+	if (!seq_disk_cache_key_get(context, seq, cfra, &key)) {
+		return NULL;
+	}
+
+	BLI_mutex_lock(&seq_disk_cache_lock);
+	seq_disk_cache_index_ensure();
+	generation = seq_disk_cache.generation;
+	file = seq_disk_cache_index_lookup(key, generation);
+	if (file == NULL || file->is_writing) {
+		BLI_mutex_unlock(&seq_disk_cache_lock);
+		return NULL;
+	}
+	file->readers++;
+	seq_disk_cache_filepath_get(key, filepath);
+	BLI_mutex_unlock(&seq_disk_cache_lock);
+
+	ibuf = seq_disk_cache_read_file(filepath, key);
+
+	BLI_mutex_lock(&seq_disk_cache_lock);
+	file = seq_disk_cache_index_lookup(key, generation);
+	if (file) {
+		file->readers--;
+		if (ibuf) {
+			/* Keep the access time across sessions. */
+			BLI_file_touch(filepath);
+			file->time = (int64_t)time(NULL);
+		}
+		else if (file->readers == 0) {
+			/* Truncated or written by another version. */
+			seq_disk_cache_index_remove(file);
+		}
+	}
+	BLI_mutex_unlock(&seq_disk_cache_lock);
+
+	return ibuf;
+}
+
+static bool seq_disk_cache_write_file(const char *filepath, uint64_t key, ImBuf *ibuf)
+{
+	const size_t pixels = (size_t)ibuf->x * (size_t)ibuf->y;
+	SeqDiskCacheHeader header = {{0}};
+	void *rect = NULL, *rect_float = NULL;
+	FILE *fp;
+	bool ok = true;
+
+	memcpy(header.magic, "BSEQ", 4);
+	header.version = SEQ_DISK_CACHE_VERSION;
+	header.key = key;
+	header.x = ibuf->x;
+	header.y = ibuf->y;
+	header.planes = ibuf->planes;
+	header.channels = ibuf->channels;
+
+	if (ibuf->rect) {
+		BLI_strncpy(header.rect_colorspace, IMB_colormanagement_get_rect_colorspace(ibuf),
+		            sizeof(header.rect_colorspace));
+		rect = seq_disk_cache_compress(ibuf->rect, pixels * 4, false, &header.rect_size);
+		ok = (rect != NULL);
+	}
+	if (ok && ibuf->rect_float) {
+		BLI_strncpy(header.float_colorspace, IMB_colormanagement_get_float_colorspace(ibuf),
+		            sizeof(header.float_colorspace));
+		rect_float = seq_disk_cache_compress(ibuf->rect_float, pixels * 4 * sizeof(float), true,
+		                                     &header.rect_float_size);
+		ok = (rect_float != NULL);
+	}
+
+	if (ok) {
+		fp = BLI_fopen(filepath, "wb");
+		ok = (fp != NULL);
+
+		if (ok) {
+			ok = (fwrite(&header, sizeof(header), 1, fp) == 1 &&
+			      (rect == NULL || fwrite(rect, 1, header.rect_size, fp) == header.rect_size) &&
+			      (rect_float == NULL || fwrite(rect_float, 1, header.rect_float_size, fp) == header.rect_float_size));
+			ok = (fclose(fp) == 0) && ok;
+		}
+	}
+
+	MEM_SAFE_FREE(rect);
+	MEM_SAFE_FREE(rect_float);
+	return ok;
+}
+
+static void seq_disk_cache_write_do(SeqDiskCacheWrite *write)
+{
+	SeqDiskCacheFile *file;
+	char filepath_tmp[FILE_MAX];
+	bool ok;
+
+	/* Written next to the final file and renamed once complete, other threads and instances
+	 * of Blender never read a partial file. Within an instance, only one thread writes a file. */
+	BLI_snprintf(filepath_tmp, sizeof(filepath_tmp), "%s.%d.tmp", write->filepath, abs(getpid()));
+
+	ok = (seq_disk_cache_write_file(filepath_tmp, write->key, write->ibuf) &&
+	      BLI_rename(filepath_tmp, write->filepath) == 0);
+	if (!ok) {
+		BLI_delete(filepath_tmp, false, false);
+	}
+	IMB_freeImBuf(write->ibuf);
+
+	BLI_mutex_lock(&seq_disk_cache_lock);
+	/* The directory may have changed meanwhile. */
+	file = seq_disk_cache_index_lookup(write->key, write->generation);
+	if (file && file->is_writing) {
+		if (ok) {
+			file->is_writing = false;
+			file->size = BLI_file_size(write->filepath);
+			seq_disk_cache.size_total += file->size;
+			seq_disk_cache_enforce_limit();
+		}
+		else {
+			BLI_gset_remove(seq_disk_cache.files, file, MEM_freeN);
+		}
+	}
+	if (--seq_disk_cache.writes_pending == 0) {
+		BLI_condition_notify_all(&seq_disk_cache.write_cond);
+	}
+	BLI_mutex_unlock(&seq_disk_cache_lock);
+
+	MEM_freeN(write);
+}
+
+static void *seq_disk_cache_write_thread(void *UNUSED(data))
+{
+	SeqDiskCacheWrite *write;
+
+	while ((write = BLI_thread_queue_pop(seq_disk_cache.write_queue))) {
+		seq_disk_cache_write_do(write);
+	}
+	return NULL;
+}
+
+/* Wait for queued files to be written, then stop the writing thread. */
+static void seq_disk_cache_write_thread_end(void)
+{
+	if (seq_disk_cache.write_queue == NULL) {
+		return;
+	}
+
+	BLI_mutex_lock(&seq_disk_cache_lock);
+	while (seq_disk_cache.writes_pending) {
+		BLI_condition_wait(&seq_disk_cache.write_cond, &seq_disk_cache_lock);
+	}
+	BLI_mutex_unlock(&seq_disk_cache_lock);
+
+	BLI_thread_queue_nowait(seq_disk_cache.write_queue);
+	BLI_threadpool_end(&seq_disk_cache.write_thread);
+	BLI_thread_queue_free(seq_disk_cache.write_queue);
+	BLI_condition_end(&seq_disk_cache.write_cond);
+	seq_disk_cache.write_queue = NULL;
+}
+
+/* Queue the image to be written by the background thread. */
+static void seq_disk_cache_put(const SeqRenderData *context, Sequence *seq, float cfra, ImBuf *ibuf)
+{
+	SeqDiskCacheWrite *write;
+	SeqDiskCacheFile *file;
+	uint64_t key;
+
+	if (ibuf->rect_float && ibuf->channels != 4) {
+		return;
+	}
+	if (!seq_disk_cache_key_get(context, seq, cfra, &key)) {
+		return;
+	}
+
+	BLI_mutex_lock(&seq_disk_cache_lock);
+	seq_disk_cache_index_ensure();
+	if (seq_disk_cache.writes_pending >= SEQ_DISK_CACHE_WRITES_MAX) {
+		/* Writing can't keep up, the image stays in memory only. */
+		BLI_mutex_unlock(&seq_disk_cache_lock);
+		return;
+	}
+	/* Claims the file, other threads neither read nor write it until written. */
+	file = seq_disk_cache_index_add(key, 0, (int64_t)time(NULL));
+	if (file == NULL) {
+		BLI_mutex_unlock(&seq_disk_cache_lock);
+		return;
+	}
+	file->is_writing = true;
+
+	write = MEM_mallocN(sizeof(SeqDiskCacheWrite), __func__);
+	write->key = key;
+	write->generation = seq_disk_cache.generation;
+	seq_disk_cache_filepath_get(key, write->filepath);
+	write->ibuf = ibuf;
+	IMB_refImBuf(ibuf);
+
+	if (seq_disk_cache.write_queue == NULL) {
+		seq_disk_cache.write_queue = BLI_thread_queue_init();
+		BLI_condition_init(&seq_disk_cache.write_cond);
+		BLI_threadpool_init(&seq_disk_cache.write_thread, seq_disk_cache_write_thread, 1);
+		BLI_threadpool_insert(&seq_disk_cache.write_thread, NULL);
+	}
+	seq_disk_cache.writes_pending++;
+	BLI_thread_queue_push(seq_disk_cache.write_queue, write);
+	BLI_mutex_unlock(&seq_disk_cache_lock);
+}
+
+/** \} */
+
+static void seqcache_ensure(void)
+{
+	BLI_mutex_lock(&moviecache_lock);
+	if (!moviecache) {
+		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
+	}
+	BLI_mutex_unlock(&moviecache_lock);
+}
+
 void BKE_sequencer_cache_destruct(void)
 {
-	if (moviecache)
+	BLI_mutex_lock(&moviecache_lock);
+	if (moviecache) {
 		IMB_moviecache_free(moviecache);
+		moviecache = NULL;
+	}
+	BLI_mutex_unlock(&moviecache_lock);
 
 	preprocessed_cache_destruct();
+
+	/* There are only a few images queued, they're still written. */
+	seq_disk_cache_write_thread_end();
+
+	BLI_mutex_lock(&seq_disk_cache_lock);
+	seq_disk_cache_index_free();
+	BLI_mutex_unlock(&seq_disk_cache_lock);
 }
 
 void BKE_sequencer_cache_cleanup(void)
 {
+	BLI_mutex_lock(&moviecache_lock);
 	if (moviecache) {
 		IMB_moviecache_free(moviecache);
 		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
 	}
+	BLI_mutex_unlock(&moviecache_lock);
 
 	BKE_sequencer_preprocessed_cache_cleanup();
 }
@@ -149,7 +1008,9 @@ void BKE_sequencer_cache_cleanup_sequence(Sequence *seq)
 
 struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context, Sequence *seq, float cfra, eSeqStripElemIBuf type)
 {
-	if (moviecache && seq) {
+	ImBuf *ibuf = NULL;
+
+	if (seq) {
 		SeqCacheKey key;
 
 		key.seq = seq;
@@ -157,10 +1018,22 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context, Sequence *se
 		key.cfra = cfra - seq->start;
 		key.type = type;
 
-		return IMB_moviecache_get(moviecache, &key);
+		if (moviecache) {
+			ibuf = IMB_moviecache_get(moviecache, &key);
+		}
+
+		if (ibuf == NULL && type == SEQ_STRIPELEM_IBUF && seq_disk_cache_is_enabled(context)) {
+			ibuf = seq_disk_cache_get(context, seq, cfra);
+
+			if (ibuf) {
+				/* Also keep it in memory, putting it again then won't write to disk. */
+				seqcache_ensure();
+				IMB_moviecache_put(moviecache, &key, ibuf);
+			}
+		}
 	}
 
-	return NULL;
+	return ibuf;
 }
 
 void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float cfra, eSeqStripElemIBuf type, ImBuf *i)
@@ -171,15 +1044,25 @@ void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float
 		return;
 	}
 
-	if (!moviecache) {
-		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
-	}
+	seqcache_ensure();
 
 	key.seq = seq;
 	key.context = *context;
 	key.cfra = cfra - seq->start;
 	key.type = type;
 
+	if (type == SEQ_STRIPELEM_IBUF && seq_disk_cache_is_enabled(context)) {
+		/* Strips are put again each time they're drawn from the cache. */
+		ImBuf *ibuf_cached = IMB_moviecache_get(moviecache, &key);
+
+		if (ibuf_cached != i) {
+			seq_disk_cache_put(context, seq, cfra, i);
+		}
+		if (ibuf_cached) {
+			IMB_freeImBuf(ibuf_cached);
+		}
+	}
+
 	IMB_moviecache_put(moviecache, &key, i);
 }
 
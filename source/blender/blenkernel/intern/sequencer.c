@@ -49,6 +49,8 @@
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
+#include "PIL_time.h"
+
 #ifdef WIN32
 #  include "BLI_winstuff.h"
 #else
@@ -2055,6 +2057,129 @@ void BKE_sequencer_proxy_rebuild(SeqIndexBuildContext *context, short *stop, sho
 	}
 }
 
+/* Movie proxies decode and encode using multiple threads already,
+ * this many threads are accounted for every movie built at the same time. */
+#define PROXY_BATCH_THREADS_PER_MOVIE 4
+
+typedef struct SeqProxyBatch {
+	SeqIndexBuildContext **contexts;
+	float *progress;
+	int num_contexts;
+	int next_context;
+	int num_running_threads;
+	SpinLock spin;
+
+	short *stop;
+	short *do_update;
+} SeqProxyBatch;
+
+static void *seq_proxy_batch_thread(void *batch_v)
+{
+	SeqProxyBatch *batch = batch_v;
+
+	for (;;) {
+		int index = -1;
+
+		BLI_spin_lock(&batch->spin);
+		if (!*batch->stop && batch->next_context < batch->num_contexts) {
+			index = batch->next_context++;
+		}
+		BLI_spin_unlock(&batch->spin);
+
+		if (index == -1) {
+			break;
+		}
+
+		BKE_sequencer_proxy_rebuild(batch->contexts[index], batch->stop, batch->do_update,
+		                            &batch->progress[index]);
+		batch->progress[index] = 1.0f;
+	}
+
+	BLI_spin_lock(&batch->spin);
+	batch->num_running_threads--;
+	BLI_spin_unlock(&batch->spin);
+
+	return NULL;
+}
+
+/**
+ * Build the proxies and indices of a queue created by #BKE_sequencer_proxy_rebuild_context.
+ * Movie strips are built by a bounded pool of worker threads, the other strips render their
+ * proxies through the sequencer and are built one after the other afterwards.
+ */
+void BKE_sequencer_proxy_rebuild_batch(ListBase *queue, short *stop, short *do_update, float *progress)
+{
+	SeqProxyBatch batch = {NULL};
+	LinkData *link;
+	int num_queued = BLI_listbase_count(queue);
+
+	if (num_queued == 0) {
+		return;
+	}
+
+	batch.contexts = MEM_mallocN(sizeof(*batch.contexts) * num_queued, "proxy batch contexts");
+	batch.progress = MEM_callocN(sizeof(*batch.progress) * num_queued, "proxy batch progress");
+	batch.stop = stop;
+	batch.do_update = do_update;
+	BLI_spin_init(&batch.spin);
+
+	for (link = queue->first; link; link = link->next) {
+		SeqIndexBuildContext *context = link->data;
+
+		if (context->seq->type == SEQ_TYPE_MOVIE && context->index_context) {
+			batch.contexts[batch.num_contexts++] = context;
+		}
+	}
+
+	if (batch.num_contexts > 0) {
+		ListBase threads;
+		int i, num_threads = BLI_system_thread_count() / PROXY_BATCH_THREADS_PER_MOVIE;
+
+		CLAMP(num_threads, 1, batch.num_contexts);
+		batch.num_running_threads = num_threads;
+
+		BLI_threadpool_init(&threads, seq_proxy_batch_thread, num_threads);
+		for (i = 0; i < num_threads; i++) {
+			BLI_threadpool_insert(&threads, &batch);
+		}
+
+		for (;;) {
+			float total_progress = 0.0f;
+			int num_running_threads;
+
+			PIL_sleep_ms(50);
+
+			for (i = 0; i < batch.num_contexts; i++) {
+				total_progress += batch.progress[i];
+			}
+			*progress = total_progress / batch.num_contexts;
+			*do_update = true;
+
+			BLI_spin_lock(&batch.spin);
+			num_running_threads = batch.num_running_threads;
+			BLI_spin_unlock(&batch.spin);
+
+			if (num_running_threads == 0) {
+				break;
+			}
+		}
+
+		BLI_threadpool_end(&threads);
+	}
+
+	for (link = queue->first; link && !*stop; link = link->next) {
+		SeqIndexBuildContext *context = link->data;
+
+		if (!(context->seq->type == SEQ_TYPE_MOVIE && context->index_context)) {
+			BKE_sequencer_proxy_rebuild(context, stop, do_update, progress);
+		}
+	}
+
+	BLI_spin_end(&batch.spin);
+	MEM_freeN(batch.contexts);
+	MEM_freeN(batch.progress);
+}
+
 void BKE_sequencer_proxy_rebuild_finish(SeqIndexBuildContext *context, bool stop)
 {
 	if (context->index_context) {
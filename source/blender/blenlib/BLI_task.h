@@ -51,7 +51,20 @@ enum {
 	TASK_SCHEDULER_SINGLE_THREAD = 1,
 };
 
+/* Flags for BLI_task_scheduler_create_ex(). */
+enum {
+	/* Tasks pushed from within other tasks (see BLI_task_pool_push_from_thread()
+	 * and delayed push) are kept in a lock-free per-thread deque instead of the
+	 * global queue. Threads run their own tasks in LIFO order and steal oldest
+	 * tasks from other threads when they run out of work. This avoids global
+	 * lock contention when lots of tiny tasks are scheduled from tasks, such
+	 * as dependency graph evaluation.
+	 */
+	TASK_SCHEDULER_WORK_STEALING = (1 << 0),
+};
+
 TaskScheduler *BLI_task_scheduler_create(int num_threads);
+TaskScheduler *BLI_task_scheduler_create_ex(int num_threads, int flag);
 void BLI_task_scheduler_free(TaskScheduler *scheduler);
 
 int BLI_task_scheduler_num_threads(TaskScheduler *scheduler);
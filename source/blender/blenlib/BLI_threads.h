@@ -46,6 +46,7 @@ void BLI_threadapi_init(void);
 void BLI_threadapi_exit(void);
 
 struct TaskScheduler *BLI_task_scheduler_get(void);
+void BLI_task_scheduler_work_stealing_set(bool use_work_stealing);
 
 void    BLI_threadpool_init(struct ListBase *threadbase, void *(*do_thread)(void *), int tot);
 int     BLI_available_threads(struct ListBase *threadbase);
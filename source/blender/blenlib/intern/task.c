@@ -58,6 +58,15 @@
  */
 #define DELAYED_QUEUE_SIZE 4096
 
+/* Number of tasks which can be stored in a per-thread work-stealing deque.
+ *
+ * Must be a power of two. Tasks which do not fit into the deque are pushed to
+ * the scheduler's global queue instead. Only used by schedulers created with
+ * TASK_SCHEDULER_WORK_STEALING flag.
+ */
+#define WORK_STEALING_DEQUE_SIZE 4096
+#define WORK_STEALING_DEQUE_MASK (WORK_STEALING_DEQUE_SIZE - 1)
+
 #ifndef NDEBUG
 #  define ASSERT_THREAD_ID(scheduler, thread_id)                              \
 	do {                                                                      \
@@ -132,6 +141,25 @@ typedef struct TaskMemPoolStats {
 } TaskMemPoolStats;
 #endif
 
+/* Bounded work-stealing deque, based on the "Dynamic Circular Work-Stealing
+ * Deque" paper by Chase and Lev, without the dynamic part.
+ *
+ * The owner thread pushes and pops tasks at the bottom (LIFO order, which keeps
+ * recently pushed data hot in caches), while other threads steal the oldest
+ * tasks from the top (FIFO order) without taking any locks.
+ *
+ * All accesses to top and bottom which require ordering go through atomic
+ * operations, which are full memory barriers.
+ */
+typedef struct TaskDeque {
+	/* Index of the oldest task, advanced by stealers and by the owner when
+	 * popping the very last task. */
+	int64_t top;
+	/* Index past the most recently pushed task, only modified by the owner. */
+	int64_t bottom;
+	Task *tasks[WORK_STEALING_DEQUE_SIZE];
+} TaskDeque;
+
 typedef struct TaskThreadLocalStorage {
 	/* Memory pool for faster task allocation.
 	 * The idea is to re-use memory of finished/discarded tasks by this thread.
@@ -155,6 +183,13 @@ typedef struct TaskThreadLocalStorage {
 	bool do_delayed_push;
 	int num_delayed_queue;
 	Task *delayed_queue[DELAYED_QUEUE_SIZE];
+
+	/* Tasks which are ready to be executed by this thread, but which might
+	 * also be stolen by other threads which ran out of work.
+	 * Only used when scheduler is in work-stealing mode, allocated by the owner
+	 * thread on its first push, so pools' local storage never gets one.
+	 */
+	TaskDeque *volatile deque;
 } TaskThreadLocalStorage;
 
 struct TaskPool {
@@ -213,6 +248,18 @@ struct TaskScheduler {
 
 	volatile bool do_exit;
 
+	/* Tasks pushed from scheduler threads go to per-thread deques, and idle
+	 * threads steal work from each other instead of going to the global queue.
+	 */
+	bool use_work_stealing;
+	/* Number of worker threads which are waiting on queue_cond, used to avoid
+	 * locking queue_mutex when pushing to deques while all threads are busy.
+	 */
+	int num_sleeping;
+	/* Incremented on every push to a deque, so threads which are about to
+	 * sleep can detect tasks pushed after their last steal attempt. */
+	uint32_t deque_push_epoch;
+
 	/* NOTE: In pthread's TLS we store the whole TaskThread structure. */
 	pthread_key_t tls_id_key;
 };
@@ -323,6 +370,91 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
 	}
 }
 
+/* Work-stealing deque */
+
+/* Get deque of the thread local storage, allocating it if needed. Only to be
+ * called from the owner thread, the pointer is published with an atomic
+ * operation so stealers never see a partially initialized deque. */
+static TaskDeque *task_deque_ensure(TaskThreadLocalStorage *tls)
+{
+	if (tls->deque == NULL) {
+		TaskDeque *deque = MEM_callocN(sizeof(TaskDeque), "task deque");
+		atomic_cas_ptr((void **)&tls->deque, NULL, deque);
+	}
+	return tls->deque;
+}
+
+/* Push task to the bottom of the deque, only to be called from the owner thread.
+ *
+ * Returns false if the deque is full.
+ */
+static bool task_deque_push(TaskDeque *deque, Task *task)
+{
+	const int64_t bottom = deque->bottom;
+	const int64_t top = atomic_fetch_and_add_int64(&deque->top, 0);
+	if (bottom - top >= WORK_STEALING_DEQUE_SIZE) {
+		return false;
+	}
+	deque->tasks[bottom & WORK_STEALING_DEQUE_MASK] = task;
+	/* Publish the task to stealers, atomic operation ensures the task pointer
+	 * is visible before the new bottom. */
+	atomic_add_and_fetch_int64(&deque->bottom, 1);
+	return true;
+}
+
+/* Number of tasks which can be pushed to the deque without it overflowing, only
+ * to be called from the owner thread. Stealers can only make more room. */
+static int task_deque_num_free(TaskDeque *deque)
+{
+	const int64_t top = atomic_fetch_and_add_int64(&deque->top, 0);
+	return (int)(WORK_STEALING_DEQUE_SIZE - (deque->bottom - top));
+}
+
+/* Pop most recently pushed task, only to be called from the owner thread. */
+static Task *task_deque_pop(TaskDeque *deque)
+{
+	if (deque == NULL) {
+		return NULL;
+	}
+	const int64_t bottom = atomic_sub_and_fetch_int64(&deque->bottom, 1);
+	const int64_t top = atomic_fetch_and_add_int64(&deque->top, 0);
+	if (top > bottom) {
+		/* Deque was empty, restore bottom so it matches top again. */
+		atomic_add_and_fetch_int64(&deque->bottom, 1);
+		return NULL;
+	}
+	Task *task = deque->tasks[bottom & WORK_STEALING_DEQUE_MASK];
+	if (top == bottom) {
+		/* This is the last task in the deque, stealers might be racing for it
+		 * as well. Whoever advances top first owns the task. */
+		if (atomic_cas_int64(&deque->top, top, top + 1) != top) {
+			task = NULL;
+		}
+		atomic_add_and_fetch_int64(&deque->bottom, 1);
+	}
+	return task;
+}
+
+/* Steal oldest task from the deque, can be called from any thread. */
+static Task *task_deque_steal(TaskDeque *deque)
+{
+	if (deque == NULL) {
+		return NULL;
+	}
+	while (true) {
+		const int64_t top = atomic_fetch_and_add_int64(&deque->top, 0);
+		const int64_t bottom = atomic_fetch_and_add_int64(&deque->bottom, 0);
+		if (top >= bottom) {
+			return NULL;
+		}
+		Task *task = deque->tasks[top & WORK_STEALING_DEQUE_MASK];
+		if (atomic_cas_int64(&deque->top, top, top + 1) == top) {
+			return task;
+		}
+		/* Lost the race against the owner or another stealer, try again. */
+	}
+}
+
 /* Task Scheduler */
 
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
@@ -349,13 +481,77 @@ static void task_pool_num_increase(TaskPool *pool, size_t new)
 	BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+/* Steal a task from any other thread's deque, starting with the neighbor thread
+ * so stealers do not all hammer the same victim. */
+static Task *task_scheduler_steal(TaskScheduler *scheduler, const int thread_id)
 {
-	bool found_task = false;
+	const int num_deques = scheduler->num_threads + 1;
+	for (int i = 1; i < num_deques; i++) {
+		TaskThread *victim = &scheduler->task_threads[(thread_id + i) % num_deques];
+		Task *task = task_deque_steal(victim->tls.deque);
+		if (task != NULL) {
+			return task;
+		}
+	}
+	return NULL;
+}
+
+/* Wake up worker threads which are waiting for tasks, after new tasks were
+ * pushed to a deque. Does not lock anything when all workers are busy. */
+static void task_scheduler_wake_sleeping(TaskScheduler *scheduler, const bool wake_all)
+{
+	/* Let threads which are about to sleep know they might have missed a task,
+	 * see task_scheduler_thread_wait_pop(). */
+	atomic_add_and_fetch_uint32(&scheduler->deque_push_epoch, 1);
+	if (atomic_add_and_fetch_int32(&scheduler->num_sleeping, 0) == 0) {
+		return;
+	}
 	BLI_mutex_lock(&scheduler->queue_mutex);
+	if (wake_all) {
+		BLI_condition_notify_all(&scheduler->queue_cond);
+	}
+	else {
+		BLI_condition_notify_one(&scheduler->queue_cond);
+	}
+	BLI_mutex_unlock(&scheduler->queue_mutex);
+}
 
-	while (!scheduler->queue.first && !scheduler->do_exit)
-		BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, const int thread_id, Task **task)
+{
+	bool found_task = false;
+
+	if (scheduler->use_work_stealing) {
+		/* Steal without holding the queue mutex, it is only needed to go to
+		 * sleep. Announce ourselves as sleeping before the final attempt to
+		 * steal, so a thread pushing to its deque afterwards either sees the
+		 * announcement and notifies us, or changes the push epoch, in which
+		 * case we try stealing again instead of waiting. */
+		while (true) {
+			atomic_add_and_fetch_int32(&scheduler->num_sleeping, 1);
+			const uint32_t epoch = atomic_add_and_fetch_uint32(&scheduler->deque_push_epoch, 0);
+			*task = task_scheduler_steal(scheduler, thread_id);
+			if (*task != NULL) {
+				atomic_sub_and_fetch_int32(&scheduler->num_sleeping, 1);
+				return true;
+			}
+			BLI_mutex_lock(&scheduler->queue_mutex);
+			if (scheduler->queue.first || scheduler->do_exit) {
+				atomic_sub_and_fetch_int32(&scheduler->num_sleeping, 1);
+				break;
+			}
+			if (atomic_add_and_fetch_uint32(&scheduler->deque_push_epoch, 0) == epoch) {
+				BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+			}
+			BLI_mutex_unlock(&scheduler->queue_mutex);
+			atomic_sub_and_fetch_int32(&scheduler->num_sleeping, 1);
+		}
+	}
+	else {
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		while (!scheduler->queue.first && !scheduler->do_exit) {
+			BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+		}
+	}
 
 	do {
 		Task *current_task;
@@ -431,7 +627,19 @@ static void *task_scheduler_thread_run(void *thread_p)
 	pthread_setspecific(scheduler->tls_id_key, thread);
 
 	/* keep popping off tasks */
-	while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+	while (true) {
+		task = NULL;
+		if (scheduler->use_work_stealing) {
+			/* Own tasks first, in LIFO order, then try to steal from others. */
+			task = task_deque_pop(tls->deque);
+			if (task == NULL) {
+				task = task_scheduler_steal(scheduler, thread_id);
+			}
+		}
+		if (task == NULL && !task_scheduler_thread_wait_pop(scheduler, thread_id, &task)) {
+			break;
+		}
+
 		TaskPool *pool = task->pool;
 
 		/* run task */
@@ -453,6 +661,14 @@ static void *task_scheduler_thread_run(void *thread_p)
 }
 
 TaskScheduler *BLI_task_scheduler_create(int num_threads)
+{
+	return BLI_task_scheduler_create_ex(num_threads, 0);
+}
+
+/**
+ * Create task scheduler with the given \a flag (see TASK_SCHEDULER_WORK_STEALING).
+ */
+TaskScheduler *BLI_task_scheduler_create_ex(int num_threads, int flag)
 {
 	TaskScheduler *scheduler = MEM_callocN(sizeof(TaskScheduler), "TaskScheduler");
 
@@ -478,6 +694,11 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 		num_threads = 1;
 	}
 
+	/* Background-only thread is not allowed to run tasks of regular pools, so
+	 * there is nobody to steal work from the main thread. */
+	scheduler->use_work_stealing = (flag & TASK_SCHEDULER_WORK_STEALING) &&
+	                               !scheduler->background_thread_only;
+
 	scheduler->task_threads = MEM_mallocN(sizeof(TaskThread) * (num_threads + 1),
 	                                      "TaskScheduler task threads");
 
@@ -536,6 +757,14 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 	if (scheduler->task_threads) {
 		for (int i = 0; i < scheduler->num_threads + 1; ++i) {
 			TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
+			/* Delete leftover tasks from work-stealing deque. */
+			if (tls->deque != NULL) {
+				for (task = task_deque_pop(tls->deque); task; task = task_deque_pop(tls->deque)) {
+					task_data_free(task, 0);
+					MEM_freeN(task);
+				}
+				MEM_freeN(tls->deque);
+			}
 			free_task_tls(tls);
 		}
 
@@ -560,10 +789,8 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 	return scheduler->num_threads + 1;
 }
 
-static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
+static void task_scheduler_queue_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
-	task_pool_num_increase(task->pool, 1);
-
 	/* add task to queue */
 	BLI_mutex_lock(&scheduler->queue_mutex);
 
@@ -576,8 +803,15 @@ static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriori
 	BLI_mutex_unlock(&scheduler->queue_mutex);
 }
 
+static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
+{
+	task_pool_num_increase(task->pool, 1);
+	task_scheduler_queue_push(scheduler, task, priority);
+}
+
 static void task_scheduler_push_all(TaskScheduler *scheduler,
                                     TaskPool *pool,
+                                    TaskDeque *deque,
                                     Task **tasks,
                                     int num_tasks)
 {
@@ -587,9 +821,30 @@ static void task_scheduler_push_all(TaskScheduler *scheduler,
 
 	task_pool_num_increase(pool, num_tasks);
 
+	if (deque != NULL) {
+		/* Work-stealing mode: keep tasks local to the pushing thread, only
+		 * fall back to the global queue for tasks which do not fit.
+		 * The owner pops tasks in LIFO order, so push in reverse order for the
+		 * first task, which is the most important one, to be popped first. */
+		const int num_pushed = min_ii(num_tasks, task_deque_num_free(deque));
+		for (int i = num_pushed - 1; i >= 0; i--) {
+			const bool pushed = task_deque_push(deque, tasks[i]);
+			BLI_assert(pushed);
+			UNUSED_VARS_NDEBUG(pushed);
+		}
+		task_scheduler_wake_sleeping(scheduler, true);
+		if (num_pushed == num_tasks) {
+			return;
+		}
+		tasks += num_pushed;
+		num_tasks -= num_pushed;
+	}
+
 	BLI_mutex_lock(&scheduler->queue_mutex);
 
-	for (int i = 0; i < num_tasks; i++) {
+	/* Add in reverse order, so tasks are picked up in the order they were
+	 * pushed in. This allows callers to push most important tasks first. */
+	for (int i = num_tasks - 1; i >= 0; i--) {
 		BLI_addhead(&scheduler->queue, tasks[i]);
 	}
 
@@ -771,6 +1026,16 @@ BLI_INLINE bool task_can_use_local_queues(TaskPool *pool, int thread_id)
 	return (thread_id != -1 && (thread_id != pool->thread_id || pool->do_work));
 }
 
+/* Deques are only visible to stealers when they belong to a scheduler's thread,
+ * pool's own local TLS is never looked into by other threads.
+ * Is to be used in addition to task_can_use_local_queues().
+ */
+BLI_INLINE bool task_can_use_deque(TaskPool *pool, int thread_id)
+{
+	return (pool->scheduler->use_work_stealing &&
+	        !(pool->use_local_tls && thread_id == 0));
+}
+
 static void task_pool_push(
         TaskPool *pool, TaskRunFunction run, void *taskdata,
         bool free_taskdata, TaskFreeFunction freedata, TaskPriority priority,
@@ -787,10 +1052,10 @@ static void task_pool_push(
 	 * and exit as soon as possible.
 	 *
 	 * This tasks will be moved to actual execution when pool is
-	 * activated by work_and_wait().
+	 * activated by work_and_wait(), in the same order as they were pushed.
 	 */
 	if (pool->is_suspended) {
-		BLI_addhead(&pool->suspended_queue, task);
+		BLI_addtail(&pool->suspended_queue, task);
 		atomic_fetch_and_add_z(&pool->num_suspended, 1);
 		return;
 	}
@@ -815,6 +1080,23 @@ static void task_pool_push(
 			tls->num_delayed_queue++;
 			return;
 		}
+		/* In work-stealing mode push to the thread's own deque, other threads
+		 * will steal the task from there if they run out of work.
+		 *
+		 * NOTE: Pool counter is to be increased before the task becomes visible
+		 * to stealers.
+		 */
+		if (task_can_use_deque(pool, thread_id)) {
+			task_pool_num_increase(pool, 1);
+			if (task_deque_push(task_deque_ensure(tls), task)) {
+				task_scheduler_wake_sleeping(pool->scheduler, false);
+			}
+			else {
+				/* Deque is full, task is already accounted in the pool. */
+				task_scheduler_queue_push(pool->scheduler, task, priority);
+			}
+			return;
+		}
 	}
 	/* Do push to a global execution pool, slowest possible method,
 	 * causes quite reasonable amount of threading overhead.
@@ -874,21 +1156,45 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
 
 		BLI_mutex_unlock(&pool->num_mutex);
 
-		BLI_mutex_lock(&scheduler->queue_mutex);
+		/* Tasks pushed by this thread are on top of its own deque. Tasks of
+		 * other pools are put back: same as for the global queue below, running
+		 * them from here could lead to a deadlock. Those are either handled
+		 * once the thread gets back to them, or are stolen by other threads.
+		 */
+		if (task_can_use_deque(pool, pool->thread_id)) {
+			work_task = task_deque_pop(tls->deque);
+			if (work_task != NULL) {
+				if (work_task->pool == pool) {
+					found_task = true;
+				}
+				else {
+					/* Never drop the task, fall back to the global queue
+					 * if it does not fit back into the deque. */
+					if (!task_deque_push(tls->deque, work_task)) {
+						task_scheduler_queue_push(scheduler, work_task, TASK_PRIORITY_LOW);
+					}
+					work_task = NULL;
+				}
+			}
+		}
+
+		if (!found_task) {
+			BLI_mutex_lock(&scheduler->queue_mutex);
 
-		/* find task from this pool. if we get a task from another pool,
-		 * we can get into deadlock */
+			/* find task from this pool. if we get a task from another pool,
+			 * we can get into deadlock */
 
-		for (task = scheduler->queue.first; task; task = task->next) {
-			if (task->pool == pool) {
-				work_task = task;
-				found_task = true;
-				BLI_remlink(&scheduler->queue, task);
-				break;
+			for (task = scheduler->queue.first; task; task = task->next) {
+				if (task->pool == pool) {
+					work_task = task;
+					found_task = true;
+					BLI_remlink(&scheduler->queue, task);
+					break;
+				}
 			}
-		}
 
-		BLI_mutex_unlock(&scheduler->queue_mutex);
+			BLI_mutex_unlock(&scheduler->queue_mutex);
+		}
 
 		/* if found task, do it, otherwise wait until other tasks are done */
 		if (found_task) {
@@ -898,7 +1204,7 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
 			BLI_assert(!tls->do_delayed_push);
 
 			/* delete task */
-			task_free(pool, task, pool->thread_id);
+			task_free(pool, work_task, pool->thread_id);
 
 			/* Handle all tasks from local queue. */
 			handle_local_queue(tls, pool->thread_id);
@@ -975,6 +1281,7 @@ void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id)
 		BLI_assert(tls->do_delayed_push);
 		task_scheduler_push_all(pool->scheduler,
 		                        pool,
+		                        task_can_use_deque(pool, thread_id) ? task_deque_ensure(tls) : NULL,
 		                        tls->delayed_queue,
 		                        tls->num_delayed_queue);
 		tls->do_delayed_push = false;
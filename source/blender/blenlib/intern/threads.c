@@ -123,6 +123,7 @@ static pthread_t mainid;
 static bool is_numa_available = false;
 static unsigned int thread_levels = 0;  /* threads can be invoked inside threads */
 static int num_threads_override = 0;
+static bool use_task_work_stealing = false;
 
 /* just a max for security reasons */
 #define RE_MAX_THREAD BLENDER_MAX_THREADS
@@ -159,6 +160,7 @@ void BLI_threadapi_exit(void)
 {
 	if (task_scheduler) {
 		BLI_task_scheduler_free(task_scheduler);
+		task_scheduler = NULL;
 	}
 	BLI_spin_end(&_malloc_lock);
 }
@@ -171,12 +173,20 @@ TaskScheduler *BLI_task_scheduler_get(void)
 		/* Do a lazy initialization, so it happens after
 		 * command line arguments parsing
 		 */
-		task_scheduler = BLI_task_scheduler_create(tot_thread);
+		task_scheduler = BLI_task_scheduler_create_ex(
+		        tot_thread, use_task_work_stealing ? TASK_SCHEDULER_WORK_STEALING : 0);
 	}
 
 	return task_scheduler;
 }
 
+/* Must be called before the global task scheduler is created. */
+void BLI_task_scheduler_work_stealing_set(bool use_work_stealing)
+{
+	BLI_assert(task_scheduler == NULL);
+	use_task_work_stealing = use_work_stealing;
+}
+
 /* tot = 0 only initializes malloc mutex in a safe way (see sequence.c)
  * problem otherwise: scene render will kill of the mutex!
  */
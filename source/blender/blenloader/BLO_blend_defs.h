@@ -73,4 +73,21 @@ enum {
 
 #define BLEN_THUMB_MEMSIZE_FILE(_x, _y) (sizeof(int) * (2 + (size_t)(_x) * (size_t)(_y)))
 
+/**
+ * Compressed files are written as a series of independent gzip members (frames),
+ * each holding #BLEN_GZIP_FRAME_SIZE bytes of the file (the last one may be smaller).
+ *
+ * A final empty member stores the frame index in its extra field (sub-field ID `BI`):
+ * - For each frame: compressed & uncompressed size (little endian `uint32_t`).
+ * - The number of frames (little endian `uint32_t`).
+ * - #BLEN_GZIP_FRAME_INDEX_MAGIC.
+ *
+ * Readers can use this to decompress frames in parallel and seek in the file,
+ * while any other gzip reader sees a regular (multi-member) gzip stream.
+ */
+#define BLEN_GZIP_FRAME_SIZE (1 << 22)
+#define BLEN_GZIP_FRAME_INDEX_MAGIC "BLZI"
+/* Limited by the size of the gzip extra field. */
+#define BLEN_GZIP_FRAME_INDEX_MAX ((0xffff - 4 - 8) / 8)
+
 #endif  /* __BLO_BLEND_DEFS_H__ */
@@ -96,12 +96,16 @@ BlendFileData *BLO_read_from_memory(
         eBLOReadSkip skip_flags,
         struct ReportList *reports);
 BlendFileData *BLO_read_from_memfile(
-        struct Main *oldmain, const char *filename, struct MemFile *memfile,
+        struct Main *oldmain, const char *filename, struct MemFile *memfile, struct MemFile *memfile_current,
         eBLOReadSkip skip_flags,
         struct ReportList *reports);
 
 void BLO_blendfiledata_free(BlendFileData *bfd);
 
+void BLO_read_use_mmap_set(bool use_mmap);
+void BLO_read_lazy_libraries_set(bool use_lazy);
+void BLO_read_undo_reuse_ids_set(bool use_reuse);
+
 BlendHandle *BLO_blendhandle_from_file(const char *filepath, struct ReportList *reports);
 BlendHandle *BLO_blendhandle_from_memory(const void *mem, int memsize);
 
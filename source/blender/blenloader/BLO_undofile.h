@@ -25,6 +25,7 @@
  * \ingroup blenloader
  */
 
+struct GSet;
 struct Scene;
 
 typedef struct {
@@ -32,15 +33,43 @@ typedef struct {
 	const char *buf;
 	/** Size in bytes. */
 	unsigned int size;
-	/** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+	/**
+	 * When true, this chunk didn't add new memory, its buffer was already stored by a previous #MemFileChunk.
+	 * Buffers are shared by content between all memory files, equal contents always use the same buffer.
+	 */
 	bool is_identical;
 } MemFileChunk;
 
+/** Chunks holding the data of one ID, which can share them with the IDs written before and after it. */
+typedef struct MemFileID {
+	/** Address of the ID (as written in the file). */
+	const void *address;
+	/** Index of the first and the last #MemFileChunk holding data of the ID. */
+	unsigned int chunk_first, chunk_last;
+	/** Offset of the ID data in its first chunk. */
+	unsigned int offset;
+} MemFileID;
+
 typedef struct MemFile {
 	ListBase chunks;
 	size_t size;
+	/** Number of #MemFile.chunks. */
+	unsigned int chunks_len;
+	/** IDs written in the file, see #BLO_memfile_identical_ids_get. */
+	MemFileID *ids;
+	unsigned int ids_len, ids_alloc;
 } MemFile;
 
+/** Memory used by chunk buffers of all memory files, see #BLO_memfile_stats_get. */
+typedef struct MemFileStats {
+	/** Number of distinct buffers. */
+	size_t buffers_num;
+	/** Size in bytes of distinct buffers (the memory actually used). */
+	size_t size_unique;
+	/** Size in bytes of all chunks (the memory used without de-duplication). */
+	size_t size_total;
+} MemFileStats;
+
 typedef struct MemFileUndoData {
 	char filename[1024];  /* FILE_MAX */
 	MemFile memfile;
@@ -51,10 +80,15 @@ typedef struct MemFileUndoData {
 extern void memfile_chunk_add(
         MemFile *memfile, const char *buf, unsigned int size,
         MemFileChunk **compchunk_step);
+extern void memfile_id_add(
+        MemFile *memfile, const void *address,
+        unsigned int chunk_first, unsigned int chunk_last, unsigned int offset);
 
 /* exports */
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
+extern void BLO_memfile_stats_get(MemFileStats *r_stats);
+extern struct GSet *BLO_memfile_identical_ids_get(MemFile *memfile_a, MemFile *memfile_b);
 
 /* utilities */
 extern struct Main *BLO_memfile_main_get(struct MemFile *memfile, struct Main *bmain, struct Scene **r_scene);
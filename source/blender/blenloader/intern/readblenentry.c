@@ -359,9 +359,11 @@ BlendFileData *BLO_read_from_memory(
  *
  * \param oldmain: old main, from which we will keep libraries and other datablocks that should not have changed.
  * \param filename: current file, only for retrieving library data.
+ * \param memfile_current: memfile written from \a oldmain (can be NULL), its data-blocks unchanged since
+ * (with no #ID.recalc_after_undo_push) and identical in \a memfile are kept instead of being read.
  */
 BlendFileData *BLO_read_from_memfile(
-        Main *oldmain, const char *filename, MemFile *memfile,
+        Main *oldmain, const char *filename, MemFile *memfile, MemFile *memfile_current,
         eBLOReadSkip skip_flags,
         ReportList *reports)
 {
@@ -375,6 +377,11 @@ BlendFileData *BLO_read_from_memfile(
 		fd->skip_flags = skip_flags;
 		BLI_strncpy(fd->relabase, filename, sizeof(fd->relabase));
 
+		/* makes lookup of unchanged IDs in old main, before it's modified */
+		if (memfile_current != NULL) {
+			blo_make_undo_reused_ids_map(fd, oldmain, memfile_current);
+		}
+
 		/* clear ob->proxy_from pointers in old main */
 		blo_clear_proxy_pointers_from_lib(oldmain);
 
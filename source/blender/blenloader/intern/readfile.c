@@ -37,10 +37,12 @@
 #include "BLI_utildefines.h"
 #ifndef WIN32
 #  include <unistd.h> // for read close
+#  include <sys/mman.h> // for mmap
 #else
 #  include <io.h> // for open close read
 #  include "winsock2.h"
 #  include "BLI_winstuff.h"
+#  include "mmap_win.h"
 #endif
 
 /* allow readfile to use deprecated functionality */
@@ -107,6 +109,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_threads.h"
+#include "BLI_task.h"
 #include "BLI_mempool.h"
 #include "BLI_ghash.h"
 
@@ -165,6 +168,7 @@
 #include "BLO_blend_validate.h"
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
+#include "BLO_writefile.h"
 
 #include "RE_engine.h"
 
@@ -226,11 +230,22 @@
  * Delay reading blocks we might not use (especially applies to library linking).
  * which keeps large arrays in memory from data-blocks we may not even use.
  *
- * \note This is disabled when using compression,
- * while zlib supports seek ist's unusably slow, see: T61880.
+ * \note This is disabled when using compression (unless the file has a frame index,
+ * see #BLEN_GZIP_FRAME_SIZE), while zlib supports seek ist's unusably slow, see: T61880.
  */
 #define USE_BHEAD_READ_ON_DEMAND
 
+/**
+ * When the whole file is available in memory (memory mapped, see #BLO_read_use_mmap_set,
+ * or decompressed from frames), DNA reconstruction of data-blocks is done in parallel
+ * ahead of the (single threaded) ID reading & linking, one window of the file at a time
+ * (see #BHEAD_READ_PARALLEL_WINDOW_SIZE), so memory use only grows by the window size.
+ *
+ * \note Requires #USE_BHEAD_READ_ON_DEMAND, data is read straight from memory.
+ */
+#define USE_BHEAD_READ_PARALLEL
+#define BHEAD_READ_PARALLEL_WINDOW_SIZE (64 * 1024 * 1024)
+
 /* use GHash for BHead name-based lookups (speeds up linking) */
 #define USE_GHASH_BHEAD
 
@@ -248,7 +263,7 @@
 
 
 /* local prototypes */
-static void read_libraries(FileData *basefd, ListBase *mainlist);
+static void read_libraries(FileData *basefd, ListBase *mainlist, const bool use_lazy);
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname);
 static void direct_link_modifiers(FileData *fd, ListBase *lb);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
@@ -267,6 +282,10 @@ typedef struct BHeadN {
 	off_t file_offset;
 	/** When set, the remainder of this allocation is the data, otherwise it needs to be read. */
 	bool has_data;
+#endif
+#ifdef USE_BHEAD_READ_PARALLEL
+	/** Result of #read_struct computed ahead of time, ownership is passed on when read. */
+	void *data_prefetch;
 #endif
 	struct BHead bhead;
 } BHeadN;
@@ -837,6 +856,9 @@ static BHeadN *get_bhead(FileData *fd)
 					new_bhead->next = new_bhead->prev = NULL;
 					new_bhead->file_offset = fd->file_offset;
 					new_bhead->has_data = false;
+#ifdef USE_BHEAD_READ_PARALLEL
+					new_bhead->data_prefetch = NULL;
+#endif
 					new_bhead->bhead = bhead;
 					off_t seek_new = fd->seek(fd, bhead.len, SEEK_CUR);
 					if (seek_new == -1) {
@@ -858,6 +880,9 @@ static BHeadN *get_bhead(FileData *fd)
 #ifdef USE_BHEAD_READ_ON_DEMAND
 					new_bhead->file_offset = 0;  /* don't seek. */
 					new_bhead->has_data = true;
+#endif
+#ifdef USE_BHEAD_READ_PARALLEL
+					new_bhead->data_prefetch = NULL;
 #endif
 					new_bhead->bhead = bhead;
 
@@ -968,6 +993,9 @@ static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
 	new_bhead_data->bhead = new_bhead->bhead;
 	new_bhead_data->file_offset = new_bhead->file_offset;
 	new_bhead_data->has_data = true;
+#ifdef USE_BHEAD_READ_PARALLEL
+	new_bhead_data->data_prefetch = NULL;
+#endif
 	if (!blo_bhead_read_data(fd, thisblock, new_bhead_data + 1)) {
 		MEM_freeN(new_bhead_data);
 		return NULL;
@@ -1158,6 +1186,414 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
 	return (readsize);
 }
 
+/* Lazy library reading. */
+
+/* Libraries are not read when loading a file when set, see #BLO_read_lazy_libraries_set. */
+static bool use_lazy_libraries = false;
+
+/**
+ * Don't read libraries when loading a file, all their linked data-blocks are
+ * place-holders until the library is reloaded (see #WM_lib_reload).
+ */
+void BLO_read_lazy_libraries_set(bool use_lazy)
+{
+	use_lazy_libraries = use_lazy;
+}
+
+/* Memory mapped file reading. */
+
+/* Uncompressed files are memory mapped when set, see #BLO_read_use_mmap_set. */
+static bool use_read_mmap = false;
+
+/**
+ * Memory map uncompressed files while reading, instead of using buffered reads.
+ * This also enables DNA reconstruction of data-blocks in parallel.
+ */
+void BLO_read_use_mmap_set(bool use_mmap)
+{
+	use_read_mmap = use_mmap;
+}
+
+static int fd_read_from_mmap(FileData *filedata, void *buffer, uint size)
+{
+	/* don't read more bytes then there are available in the mapping */
+	const size_t remaining = filedata->mmap_size - (size_t)filedata->file_offset;
+	const int readsize = (int)MIN2((size_t)size, remaining);
+
+	memcpy(buffer, filedata->mmap_buffer + filedata->file_offset, readsize);
+	filedata->file_offset += readsize;
+
+	return (readsize);
+}
+
+static off_t fd_seek_from_mmap(FileData *filedata, off_t offset, int whence)
+{
+	off_t offset_new;
+
+	switch (whence) {
+		case SEEK_SET:
+			offset_new = offset;
+			break;
+		case SEEK_CUR:
+			offset_new = filedata->file_offset + offset;
+			break;
+		case SEEK_END:
+			offset_new = (off_t)filedata->mmap_size + offset;
+			break;
+		default:
+			return -1;
+	}
+
+	if (offset_new < 0 || offset_new > (off_t)filedata->mmap_size) {
+		return -1;
+	}
+
+	filedata->file_offset = offset_new;
+	return offset_new;
+}
+
+/* Compressed file reading, using the frame index (see #BLEN_GZIP_FRAME_SIZE).
+ *
+ * Frames are decompressed on demand when they are read, so linking from a library only
+ * decompresses the frames holding block headers and the data of the ID's it needs.
+ * Reading a whole file decompresses all frames in parallel instead,
+ * see #blo_gzip_frames_decompress_all. */
+
+/* Number of decompressed frames kept around when decompressing on demand. */
+#define GZIP_FRAMES_CACHE_SIZE 4
+
+typedef struct GzipFrame {
+	/** Offset & size in the compressed file. */
+	off_t in_offset;
+	size_t in_len;
+	/** Offset & size in the uncompressed file. */
+	off_t out_offset;
+	size_t out_len;
+} GzipFrame;
+
+typedef struct GzipFrameCache {
+	/** Frame decompressed into the buffer, -1 when unused. */
+	int frame;
+	char *buf;
+	uint last_use;
+} GzipFrameCache;
+
+typedef struct GzipFrames {
+	int file;
+	GzipFrame *frames;
+	uint frames_len;
+	/** Size of the uncompressed file. */
+	size_t out_len;
+	GzipFrameCache cache[GZIP_FRAMES_CACHE_SIZE];
+	uint use_counter;
+	/** Compressed data of the frame being decompressed. */
+	char *in_buf;
+	size_t in_buf_len;
+} GzipFrames;
+
+static uint32_t gzip_frame_u32(const uchar *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool gzip_frame_read_full(int file, off_t offset, void *buf, size_t buf_len)
+{
+	char *data = buf;
+	if (lseek(file, offset, SEEK_SET) != offset) {
+		return false;
+	}
+	while (buf_len > 0) {
+		const ssize_t readsize = read(file, data, (uint)MIN2(buf_len, INT_MAX));
+		if (readsize <= 0) {
+			return false;
+		}
+		data += readsize;
+		buf_len -= (size_t)readsize;
+	}
+	return true;
+}
+
+static bool gzip_frame_decompress(const char *in, size_t in_len, char *out, size_t out_len)
+{
+	z_stream strm = {NULL};
+	bool ok;
+
+	/* 16 is added to the window bits to expect a gzip wrapper. */
+	if (inflateInit2(&strm, MAX_WBITS + 16) != Z_OK) {
+		return false;
+	}
+
+	strm.next_in = (Bytef *)in;
+	strm.avail_in = (uInt)in_len;
+	strm.next_out = (Bytef *)out;
+	strm.avail_out = (uInt)out_len;
+
+	ok = (inflate(&strm, Z_FINISH) == Z_STREAM_END) && (strm.total_out == out_len);
+	inflateEnd(&strm);
+	return ok;
+}
+
+static void gzip_frames_free(GzipFrames *gf)
+{
+	for (int i = 0; i < GZIP_FRAMES_CACHE_SIZE; i++) {
+		MEM_SAFE_FREE(gf->cache[i].buf);
+	}
+	MEM_SAFE_FREE(gf->in_buf);
+	MEM_freeN(gf->frames);
+	MEM_freeN(gf);
+}
+
+/**
+ * Read the frame index of a gzip file, nothing is decompressed yet.
+ *
+ * \return NULL when the file has no (valid) frame index,
+ * it can still be read as a regular gzip stream in that case.
+ */
+static GzipFrames *blo_gzip_frames_open(int file)
+{
+	/* Last bytes of the index member: frame count, magic, empty deflate block, CRC & size. */
+	uchar tail[4 + 4 + 2 + 8];
+	const uchar tail_end[2 + 8] = {0x03, 0x00};
+	const size_t file_len = BLI_file_descriptor_size(file);
+
+	if ((file_len == (size_t)-1) || (file_len < sizeof(tail)) ||
+	    !gzip_frame_read_full(file, (off_t)(file_len - sizeof(tail)), tail, sizeof(tail)) ||
+	    (memcmp(tail + 4, BLEN_GZIP_FRAME_INDEX_MAGIC, 4) != 0) ||
+	    (memcmp(tail + 8, tail_end, sizeof(tail_end)) != 0))
+	{
+		lseek(file, 0, SEEK_SET);
+		return NULL;
+	}
+
+	const uint frames_len = gzip_frame_u32(tail);
+	if ((frames_len == 0) || (frames_len > BLEN_GZIP_FRAME_INDEX_MAX)) {
+		lseek(file, 0, SEEK_SET);
+		return NULL;
+	}
+
+	const uint sub_len = frames_len * 8 + 8;
+	const size_t member_len = 10 + 2 + 4 + sub_len + 10;
+	if (member_len > file_len) {
+		lseek(file, 0, SEEK_SET);
+		return NULL;
+	}
+
+	uchar *member = MEM_mallocN(member_len, __func__);
+	const size_t frames_end = file_len - member_len;
+	bool ok = gzip_frame_read_full(file, (off_t)frames_end, member, member_len) &&
+	          (member[0] == 0x1f && member[1] == 0x8b && member[2] == 8 && member[3] == 4) &&
+	          (member[12] == 'B' && member[13] == 'I') &&
+	          ((uint)member[14] | ((uint)member[15] << 8)) == sub_len;
+
+	GzipFrames *gf = NULL;
+
+	if (ok) {
+		gf = MEM_callocN(sizeof(*gf), __func__);
+		gf->file = file;
+		gf->frames = MEM_mallocN(sizeof(*gf->frames) * frames_len, __func__);
+		gf->frames_len = frames_len;
+		for (int i = 0; i < GZIP_FRAMES_CACHE_SIZE; i++) {
+			gf->cache[i].frame = -1;
+		}
+
+		size_t in_len = 0;
+		for (uint i = 0; i < frames_len; i++) {
+			GzipFrame *frame = &gf->frames[i];
+			frame->in_offset = (off_t)in_len;
+			frame->in_len = gzip_frame_u32(member + 16 + i * 8);
+			frame->out_offset = (off_t)gf->out_len;
+			frame->out_len = gzip_frame_u32(member + 16 + i * 8 + 4);
+			in_len += frame->in_len;
+			gf->out_len += frame->out_len;
+			/* Decompressed frames are expected to fit in the cache buffers. */
+			ok = ok && (frame->out_len <= BLEN_GZIP_FRAME_SIZE);
+		}
+		ok = ok && (in_len == frames_end) && (gf->out_len != 0);
+	}
+
+	MEM_freeN(member);
+	lseek(file, 0, SEEK_SET);
+
+	if (!ok) {
+		if (gf) {
+			gzip_frames_free(gf);
+		}
+		return NULL;
+	}
+	return gf;
+}
+
+/* Index of the frame holding \a offset in the uncompressed file. */
+static uint gzip_frames_find(const GzipFrames *gf, off_t offset)
+{
+	uint lo = 0, hi = gf->frames_len - 1;
+	while (lo < hi) {
+		const uint mid = (lo + hi + 1) / 2;
+		if (gf->frames[mid].out_offset <= offset) {
+			lo = mid;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+/* Decompressed data of the frame, NULL on failure. */
+static const char *gzip_frames_cache_ensure(GzipFrames *gf, uint frame_index)
+{
+	GzipFrameCache *slot = &gf->cache[0];
+	for (int i = 0; i < GZIP_FRAMES_CACHE_SIZE; i++) {
+		GzipFrameCache *cache = &gf->cache[i];
+		if (cache->frame == (int)frame_index) {
+			cache->last_use = ++gf->use_counter;
+			return cache->buf;
+		}
+		if (cache->frame == -1 || cache->last_use < slot->last_use) {
+			slot = cache;
+		}
+	}
+
+	const GzipFrame *frame = &gf->frames[frame_index];
+	if (gf->in_buf_len < frame->in_len) {
+		MEM_SAFE_FREE(gf->in_buf);
+		gf->in_buf = MEM_mallocN(frame->in_len, __func__);
+		gf->in_buf_len = frame->in_len;
+	}
+	if (slot->buf == NULL) {
+		slot->buf = MEM_mallocN(BLEN_GZIP_FRAME_SIZE, __func__);
+	}
+
+	slot->frame = -1;
+	if (!gzip_frame_read_full(gf->file, frame->in_offset, gf->in_buf, frame->in_len) ||
+	    !gzip_frame_decompress(gf->in_buf, frame->in_len, slot->buf, frame->out_len))
+	{
+		return NULL;
+	}
+	slot->frame = (int)frame_index;
+	slot->last_use = ++gf->use_counter;
+	return slot->buf;
+}
+
+static int fd_read_from_gzip_frames(FileData *filedata, void *buffer, uint size)
+{
+	GzipFrames *gf = filedata->gzip_frames;
+	char *out = buffer;
+	uint readsize = 0;
+
+	/* don't read more bytes then there are available in the file */
+	while ((readsize < size) && ((size_t)filedata->file_offset < gf->out_len)) {
+		const uint frame_index = gzip_frames_find(gf, filedata->file_offset);
+		const GzipFrame *frame = &gf->frames[frame_index];
+		const char *frame_data = gzip_frames_cache_ensure(gf, frame_index);
+		if (frame_data == NULL) {
+			break;
+		}
+		const size_t frame_offset = (size_t)(filedata->file_offset - frame->out_offset);
+		const uint len = (uint)MIN2((size_t)(size - readsize), frame->out_len - frame_offset);
+		memcpy(out + readsize, frame_data + frame_offset, len);
+		readsize += len;
+		filedata->file_offset += len;
+	}
+
+	return (int)readsize;
+}
+
+static off_t fd_seek_from_gzip_frames(FileData *filedata, off_t offset, int whence)
+{
+	const off_t size = (off_t)filedata->gzip_frames->out_len;
+	off_t offset_new;
+
+	switch (whence) {
+		case SEEK_SET:
+			offset_new = offset;
+			break;
+		case SEEK_CUR:
+			offset_new = filedata->file_offset + offset;
+			break;
+		case SEEK_END:
+			offset_new = size + offset;
+			break;
+		default:
+			return -1;
+	}
+
+	if (offset_new < 0 || offset_new > size) {
+		return -1;
+	}
+
+	filedata->file_offset = offset_new;
+	return offset_new;
+}
+
+typedef struct GzipFramesDecompressData {
+	const GzipFrames *gf;
+	const char *in;
+	char *out;
+	bool ok;
+} GzipFramesDecompressData;
+
+static void gzip_frame_decompress_cb(
+        void *__restrict userdata,
+        const int index,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	GzipFramesDecompressData *data = userdata;
+	const GzipFrame *frame = &data->gf->frames[index];
+
+	if (!gzip_frame_decompress(data->in + frame->in_offset, frame->in_len,
+	                           data->out + frame->out_offset, frame->out_len))
+	{
+		data->ok = false;
+	}
+}
+
+/**
+ * Decompress all frames of the file at once using multiple threads, when the whole file is
+ * going to be read anyway. Reading continues from memory afterwards, like for memory mapped
+ * files, which also enables parallel DNA reconstruction.
+ *
+ * On failure frames keep being decompressed on demand.
+ */
+static void blo_gzip_frames_decompress_all(FileData *fd)
+{
+	GzipFrames *gf = fd->gzip_frames;
+	const GzipFrame *frame_last = &gf->frames[gf->frames_len - 1];
+	const size_t in_len = (size_t)frame_last->in_offset + frame_last->in_len;
+
+	char *buf_in = MEM_mallocN(in_len, __func__);
+	char *buf_out = MEM_mallocN(gf->out_len, __func__);
+
+	GzipFramesDecompressData data = {
+		.gf = gf,
+		.in = buf_in,
+		.out = buf_out,
+		.ok = (buf_in != NULL) && (buf_out != NULL) && gzip_frame_read_full(gf->file, 0, buf_in, in_len),
+	};
+
+	if (data.ok) {
+		ParallelRangeSettings settings;
+		BLI_parallel_range_settings_defaults(&settings);
+		settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+		BLI_task_parallel_range(0, (int)gf->frames_len, &data, gzip_frame_decompress_cb, &settings);
+	}
+
+	MEM_SAFE_FREE(buf_in);
+	if (!data.ok) {
+		MEM_SAFE_FREE(buf_out);
+		return;
+	}
+
+	fd->mmap_buffer = buf_out;
+	fd->mmap_size = gf->out_len;
+	fd->flags |= FD_FLAGS_MMAP_IS_ALLOC;
+	fd->read = fd_read_from_mmap;
+	fd->seek = fd_seek_from_mmap;
+
+	gzip_frames_free(gf);
+	fd->gzip_frames = NULL;
+}
+
 /* Memory reading. */
 
 static int fd_read_from_memory(FileData *filedata, void *buffer, uint size)
@@ -1280,6 +1716,10 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath, ReportL
 
 	gzFile gzfile = (gzFile)Z_NULL;
 
+	void *mmap_buffer = NULL;
+	size_t mmap_size = 0;
+	GzipFrames *gzip_frames = NULL;
+
 	char header[7];
 
 	/* Regular file. */
@@ -1297,6 +1737,34 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath, ReportL
 	if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
 		read_fn = fd_read_data_from_file;
 		seek_fn = fd_seek_data_from_file;
+
+		if (use_read_mmap) {
+			const size_t file_size = BLI_file_descriptor_size(file);
+			/* On failure (e.g. address space exhausted) fall back to regular reading. */
+			if (file_size != (size_t)-1 && file_size != 0) {
+				mmap_buffer = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, file, 0);
+				if (mmap_buffer == MAP_FAILED) {
+					mmap_buffer = NULL;
+				}
+				else {
+					mmap_size = file_size;
+					read_fn = fd_read_from_mmap;
+					seek_fn = fd_seek_from_mmap;
+				}
+			}
+		}
+	}
+
+	/* Gzip file, written with a frame index. */
+	if ((read_fn == NULL) &&
+	    /* Check header magic. */
+	    (header[0] == 0x1f && header[1] == 0x8b))
+	{
+		gzip_frames = blo_gzip_frames_open(file);
+		if (gzip_frames != NULL) {
+			read_fn = fd_read_from_gzip_frames;
+			seek_fn = fd_seek_from_gzip_frames;
+		}
 	}
 
 	/* Gzip file. */
@@ -1329,6 +1797,10 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath, ReportL
 	fd->filedes = file;
 	fd->gzfiledes = gzfile;
 
+	fd->mmap_buffer = mmap_buffer;
+	fd->mmap_size = mmap_size;
+	fd->gzip_frames = gzip_frames;
+
 	fd->read = read_fn;
 	fd->seek = seek_fn;
 
@@ -1491,6 +1963,15 @@ void blo_filedata_free(FileData *fd)
 			fd->buffer = NULL;
 		}
 
+#ifdef USE_BHEAD_READ_PARALLEL
+		/* Data computed ahead of time that was never read (from unknown ID types for example). */
+		LISTBASE_FOREACH (BHeadN *, new_bhead, &fd->bhead_list) {
+			if (new_bhead->data_prefetch) {
+				MEM_freeN(new_bhead->data_prefetch);
+			}
+		}
+#endif
+
 		/* Free all BHeadN data blocks */
 #ifndef NDEBUG
 		BLI_freelistN(&fd->bhead_list);
@@ -1504,6 +1985,19 @@ void blo_filedata_free(FileData *fd)
 		}
 #endif
 
+		if (fd->gzip_frames) {
+			gzip_frames_free(fd->gzip_frames);
+		}
+
+		if (fd->mmap_buffer) {
+			if (fd->flags & FD_FLAGS_MMAP_IS_ALLOC) {
+				MEM_freeN((void *)fd->mmap_buffer);
+			}
+			else {
+				munmap((void *)fd->mmap_buffer, fd->mmap_size);
+			}
+		}
+
 		if (fd->filesdna)
 			DNA_sdna_free(fd->filesdna);
 		if (fd->compflags)
@@ -1521,6 +2015,8 @@ void blo_filedata_free(FileData *fd)
 			oldnewmap_free(fd->scenemap);
 		if (fd->soundmap)
 			oldnewmap_free(fd->soundmap);
+		if (fd->undo_reused_ids)
+			BLI_gset_free(fd->undo_reused_ids, NULL);
 		if (fd->packedmap)
 			oldnewmap_free(fd->packedmap);
 		if (fd->libmap && !(fd->flags & FD_FLAGS_NOT_MY_LIBMAP))
@@ -2106,6 +2602,97 @@ void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd)
 	fd->old_mainlist = old_mainlist;
 }
 
+/* Undo reusing unchanged IDs of the old main. */
+
+/* Unchanged IDs are kept on undo unless disabled, see #BLO_read_undo_reuse_ids_set. */
+static bool use_undo_reuse_ids = true;
+
+/**
+ * Keep IDs which didn't change between the current state and the undo step being read,
+ * instead of reading them again from the undo memfile (enabled by default, disabled by tests to
+ * compare with a full read).
+ */
+void BLO_read_undo_reuse_ids_set(bool use_reuse)
+{
+	use_undo_reuse_ids = use_reuse;
+}
+
+static bool undo_reuse_id_type_supported(ID *id)
+{
+	/* Only geometry data outside of edit-mode. Other types have runtime data restored separately
+	 * (images, scenes...), or pointers into data of other IDs which are only restored when linking
+	 * (pose channels of objects). */
+	switch (GS(id->name)) {
+		case ID_ME:
+			return ((Mesh *)id)->edit_mesh == NULL;
+		case ID_CU:
+			return (((Curve *)id)->editnurb == NULL) && (((Curve *)id)->editfont == NULL);
+		case ID_MB:
+			return ((MetaBall *)id)->editelems == NULL;
+		case ID_LT:
+			return ((Lattice *)id)->editlatt == NULL;
+		case ID_AR:
+			return ((bArmature *)id)->edbo == NULL;
+		case ID_KE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Find the local IDs of \a oldmain which can be kept as they are when reading the undo memfile.
+ *
+ * \a memfile_current was written from \a oldmain: an ID not tagged for update since
+ * (#ID.recalc_after_undo_push) is still as written, at the same address. If its chunks are
+ * identical to the ones in the memfile being read, so are all pointers it contains.
+ */
+void blo_make_undo_reused_ids_map(FileData *fd, Main *oldmain, MemFile *memfile_current)
+{
+	BLI_assert(fd->memfile != NULL);
+
+	if (use_undo_reuse_ids == false) {
+		return;
+	}
+
+	GSet *ids_identical = BLO_memfile_identical_ids_get(fd->memfile, memfile_current);
+	if (ids_identical == NULL) {
+		return;
+	}
+
+	for (Object *ob = oldmain->objects.first; ob; ob = ob->id.next) {
+		if (ob->data == NULL) {
+			continue;
+		}
+		/* Data of objects in a paint or sculpt mode may still be changed when the object is freed,
+		 * and these modes change the data in place, only tagging the object. */
+		if ((ob->mode != OB_MODE_OBJECT) || (ob->sculpt != NULL) ||
+		    (ob->id.recalc_after_undo_push & (ID_RECALC_GEOMETRY | ID_RECALC_SHADING)))
+		{
+			BLI_gset_remove(ids_identical, ob->data, NULL);
+		}
+	}
+
+	ListBase *lbarray[MAX_LIBARRAY];
+	int a = set_listbasepointers(oldmain, lbarray);
+	while (a--) {
+		for (ID *id = lbarray[a]->first; id; id = id->next) {
+			if ((id->lib == NULL) &&
+			    (id->recalc_after_undo_push == 0) &&
+			    undo_reuse_id_type_supported(id) &&
+			    BLI_gset_haskey(ids_identical, id))
+			{
+				if (fd->undo_reused_ids == NULL) {
+					fd->undo_reused_ids = BLI_gset_ptr_new(__func__);
+				}
+				BLI_gset_insert(fd->undo_reused_ids, id);
+			}
+		}
+	}
+
+	BLI_gset_free(ids_identical, NULL);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -2132,6 +2719,17 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 {
 	void *temp = NULL;
 
+#ifdef USE_BHEAD_READ_PARALLEL
+	{
+		BHeadN *new_bhead = BHEADN_FROM_BHEAD(bh);
+		if (new_bhead->data_prefetch) {
+			temp = new_bhead->data_prefetch;
+			new_bhead->data_prefetch = NULL;
+			return temp;
+		}
+	}
+#endif
+
 	if (bh->len) {
 #ifdef USE_BHEAD_READ_ON_DEMAND
 		BHead *bh_orig = bh;
@@ -8891,6 +9489,153 @@ static const char *dataname(short id_code)
 
 }
 
+#ifdef USE_BHEAD_READ_PARALLEL
+
+typedef struct BHeadPrefetch {
+	BHeadN *new_bhead;
+	const char *blockname;
+} BHeadPrefetch;
+
+typedef struct ReadStructParallelData {
+	FileData *fd;
+	BHeadPrefetch *prefetch;
+} ReadStructParallelData;
+
+static void read_struct_parallel_cb(
+        void *__restrict userdata,
+        const int index,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	ReadStructParallelData *data = userdata;
+	FileData *fd = data->fd;
+	BHeadN *new_bhead = data->prefetch[index].new_bhead;
+	const BHead *bh = &new_bhead->bhead;
+	const char *bh_data = fd->mmap_buffer + new_bhead->file_offset;
+
+	if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+		new_bhead->data_prefetch = DNA_struct_reconstruct(
+		        fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, bh_data);
+	}
+	else {
+		/* SDNA_CMP_EQUAL */
+		new_bhead->data_prefetch = MEM_mallocN(bh->len, data->prefetch[index].blockname);
+		memcpy(new_bhead->data_prefetch, bh_data, bh->len);
+	}
+}
+
+/**
+ * Run #read_struct in parallel on the direct data of ID's following \a bhead_start, until
+ * #BHEAD_READ_PARALLEL_WINDOW_SIZE bytes are covered, results are picked up by #read_struct
+ * when reading the ID's afterwards. The window always ends at an ID boundary.
+ *
+ * ID blocks themselves are left to the regular reading code,
+ * which needs them for lookups before their data is read.
+ */
+static void read_struct_prefetch_window(FileData *fd, BHead *bhead_start)
+{
+	/* Only headers are read here, data stays in memory until reconstructed. */
+	const char *blockname = NULL;
+	size_t window_size = 0;
+	int prefetch_len = 0;
+	BHead *bhead_end;
+
+	for (bhead_end = bhead_start; bhead_end; bhead_end = blo_bhead_next(fd, bhead_end)) {
+		if (bhead_end->code == DATA) {
+			prefetch_len++;
+			window_size += (size_t)bhead_end->len;
+		}
+		else if (bhead_end != bhead_start && window_size >= BHEAD_READ_PARALLEL_WINDOW_SIZE) {
+			break;
+		}
+	}
+
+	fd->prefetch_bhead_next = bhead_end;
+
+	if (prefetch_len == 0) {
+		return;
+	}
+
+	BHeadPrefetch *prefetch = MEM_mallocN(sizeof(*prefetch) * (size_t)prefetch_len, __func__);
+	prefetch_len = 0;
+
+	for (BHead *bhead = bhead_start; bhead != bhead_end; bhead = blo_bhead_next(fd, bhead)) {
+		switch (bhead->code) {
+			case DATA:
+			{
+				BHeadN *new_bhead = BHEADN_FROM_BHEAD(bhead);
+				if ((blockname != NULL) &&
+				    (bhead->len != 0) &&
+				    (new_bhead->has_data == false) &&
+				    (new_bhead->data_prefetch == NULL) &&
+				    (fd->compflags[bhead->SDNAnr] != SDNA_CMP_REMOVED))
+				{
+					prefetch[prefetch_len].new_bhead = new_bhead;
+					prefetch[prefetch_len].blockname = blockname;
+					prefetch_len++;
+				}
+				break;
+			}
+			/* Data following these blocks is not part of an ID. */
+			case DNA1:
+			case TEST:
+			case REND:
+			case GLOB:
+			case USER:
+			case ENDB:
+			case ID_LINK_PLACEHOLDER:
+				blockname = NULL;
+				break;
+			case ID_SCRN:
+				blockname = dataname(ID_SCR);
+				break;
+			default:
+				blockname = dataname(bhead->code);
+				break;
+		}
+	}
+
+	ReadStructParallelData data = {
+		.fd = fd,
+		.prefetch = prefetch,
+	};
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	/* Block sizes vary wildly (a mesh vertex array next to a single modifier). */
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+	settings.min_iter_per_thread = 64;
+	BLI_task_parallel_range(0, prefetch_len, &data, read_struct_parallel_cb, &settings);
+
+	MEM_freeN(prefetch);
+}
+
+/**
+ * Make sure data of the ID starting at \a bhead is reconstructed ahead of time,
+ * when the file supports it. Cheap to call for every block.
+ */
+static void read_struct_prefetch_ensure(FileData *fd, BHead *bhead)
+{
+	if (bhead == fd->prefetch_bhead_next) {
+		read_struct_prefetch_window(fd, bhead);
+	}
+}
+
+static void read_struct_prefetch_init(FileData *fd)
+{
+	if ((fd->mmap_buffer == NULL) ||
+	    (fd->seek == NULL) ||
+	    (fd->flags & FD_FLAGS_SWITCH_ENDIAN) ||
+	    (fd->skip_flags & BLO_READ_SKIP_DATA))
+	{
+		fd->prefetch_bhead_next = NULL;
+	}
+	else {
+		fd->prefetch_bhead_next = blo_bhead_first(fd);
+	}
+}
+
+#endif  /* USE_BHEAD_READ_PARALLEL */
+
 static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *allocname)
 {
 	bhead = blo_bhead_next(fd, bhead);
@@ -8918,6 +9663,39 @@ static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *a
 	return bhead;
 }
 
+/**
+ * Move the unchanged ID from the old main instead of reading it (see #blo_make_undo_reused_ids_map).
+ * Its ID pointers are still the ones written in the memfile, they're relinked by #lib_link_undo_reused_ids.
+ */
+static BHead *read_libblock_undo_reuse(FileData *fd, Main *main, BHead *bhead, const int tag, ID **r_id)
+{
+	ID *id = (ID *)bhead->old;
+	Main *oldmain = fd->old_mainlist->first;
+
+	BLI_assert(GS(id->name) == bhead->code);
+
+	BLI_remlink(which_libbase(oldmain, GS(id->name)), id);
+	BLI_addtail(which_libbase(main, GS(id->name)), id);
+	oldnewmap_insert(fd->libmap, bhead->old, id, bhead->code);
+
+	/* Same as for a read ID, users are counted again when linking. */
+	id->us = ID_FAKE_USERS(id);
+	id->newid = NULL;
+	id->recalc = 0;
+	id->tag = tag | LIB_TAG_NEW | LIB_TAG_UNDO_OLD_ID_REUSED;
+
+	if (r_id) {
+		*r_id = id;
+	}
+
+	/* Skip the ID data. */
+	bhead = blo_bhead_next(fd, bhead);
+	while (bhead && bhead->code == DATA) {
+		bhead = blo_bhead_next(fd, bhead);
+	}
+	return bhead;
+}
+
 static BHead *read_libblock(FileData *fd, Main *main, BHead *bhead, const int tag, ID **r_id)
 {
 	/* this routine reads a libblock and its direct data. Use link functions to connect it all
@@ -8980,6 +9758,10 @@ static BHead *read_libblock(FileData *fd, Main *main, BHead *bhead, const int ta
 		}
 	}
 
+	if (fd->undo_reused_ids && BLI_gset_haskey(fd->undo_reused_ids, bhead->old)) {
+		return read_libblock_undo_reuse(fd, main, bhead, tag, r_id);
+	}
+
 	/* read libblock */
 	id = read_struct(fd, bhead, "lib block");
 
@@ -9010,6 +9792,8 @@ static BHead *read_libblock(FileData *fd, Main *main, BHead *bhead, const int ta
 	id->newid = NULL;  /* Needed because .blend may have been saved with crap value here... */
 	id->orig_id = NULL;
 	id->recalc = 0;
+	/* Not at the address it has in any undo memfile, see #blo_make_undo_reused_ids_map. */
+	id->recalc_after_undo_push = ID_RECALC_ALL;
 
 	/* this case cannot be direct_linked: it's just the ID part */
 	if (bhead->code == ID_LINK_PLACEHOLDER) {
@@ -9307,6 +10091,29 @@ static void do_versions_after_linking(Main *main)
 /** \name Read Library Data Block (all)
  * \{ */
 
+static int lib_link_undo_reused_id_cb(void *user_data, ID *UNUSED(id_self), ID **id_pointer, int cb_flag)
+{
+	FileData *fd = user_data;
+
+	if (*id_pointer) {
+		*id_pointer = newlibadr(fd, NULL, *id_pointer);
+		if (cb_flag & IDWALK_CB_USER) {
+			id_us_plus_no_lib(*id_pointer);
+		}
+	}
+	return IDWALK_RET_NOP;
+}
+
+/* Relink IDs kept from the old main, like the lib_link functions do for read ones. */
+static void lib_link_undo_reused_ids(FileData *fd, Main *main)
+{
+	GSET_FOREACH_BEGIN (ID *, id, fd->undo_reused_ids)
+	{
+		BKE_library_foreach_ID_link(main, id, lib_link_undo_reused_id_cb, fd, IDWALK_NOP);
+	}
+	GSET_FOREACH_END();
+}
+
 static void lib_link_all(FileData *fd, Main *main)
 {
 	lib_link_id(fd, main);
@@ -9498,7 +10305,19 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 		}
 	}
 
+	/* The whole file is read, faster to decompress it at once using multiple threads. */
+	if ((fd->gzip_frames != NULL) && !(fd->skip_flags & BLO_READ_SKIP_DATA)) {
+		blo_gzip_frames_decompress_all(fd);
+	}
+
+#ifdef USE_BHEAD_READ_PARALLEL
+	read_struct_prefetch_init(fd);
+#endif
+
 	while (bhead) {
+#ifdef USE_BHEAD_READ_PARALLEL
+		read_struct_prefetch_ensure(fd, bhead);
+#endif
 		switch (bhead->code) {
 			case DATA:
 			case DNA1:
@@ -9555,12 +10374,16 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 		do_versions_userdef(fd, bfd);
 	}
 
-	read_libraries(fd, &mainlist);
+	read_libraries(fd, &mainlist, use_lazy_libraries && (fd->memfile == NULL));
 
 	blo_join_main(&mainlist);
 
 	lib_link_all(fd, bfd->main);
 
+	if (fd->undo_reused_ids) {
+		lib_link_undo_reused_ids(fd, bfd->main);
+	}
+
 	/* Skip in undo case. */
 	if (fd->memfile == NULL) {
 		/* Yep, second splitting... but this is a very cheap operation, so no big deal. */
@@ -11173,7 +11996,7 @@ static void library_link_end(
 	BLO_expand_main(*fd, mainl);
 
 	/* do this when expand found other libs */
-	read_libraries(*fd, (*fd)->mainlist);
+	read_libraries(*fd, (*fd)->mainlist, false);
 
 	curlib = mainl->curlib;
 
@@ -11313,13 +12136,15 @@ static void read_library_linked_id(ReportList *reports, FileData *fd, Main *main
 		read_libblock(fd, mainvar, bhead, id->tag, r_id);
 	}
 	else {
-		blo_reportf_wrap(
-		        reports, RPT_WARNING,
-		        TIP_("LIB: %s: '%s' missing from '%s', parent '%s'"),
-		        BKE_idcode_to_name(GS(id->name)),
-		        id->name + 2,
-		        mainvar->curlib->filepath,
-		        library_parent_filepath(mainvar->curlib));
+		if ((mainvar->curlib->id.tag & LIB_TAG_LAZY) == 0) {
+			blo_reportf_wrap(
+			        reports, RPT_WARNING,
+			        TIP_("LIB: %s: '%s' missing from '%s', parent '%s'"),
+			        BKE_idcode_to_name(GS(id->name)),
+			        id->name + 2,
+			        mainvar->curlib->filepath,
+			        library_parent_filepath(mainvar->curlib));
+		}
 
 		/* Generate a placeholder for this ID (simplified version of read_libblock actually...). */
 		if (r_id) {
@@ -11377,7 +12202,8 @@ static void read_library_linked_ids(FileData *basefd, FileData *fd, ListBase *ma
 	BLI_ghash_free(loaded_ids, NULL, NULL);
 }
 
-static FileData *read_library_file_data(FileData *basefd, ListBase *mainlist, Main *mainl, Main *mainptr)
+static FileData *read_library_file_data(
+        FileData *basefd, ListBase *mainlist, Main *mainl, Main *mainptr, const bool use_lazy)
 {
 	FileData *fd = mainptr->curlib->filedata;
 
@@ -11386,6 +12212,26 @@ static FileData *read_library_file_data(FileData *basefd, ListBase *mainlist, Ma
 		return fd;
 	}
 
+	/* Lazy libraries are not opened at all, their linked data-blocks become place-holders.
+	 * Libraries stay lazy until their place-holders are read by #WM_lib_lazy_ensure or the library is reloaded
+	 * (also when kept from the previous state on undo).
+	 * Packed libraries are always read, they can't be reloaded from disk. */
+	if ((use_lazy || (mainptr->curlib->id.tag & LIB_TAG_LAZY)) && (mainptr->curlib->packedfile == NULL)) {
+		if ((mainptr->curlib->id.tag & LIB_TAG_LAZY) == 0) {
+			blo_reportf_wrap(
+			        basefd->reports, RPT_INFO, TIP_("Defer reading library:  '%s', '%s', parent '%s'"),
+			        mainptr->curlib->filepath,
+			        mainptr->curlib->name,
+			        library_parent_filepath(mainptr->curlib));
+		}
+
+		mainptr->curlib->id.tag |= LIB_TAG_LAZY;
+		/* Set lib version to current main one... Makes assert later happy. */
+		mainptr->versionfile = mainptr->curlib->versionfile = mainl->versionfile;
+		mainptr->subversionfile = mainptr->curlib->subversionfile = mainl->subversionfile;
+		return NULL;
+	}
+
 	if (mainptr->curlib->packedfile) {
 		/* Read packed file. */
 		PackedFile *pf = mainptr->curlib->packedfile;
@@ -11448,7 +12294,10 @@ static FileData *read_library_file_data(FileData *basefd, ListBase *mainlist, Ma
 	return fd;
 }
 
-static void read_libraries(FileData *basefd, ListBase *mainlist)
+/**
+ * \param use_lazy: Don't read libraries not opened yet, see #BLO_read_lazy_libraries_set.
+ */
+static void read_libraries(FileData *basefd, ListBase *mainlist, const bool use_lazy)
 {
 	Main *mainl = mainlist->first;
 	bool do_it = true;
@@ -11474,7 +12323,7 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 				// printf("Reading linked datablocks from %s (%s)\n", mainptr->curlib->id.name, mainptr->curlib->name);
 
 				/* Open file if it has not been done yet. */
-				FileData *fd = read_library_file_data(basefd, mainlist, mainl, mainptr);
+				FileData *fd = read_library_file_data(basefd, mainlist, mainl, mainptr, use_lazy);
 
 				if (fd) {
 					do_it = true;
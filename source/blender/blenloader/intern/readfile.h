@@ -30,6 +30,7 @@
 #include "DNA_space_types.h"
 #include "DNA_windowmanager_types.h"  /* for ReportType */
 
+struct GSet;
 struct Key;
 struct MemFile;
 struct Object;
@@ -46,6 +47,8 @@ enum eFileDataFlag {
 	FD_FLAGS_NOT_MY_BUFFER         = 1 << 4,
 	/* XXX Unused in practice (checked once but never set). */
 	FD_FLAGS_NOT_MY_LIBMAP         = 1 << 5,
+	/** #FileData.mmap_buffer holds decompressed frames instead of a file mapping. */
+	FD_FLAGS_MMAP_IS_ALLOC         = 1 << 6,
 };
 
 
@@ -69,6 +72,14 @@ typedef struct FileData {
 
 	/** Variables needed for reading from memory / stream. */
 	const char *buffer;
+	/** Variables needed for reading from a memory mapped file (or decompressed frames). */
+	const char *mmap_buffer;
+	size_t mmap_size;
+	/** Variables needed for reading compressed frames on demand. */
+	struct GzipFrames *gzip_frames;
+	/** First block which data-blocks were not reconstructed ahead of reading yet,
+	 * NULL once all were, or when this is not done for the file. */
+	struct BHead *prefetch_bhead_next;
 	/** Variables needed for reading from memfile (undo). */
 	struct MemFile *memfile;
 
@@ -114,6 +125,8 @@ typedef struct FileData {
 	ListBase *mainlist;
 	/** Used for undo. */
 	ListBase *old_mainlist;
+	/** Used for undo, IDs of the old main kept instead of being read, see #blo_make_undo_reused_ids_map. */
+	struct GSet *undo_reused_ids;
 
 	struct ReportList *reports;
 } FileData;
@@ -143,6 +156,7 @@ void blo_end_sound_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_make_packed_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_end_packed_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd);
+void blo_make_undo_reused_ids_map(FileData *fd, struct Main *oldmain, struct MemFile *memfile_current);
 
 void blo_filedata_free(FileData *fd);
 
@@ -41,6 +41,9 @@
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_threads.h"
 
 #include "BLO_undofile.h"
 #include "BLO_readfile.h"
@@ -52,77 +55,284 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/**
+ * Chunk buffers are de-duplicated by content between all memory files (not only against the previous step),
+ * so data that moves in the file (because an ID was added or removed before it) is still shared.
+ *
+ * Each distinct buffer is stored once in a #MemFileBuffer, reference counted by the chunks using it.
+ * The storage is shared by all memory files, which can be written and freed from any thread,
+ * so it's only accessed with #g_memfile_buffers_mutex locked.
+ */
+typedef struct MemFileBuffer {
+	/** Points to the data directly after this struct (or any data, for a lookup key). */
+	const char *buf;
+	uint size;
+	uint hash;
+	/** Number of #MemFileChunk using this buffer. */
+	uint users;
+} MemFileBuffer;
+
+static struct {
+	/** Set of #MemFileBuffer, allocated on demand, freed when the last buffer is freed. */
+	GSet *buffers;
+	size_t size_unique;
+	size_t size_total;
+} g_memfile_buffers = {NULL};
+
+static ThreadMutex g_memfile_buffers_mutex = BLI_MUTEX_INITIALIZER;
+
+static uint memfile_buffer_hash(const void *key)
+{
+	const MemFileBuffer *mbuf = key;
+	return mbuf->hash;
+}
+
+static bool memfile_buffer_cmp(const void *a, const void *b)
+{
+	const MemFileBuffer *mbuf_a = a;
+	const MemFileBuffer *mbuf_b = b;
+	return ((mbuf_a->hash != mbuf_b->hash) ||
+	        (mbuf_a->size != mbuf_b->size) ||
+	        (memcmp(mbuf_a->buf, mbuf_b->buf, mbuf_a->size) != 0));
+}
+
+static MemFileBuffer *memfile_buffer_from_chunk(const MemFileChunk *chunk)
+{
+	return ((MemFileBuffer *)chunk->buf) - 1;
+}
+
+/**
+ * \return the stored buffer matching \a buf, adding a new one when there is no match.
+ * \note Call with #g_memfile_buffers_mutex locked.
+ */
+static MemFileBuffer *memfile_buffer_ensure(const char *buf, uint size, uint hash, bool *r_is_new)
+{
+	if (g_memfile_buffers.buffers == NULL) {
+		g_memfile_buffers.buffers = BLI_gset_new(memfile_buffer_hash, memfile_buffer_cmp, __func__);
+	}
+
+	const MemFileBuffer key = {
+		.buf = buf,
+		.size = size,
+		.hash = hash,
+	};
+
+	void **val;
+	if (BLI_gset_ensure_p_ex(g_memfile_buffers.buffers, &key, &val)) {
+		*r_is_new = false;
+		return *val;
+	}
+
+	MemFileBuffer *mbuf = MEM_mallocN(sizeof(*mbuf) + size, "MemFileBuffer");
+	char *buf_new = (char *)(mbuf + 1);
+	memcpy(buf_new, buf, size);
+	mbuf->buf = buf_new;
+	mbuf->size = size;
+	mbuf->hash = key.hash;
+	mbuf->users = 0;
+	/* Replace the key with the stored buffer. */
+	*val = mbuf;
+
+	g_memfile_buffers.size_unique += size;
+	*r_is_new = true;
+	return mbuf;
+}
+
+/* Call with #g_memfile_buffers_mutex locked. */
+static void memfile_buffer_user_add(MemFileBuffer *mbuf)
+{
+	mbuf->users++;
+	g_memfile_buffers.size_total += mbuf->size;
+}
+
+/* Call with #g_memfile_buffers_mutex locked. */
+static void memfile_buffer_user_remove(MemFileBuffer *mbuf)
+{
+	BLI_assert(mbuf->users > 0);
+	g_memfile_buffers.size_total -= mbuf->size;
+	if (--mbuf->users != 0) {
+		return;
+	}
+
+	g_memfile_buffers.size_unique -= mbuf->size;
+	BLI_gset_remove(g_memfile_buffers.buffers, mbuf, NULL);
+	MEM_freeN(mbuf);
+
+	if (BLI_gset_len(g_memfile_buffers.buffers) == 0) {
+		BLI_gset_free(g_memfile_buffers.buffers, NULL);
+		g_memfile_buffers.buffers = NULL;
+		BLI_assert(g_memfile_buffers.size_unique == 0 && g_memfile_buffers.size_total == 0);
+	}
+}
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
 	MemFileChunk *chunk;
 
+	BLI_mutex_lock(&g_memfile_buffers_mutex);
 	while ((chunk = BLI_pophead(&memfile->chunks))) {
-		if (chunk->is_identical == false) {
-			MEM_freeN((void *)chunk->buf);
-		}
+		memfile_buffer_user_remove(memfile_buffer_from_chunk(chunk));
 		MEM_freeN(chunk);
 	}
+	BLI_mutex_unlock(&g_memfile_buffers_mutex);
 	memfile->size = 0;
+	memfile->chunks_len = 0;
+
+	MEM_SAFE_FREE(memfile->ids);
+	memfile->ids_len = memfile->ids_alloc = 0;
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
-void BLO_memfile_merge(MemFile *first, MemFile *second)
+void BLO_memfile_merge(MemFile *first, MemFile *UNUSED(second))
 {
-	MemFileChunk *fc, *sc;
-
-	fc = first->chunks.first;
-	sc = second->chunks.first;
-	while (fc || sc) {
-		if (fc && sc) {
-			if (sc->is_identical) {
-				sc->is_identical = false;
-				fc->is_identical = true;
-			}
-		}
-		if (fc) fc = fc->next;
-		if (sc) sc = sc->next;
-	}
-
+	/* Buffers are reference counted, 'second' keeps the ones it uses. */
 	BLO_memfile_free(first);
 }
 
+/**
+ * Statistics for the chunk buffers of all memory files.
+ */
+void BLO_memfile_stats_get(MemFileStats *r_stats)
+{
+	BLI_mutex_lock(&g_memfile_buffers_mutex);
+	r_stats->buffers_num = g_memfile_buffers.buffers ? BLI_gset_len(g_memfile_buffers.buffers) : 0;
+	r_stats->size_unique = g_memfile_buffers.size_unique;
+	r_stats->size_total = g_memfile_buffers.size_total;
+	BLI_mutex_unlock(&g_memfile_buffers_mutex);
+}
+
 void memfile_chunk_add(
         MemFile *memfile, const char *buf, uint size,
         MemFileChunk **compchunk_step)
 {
 	MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
+	MemFileBuffer *mbuf = NULL;
 	curchunk->size = size;
-	curchunk->buf = NULL;
-	curchunk->is_identical = false;
+	curchunk->is_identical = true;
 	BLI_addtail(&memfile->chunks, curchunk);
+	memfile->chunks_len++;
 
-	/* we compare compchunk with buf */
+	/* we compare compchunk with buf, cheaper than hashing when data didn't move */
 	if (*compchunk_step != NULL) {
 		MemFileChunk *compchunk = *compchunk_step;
 		if (compchunk->size == curchunk->size) {
 			if (memcmp(compchunk->buf, buf, size) == 0) {
-				curchunk->buf = compchunk->buf;
-				curchunk->is_identical = true;
+				mbuf = memfile_buffer_from_chunk(compchunk);
 			}
 		}
 		*compchunk_step = compchunk->next;
 	}
 
-	/* not equal... */
-	if (curchunk->buf == NULL) {
-		char *buf_new = MEM_mallocN(size, "Chunk buffer");
-		memcpy(buf_new, buf, size);
-		curchunk->buf = buf_new;
-		memfile->size += size;
+	/* not equal, look up the buffer in all memfiles (hashing outside of the lock)... */
+	const uint hash = (mbuf == NULL) ? BLI_hash_mm2((const unsigned char *)buf, size, 0) : 0;
+
+	BLI_mutex_lock(&g_memfile_buffers_mutex);
+	if (mbuf == NULL) {
+		bool is_new;
+		mbuf = memfile_buffer_ensure(buf, size, hash, &is_new);
+		if (is_new) {
+			curchunk->is_identical = false;
+			memfile->size += size;
+		}
 	}
+	memfile_buffer_user_add(mbuf);
+	BLI_mutex_unlock(&g_memfile_buffers_mutex);
+
+	curchunk->buf = mbuf->buf;
+}
+
+/**
+ * Record the chunks holding the data of an ID, see #BLO_memfile_identical_ids_get.
+ */
+void memfile_id_add(MemFile *memfile, const void *address, uint chunk_first, uint chunk_last, uint offset)
+{
+	if (memfile->ids_len == memfile->ids_alloc) {
+		memfile->ids_alloc = memfile->ids_alloc ? memfile->ids_alloc * 2 : 256;
+		memfile->ids = MEM_reallocN(memfile->ids, sizeof(*memfile->ids) * memfile->ids_alloc);
+	}
+	MemFileID *mid = &memfile->ids[memfile->ids_len++];
+	mid->address = address;
+	mid->chunk_first = chunk_first;
+	mid->chunk_last = chunk_last;
+	mid->offset = offset;
+}
+
+static const MemFileChunk **memfile_chunks_array(MemFile *memfile)
+{
+	const MemFileChunk **chunks = MEM_mallocN(sizeof(*chunks) * memfile->chunks_len, __func__);
+	uint i = 0;
+	for (const MemFileChunk *chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+		chunks[i++] = chunk;
+	}
+	BLI_assert(i == memfile->chunks_len);
+	return chunks;
+}
+
+/**
+ * Find the IDs written with the same data into both memory files.
+ *
+ * An ID can share its chunks with the IDs written before and after it, all of them are compared.
+ * Since equal buffers are always shared (see #MemFileBuffer), comparing buffer pointers is enough.
+ * Both memory files store the ID at the same address, which is also the address
+ * of all the pointers it contains.
+ *
+ * \return a set of ID addresses (as written in the files), NULL when there are none.
+ */
+GSet *BLO_memfile_identical_ids_get(MemFile *memfile_a, MemFile *memfile_b)
+{
+	if (memfile_a->ids_len == 0 || memfile_b->ids_len == 0) {
+		return NULL;
+	}
+
+	GHash *ids_a = BLI_ghash_ptr_new_ex(__func__, memfile_a->ids_len);
+	for (uint i = 0; i < memfile_a->ids_len; i++) {
+		BLI_ghash_insert(ids_a, (void *)memfile_a->ids[i].address, &memfile_a->ids[i]);
+	}
+
+	const MemFileChunk **chunks_a = memfile_chunks_array(memfile_a);
+	const MemFileChunk **chunks_b = memfile_chunks_array(memfile_b);
+	GSet *ids_identical = NULL;
+
+	for (uint i = 0; i < memfile_b->ids_len; i++) {
+		const MemFileID *mid_b = &memfile_b->ids[i];
+		const MemFileID *mid_a = BLI_ghash_lookup(ids_a, mid_b->address);
+
+		if ((mid_a == NULL) ||
+		    (mid_a->offset != mid_b->offset) ||
+		    (mid_a->chunk_last - mid_a->chunk_first != mid_b->chunk_last - mid_b->chunk_first))
+		{
+			continue;
+		}
+
+		bool is_identical = true;
+		for (uint j = 0; j <= mid_b->chunk_last - mid_b->chunk_first; j++) {
+			if (chunks_a[mid_a->chunk_first + j]->buf != chunks_b[mid_b->chunk_first + j]->buf) {
+				is_identical = false;
+				break;
+			}
+		}
+
+		if (is_identical) {
+			if (ids_identical == NULL) {
+				ids_identical = BLI_gset_ptr_new(__func__);
+			}
+			BLI_gset_insert(ids_identical, (void *)mid_b->address);
+		}
+	}
+
+	MEM_freeN(chunks_a);
+	MEM_freeN(chunks_b);
+	BLI_ghash_free(ids_a, NULL, NULL);
+	return ids_identical;
 }
 
 struct Main *BLO_memfile_main_get(struct MemFile *memfile, struct Main *oldmain, struct Scene **r_scene)
 {
 	struct Main *bmain_undo = NULL;
-	BlendFileData *bfd = BLO_read_from_memfile(oldmain, BKE_main_blendfile_path(oldmain), memfile, BLO_READ_SKIP_NONE, NULL);
+	BlendFileData *bfd = BLO_read_from_memfile(
+	        oldmain, BKE_main_blendfile_path(oldmain), memfile, NULL, BLO_READ_SKIP_NONE, NULL);
 
 	if (bfd) {
 		bmain_undo = bfd->main;
@@ -485,6 +485,9 @@ void BLO_version_defaults_userpref_blend(Main *bmain, UserDef *userdef)
 	 */
 	{
 		/* (keep this block even if it becomes empty). */
+		if (userdef->sequencer_disk_cache_size_limit == 0) {
+			userdef->sequencer_disk_cache_size_limit = 100;
+		}
 	}
 
 	if (userdef->pixelsize == 0.0f)
@@ -148,7 +148,11 @@
 #include "MEM_guardedalloc.h" // MEM_freeN
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_math_base.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BKE_action.h"
 #include "BKE_blender_version.h"
@@ -197,6 +201,14 @@
 #define MYWRITE_BUFFER_SIZE (MEM_SIZE_OPTIMAL(1 << 17))  /* 128kb */
 #define MYWRITE_MAX_CHUNK   (MEM_SIZE_OPTIMAL(1 << 15))  /* ~32kb */
 
+/**
+ * Undo memfile chunks end after an ID when its name hash has these bits unset (so every 8 IDs on average),
+ * or when they're large enough. Boundaries picked from names don't move when data before them changes size,
+ * and small IDs still share chunks.
+ */
+#define MEMFILE_ID_CHUNK_MASK  0x7
+#define MEMFILE_ID_CHUNK_MIN   (MYWRITE_BUFFER_SIZE / 4)
+
 /** Use if we want to store how many bytes have been written to the file. */
 // #define USE_WRITE_DATA_LEN
 
@@ -222,7 +234,7 @@ struct WriteWrap {
 	/* internal */
 	union {
 		int file_handle;
-		gzFile gz_handle;
+		struct ZlibFrames *zlib_frames;
 	} _user_data;
 };
 
@@ -254,31 +266,221 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
+/* zlib, written as independent frames with an index (see #BLEN_GZIP_FRAME_SIZE). */
+
+/* Maximum number of frames compressed at once, which bounds memory used while writing. */
+#define ZLIB_FRAMES_IN_FLIGHT_MAX 8
+
+typedef struct ZlibFrame {
+	/** Uncompressed input. */
+	char *buf;
+	size_t buf_len;
+	/** Compressed output, a complete gzip member. */
+	char *out;
+	size_t out_len;
+} ZlibFrame;
+
+typedef struct ZlibFrames {
+	int file_handle;
+	/** Frames compressed at once, in parallel. Buffers are allocated on first use. */
+	ZlibFrame *frames;
+	int frames_len;
+	/** Frame currently being filled. */
+	int frame_active;
+	size_t out_alloc;
+	/** Compressed & uncompressed size of all frames written so far. */
+	uint32_t *index;
+	int index_len, index_alloc;
+	bool error;
+} ZlibFrames;
+
 #define FILE_HANDLE(ww) \
-	(ww)->_user_data.gz_handle
+	(ww)->_user_data.zlib_frames
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-	gzFile file;
+	int file;
 
-	file = BLI_gzopen(filepath, "wb1");
+	file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
 
-	if (file != Z_NULL) {
-		FILE_HANDLE(ww) = file;
+	if (file != -1) {
+		ZlibFrames *zf = MEM_callocN(sizeof(*zf), __func__);
+		zf->file_handle = file;
+		zf->frames_len = min_ii(BLI_system_thread_count(), ZLIB_FRAMES_IN_FLIGHT_MAX);
+		zf->frames = MEM_callocN(sizeof(*zf->frames) * (size_t)zf->frames_len, __func__);
+		/* Room for the gzip header & trailer, 'compressBound' accounts for a zlib wrapper. */
+		zf->out_alloc = compressBound(BLEN_GZIP_FRAME_SIZE) + 32;
+		FILE_HANDLE(ww) = zf;
 		return true;
 	}
 	else {
 		return false;
 	}
 }
+
+static bool ww_write_zlib_data(ZlibFrames *zf, const void *buf, size_t buf_len)
+{
+	const char *data = buf;
+	while (buf_len > 0) {
+		const ssize_t written = write(zf->file_handle, data, buf_len);
+		if (written <= 0) {
+			return false;
+		}
+		data += written;
+		buf_len -= (size_t)written;
+	}
+	return true;
+}
+
+static void ww_zlib_frame_compress_cb(
+        void *__restrict userdata,
+        const int index,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	ZlibFrames *zf = userdata;
+	ZlibFrame *frame = &zf->frames[index];
+	z_stream strm = {NULL};
+
+	frame->out_len = 0;
+
+	if (frame->out == NULL) {
+		frame->out = MEM_mallocN(zf->out_alloc, __func__);
+	}
+
+	/* Same compression level as 'wb1' used to be, 16 is added to the window bits for a gzip wrapper. */
+	if (deflateInit2(&strm, 1, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return;
+	}
+
+	strm.next_in = (Bytef *)frame->buf;
+	strm.avail_in = (uInt)frame->buf_len;
+	strm.next_out = (Bytef *)frame->out;
+	strm.avail_out = (uInt)zf->out_alloc;
+
+	if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+		frame->out_len = strm.total_out;
+	}
+	deflateEnd(&strm);
+}
+
+static void ww_index_append_u32(ZlibFrames *zf, uint32_t value)
+{
+	if (zf->index_len == zf->index_alloc) {
+		zf->index_alloc = max_ii(zf->index_alloc * 2, 256);
+		zf->index = MEM_reallocN(zf->index, sizeof(*zf->index) * (size_t)zf->index_alloc);
+	}
+	zf->index[zf->index_len++] = value;
+}
+
+/* Compress and write all frames filled so far. */
+static void ww_zlib_frames_flush(ZlibFrames *zf)
+{
+	int frames_len = zf->frame_active;
+	if (zf->frame_active < zf->frames_len && zf->frames[zf->frame_active].buf_len != 0) {
+		frames_len++;
+	}
+	if (frames_len == 0) {
+		return;
+	}
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (frames_len > 1);
+	BLI_task_parallel_range(0, frames_len, zf, ww_zlib_frame_compress_cb, &settings);
+
+	for (int i = 0; i < frames_len; i++) {
+		ZlibFrame *frame = &zf->frames[i];
+		if ((frame->out_len == 0) || !ww_write_zlib_data(zf, frame->out, frame->out_len)) {
+			zf->error = true;
+		}
+		ww_index_append_u32(zf, (uint32_t)frame->out_len);
+		ww_index_append_u32(zf, (uint32_t)frame->buf_len);
+		frame->buf_len = 0;
+	}
+	zf->frame_active = 0;
+}
+
+/* Write the frame index as an empty gzip member, see #BLEN_GZIP_FRAME_SIZE. */
+static bool ww_zlib_frames_write_index(ZlibFrames *zf)
+{
+	const int frames_len = zf->index_len / 2;
+	if (frames_len > BLEN_GZIP_FRAME_INDEX_MAX) {
+		/* Still a valid file, it can only be read sequentially. */
+		return true;
+	}
+
+	const uint sub_len = (uint)(zf->index_len + 1) * 4 + 4;
+	const uint extra_len = sub_len + 4;
+	const size_t member_len = 10 + 2 + extra_len + 10;
+	uchar *member = MEM_callocN(member_len, __func__);
+	uchar *p = member;
+
+	/* Header: magic, deflate, FEXTRA, no time-stamp, no extra flags, unknown OS. */
+	*p++ = 0x1f; *p++ = 0x8b; *p++ = 8; *p++ = 4;
+	p += 4;
+	*p++ = 0; *p++ = 255;
+	*p++ = extra_len & 0xff; *p++ = extra_len >> 8;
+	*p++ = 'B'; *p++ = 'I';
+	*p++ = sub_len & 0xff; *p++ = sub_len >> 8;
+	for (int i = 0; i <= zf->index_len; i++) {
+		const uint32_t value = (i < zf->index_len) ? zf->index[i] : (uint32_t)frames_len;
+		*p++ = value & 0xff; *p++ = (value >> 8) & 0xff; *p++ = (value >> 16) & 0xff; *p++ = value >> 24;
+	}
+	memcpy(p, BLEN_GZIP_FRAME_INDEX_MAGIC, 4);
+	p += 4;
+	/* Empty final deflate block, the CRC & size of no data are zero. */
+	*p++ = 0x03; *p++ = 0x00;
+	p += 8;
+	BLI_assert(p == member + member_len);
+
+	const bool ok = ww_write_zlib_data(zf, member, member_len);
+	MEM_freeN(member);
+	return ok;
+}
+
 static bool ww_close_zlib(WriteWrap *ww)
 {
-	return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+	ZlibFrames *zf = FILE_HANDLE(ww);
+	bool ok;
+
+	ww_zlib_frames_flush(zf);
+	ok = !zf->error && ww_zlib_frames_write_index(zf);
+	ok = (close(zf->file_handle) != -1) && ok;
+
+	for (int i = 0; i < zf->frames_len; i++) {
+		MEM_SAFE_FREE(zf->frames[i].buf);
+		MEM_SAFE_FREE(zf->frames[i].out);
+	}
+	MEM_freeN(zf->frames);
+	MEM_SAFE_FREE(zf->index);
+	MEM_freeN(zf);
+	return ok;
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-	return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+	ZlibFrames *zf = FILE_HANDLE(ww);
+	size_t remaining = buf_len;
+
+	while (remaining > 0) {
+		ZlibFrame *frame = &zf->frames[zf->frame_active];
+		if (frame->buf == NULL) {
+			frame->buf = MEM_mallocN(BLEN_GZIP_FRAME_SIZE, __func__);
+		}
+		const size_t len = MIN2(remaining, BLEN_GZIP_FRAME_SIZE - frame->buf_len);
+		memcpy(frame->buf + frame->buf_len, buf, len);
+		frame->buf_len += len;
+		buf += len;
+		remaining -= len;
+
+		if (frame->buf_len == BLEN_GZIP_FRAME_SIZE) {
+			zf->frame_active++;
+			if (zf->frame_active == zf->frames_len) {
+				ww_zlib_frames_flush(zf);
+			}
+		}
+	}
+
+	return zf->error ? 0 : buf_len;
 }
 #undef FILE_HANDLE
 
@@ -3899,6 +4101,9 @@ static bool write_file_handle(
 				BLI_assert((id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) == 0);
 
 				const bool do_override = !ELEM(override_storage, NULL, bmain) && id->override_static;
+				/* ID data starts in the next chunk, after the data still in the buffer. */
+				const uint id_chunk_first = wd->use_memfile ? wd->mem.current->chunks_len : 0;
+				const uint id_chunk_offset = (uint)wd->buf_used_len;
 
 				if (do_override) {
 					BKE_override_static_operations_store_start(bmain, override_storage, id);
@@ -4023,6 +4228,18 @@ static bool write_file_handle(
 				if (do_override) {
 					BKE_override_static_operations_store_end(override_storage, id);
 				}
+
+				if (wd->use_memfile) {
+					/* End chunks at ID boundaries, so unchanged IDs are de-duplicated
+					 * even when data before them changed size, and can be detected on undo. */
+					if ((wd->buf_used_len >= MEMFILE_ID_CHUNK_MIN) ||
+					    (BLI_ghashutil_strhash_p(id->name) & MEMFILE_ID_CHUNK_MASK) == 0)
+					{
+						mywrite_flush(wd);
+					}
+					const uint id_chunk_last = wd->mem.current->chunks_len - (wd->buf_used_len ? 0 : 1);
+					memfile_id_add(wd->mem.current, id, id_chunk_first, id_chunk_last, id_chunk_offset);
+				}
 			}
 
 			mywrite_flush(wd);
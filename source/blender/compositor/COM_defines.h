@@ -107,4 +107,18 @@ typedef enum OrderOfChunks {
 
 #define COM_BLUR_BOKEH_PIXELS 512
 
+/**
+ * \brief Full-frame execution splits every buffer in full-width row bands,
+ * a few per thread so the bands balance, but never thinner than the minimum height.
+ * \see NTREE_COM_FULL_FRAME
+ */
+#define COM_FULL_FRAME_BANDS_PER_THREAD 4
+#define COM_FULL_FRAME_MIN_BAND_HEIGHT 16
+
+/**
+ * \brief Maximum number of pixels calculated in one SocketReader::executeRow call,
+ * row buffers of this length are allocated on the stack.
+ */
+#define COM_ROW_LENGTH 256
+
 #endif  /* __COM_DEFINES_H__ */
@@ -56,6 +56,8 @@ ExecutionGroup::ExecutionGroup()
 	this->m_initialized = false;
 	this->m_openCL = false;
 	this->m_singleThreaded = false;
+	this->m_fullFrame = false;
+	this->m_fullFrameExecuted = false;
 	this->m_chunksFinished = 0;
 	BLI_rcti_init(&this->m_viewerBorder, 0, 0, 0, 0);
 	this->m_executionStartTime = 0;
@@ -111,12 +113,20 @@ void ExecutionGroup::initExecution()
 	}
 	unsigned int index;
 	determineNumberOfChunks();
+	this->m_fullFrameExecuted = false;
+
+	/* a result taken from the cache is available before execution */
+	NodeOperation *outputOperation = this->getOutputOperation();
+	const bool cached = outputOperation->isWriteBufferOperation() && ((WriteBufferOperation *)outputOperation)->isCached();
+	if (cached) {
+		this->m_fullFrameExecuted = true;
+	}
 
 	this->m_chunkExecutionStates = NULL;
 	if (this->m_numberOfChunks != 0) {
 		this->m_chunkExecutionStates = (ChunkExecutionState *)MEM_mallocN(sizeof(ChunkExecutionState) * this->m_numberOfChunks, __func__);
 		for (index = 0; index < this->m_numberOfChunks; index++) {
-			this->m_chunkExecutionStates[index] = COM_ES_NOT_SCHEDULED;
+			this->m_chunkExecutionStates[index] = cached ? COM_ES_EXECUTED : COM_ES_NOT_SCHEDULED;
 		}
 	}
 
@@ -164,6 +174,15 @@ void ExecutionGroup::determineNumberOfChunks()
 		this->m_numberOfYChunks = 1;
 		this->m_numberOfChunks = 1;
 	}
+	else if (this->m_fullFrame) {
+		/* full-width row bands, the chunk size is the height of a band */
+		const int border_height = BLI_rcti_size_y(&this->m_viewerBorder);
+		const int numberOfBands = BLI_system_thread_count() * COM_FULL_FRAME_BANDS_PER_THREAD;
+		this->m_chunkSize = max_ii(COM_FULL_FRAME_MIN_BAND_HEIGHT, (border_height + numberOfBands - 1) / numberOfBands);
+		this->m_numberOfXChunks = 1;
+		this->m_numberOfYChunks = (border_height + this->m_chunkSize - 1) / this->m_chunkSize;
+		this->m_numberOfChunks = this->m_numberOfYChunks;
+	}
 	else {
 		const float chunkSizef = this->m_chunkSize;
 		const int border_width = BLI_rcti_size_x(&this->m_viewerBorder);
@@ -186,6 +205,13 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 	if (this->m_numberOfChunks == 0) {return; } /// \note: early break out
 	unsigned int chunkNumber;
 
+	if (this->m_fullFrame) {
+		DebugInfo::execution_group_started(this);
+		executeFullFrame(graph);
+		DebugInfo::execution_group_finished(this);
+		return;
+	}
+
 	this->m_executionStartTime = PIL_check_seconds_timer();
 
 	this->m_chunksFinished = 0;
@@ -414,6 +440,12 @@ inline void ExecutionGroup::determineChunkRect(rcti *rect, const unsigned int xC
 	if (this->m_singleThreaded) {
 		BLI_rcti_init(rect, this->m_viewerBorder.xmin, border_width, this->m_viewerBorder.ymin, border_height);
 	}
+	else if (this->m_fullFrame) {
+		const unsigned int miny = yChunk * this->m_chunkSize + this->m_viewerBorder.ymin;
+		const unsigned int width = min((unsigned int) this->m_viewerBorder.xmax, this->m_width);
+		const unsigned int height = min((unsigned int) this->m_viewerBorder.ymax, this->m_height);
+		BLI_rcti_init(rect, min((unsigned int) this->m_viewerBorder.xmin, this->m_width), width, min(miny, this->m_height), min(miny + this->m_chunkSize, height));
+	}
 	else {
 		const unsigned int minx = xChunk * this->m_chunkSize + this->m_viewerBorder.xmin;
 		const unsigned int miny = yChunk * this->m_chunkSize + this->m_viewerBorder.ymin;
@@ -488,6 +520,66 @@ bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber)
 	return false;
 }
 
+void ExecutionGroup::executeFullFrame(ExecutionSystem *graph)
+{
+	if (this->m_fullFrameExecuted) {
+		return;
+	}
+	this->m_fullFrameExecuted = true;
+
+	/* upstream buffers are complete before any band of this group reads them */
+	for (unsigned int index = 0; index < this->m_cachedReadOperations.size(); index++) {
+		ReadBufferOperation *readOperation = (ReadBufferOperation *)this->m_cachedReadOperations[index];
+		ExecutionGroup *group = readOperation->getMemoryProxy()->getExecutor();
+		if (group == NULL) {
+			throw "ERROR";
+		}
+		group->executeFullFrame(graph);
+	}
+
+	const bNodeTree *bTree = graph->getContext().getbNodeTree();
+	if (this->m_width == 0 || this->m_height == 0 || this->m_numberOfChunks == 0) {
+		return;
+	}
+	if (bTree->test_break && bTree->test_break(bTree->tbh)) {
+		return;
+	}
+
+	this->m_executionStartTime = PIL_check_seconds_timer();
+	this->m_chunksFinished = 0;
+	if (this->isOutputExecutionGroup()) {
+		this->m_bTree = bTree;
+	}
+
+	for (unsigned int chunkNumber = 0; chunkNumber < this->m_numberOfChunks; chunkNumber++) {
+		scheduleChunk(chunkNumber);
+	}
+	WorkScheduler::finish();
+
+	if (bTree->update_draw) {
+		bTree->update_draw(bTree->udh);
+	}
+}
+
+bool ExecutionGroup::isFullyExecuted() const
+{
+	if (this->m_chunkExecutionStates == NULL) {
+		return false;
+	}
+	/* borders only calculate part of the frame */
+	if (this->m_viewerBorder.xmin > 0 || this->m_viewerBorder.ymin > 0 ||
+	    this->m_viewerBorder.xmax < (int)this->m_width || this->m_viewerBorder.ymax < (int)this->m_height)
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		if (this->m_chunkExecutionStates[index] != COM_ES_EXECUTED) {
+			return false;
+		}
+	}
+	return true;
+}
+
 bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk)
 {
 	if (xChunk < 0 || xChunk >= (int)this->m_numberOfXChunks) {
@@ -122,6 +122,18 @@ private:
 	 */
 	bool m_singleThreaded;
 
+	/**
+	 * \brief Is this ExecutionGroup calculated for the whole frame at once
+	 * \note chunks are full-width row bands and all depending groups are executed first
+	 * \see NTREE_COM_FULL_FRAME
+	 */
+	bool m_fullFrame;
+
+	/**
+	 * \brief has the full frame of this ExecutionGroup been calculated during this execution
+	 */
+	bool m_fullFrameExecuted;
+
 	/**
 	 * \brief what is the maximum number field of all ReadBufferOperation in this ExecutionGroup.
 	 * \note this is used to construct the MemoryBuffers that will be passed during execution.
@@ -233,6 +245,14 @@ private:
 	 */
 	bool scheduleChunk(unsigned int chunkNumber);
 
+	/**
+	 * \brief calculate the whole frame of this ExecutionGroup.
+	 * \note the ExecutionGroups of all read buffers are calculated first, each exactly once,
+	 * \note so no area of interest needs to be scheduled.
+	 * \param graph:
+	 */
+	void executeFullFrame(ExecutionSystem *graph);
+
 	/**
 	 * \brief determine the area of interest of a certain input area
 	 * \note This method only evaluates a single ReadBufferOperation
@@ -395,6 +415,14 @@ public:
 
 	void setChunksize(int chunksize) { this->m_chunkSize = chunksize; }
 
+	void setFullFrame(bool fullFrame) { this->m_fullFrame = fullFrame; }
+
+	/**
+	 * \brief have all pixels of this ExecutionGroup been calculated
+	 * \note only valid between initExecution and deinitExecution
+	 */
+	bool isFullyExecuted() const;
+
 	/**
 	 * \brief get the Render priority of this ExecutionGroup
 	 * \see ExecutionSystem.execute
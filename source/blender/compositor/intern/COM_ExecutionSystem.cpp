@@ -32,6 +32,8 @@ extern "C" {
 #include "COM_ExecutionGroup.h"
 #include "COM_WorkScheduler.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+#include "COM_ResultCache.h"
 #include "COM_Debug.h"
 
 #ifdef WITH_CXX_GUARDEDALLOC
@@ -167,6 +169,7 @@ void ExecutionSystem::execute()
 	for (index = 0; index < this->m_groups.size(); index++) {
 		ExecutionGroup *executionGroup = this->m_groups[index];
 		executionGroup->setChunksize(this->m_context.getChunksize());
+		executionGroup->setFullFrame(this->m_context.isFullFrame());
 		executionGroup->initExecution();
 	}
 
@@ -181,6 +184,25 @@ void ExecutionSystem::execute()
 	WorkScheduler::finish();
 	WorkScheduler::stop();
 
+	/* keep complete results for the next execution, see NodeOperationBuilder::add_cached_results */
+	if (!this->m_context.isRendering()) {
+		const bool breaked = editingtree->test_break && editingtree->test_break(editingtree->tbh);
+		for (index = 0; index < this->m_groups.size(); index++) {
+			ExecutionGroup *executionGroup = this->m_groups[index];
+			NodeOperation *operation = executionGroup->getOutputOperation();
+			if (!operation->isWriteBufferOperation()) {
+				continue;
+			}
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			if (!writeOperation->getResultKey().isValid()) {
+				continue;
+			}
+			if (writeOperation->isCached() || (!breaked && executionGroup->isFullyExecuted())) {
+				ResultCache::store(writeOperation->getResultKey(), writeOperation->getMemoryProxy()->releaseBuffer());
+			}
+		}
+	}
+
 	editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing | De-initializing execution"));
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
@@ -20,6 +20,11 @@
 
 #include "MEM_guardedalloc.h"
 
+extern "C" {
+#  include "IMB_imbuf.h"
+#  include "IMB_imbuf_types.h"
+}
+
 using std::min;
 using std::max;
 
@@ -59,6 +64,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
 	this->m_chunkNumber = chunkNumber;
 	this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
 	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+	this->m_ibuf = NULL;
 	this->m_state = COM_MB_ALLOCATED;
 	this->m_datatype = memoryProxy->getDataType();
 }
@@ -72,6 +78,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
 	this->m_chunkNumber = -1;
 	this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
 	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+	this->m_ibuf = NULL;
 	this->m_state = COM_MB_TEMPORARILY;
 	this->m_datatype = memoryProxy->getDataType();
 }
@@ -85,9 +92,24 @@ MemoryBuffer::MemoryBuffer(DataType dataType, rcti *rect)
 	this->m_chunkNumber = -1;
 	this->m_num_channels = determine_num_channels(dataType);
 	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+	this->m_ibuf = NULL;
 	this->m_state = COM_MB_TEMPORARILY;
 	this->m_datatype = dataType;
 }
+MemoryBuffer::MemoryBuffer(DataType dataType, ImBuf *ibuf)
+{
+	BLI_rcti_init(&this->m_rect, 0, ibuf->x, 0, ibuf->y);
+	this->m_width = ibuf->x;
+	this->m_height = ibuf->y;
+	this->m_memoryProxy = NULL;
+	this->m_chunkNumber = -1;
+	this->m_num_channels = determine_num_channels(dataType);
+	BLI_assert(ibuf->rect_float && ibuf->channels == (int)this->m_num_channels);
+	this->m_buffer = ibuf->rect_float;
+	this->m_ibuf = ibuf;
+	this->m_state = COM_MB_AVAILABLE;
+	this->m_datatype = dataType;
+}
 MemoryBuffer *MemoryBuffer::duplicate()
 {
 	MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
@@ -140,12 +162,25 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 
 MemoryBuffer::~MemoryBuffer()
 {
-	if (this->m_buffer) {
+	if (this->m_ibuf) {
+		IMB_freeImBuf(this->m_ibuf);
+		this->m_ibuf = NULL;
+		this->m_buffer = NULL;
+	}
+	else if (this->m_buffer) {
 		MEM_freeN(this->m_buffer);
 		this->m_buffer = NULL;
 	}
 }
 
+float *MemoryBuffer::stealBuffer()
+{
+	BLI_assert(this->m_ibuf == NULL);
+	float *buffer = this->m_buffer;
+	this->m_buffer = NULL;
+	return buffer;
+}
+
 void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
 {
 	if (!otherBuffer) {
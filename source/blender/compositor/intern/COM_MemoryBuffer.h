@@ -30,6 +30,8 @@ extern "C" {
 #  include "BLI_rect.h"
 }
 
+struct ImBuf;
+
 /**
  * \brief state of a memory buffer
  * \ingroup Memory
@@ -94,6 +96,11 @@ private:
 	 */
 	unsigned int m_num_channels;
 
+	/**
+	 * \brief image buffer the data belongs to, when wrapping a result of the ResultCache
+	 */
+	struct ImBuf *m_ibuf;
+
 	int m_width;
 	int m_height;
 
@@ -113,6 +120,12 @@ public:
 	 */
 	MemoryBuffer(DataType datatype, rcti *rect);
 
+	/**
+	 * \brief construct a MemoryBuffer reading the float buffer of an ImBuf
+	 * \note takes over the reference to the ImBuf, it is freed together with the MemoryBuffer
+	 */
+	MemoryBuffer(DataType datatype, struct ImBuf *ibuf);
+
 	/**
 	 * \brief destructor
 	 */
@@ -125,12 +138,28 @@ public:
 
 	unsigned int get_num_channels() { return this->m_num_channels; }
 
+	/**
+	 * \brief set the proxy owning this buffer, used when a cached result is passed between executions
+	 */
+	void setMemoryProxy(MemoryProxy *memoryProxy) { this->m_memoryProxy = memoryProxy; }
+
 	/**
 	 * \brief get the data of this MemoryBuffer
 	 * \note buffer should already be available in memory
 	 */
 	float *getBuffer() { return this->m_buffer; }
 
+	/**
+	 * \brief is the data of this MemoryBuffer owned by an ImBuf
+	 */
+	bool isImBufWrapper() const { return this->m_ibuf != NULL; }
+
+	/**
+	 * \brief take the data of this MemoryBuffer, the caller frees it with MEM_freeN
+	 * \note the MemoryBuffer must not be used afterwards, except for deleting it
+	 */
+	float *stealBuffer();
+
 	/**
 	 * \brief after execution the state will be set to available by calling this method
 	 */
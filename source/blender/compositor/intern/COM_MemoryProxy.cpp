@@ -23,6 +23,7 @@ MemoryProxy::MemoryProxy(DataType datatype)
 {
 	this->m_writeBufferOperation = NULL;
 	this->m_executor = NULL;
+	this->m_buffer = NULL;
 	this->m_datatype = datatype;
 }
 
@@ -44,3 +45,20 @@ void MemoryProxy::free()
 		this->m_buffer = NULL;
 	}
 }
+
+void MemoryProxy::setBuffer(MemoryBuffer *buffer)
+{
+	free();
+	buffer->setMemoryProxy(this);
+	this->m_buffer = buffer;
+}
+
+MemoryBuffer *MemoryProxy::releaseBuffer()
+{
+	MemoryBuffer *buffer = this->m_buffer;
+	if (buffer) {
+		buffer->setMemoryProxy(NULL);
+	}
+	this->m_buffer = NULL;
+	return buffer;
+}
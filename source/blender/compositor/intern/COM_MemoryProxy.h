@@ -100,6 +100,16 @@ public:
 	 */
 	void free();
 
+	/**
+	 * \brief use an existing buffer instead of allocating one, the proxy takes ownership.
+	 */
+	void setBuffer(MemoryBuffer *buffer);
+
+	/**
+	 * \brief take the buffer out of the proxy, the caller takes ownership.
+	 */
+	MemoryBuffer *releaseBuffer();
+
 	/**
 	 * \brief get the allocated memory
 	 */
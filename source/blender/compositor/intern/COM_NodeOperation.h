@@ -101,6 +101,12 @@ private:
 	 */
 	bool m_openCL;
 
+	/**
+	 * \brief does executeRow calculate from rows of the inputs.
+	 * \see RowEvaluator
+	 */
+	bool m_rowInputs;
+
 	/**
 	 * \brief mutex reference for very special node initializations
 	 * \note only use when you really know what you are doing.
@@ -285,6 +291,12 @@ public:
 	 */
 	bool isOpenCL() const { return this->m_openCL; }
 
+	/**
+	 * \brief does executeRow calculate from rows of the inputs, calculated before
+	 * \see RowEvaluator
+	 */
+	bool hasRowInputs() const { return this->m_rowInputs; }
+
 	virtual bool isViewerOperation() const { return false; }
 	virtual bool isPreviewOperation() const { return false; }
 	virtual bool isFileOutputOperation() const { return false; }
@@ -329,8 +341,15 @@ protected:
 	 */
 	void setOpenCL(bool openCL) { this->m_openCL = openCL; }
 
+	/**
+	 * \brief set if executeRow reads rows of the inputs instead of reading the inputs itself
+	 */
+	void setRowInputs(bool rowInputs) { this->m_rowInputs = rowInputs; }
+
 	/* allow the DebugInfo class to look at internals */
 	friend class DebugInfo;
+	/* RowEvaluator follows the inputs of row operations */
+	friend class RowEvaluator;
 
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:NodeOperation")
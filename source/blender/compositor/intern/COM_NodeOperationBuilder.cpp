@@ -16,6 +16,8 @@
  * Copyright 2013, Blender Foundation.
  */
 
+#include <typeinfo>
+
 extern "C" {
 #include "BLI_utildefines.h"
 }
@@ -42,6 +44,7 @@ extern "C" {
 NodeOperationBuilder::NodeOperationBuilder(const CompositorContext *context, bNodeTree *b_nodetree) :
     m_context(context),
     m_current_node(NULL),
+    m_current_node_operations(0),
     m_active_viewer(NULL)
 {
 	m_graph.from_bNodeTree(*context, b_nodetree);
@@ -60,6 +63,7 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 		Node *node = (Node *)m_graph.nodes()[index];
 
 		m_current_node = node;
+		m_current_node_operations = 0;
 
 		DebugInfo::node_to_operations(node);
 		node->convertToOperations(converter, *m_context);
@@ -109,12 +113,20 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 	/* surround complex ops with read/write buffer */
 	add_complex_operation_buffers();
 
+	/* full-frame execution also buffers results read by more than one op, so each is calculated only once */
+	if (m_context->isFullFrame())
+		add_full_frame_operation_buffers();
+
 	/* links not available from here on */
 	/* XXX make m_links a local variable to avoid confusion! */
 	m_links.clear();
 
 	prune_operations();
 
+	/* reuse unchanged results of earlier executions, the operations they replace become unreachable */
+	if (add_cached_results())
+		prune_operations();
+
 	/* ensure topological (link-based) order of nodes */
 	/*sort_operations();*/ /* not needed yet */
 
@@ -128,6 +140,9 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 void NodeOperationBuilder::addOperation(NodeOperation *operation)
 {
 	m_operations.push_back(operation);
+
+	if (m_current_node)
+		m_origins[operation] = OpOrigin(m_current_node, m_current_node_operations++);
 }
 
 void NodeOperationBuilder::mapInputSocket(NodeInput *node_socket, NodeOperationInput *operation_socket)
@@ -493,7 +508,8 @@ void NodeOperationBuilder::add_input_buffers(NodeOperation * /*operation*/,
 	readoperation->readResolutionFromWriteBuffer();
 }
 
-void NodeOperationBuilder::add_output_buffers(NodeOperation *operation, NodeOperationOutput *output)
+void NodeOperationBuilder::add_output_buffers(NodeOperation * /*operation*/,
+                                              NodeOperationOutput *output)
 {
 	/* cache connected sockets, so we can safely remove links first before replacing them */
 	OpInputs targets = cache_output_links(output);
@@ -517,7 +533,7 @@ void NodeOperationBuilder::add_output_buffers(NodeOperation *operation, NodeOper
 
 	/* if no write buffer operation exists yet, create a new one */
 	if (!writeOperation) {
-		writeOperation = new WriteBufferOperation(operation->getOutputSocket()->getDataType());
+		writeOperation = new WriteBufferOperation(output->getDataType());
 		writeOperation->setbNodeTree(m_context->getbNodeTree());
 		addOperation(writeOperation);
 
@@ -532,7 +548,7 @@ void NodeOperationBuilder::add_output_buffers(NodeOperation *operation, NodeOper
 		if (&target->getOperation() == writeOperation)
 			continue; /* skip existing write op links */
 
-		ReadBufferOperation *readoperation = new ReadBufferOperation(operation->getOutputSocket()->getDataType());
+		ReadBufferOperation *readoperation = new ReadBufferOperation(output->getDataType());
 		readoperation->setMemoryProxy(writeOperation->getMemoryProxy());
 		addOperation(readoperation);
 
@@ -565,6 +581,140 @@ void NodeOperationBuilder::add_complex_operation_buffers()
 	}
 }
 
+void NodeOperationBuilder::add_full_frame_operation_buffers()
+{
+	/* note: outputs are cached first, adding buffers invalidates iterators over m_operations */
+	std::vector<NodeOperationOutput *> shared_outputs;
+	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
+		NodeOperation *op = *it;
+
+		/* buffer ops already store their result, constants are cheaper to read directly */
+		if (op->isReadBufferOperation() || op->isWriteBufferOperation() || op->isSetOperation())
+			continue;
+
+		for (int index = 0; index < op->getNumberOfOutputSockets(); index++) {
+			NodeOperationOutput *output = op->getOutputSocket(index);
+
+			/* outputs of complex ops are written to a buffer already */
+			if (find_attached_write_buffer_operation(output))
+				continue;
+
+			/* an output read by a single op is calculated in the bands of that op's group,
+			 * only results read back by several ops are stored, each of them would
+			 * otherwise calculate the whole chain leading up to it again */
+			if (cache_output_links(output).size() > 1)
+				shared_outputs.push_back(output);
+		}
+	}
+
+	for (std::vector<NodeOperationOutput *>::const_iterator it = shared_outputs.begin(); it != shared_outputs.end(); ++it) {
+		NodeOperationOutput *output = *it;
+		NodeOperation *op = &output->getOperation();
+
+		DebugInfo::operation_read_write_buffer(op);
+
+		add_output_buffers(op, output);
+	}
+}
+
+ResultKey NodeOperationBuilder::operation_result_key(OpKeyMap &op_keys, NodeKeyMap &node_keys,
+                                                     const ResultKey &context_key, NodeOperation *operation)
+{
+	OpKeyMap::const_iterator it = op_keys.find(operation);
+	if (it != op_keys.end())
+		return it->second;
+
+	ResultKey key = context_key;
+
+	if (operation->isReadBufferOperation()) {
+		MemoryProxy *memproxy = ((ReadBufferOperation *)operation)->getMemoryProxy();
+		key.addKey(operation_result_key(op_keys, node_keys, context_key, memproxy->getWriteBufferOperation()));
+		op_keys[operation] = key;
+		return key;
+	}
+
+	key.addString(typeid(*operation).name());
+	key.addInt(operation->getWidth());
+	key.addInt(operation->getHeight());
+
+	/* settings of operations are copied from their node */
+	OpOriginMap::const_iterator origin = m_origins.find(operation);
+	if (origin != m_origins.end()) {
+		Node *node = origin->second.first;
+		NodeKeyMap::iterator node_key = node_keys.find(node);
+		if (node_key == node_keys.end()) {
+			ResultKey new_node_key;
+			ResultCache::addNode(new_node_key, node->getbNodeTree(), node->getbNode());
+			node_key = node_keys.insert(NodeKeyMap::value_type(node, new_node_key)).first;
+		}
+		key.addKey(node_key->second);
+		key.addInt(origin->second.second);
+	}
+
+	/* constants created for unconnected inputs, value is available without initialization */
+	if (operation->isSetOperation() && key.isValid()) {
+		float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+		operation->readSampled(value, 0.0f, 0.0f, COM_PS_NEAREST);
+		key.addData(value, sizeof(value));
+	}
+
+	for (int i = 0; i < operation->getNumberOfInputSockets(); ++i) {
+		NodeOperationInput *input = operation->getInputSocket(i);
+		key.addInt(input->getDataType());
+		if (input->isConnected()) {
+			NodeOperationOutput *output = input->getLink();
+			NodeOperation *from = &output->getOperation();
+			key.addKey(operation_result_key(op_keys, node_keys, context_key, from));
+			for (int j = 0; j < from->getNumberOfOutputSockets(); ++j) {
+				if (from->getOutputSocket(j) == output)
+					key.addInt(j);
+			}
+		}
+		else {
+			key.addInt(-1);
+		}
+	}
+
+	op_keys[operation] = key;
+	return key;
+}
+
+bool NodeOperationBuilder::add_cached_results()
+{
+	/* rendering uses new render results every time, only cache for interactive editing */
+	if (m_context->isRendering())
+		return false;
+
+	ResultKey context_key;
+	ResultCache::addContext(context_key, *m_context);
+
+	OpKeyMap op_keys;
+	NodeKeyMap node_keys;
+	vector<WriteBufferOperation *> write_ops;
+	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
+		NodeOperation *op = *it;
+		if (op->isWriteBufferOperation()) {
+			WriteBufferOperation *write_op = (WriteBufferOperation *)op;
+			write_op->setResultKey(operation_result_key(op_keys, node_keys, context_key, op));
+			write_ops.push_back(write_op);
+		}
+	}
+
+	/* inputs are only disconnected once all keys are known */
+	bool found = false;
+	for (vector<WriteBufferOperation *>::const_iterator it = write_ops.begin(); it != write_ops.end(); ++it) {
+		WriteBufferOperation *write_op = *it;
+		MemoryBuffer *buffer = ResultCache::acquire(write_op->getResultKey(), write_op->getMemoryProxy()->getDataType(),
+		                                            write_op->getWidth(), write_op->getHeight());
+		if (buffer) {
+			write_op->setCachedBuffer(buffer);
+			write_op->getInputSocket(0)->setLink(NULL);
+			found = true;
+		}
+	}
+	return found;
+}
+
 typedef std::set<NodeOperation*> Tags;
 
 static void find_reachable_operations_recursive(Tags &reachable, NodeOperation *op)
@@ -603,10 +753,13 @@ void NodeOperationBuilder::prune_operations()
 	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
 		NodeOperation *op = *it;
 
-		if (reachable.find(op) != reachable.end())
+		if (reachable.find(op) != reachable.end()) {
 			reachable_ops.push_back(op);
-		else
+		}
+		else {
+			m_origins.erase(op);
 			delete op;
+		}
 	}
 	/* finally replace the operations list with the pruned list */
 	m_operations = reachable_ops;
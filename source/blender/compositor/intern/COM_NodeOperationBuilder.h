@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "COM_NodeGraph.h"
+#include "COM_ResultCache.h"
 
 using std::vector;
 
@@ -70,6 +71,13 @@ public:
 	typedef std::vector<NodeOperationInput *> OpInputs;
 	typedef std::map<NodeInput *, OpInputs> OpInputInverseMap;
 
+	/** Node an operation was created for, and the index among the operations of that node */
+	typedef std::pair<Node *, int> OpOrigin;
+	typedef std::map<NodeOperation *, OpOrigin> OpOriginMap;
+
+	typedef std::map<NodeOperation *, ResultKey> OpKeyMap;
+	typedef std::map<Node *, ResultKey> NodeKeyMap;
+
 private:
 	const CompositorContext *m_context;
 	NodeGraph m_graph;
@@ -84,6 +92,10 @@ private:
 	OutputSocketMap m_output_map;
 
 	Node *m_current_node;
+	int m_current_node_operations;
+
+	/** Origin of operations created by nodes, used for the keys of cached results */
+	OpOriginMap m_origins;
 
 	/** Operation that will be writing to the viewer image
 	 *  Only one operation can occupy this place at a time,
@@ -143,9 +155,16 @@ protected:
 	WriteBufferOperation *find_attached_write_buffer_operation(NodeOperationOutput *output) const;
 	/** Add read/write buffer operations around complex operations */
 	void add_complex_operation_buffers();
+	/** Add read/write buffer operations after outputs read by several operations, for full-frame execution */
+	void add_full_frame_operation_buffers();
 	void add_input_buffers(NodeOperation *operation, NodeOperationInput *input);
 	void add_output_buffers(NodeOperation *operation, NodeOperationOutput *output);
 
+	/** Take results of earlier executions from the ResultCache, returns true if any were found */
+	bool add_cached_results();
+	ResultKey operation_result_key(OpKeyMap &op_keys, NodeKeyMap &node_keys, const ResultKey &context_key,
+	                               NodeOperation *operation);
+
 	/** Remove unreachable operations */
 	void prune_operations();
 
@@ -0,0 +1,391 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2011, Blender Foundation.
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "COM_ResultCache.h"
+#include "COM_CompositorContext.h"
+#include "COM_MemoryBuffer.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#  include "BLI_fileops.h"
+#  include "BLI_path_util.h"
+#  include "BLI_string.h"
+#  include "BLI_threads.h"
+
+#  include "DNA_image_types.h"
+#  include "DNA_node_types.h"
+#  include "DNA_scene_types.h"
+
+#  include "BKE_image.h"
+#  include "BKE_main.h"
+
+#  include "IMB_imbuf.h"
+#  include "IMB_imbuf_types.h"
+#  include "IMB_moviecache.h"
+
+#  include "RNA_access.h"
+}
+
+/* nested structs of node settings are hashed up to this depth (curve mapping points, ramp elements) */
+#define RESULT_KEY_MAX_DEPTH 3
+
+#define RESULT_KEY_FNV_OFFSET 14695981039346656037ULL
+#define RESULT_KEY_FNV_PRIME 1099511628211ULL
+
+ResultKey::ResultKey()
+{
+	this->m_hash = RESULT_KEY_FNV_OFFSET;
+	this->m_valid = true;
+}
+
+void ResultKey::addData(const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	uint64_t hash = this->m_hash;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= RESULT_KEY_FNV_PRIME;
+	}
+	this->m_hash = hash;
+}
+
+void ResultKey::addString(const char *str)
+{
+	if (str) {
+		addData(str, strlen(str) + 1);
+	}
+	else {
+		addInt(0);
+	}
+}
+
+void ResultKey::addKey(const ResultKey &key)
+{
+	const uint64_t hash = key.getHash();
+	addData(&hash, sizeof(hash));
+	if (!key.isValid()) {
+		invalidate();
+	}
+}
+
+/* ******** Keys ******** */
+
+static void add_rna_struct(ResultKey &key, PointerRNA *ptr, int depth);
+
+static void add_image(ResultKey &key, Image *ima)
+{
+	/* viewer and render result images change with every execution, painted images without notice */
+	if (ima->source == IMA_SRC_VIEWER || BKE_image_is_dirty(ima)) {
+		key.invalidate();
+		return;
+	}
+
+	key.addInt(ima->source);
+	key.addInt(ima->type);
+	key.addString(ima->colorspace_settings.name);
+	key.addInt(ima->alpha_mode);
+
+	if (ima->source == IMA_SRC_GENERATED) {
+		key.addInt(ima->gen_x);
+		key.addInt(ima->gen_y);
+		key.addInt(ima->gen_type);
+		key.addInt(ima->gen_flag);
+		key.addInt(ima->gen_depth);
+		key.addData(ima->gen_color, sizeof(ima->gen_color));
+	}
+	else {
+		key.addString(ima->name);
+
+		/* an image reloaded after it was saved by another application has a new modification time */
+		if (!BKE_image_has_packedfile(ima)) {
+			char filepath[FILE_MAX];
+			BLI_stat_t st;
+			BLI_strncpy(filepath, ima->name, sizeof(filepath));
+			BLI_path_abs(filepath, ID_BLEND_PATH_FROM_GLOBAL(&ima->id));
+			if (BLI_stat(filepath, &st) == 0) {
+				key.addData(&st.st_mtime, sizeof(st.st_mtime));
+			}
+		}
+	}
+}
+
+static void add_id(ResultKey &key, ID *id)
+{
+	key.addPointer(id);
+	if (id == NULL) {
+		return;
+	}
+	key.addString(id->name);
+
+	switch (GS(id->name)) {
+		case ID_IM:
+			add_image(key, (Image *)id);
+			break;
+		case ID_SCE:
+			/* render layers, the cache is cleared when a render finishes */
+			break;
+		default:
+			/* movie clips, masks, textures, ... are not tracked */
+			key.invalidate();
+			break;
+	}
+}
+
+static void add_rna_property(ResultKey &key, PointerRNA *ptr, PropertyRNA *prop, int depth)
+{
+	const int length = RNA_property_array_length(ptr, prop);
+
+	switch (RNA_property_type(prop)) {
+		case PROP_BOOLEAN:
+			if (length) {
+				bool *values = (bool *)MEM_mallocN(sizeof(bool) * length, __func__);
+				RNA_property_boolean_get_array(ptr, prop, values);
+				key.addData(values, sizeof(bool) * length);
+				MEM_freeN(values);
+			}
+			else {
+				key.addInt(RNA_property_boolean_get(ptr, prop));
+			}
+			break;
+		case PROP_INT:
+			if (length) {
+				std::vector<int> values(length);
+				RNA_property_int_get_array(ptr, prop, &values[0]);
+				key.addData(&values[0], sizeof(int) * length);
+			}
+			else {
+				key.addInt(RNA_property_int_get(ptr, prop));
+			}
+			break;
+		case PROP_FLOAT:
+			if (length) {
+				std::vector<float> values(length);
+				RNA_property_float_get_array(ptr, prop, &values[0]);
+				key.addData(&values[0], sizeof(float) * length);
+			}
+			else {
+				key.addFloat(RNA_property_float_get(ptr, prop));
+			}
+			break;
+		case PROP_ENUM:
+			key.addInt(RNA_property_enum_get(ptr, prop));
+			break;
+		case PROP_STRING:
+		{
+			char fixedbuf[256];
+			int len;
+			char *value = RNA_property_string_get_alloc(ptr, prop, fixedbuf, sizeof(fixedbuf), &len);
+			key.addString(value);
+			if (value != fixedbuf) {
+				MEM_freeN(value);
+			}
+			break;
+		}
+		case PROP_POINTER:
+		{
+			PointerRNA value = RNA_property_pointer_get(ptr, prop);
+			if (value.data == NULL) {
+				key.addPointer(NULL);
+			}
+			else if (RNA_struct_is_ID(value.type)) {
+				add_id(key, (ID *)value.data);
+			}
+			else if (depth < RESULT_KEY_MAX_DEPTH) {
+				add_rna_struct(key, &value, depth + 1);
+			}
+			break;
+		}
+		case PROP_COLLECTION:
+			key.addInt(RNA_property_collection_length(ptr, prop));
+			if (depth < RESULT_KEY_MAX_DEPTH) {
+				RNA_PROP_BEGIN (ptr, itemptr, prop)
+				{
+					if (RNA_struct_is_ID(itemptr.type)) {
+						add_id(key, (ID *)itemptr.data);
+					}
+					else {
+						add_rna_struct(key, &itemptr, depth + 1);
+					}
+				}
+				RNA_PROP_END;
+			}
+			break;
+	}
+}
+
+static void add_rna_struct(ResultKey &key, PointerRNA *ptr, int depth)
+{
+	RNA_STRUCT_BEGIN (ptr, prop)
+	{
+		const char *identifier = RNA_property_identifier(prop);
+		if (STREQ(identifier, "rna_type")) {
+			continue;
+		}
+		/* name, location, selection, sockets, ... of the base node type don't change the result */
+		if (depth == 0 && RNA_struct_type_find_property(&RNA_Node, identifier)) {
+			continue;
+		}
+		key.addString(identifier);
+		add_rna_property(key, ptr, prop, depth);
+	}
+	RNA_STRUCT_END;
+}
+
+void ResultCache::addNode(ResultKey &key, bNodeTree *ntree, bNode *node)
+{
+	key.addString(node->idname);
+	key.addInt(node->type);
+
+	PointerRNA ptr;
+	RNA_pointer_create((ID *)ntree, &RNA_Node, node, &ptr);
+	add_rna_struct(key, &ptr, 0);
+
+	/* nodes may read unconnected input values directly instead of through a constant operation */
+	for (bNodeSocket *sock = (bNodeSocket *)node->inputs.first; sock; sock = sock->next) {
+		PointerRNA sockptr;
+		RNA_pointer_create((ID *)ntree, &RNA_NodeSocket, sock, &sockptr);
+		PropertyRNA *prop = RNA_struct_find_property(&sockptr, "default_value");
+		if (prop) {
+			add_rna_property(key, &sockptr, prop, 1);
+		}
+	}
+}
+
+void ResultCache::addContext(ResultKey &key, const CompositorContext &context)
+{
+	key.addInt(context.getQuality());
+	key.addInt(context.isFastCalculation());
+	key.addInt(context.getFramenumber());
+	key.addString(context.getViewName());
+
+	/* relative sizes and render layer buffers depend on the render size */
+	const RenderData *rd = context.getRenderData();
+	if (rd) {
+		key.addInt(rd->xsch);
+		key.addInt(rd->ysch);
+		key.addInt(rd->size);
+		key.addInt(rd->mode & (R_BORDER | R_CROP));
+		key.addData(&rd->border, sizeof(rd->border));
+	}
+}
+
+/* ******** Cache ******** */
+
+/* Results are kept in a movie cache, which registers them in the global cache limiter.
+ * They share the memory cache limit with movie clips, sequencer strips and images,
+ * the least recently used buffers of all those caches are freed first. */
+
+typedef struct ResultCacheKey {
+	uint64_t hash;
+} ResultCacheKey;
+
+static MovieCache *g_cache = NULL;
+static ThreadMutex g_mutex = BLI_MUTEX_INITIALIZER;
+
+static unsigned int result_cache_hash(const void *key_v)
+{
+	const ResultCacheKey *key = (const ResultCacheKey *)key_v;
+	return (unsigned int)(key->hash ^ (key->hash >> 32));
+}
+
+static bool result_cache_cmp(const void *a_v, const void *b_v)
+{
+	const ResultCacheKey *a = (const ResultCacheKey *)a_v;
+	const ResultCacheKey *b = (const ResultCacheKey *)b_v;
+	return a->hash != b->hash;
+}
+
+static int result_cache_num_channels(DataType datatype)
+{
+	switch (datatype) {
+		case COM_DT_VALUE:
+			return COM_NUM_CHANNELS_VALUE;
+		case COM_DT_VECTOR:
+			return COM_NUM_CHANNELS_VECTOR;
+		case COM_DT_COLOR:
+		default:
+			return COM_NUM_CHANNELS_COLOR;
+	}
+}
+
+MemoryBuffer *ResultCache::acquire(const ResultKey &key, DataType datatype, unsigned int width, unsigned int height)
+{
+	if (!key.isValid()) {
+		return NULL;
+	}
+
+	ResultCacheKey cache_key;
+	cache_key.hash = key.getHash();
+
+	BLI_mutex_lock(&g_mutex);
+	ImBuf *ibuf = g_cache ? IMB_moviecache_get(g_cache, &cache_key) : NULL;
+	BLI_mutex_unlock(&g_mutex);
+
+	if (ibuf == NULL) {
+		return NULL;
+	}
+	if (ibuf->x != (int)width || ibuf->y != (int)height || ibuf->channels != result_cache_num_channels(datatype)) {
+		IMB_freeImBuf(ibuf);
+		return NULL;
+	}
+	return new MemoryBuffer(datatype, ibuf);
+}
+
+void ResultCache::store(const ResultKey &key, MemoryBuffer *buffer)
+{
+	/* buffers wrapping a cached result are still in the cache */
+	if (!key.isValid() || buffer->isImBufWrapper()) {
+		delete buffer;
+		return;
+	}
+
+	ImBuf *ibuf = IMB_allocImBuf(buffer->getWidth(), buffer->getHeight(), 32, 0);
+	ibuf->channels = buffer->get_num_channels();
+	ibuf->rect_float = buffer->stealBuffer();
+	ibuf->mall |= IB_rectfloat;
+	ibuf->flags |= IB_rectfloat;
+	delete buffer;
+
+	ResultCacheKey cache_key;
+	cache_key.hash = key.getHash();
+
+	BLI_mutex_lock(&g_mutex);
+	if (g_cache == NULL) {
+		g_cache = IMB_moviecache_create("compositor results", sizeof(ResultCacheKey),
+		                                result_cache_hash, result_cache_cmp);
+	}
+	IMB_moviecache_put(g_cache, &cache_key, ibuf);
+	BLI_mutex_unlock(&g_mutex);
+
+	IMB_freeImBuf(ibuf);
+}
+
+void ResultCache::clear()
+{
+	BLI_mutex_lock(&g_mutex);
+	if (g_cache) {
+		/* buffers used by a running execution are referenced, they're freed with their MemoryBuffer */
+		IMB_moviecache_free(g_cache);
+		g_cache = NULL;
+	}
+	BLI_mutex_unlock(&g_mutex);
+}
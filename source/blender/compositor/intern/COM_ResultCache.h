@@ -0,0 +1,108 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2011, Blender Foundation.
+ */
+
+#ifndef __COM_RESULTCACHE_H__
+#define __COM_RESULTCACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "COM_defines.h"
+
+class CompositorContext;
+class MemoryBuffer;
+struct bNode;
+struct bNodeTree;
+struct ID;
+
+/**
+ * \brief Identifies the result of a buffered operation.
+ *
+ * The key is a hash of the operation, the parameters of the node it was created for
+ * and the keys of all its inputs, so any change upstream results in a different key.
+ * Results that depend on data which can change without the node tree noticing
+ * (movie clips, masks, painted images, ...) get an invalid key and are never cached.
+ */
+class ResultKey {
+private:
+	uint64_t m_hash;
+	bool m_valid;
+
+public:
+	ResultKey();
+
+	void addData(const void *data, size_t size);
+	void addString(const char *str);
+	void addInt(int value) { addData(&value, sizeof(value)); }
+	void addFloat(float value) { addData(&value, sizeof(value)); }
+	void addPointer(const void *value) { addData(&value, sizeof(value)); }
+	void addKey(const ResultKey &key);
+
+	/**
+	 * \brief the result depends on data that can't be tracked, don't cache it
+	 */
+	void invalidate() { this->m_valid = false; }
+	bool isValid() const { return this->m_valid; }
+	uint64_t getHash() const { return this->m_hash; }
+};
+
+/**
+ * \brief Memory bounded cache of operation results, kept between compositor executions.
+ *
+ * During editing the complete buffers of WriteBufferOperations are stored after execution.
+ * When the tree is executed again, write buffers with an unchanged key read their buffer
+ * from the cache, so only the operations after a changed node are calculated again.
+ * Results are stored in a MovieCache, so they share the memory cache limit with movie clips,
+ * sequencer strips and images, the least recently used buffers are freed first.
+ *
+ * Functions are thread safe.
+ * \ingroup execution
+ */
+class ResultCache {
+public:
+	/**
+	 * \brief add the node parameters that influence its result to the key
+	 * \note all RNA properties of the node (except the generic ones like name and location),
+	 * \note the default values of its input sockets and the state of referenced ID datablocks.
+	 */
+	static void addNode(ResultKey &key, bNodeTree *ntree, bNode *node);
+
+	/**
+	 * \brief add the context settings that nodes read while converting to operations
+	 */
+	static void addContext(ResultKey &key, const CompositorContext &context);
+
+	/**
+	 * \brief get a cached result.
+	 * \note the buffer reads the data of the cache entry, it must not be modified.
+	 * \return the buffer or NULL when there is no matching result.
+	 */
+	static MemoryBuffer *acquire(const ResultKey &key, DataType datatype, unsigned int width, unsigned int height);
+
+	/**
+	 * \brief store a complete result, the cache takes ownership of the buffer.
+	 */
+	static void store(const ResultKey &key, MemoryBuffer *buffer);
+
+	/**
+	 * \brief free all cached results
+	 */
+	static void clear();
+};
+
+#endif  /* __COM_RESULTCACHE_H__ */
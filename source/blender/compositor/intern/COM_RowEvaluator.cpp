@@ -0,0 +1,100 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2011, Blender Foundation.
+ */
+
+#include <map>
+
+#include "COM_RowEvaluator.h"
+
+#include "MEM_guardedalloc.h"
+
+#define COM_ROW_SIZE (COM_ROW_LENGTH * COM_NUM_CHANNELS_COLOR)
+
+RowEvaluator::RowEvaluator(NodeOperation *operation)
+{
+	/* step of every operation, with the index of its output row */
+	std::map<NodeOperation *, unsigned int> rows;
+	/* depth first, operations are added after all of their inputs */
+	std::vector<std::pair<NodeOperation *, bool> > stack;
+	/* step calculating every input row, until the scratch buffer is allocated */
+	std::vector<unsigned int> inputSteps;
+
+	for (unsigned int index = operation->getNumberOfInputSockets(); index > 0; index--) {
+		stack.push_back(std::make_pair(operation->getInputOperation(index - 1), false));
+	}
+
+	while (!stack.empty()) {
+		NodeOperation *op = stack.back().first;
+		const bool inputsAdded = stack.back().second;
+		stack.pop_back();
+
+		if (rows.find(op) != rows.end()) {
+			continue;
+		}
+
+		if (op->hasRowInputs() && !inputsAdded) {
+			stack.push_back(std::make_pair(op, true));
+			for (unsigned int index = op->getNumberOfInputSockets(); index > 0; index--) {
+				NodeOperation *input = op->getInputOperation(index - 1);
+				if (rows.find(input) == rows.end()) {
+					stack.push_back(std::make_pair(input, false));
+				}
+			}
+			continue;
+		}
+
+		RowStep step;
+		step.operation = op;
+		step.firstInput = inputSteps.size();
+		step.output = NULL;
+		if (op->hasRowInputs()) {
+			for (unsigned int index = 0; index < op->getNumberOfInputSockets(); index++) {
+				inputSteps.push_back(rows[op->getInputOperation(index)]);
+			}
+		}
+		rows[op] = this->m_steps.size();
+		this->m_steps.push_back(step);
+	}
+
+	this->m_firstInput = inputSteps.size();
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		inputSteps.push_back(rows[operation->getInputOperation(index)]);
+	}
+
+	this->m_scratch = (float *)MEM_mallocN_aligned(sizeof(float) * COM_ROW_SIZE * max_ii((int)this->m_steps.size(), 1), 16, "COM_RowEvaluator");
+	for (unsigned int index = 0; index < this->m_steps.size(); index++) {
+		this->m_steps[index].output = &this->m_scratch[index * COM_ROW_SIZE];
+	}
+	for (unsigned int index = 0; index < inputSteps.size(); index++) {
+		this->m_inputs.push_back(this->m_steps[inputSteps[index]].output);
+	}
+}
+
+RowEvaluator::~RowEvaluator()
+{
+	MEM_freeN(this->m_scratch);
+}
+
+void RowEvaluator::execute(int x, int y, int length)
+{
+	BLI_assert(length <= COM_ROW_LENGTH);
+	const float **inputs = this->m_inputs.empty() ? NULL : &this->m_inputs[0];
+	for (unsigned int index = 0; index < this->m_steps.size(); index++) {
+		RowStep &step = this->m_steps[index];
+		step.operation->readRow(step.output, inputs + step.firstInput, x, y, length);
+	}
+}
@@ -0,0 +1,77 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2011, Blender Foundation.
+ */
+
+#ifndef __COM_ROWEVALUATOR_H__
+#define __COM_ROWEVALUATOR_H__
+
+#include <vector>
+
+#include "COM_NodeOperation.h"
+
+/**
+ * \brief Calculates rows of the inputs of an operation writing a buffer.
+ *
+ * Operations with row inputs are evaluated in dependency order, each from the rows its
+ * inputs calculated before, so a chain of them doesn't recurse. Their rows are stored in
+ * a scratch buffer allocated once per evaluator, operations read by several others are
+ * calculated once. Other operations calculate their row per pixel, as before.
+ *
+ * An evaluator is created for every chunk, so every thread has its own scratch buffer.
+ * \ingroup execution
+ */
+class RowEvaluator {
+private:
+	typedef struct RowStep {
+		NodeOperation *operation;
+		/** index of the first input row in m_inputs */
+		unsigned int firstInput;
+		float *output;
+	} RowStep;
+
+	/** operations in the order they're calculated */
+	std::vector<RowStep> m_steps;
+	/** input rows of all steps, followed by the input rows of the evaluated operation */
+	std::vector<const float *> m_inputs;
+	unsigned int m_firstInput;
+	float *m_scratch;
+
+public:
+	/**
+	 * \brief create an evaluator for the inputs of the operation
+	 */
+	RowEvaluator(NodeOperation *operation);
+	~RowEvaluator();
+
+	/**
+	 * \brief calculate a row of all inputs
+	 * \param length: number of pixels, at most COM_ROW_LENGTH
+	 */
+	void execute(int x, int y, int length);
+
+	/**
+	 * \brief get the row of an input calculated by execute
+	 * \note every pixel is stored as 4 floats regardless of the data type.
+	 */
+	const float *getInputRow(unsigned int index) const { return this->m_inputs[this->m_firstInput + index]; }
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("COM:RowEvaluator")
+#endif
+};
+
+#endif  /* __COM_ROWEVALUATOR_H__ */
@@ -91,6 +91,24 @@ protected:
 	                                  float /*x*/, float /*y*/,
 	                                  float /*dx*/[2], float /*dy*/[2]) {}
 
+	/**
+	 * \brief calculate a row of pixels
+	 * \note this method is called for non-complex, operations with a cheap per-pixel
+	 * \note calculation override it to avoid the virtual call and sampler dispatch per pixel.
+	 * \param output: is a float[length * COM_NUM_CHANNELS_COLOR] array to store the result,
+	 * \param output: every pixel is stored as 4 floats regardless of the data type.
+	 * \param inputs: the same row of every input socket, only for operations with row inputs
+	 * \param x: the x-coordinate of the first pixel to calculate in image space
+	 * \param y: the y-coordinate of the row to calculate in image space
+	 * \param length: number of pixels to calculate, at most COM_ROW_LENGTH
+	 * \see RowEvaluator
+	 */
+	virtual void executeRow(float *output, const float ** /*inputs*/, int x, int y, int length) {
+		for (int i = 0; i < length; i++) {
+			executePixelSampled(&output[i * COM_NUM_CHANNELS_COLOR], x + i, y, COM_PS_NEAREST);
+		}
+	}
+
 public:
 	inline void readSampled(float result[4], float x, float y, PixelSampler sampler) {
 		executePixelSampled(result, x, y, sampler);
@@ -98,6 +116,9 @@ public:
 	inline void read(float result[4], int x, int y, void *chunkData) {
 		executePixel(result, x, y, chunkData);
 	}
+	inline void readRow(float *result, const float **inputs, int x, int y, int length) {
+		executeRow(result, inputs, x, y, length);
+	}
 	inline void readFiltered(float result[4], float x, float y, float dx[2], float dy[2]) {
 		executePixelFiltered(result, x, y, dx, dy);
 	}
@@ -20,7 +20,7 @@
 
 AlphaOverPremultiplyOperation::AlphaOverPremultiplyOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setRowInputs(true);
 }
 
 void AlphaOverPremultiplyOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -49,3 +49,33 @@ void AlphaOverPremultiplyOperation::executePixelSampled(float output[4], float x
 		output[3] = (mul * inputColor1[3]) + value[0] * inputOverColor[3];
 	}
 }
+
+void AlphaOverPremultiplyOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *color1 = &inputs[1][i * COM_NUM_CHANNELS_COLOR];
+		const float *overColor = &inputs[2][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		const float value = getRowValue(inputs, i);
+
+		/* Zero alpha values should still permit an add of RGB data */
+		if (overColor[3] < 0.0f) {
+			copy_v4_v4(out, color1);
+		}
+		else if (value == 1.0f && overColor[3] >= 1.0f) {
+			copy_v4_v4(out, overColor);
+		}
+		else {
+			float mul = 1.0f - value * overColor[3];
+#ifdef __SSE2__
+			_mm_storeu_ps(out, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(mul), _mm_loadu_ps(color1)),
+			                              _mm_mul_ps(_mm_set1_ps(value), _mm_loadu_ps(overColor))));
+#else
+			out[0] = (mul * color1[0]) + value * overColor[0];
+			out[1] = (mul * color1[1]) + value * overColor[1];
+			out[2] = (mul * color1[2]) + value * overColor[2];
+			out[3] = (mul * color1[3]) + value * overColor[3];
+#endif
+		}
+	}
+}
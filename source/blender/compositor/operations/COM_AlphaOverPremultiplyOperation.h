@@ -36,6 +36,7 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 
 };
 #endif
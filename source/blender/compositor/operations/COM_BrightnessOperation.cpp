@@ -24,6 +24,7 @@ BrightnessOperation::BrightnessOperation() : NodeOperation()
 	this->addInputSocket(COM_DT_VALUE);
 	this->addInputSocket(COM_DT_VALUE);
 	this->addOutputSocket(COM_DT_COLOR);
+	this->setRowInputs(true);
 	this->m_inputProgram = NULL;
 	this->m_use_premultiply = false;
 }
@@ -79,6 +80,43 @@ void BrightnessOperation::executePixelSampled(float output[4], float x, float y,
 	}
 }
 
+void BrightnessOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		float *color = &output[i * COM_NUM_CHANNELS_COLOR];
+		float a, b;
+		float brightness = inputs[1][i * COM_NUM_CHANNELS_COLOR];
+		float contrast = inputs[2][i * COM_NUM_CHANNELS_COLOR];
+		copy_v4_v4(color, &inputs[0][i * COM_NUM_CHANNELS_COLOR]);
+		brightness /= 100.0f;
+		float delta = contrast / 200.0f;
+		a = 1.0f - delta * 2.0f;
+		if (contrast > 0) {
+			a = 1.0f / a;
+			b = a * (brightness - delta);
+		}
+		else {
+			delta *= -1;
+			b = a * (brightness + delta);
+		}
+		if (this->m_use_premultiply) {
+			premul_to_straight_v4(color);
+		}
+#ifdef __SSE2__
+		const float alpha = color[3];
+		_mm_storeu_ps(color, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a), _mm_loadu_ps(color)), _mm_set1_ps(b)));
+		color[3] = alpha;
+#else
+		color[0] = a * color[0] + b;
+		color[1] = a * color[1] + b;
+		color[2] = a * color[2] + b;
+#endif
+		if (this->m_use_premultiply) {
+			straight_to_premul_v4(color);
+		}
+	}
+}
+
 void BrightnessOperation::deinitExecution()
 {
 	this->m_inputProgram = NULL;
@@ -20,6 +20,10 @@
 #define __COM_BRIGHTNESSOPERATION_H__
 #include "COM_NodeOperation.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 
 class BrightnessOperation : public NodeOperation {
 private:
@@ -39,6 +43,7 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 
 	/**
 	 * Initialize the execution
@@ -17,7 +17,9 @@
  */
 
 #include "COM_CompositorOperation.h"
+#include "COM_RowEvaluator.h"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BKE_global.h"
 #include "BKE_image.h"
 
@@ -129,7 +131,6 @@ void CompositorOperation::deinitExecution()
 
 void CompositorOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 {
-	float color[8]; // 7 is enough
 	float *buffer = this->m_outputBuffer;
 	float *zbuffer = this->m_depthBuffer;
 
@@ -185,21 +186,28 @@ void CompositorOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 	}
 #endif
 
+	RowEvaluator rows(this);
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2 && (!breaked); x++) {
+		for (x = x1; x < x2 && (!breaked); x += COM_ROW_LENGTH) {
+			const int length = min_ii(x2 - x, COM_ROW_LENGTH);
 			int input_x = x + dx, input_y = y + dy;
+			int i;
 
-			this->m_imageInput->readSampled(color, input_x, input_y, COM_PS_NEAREST);
+			rows.execute(input_x, input_y, length);
+			memcpy(buffer + offset4, rows.getInputRow(0), sizeof(float) * COM_NUM_CHANNELS_COLOR * length);
 			if (this->m_useAlphaInput) {
-				this->m_alphaInput->readSampled(&(color[3]), input_x, input_y, COM_PS_NEAREST);
+				const float *row = rows.getInputRow(1);
+				for (i = 0; i < length; i++) {
+					buffer[offset4 + i * COM_NUM_CHANNELS_COLOR + 3] = row[i * COM_NUM_CHANNELS_COLOR];
+				}
 			}
 
-			copy_v4_v4(buffer + offset4, color);
-
-			this->m_depthInput->readSampled(color, input_x, input_y, COM_PS_NEAREST);
-			zbuffer[offset] = color[0];
-			offset4 += COM_NUM_CHANNELS_COLOR;
-			offset++;
+			const float *row = rows.getInputRow(2);
+			for (i = 0; i < length; i++) {
+				zbuffer[offset + i] = row[i * COM_NUM_CHANNELS_COLOR];
+			}
+			offset4 += length * COM_NUM_CHANNELS_COLOR;
+			offset += length;
 			if (isBreaked()) {
 				breaked = true;
 			}
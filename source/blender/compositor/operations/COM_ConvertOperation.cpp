@@ -44,6 +44,7 @@ ConvertValueToColorOperation::ConvertValueToColorOperation() : ConvertBaseOperat
 {
 	this->addInputSocket(COM_DT_VALUE);
 	this->addOutputSocket(COM_DT_COLOR);
+	this->setRowInputs(true);
 }
 
 void ConvertValueToColorOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -54,6 +55,16 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4], float x,
 	output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *in = &inputs[0][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		out[0] = out[1] = out[2] = in[0];
+		out[3] = 1.0f;
+	}
+}
+
 
 /* ******** Color to Value ******** */
 
@@ -61,6 +72,7 @@ ConvertColorToValueOperation::ConvertColorToValueOperation() : ConvertBaseOperat
 {
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VALUE);
+	this->setRowInputs(true);
 }
 
 void ConvertColorToValueOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -70,6 +82,14 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4], float x,
 	output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *in = &inputs[0][i * COM_NUM_CHANNELS_COLOR];
+		output[i * COM_NUM_CHANNELS_COLOR] = (in[0] + in[1] + in[2]) / 3.0f;
+	}
+}
+
 
 /* ******** Color to BW ******** */
 
@@ -77,6 +97,7 @@ ConvertColorToBWOperation::ConvertColorToBWOperation() : ConvertBaseOperation()
 {
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VALUE);
+	this->setRowInputs(true);
 }
 
 void ConvertColorToBWOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -86,6 +107,13 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4], float x, fl
 	output[0] = IMB_colormanagement_get_luminance(inputColor);
 }
 
+void ConvertColorToBWOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		output[i * COM_NUM_CHANNELS_COLOR] = IMB_colormanagement_get_luminance(&inputs[0][i * COM_NUM_CHANNELS_COLOR]);
+	}
+}
+
 
 /* ******** Color to Vector ******** */
 
@@ -93,6 +121,7 @@ ConvertColorToVectorOperation::ConvertColorToVectorOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VECTOR);
+	this->setRowInputs(true);
 }
 
 void ConvertColorToVectorOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -101,6 +130,13 @@ void ConvertColorToVectorOperation::executePixelSampled(float output[4], float x
 	this->m_inputOperation->readSampled(color, x, y, sampler);
 	copy_v3_v3(output, color);}
 
+void ConvertColorToVectorOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		copy_v3_v3(&output[i * COM_NUM_CHANNELS_COLOR], &inputs[0][i * COM_NUM_CHANNELS_COLOR]);
+	}
+}
+
 
 /* ******** Value to Vector ******** */
 
@@ -108,6 +144,7 @@ ConvertValueToVectorOperation::ConvertValueToVectorOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_VALUE);
 	this->addOutputSocket(COM_DT_VECTOR);
+	this->setRowInputs(true);
 }
 
 void ConvertValueToVectorOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -117,6 +154,15 @@ void ConvertValueToVectorOperation::executePixelSampled(float output[4], float x
 	output[0] = output[1] = output[2] = value;
 }
 
+void ConvertValueToVectorOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *in = &inputs[0][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		out[0] = out[1] = out[2] = in[0];
+	}
+}
+
 
 /* ******** Vector to Color ******** */
 
@@ -124,6 +170,7 @@ ConvertVectorToColorOperation::ConvertVectorToColorOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_VECTOR);
 	this->addOutputSocket(COM_DT_COLOR);
+	this->setRowInputs(true);
 }
 
 void ConvertVectorToColorOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -132,6 +179,16 @@ void ConvertVectorToColorOperation::executePixelSampled(float output[4], float x
 	output[3] = 1.0f;
 }
 
+void ConvertVectorToColorOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *in = &inputs[0][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		copy_v3_v3(out, in);
+		out[3] = 1.0f;
+	}
+}
+
 
 /* ******** Vector to Value ******** */
 
@@ -139,6 +196,7 @@ ConvertVectorToValueOperation::ConvertVectorToValueOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_VECTOR);
 	this->addOutputSocket(COM_DT_VALUE);
+	this->setRowInputs(true);
 }
 
 void ConvertVectorToValueOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -148,6 +206,14 @@ void ConvertVectorToValueOperation::executePixelSampled(float output[4], float x
 	output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+void ConvertVectorToValueOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *in = &inputs[0][i * COM_NUM_CHANNELS_COLOR];
+		output[i * COM_NUM_CHANNELS_COLOR] = (in[0] + in[1] + in[2]) / 3.0f;
+	}
+}
+
 
 /* ******** RGB to YCC ******** */
 
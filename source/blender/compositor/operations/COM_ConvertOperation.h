@@ -39,6 +39,7 @@ public:
 	ConvertValueToColorOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 
@@ -47,6 +48,7 @@ public:
 	ConvertColorToValueOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 
@@ -55,6 +57,7 @@ public:
 	ConvertColorToBWOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 
@@ -63,6 +66,7 @@ public:
 	ConvertColorToVectorOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 
@@ -71,6 +75,7 @@ public:
 	ConvertValueToVectorOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 
@@ -79,6 +84,7 @@ public:
 	ConvertVectorToColorOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 
@@ -87,6 +93,7 @@ public:
 	ConvertVectorToValueOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 
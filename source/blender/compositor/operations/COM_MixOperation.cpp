@@ -100,7 +100,7 @@ void MixBaseOperation::deinitExecution()
 
 MixAddOperation::MixAddOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setRowInputs(true);
 }
 
 void MixAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -125,11 +125,33 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
 	clampIfNeeded(output);
 }
 
+void MixAddOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *color1 = &inputs[1][i * COM_NUM_CHANNELS_COLOR];
+		const float *color2 = &inputs[2][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		const float value = getRowValue(inputs, i);
+#ifdef __SSE2__
+		__m128 result = _mm_add_ps(_mm_loadu_ps(color1),
+		                           _mm_mul_ps(_mm_set1_ps(value), _mm_loadu_ps(color2)));
+		storeRowPixel(out, result, color1[3]);
+#else
+		out[0] = color1[0] + value * color2[0];
+		out[1] = color1[1] + value * color2[1];
+		out[2] = color1[2] + value * color2[2];
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+#endif
+	}
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setRowInputs(true);
 }
 
 void MixBlendOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -156,6 +178,29 @@ void MixBlendOperation::executePixelSampled(float output[4], float x, float y, P
 	clampIfNeeded(output);
 }
 
+void MixBlendOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *color1 = &inputs[1][i * COM_NUM_CHANNELS_COLOR];
+		const float *color2 = &inputs[2][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		const float value = getRowValue(inputs, i);
+#ifdef __SSE2__
+		__m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.0f - value), _mm_loadu_ps(color1)),
+		                           _mm_mul_ps(_mm_set1_ps(value), _mm_loadu_ps(color2)));
+		storeRowPixel(out, result, color1[3]);
+#else
+		const float valuem = 1.0f - value;
+		out[0] = valuem * (color1[0]) + value * (color2[0]);
+		out[1] = valuem * (color1[1]) + value * (color2[1]);
+		out[2] = valuem * (color1[2]) + value * (color2[2]);
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+#endif
+	}
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixBurnOperation::MixBurnOperation() : MixBaseOperation()
@@ -593,7 +638,7 @@ void MixLinearLightOperation::executePixelSampled(float output[4], float x, floa
 
 MixMultiplyOperation::MixMultiplyOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setRowInputs(true);
 }
 
 void MixMultiplyOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -619,6 +664,30 @@ void MixMultiplyOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MixMultiplyOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *color1 = &inputs[1][i * COM_NUM_CHANNELS_COLOR];
+		const float *color2 = &inputs[2][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		const float value = getRowValue(inputs, i);
+#ifdef __SSE2__
+		__m128 factor = _mm_add_ps(_mm_set1_ps(1.0f - value),
+		                           _mm_mul_ps(_mm_set1_ps(value), _mm_loadu_ps(color2)));
+		__m128 result = _mm_mul_ps(_mm_loadu_ps(color1), factor);
+		storeRowPixel(out, result, color1[3]);
+#else
+		const float valuem = 1.0f - value;
+		out[0] = color1[0] * (valuem + value * color2[0]);
+		out[1] = color1[1] * (valuem + value * color2[1]);
+		out[2] = color1[2] * (valuem + value * color2[2]);
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+#endif
+	}
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation() : MixBaseOperation()
@@ -709,7 +778,7 @@ void MixSaturationOperation::executePixelSampled(float output[4], float x, float
 
 MixScreenOperation::MixScreenOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setRowInputs(true);
 }
 
 void MixScreenOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -736,6 +805,31 @@ void MixScreenOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+void MixScreenOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *color1 = &inputs[1][i * COM_NUM_CHANNELS_COLOR];
+		const float *color2 = &inputs[2][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		const float value = getRowValue(inputs, i);
+#ifdef __SSE2__
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 factor = _mm_add_ps(_mm_set1_ps(1.0f - value),
+		                           _mm_mul_ps(_mm_set1_ps(value), _mm_sub_ps(one, _mm_loadu_ps(color2))));
+		__m128 result = _mm_sub_ps(one, _mm_mul_ps(factor, _mm_sub_ps(one, _mm_loadu_ps(color1))));
+		storeRowPixel(out, result, color1[3]);
+#else
+		const float valuem = 1.0f - value;
+		out[0] = 1.0f - (valuem + value * (1.0f - color2[0])) * (1.0f - color1[0]);
+		out[1] = 1.0f - (valuem + value * (1.0f - color2[1])) * (1.0f - color1[1]);
+		out[2] = 1.0f - (valuem + value * (1.0f - color2[2])) * (1.0f - color1[2]);
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+#endif
+	}
+}
+
 /* ******** Mix Soft Light Operation ******** */
 
 MixSoftLightOperation::MixSoftLightOperation() : MixBaseOperation()
@@ -777,7 +871,7 @@ void MixSoftLightOperation::executePixelSampled(float output[4], float x, float
 
 MixSubtractOperation::MixSubtractOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setRowInputs(true);
 }
 
 void MixSubtractOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -802,6 +896,28 @@ void MixSubtractOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MixSubtractOperation::executeRow(float *output, const float **inputs, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		const float *color1 = &inputs[1][i * COM_NUM_CHANNELS_COLOR];
+		const float *color2 = &inputs[2][i * COM_NUM_CHANNELS_COLOR];
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		const float value = getRowValue(inputs, i);
+#ifdef __SSE2__
+		__m128 result = _mm_sub_ps(_mm_loadu_ps(color1),
+		                           _mm_mul_ps(_mm_set1_ps(value), _mm_loadu_ps(color2)));
+		storeRowPixel(out, result, color1[3]);
+#else
+		out[0] = color1[0] - value * (color2[0]);
+		out[1] = color1[1] - value * (color2[1]);
+		out[2] = color1[2] - value * (color2[2]);
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+#endif
+	}
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation() : MixBaseOperation()
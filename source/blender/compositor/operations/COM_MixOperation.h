@@ -20,6 +20,9 @@
 #define __COM_MIXOPERATION_H__
 #include "COM_NodeOperation.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
 
 /**
  * All this programs converts an input color to an output value.
@@ -47,6 +50,34 @@ protected:
 		}
 	}
 
+	/**
+	 * Mix factor of a pixel in executeRow, multiplied by the alpha of the second color
+	 * when useValueAlphaMultiply is set.
+	 */
+	inline float getRowValue(const float **inputs, int index) const
+	{
+		float value = inputs[0][index * COM_NUM_CHANNELS_COLOR];
+		if (this->m_valueAlphaMultiply) {
+			value *= inputs[2][index * COM_NUM_CHANNELS_COLOR + 3];
+		}
+		return value;
+	}
+
+#ifdef __SSE2__
+	/**
+	 * Store the RGB of a blended pixel with the alpha of the first color, clamped when needed.
+	 */
+	inline void storeRowPixel(float output[4], __m128 color, float alpha)
+	{
+		const __m128 rgb_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		color = _mm_or_ps(_mm_and_ps(rgb_mask, color), _mm_andnot_ps(rgb_mask, _mm_set1_ps(alpha)));
+		if (m_useClamp) {
+			color = _mm_min_ps(_mm_max_ps(color, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		}
+		_mm_storeu_ps(output, color);
+	}
+#endif
+
 public:
 	/**
 	 * Default constructor
@@ -80,12 +111,14 @@ class MixAddOperation : public MixBaseOperation {
 public:
 	MixAddOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 class MixBlendOperation : public MixBaseOperation {
 public:
 	MixBlendOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 class MixBurnOperation : public MixBaseOperation {
@@ -152,6 +185,7 @@ class MixMultiplyOperation : public MixBaseOperation {
 public:
 	MixMultiplyOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -170,6 +204,7 @@ class MixScreenOperation : public MixBaseOperation {
 public:
 	MixScreenOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 class MixSoftLightOperation : public MixBaseOperation {
@@ -182,6 +217,7 @@ class MixSubtractOperation : public MixBaseOperation {
 public:
 	MixSubtractOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, const float **inputs, int x, int y, int length);
 };
 
 class MixValueOperation : public MixBaseOperation {
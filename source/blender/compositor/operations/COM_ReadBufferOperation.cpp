@@ -20,6 +20,8 @@
 #include "COM_WriteBufferOperation.h"
 #include "COM_defines.h"
 
+#include <string.h>
+
 ReadBufferOperation::ReadBufferOperation(DataType datatype) : NodeOperation()
 {
 	this->addOutputSocket(datatype);
@@ -85,6 +87,36 @@ void ReadBufferOperation::executePixelExtend(float output[4], float x, float y,
 	}
 }
 
+void ReadBufferOperation::executeRow(float *output, const float **inputs, int x, int y, int length)
+{
+	const int num_channels = m_buffer->get_num_channels();
+	if (m_single_value) {
+		/* write buffer has a single value stored at (0,0) */
+		m_buffer->read(output, 0, 0);
+		for (int i = 1; i < length; i++) {
+			memcpy(&output[i * COM_NUM_CHANNELS_COLOR], output, sizeof(float) * num_channels);
+		}
+		return;
+	}
+
+	const rcti *rect = m_buffer->getRect();
+	if (y < rect->ymin || y >= rect->ymax || x < rect->xmin || x + length > rect->xmax) {
+		/* partially outside the buffer, let the per-pixel path handle clipping */
+		NodeOperation::executeRow(output, inputs, x, y, length);
+		return;
+	}
+
+	const float *buffer = &m_buffer->getBuffer()[((y - rect->ymin) * m_buffer->getWidth() + (x - rect->xmin)) * num_channels];
+	if (num_channels == COM_NUM_CHANNELS_COLOR) {
+		memcpy(output, buffer, sizeof(float) * COM_NUM_CHANNELS_COLOR * length);
+	}
+	else {
+		for (int i = 0; i < length; i++) {
+			memcpy(&output[i * COM_NUM_CHANNELS_COLOR], &buffer[i * num_channels], sizeof(float) * num_channels);
+		}
+	}
+}
+
 void ReadBufferOperation::executePixelFiltered(float output[4], float x, float y, float dx[2], float dy[2])
 {
 	if (m_single_value) {
@@ -30,6 +30,13 @@ void SetValueOperation::executePixelSampled(float output[4],
 	output[0] = this->m_value;
 }
 
+void SetValueOperation::executeRow(float *output, const float ** /*inputs*/, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		output[i * COM_NUM_CHANNELS_COLOR] = this->m_value;
+	}
+}
+
 void SetValueOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	resolution[0] = preferredResolution[0];
@@ -33,6 +33,16 @@ void SetVectorOperation::executePixelSampled(float output[4],
 	output[2] = this->m_z;
 }
 
+void SetVectorOperation::executeRow(float *output, const float ** /*inputs*/, int /*x*/, int /*y*/, int length)
+{
+	for (int i = 0; i < length; i++) {
+		float *out = &output[i * COM_NUM_CHANNELS_COLOR];
+		out[0] = this->m_x;
+		out[1] = this->m_y;
+		out[2] = this->m_z;
+	}
+}
+
 void SetVectorOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	resolution[0] = preferredResolution[0];
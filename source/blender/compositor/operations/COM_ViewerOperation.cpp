@@ -17,6 +17,7 @@
  */
 
 #include "COM_ViewerOperation.h"
+#include "COM_RowEvaluator.h"
 #include "BLI_listbase.h"
 #include "BKE_image.h"
 #include "BKE_scene.h"
@@ -24,6 +25,7 @@
 #include "WM_types.h"
 #include "PIL_time.h"
 #include "BLI_utildefines.h"
+#include "BLI_math_base.h"
 #include "BLI_math_color.h"
 #include "BLI_math_vector.h"
 
@@ -92,23 +94,31 @@ void ViewerOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 	const int offsetadd4 = offsetadd * 4;
 	int offset = (y1 * this->getWidth() + x1);
 	int offset4 = offset * 4;
-	float alpha[4], depth[4];
 	int x;
 	int y;
 	bool breaked = false;
 
+	RowEvaluator rows(this);
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2; x++) {
-			this->m_imageInput->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
+		for (x = x1; x < x2; x += COM_ROW_LENGTH) {
+			const int length = min_ii(x2 - x, COM_ROW_LENGTH);
+			int i;
+
+			rows.execute(x, y, length);
+			memcpy(&(buffer[offset4]), rows.getInputRow(0), sizeof(float) * 4 * length);
 			if (this->m_useAlphaInput) {
-				this->m_alphaInput->readSampled(alpha, x, y, COM_PS_NEAREST);
-				buffer[offset4 + 3] = alpha[0];
+				const float *row = rows.getInputRow(1);
+				for (i = 0; i < length; i++) {
+					buffer[offset4 + i * 4 + 3] = row[i * 4];
+				}
+			}
+			const float *row = rows.getInputRow(2);
+			for (i = 0; i < length; i++) {
+				depthbuffer[offset + i] = row[i * 4];
 			}
-			this->m_depthInput->readSampled(depth, x, y, COM_PS_NEAREST);
-			depthbuffer[offset] = depth[0];
 
-			offset ++;
-			offset4 += 4;
+			offset += length;
+			offset4 += length * 4;
 		}
 		if (isBreaked()) {
 			breaked = true;
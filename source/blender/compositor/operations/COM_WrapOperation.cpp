@@ -69,6 +69,12 @@ void WrapOperation::executePixelSampled(float output[4], float x, float y, Pixel
 	executePixelExtend(output, nx, ny, sampler, extend_x, extend_y);
 }
 
+void WrapOperation::executeRow(float *output, const float **inputs, int x, int y, int length)
+{
+	/* coordinates are wrapped per pixel, don't copy rows directly from the buffer */
+	NodeOperation::executeRow(output, inputs, x, y, length);
+}
+
 bool WrapOperation::determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output)
 {
 	rcti newInput;
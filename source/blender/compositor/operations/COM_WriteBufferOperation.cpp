@@ -19,7 +19,10 @@
 #include "COM_WriteBufferOperation.h"
 #include "COM_defines.h"
 #include <stdio.h>
+#include <string.h>
+#include "BLI_math_base.h"
 #include "COM_OpenCLDevice.h"
+#include "COM_RowEvaluator.h"
 
 WriteBufferOperation::WriteBufferOperation(DataType datatype) : NodeOperation()
 {
@@ -27,9 +30,15 @@ WriteBufferOperation::WriteBufferOperation(DataType datatype) : NodeOperation()
 	this->m_memoryProxy = new MemoryProxy(datatype);
 	this->m_memoryProxy->setWriteBufferOperation(this);
 	this->m_memoryProxy->setExecutor(NULL);
+	this->m_cachedBuffer = NULL;
+	this->m_cached = false;
 }
 WriteBufferOperation::~WriteBufferOperation()
 {
+	if (this->m_cachedBuffer) {
+		delete this->m_cachedBuffer;
+		this->m_cachedBuffer = NULL;
+	}
 	if (this->m_memoryProxy) {
 		delete this->m_memoryProxy;
 		this->m_memoryProxy = NULL;
@@ -44,7 +53,13 @@ void WriteBufferOperation::executePixelSampled(float output[4], float x, float y
 void WriteBufferOperation::initExecution()
 {
 	this->m_input = this->getInputOperation(0);
-	this->m_memoryProxy->allocate(this->m_width, this->m_height);
+	if (this->m_cachedBuffer) {
+		this->m_memoryProxy->setBuffer(this->m_cachedBuffer);
+		this->m_cachedBuffer = NULL;
+	}
+	else if (!this->m_cached) {
+		this->m_memoryProxy->allocate(this->m_width, this->m_height);
+	}
 }
 
 void WriteBufferOperation::deinitExecution()
@@ -53,6 +68,12 @@ void WriteBufferOperation::deinitExecution()
 	this->m_memoryProxy->free();
 }
 
+void WriteBufferOperation::setCachedBuffer(MemoryBuffer *buffer)
+{
+	this->m_cachedBuffer = buffer;
+	this->m_cached = true;
+}
+
 void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 {
 	MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
@@ -92,11 +113,25 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
 		int x;
 		int y;
 		bool breaked = false;
+		/* calculate rows in batches, only the used channels are copied */
+		RowEvaluator rows(this);
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * num_channels;
-			for (x = x1; x < x2; x++) {
-				this->m_input->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
-				offset4 += num_channels;
+			int offset = (y * memoryBuffer->getWidth() + x1) * num_channels;
+			for (x = x1; x < x2; x += COM_ROW_LENGTH) {
+				const int length = min_ii(x2 - x, COM_ROW_LENGTH);
+				rows.execute(x, y, length);
+				const float *row = rows.getInputRow(0);
+				if (num_channels == COM_NUM_CHANNELS_COLOR) {
+					memcpy(&buffer[offset], row, sizeof(float) * COM_NUM_CHANNELS_COLOR * length);
+				}
+				else {
+					for (int i = 0; i < length; i++) {
+						memcpy(&buffer[offset + i * num_channels],
+						       &row[i * COM_NUM_CHANNELS_COLOR],
+						       sizeof(float) * num_channels);
+					}
+				}
+				offset += length * num_channels;
 			}
 			if (isBreaked()) {
 				breaked = true;
@@ -22,6 +22,7 @@
 #include "COM_NodeOperation.h"
 #include "COM_MemoryProxy.h"
 #include "COM_SocketReader.h"
+#include "COM_ResultCache.h"
 /**
  * \brief NodeOperation to write to a tile
  * \ingroup Operation
@@ -30,6 +31,9 @@ class WriteBufferOperation : public NodeOperation {
 	MemoryProxy *m_memoryProxy;
 	bool m_single_value; /* single value stored in buffer */
 	NodeOperation *m_input;
+	ResultKey m_resultKey; /* identifies the result in the ResultCache */
+	MemoryBuffer *m_cachedBuffer; /* result taken from the ResultCache, until it is passed to the proxy */
+	bool m_cached; /* result is taken from the ResultCache, the input is not executed */
 public:
 	WriteBufferOperation(DataType datatype);
 	~WriteBufferOperation();
@@ -48,5 +52,14 @@ public:
 		return m_input;
 	}
 
+	void setResultKey(const ResultKey &key) { this->m_resultKey = key; }
+	const ResultKey &getResultKey() const { return this->m_resultKey; }
+	/**
+	 * \brief use a result of an earlier execution instead of calculating the input.
+	 * \note the operation takes ownership of the buffer.
+	 */
+	void setCachedBuffer(MemoryBuffer *buffer);
+	bool isCached() const { return this->m_cached; }
+
 };
 #endif
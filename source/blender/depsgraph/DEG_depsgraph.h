@@ -97,6 +97,12 @@ Depsgraph *DEG_graph_new(struct Scene *scene,
 /* Free Depsgraph itself and all its data */
 void DEG_graph_free(Depsgraph *graph);
 
+/* Use depsgraph for another scene and view layer, relations are to be built again
+ * (used on undo, when scene was read again, see DEG_graph_build_from_view_layer()). */
+void DEG_graph_replace_owners(Depsgraph *depsgraph,
+                              struct Scene *scene,
+                              struct ViewLayer *view_layer);
+
 /* Node Types Registry ---------------------------- */
 
 /* Register all node types */
@@ -63,6 +63,9 @@ void DEG_graph_build_from_view_layer(struct Depsgraph *graph,
 /* Tag relations from the given graph for update. */
 void DEG_graph_tag_relations_update(struct Depsgraph *graph);
 
+/* Check whether relations of the specified graph are to be updated. */
+bool DEG_graph_relations_need_update(const struct Depsgraph *graph);
+
 /* Create or update relations in the specified graph. */
 void DEG_graph_relations_update(struct Depsgraph *graph,
                                 struct Main *bmain,
@@ -0,0 +1,116 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2019 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/builder/deg_builder_priority.h"
+
+#include <algorithm>
+
+#include "BLI_utildefines.h"
+
+#include "intern/node/deg_node.h"
+#include "intern/node/deg_node_operation.h"
+
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_type.h"
+
+namespace DEG {
+
+/* Static estimate of the operation evaluation cost, in arbitrary units.
+ *
+ * Measuring actual evaluation time would be more precise, but is too costly to
+ * be done on every evaluation, and would require re-calculating priorities
+ * before each of them. Only the order of magnitude matters here: it is used to
+ * find the longest chains of operations in the graph. */
+static double operation_cost_estimate(const OperationNode *op_node)
+{
+	if (op_node->is_noop()) {
+		return 0.0;
+	}
+	switch (op_node->opcode) {
+		case OperationCode::GEOMETRY_EVAL:
+		case OperationCode::PARTICLE_SYSTEM_EVAL:
+		case OperationCode::RIGIDBODY_SIM:
+			return 10.0;
+		default:
+			return 1.0;
+	}
+}
+
+static bool operation_priority_compare(const Relation *a, const Relation *b)
+{
+	return ((OperationNode *)a->to)->priority >
+	       ((OperationNode *)b->to)->priority;
+}
+
+/* Priority of an operation is the estimated cost of the longest chain of
+ * operations starting at it. Operations are visited in a reverse topological
+ * order, starting from the ones which have no children. Cyclic relations are
+ * ignored, same as the evaluation does when counting pending parents. */
+void deg_graph_calculate_priorities(Depsgraph *graph)
+{
+	vector<OperationNode *> queue;
+	/* Count number of children of every operation. */
+	for (OperationNode *node : graph->operations) {
+		node->priority = 0.0;
+		node->custom_flags = 0;
+		for (Relation *rel : node->outlinks) {
+			if ((rel->flag & RELATION_FLAG_CYCLIC) == 0) {
+				++node->custom_flags;
+			}
+		}
+		if (node->custom_flags == 0) {
+			queue.push_back(node);
+		}
+	}
+	while (!queue.empty()) {
+		OperationNode *node = queue.back();
+		queue.pop_back();
+		double max_child_priority = 0.0;
+		for (Relation *rel : node->outlinks) {
+			if ((rel->flag & RELATION_FLAG_CYCLIC) == 0) {
+				OperationNode *child = (OperationNode *)rel->to;
+				max_child_priority = max(max_child_priority, child->priority);
+			}
+		}
+		node->priority = operation_cost_estimate(node) + max_child_priority;
+		/* Stable, so operations of the same priority keep the order in which
+		 * relations were built. */
+		std::stable_sort(node->outlinks.begin(),
+		                 node->outlinks.end(),
+		                 operation_priority_compare);
+		for (Relation *rel : node->inlinks) {
+			if (rel->from->type != NodeType::OPERATION ||
+			    (rel->flag & RELATION_FLAG_CYCLIC) != 0)
+			{
+				continue;
+			}
+			OperationNode *parent = (OperationNode *)rel->from;
+			BLI_assert(parent->custom_flags > 0);
+			if (--parent->custom_flags == 0) {
+				queue.push_back(parent);
+			}
+		}
+	}
+}
+
+}  // namespace DEG
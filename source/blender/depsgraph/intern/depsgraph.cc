@@ -208,6 +208,23 @@ Relation *Depsgraph::check_nodes_connected(const Node *from,
                                            const Node *to,
                                            const char *description)
 {
+	/* Iterate over the shorter list of relations. Some nodes (animation,
+	 * copy-on-write of shared datablocks) have thousands of relations, and
+	 * scanning all of them for every added relation makes graph construction
+	 * quadratic. */
+	if (to->inlinks.size() < from->outlinks.size()) {
+		for (Relation *rel : to->inlinks) {
+			BLI_assert(rel->to == to);
+			if (rel->from != from) {
+				continue;
+			}
+			if (description != NULL && !STREQ(rel->name, description)) {
+				continue;
+			}
+			return rel;
+		}
+		return NULL;
+	}
 	for (Relation *rel : from->outlinks) {
 		BLI_assert(rel->from == from);
 		if (rel->to != to) {
@@ -337,6 +354,17 @@ void DEG_graph_free(Depsgraph *graph)
 	OBJECT_GUARDED_DELETE(deg_depsgraph, Depsgraph);
 }
 
+void DEG_graph_replace_owners(Depsgraph *depsgraph,
+                              Scene *scene,
+                              ViewLayer *view_layer)
+{
+	DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(depsgraph);
+	deg_graph->scene = scene;
+	deg_graph->view_layer = view_layer;
+	deg_graph->scene_cow = NULL;
+	deg_graph->need_update = true;
+}
+
 bool DEG_is_active(const struct Depsgraph *depsgraph)
 {
 	if (depsgraph == NULL) {
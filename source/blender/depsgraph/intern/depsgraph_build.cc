@@ -48,6 +48,7 @@ extern "C" {
 #include "builder/deg_builder.h"
 #include "builder/deg_builder_cycle.h"
 #include "builder/deg_builder_nodes.h"
+#include "builder/deg_builder_priority.h"
 #include "builder/deg_builder_relations.h"
 #include "builder/deg_builder_transitive.h"
 
@@ -243,8 +244,10 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
                                       Scene *scene,
                                       ViewLayer *view_layer)
 {
-	double start_time = 0.0;
-	if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
+	const bool do_time_debug =
+	        (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) != 0;
+	double start_time = 0.0, nodes_time = 0.0, relations_time = 0.0;
+	if (do_time_debug) {
 		start_time = PIL_check_seconds_timer();
 	}
 	DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
@@ -259,12 +262,18 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
 	                               view_layer,
 	                               DEG::DEG_ID_LINKED_DIRECTLY);
 	node_builder.end_build();
+	if (do_time_debug) {
+		nodes_time = PIL_check_seconds_timer();
+	}
 	/* Hook up relationships between operations - to determine evaluation
 	 * order. */
 	DEG::DepsgraphRelationBuilder relation_builder(bmain, deg_graph);
 	relation_builder.begin_build();
 	relation_builder.build_view_layer(scene, view_layer);
 	relation_builder.build_copy_on_write_relations();
+	if (do_time_debug) {
+		relations_time = PIL_check_seconds_timer();
+	}
 	/* Detect and solve cycles. */
 	DEG::deg_graph_detect_cycles(deg_graph);
 	/* Simplify the graph by removing redundant relations (to optimize
@@ -274,6 +283,8 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
 	if (G.debug_value == 799) {
 		DEG::deg_graph_transitive_reduction(deg_graph);
 	}
+	/* Order operations for scheduling, once relations are final. */
+	DEG::deg_graph_calculate_priorities(deg_graph);
 	/* Store pointers to commonly used valuated datablocks. */
 	deg_graph->scene_cow = (Scene *)deg_graph->get_cow_id(&deg_graph->scene->id);
 	/* Flush visibility layer and re-schedule nodes for update. */
@@ -288,9 +299,19 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
 	/* Relations are up to date. */
 	deg_graph->need_update = false;
 	/* Finish statistics. */
-	if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-		printf("Depsgraph built in %f seconds.\n",
-		       PIL_check_seconds_timer() - start_time);
+	if (do_time_debug) {
+		const double end_time = PIL_check_seconds_timer();
+		size_t num_operations, num_relations;
+		DEG_stats_simple(graph, NULL, &num_operations, &num_relations);
+		printf("Depsgraph built in %f seconds "
+		       "(nodes %f, relations %f, finalize %f; "
+		       "%d operations, %d relations).\n",
+		       end_time - start_time,
+		       nodes_time - start_time,
+		       relations_time - nodes_time,
+		       end_time - relations_time,
+		       (int)num_operations,
+		       (int)num_relations);
 	}
 }
 
@@ -312,6 +333,13 @@ void DEG_graph_tag_relations_update(Depsgraph *graph)
 	}
 }
 
+/* Check whether relations of the specified graph are to be updated. */
+bool DEG_graph_relations_need_update(const Depsgraph *graph)
+{
+	const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+	return deg_graph->need_update;
+}
+
 /* Create or update relations in the specified graph. */
 void DEG_graph_relations_update(Depsgraph *graph,
                                 Main *bmain,
@@ -571,6 +571,8 @@ NodeType geometry_tag_to_component(const ID *id)
 
 void id_tag_update(Main *bmain, ID *id, int flag, eUpdateSource update_source)
 {
+	/* Remember changed data-blocks for global undo, see BLO_read_from_memfile(). */
+	id->recalc_after_undo_push |= (flag != 0) ? flag : ID_RECALC_ALL;
 	graph_id_tag_update(bmain, NULL, id, flag, update_source);
 	LISTBASE_FOREACH (Scene *, scene, &bmain->scenes) {
 		LISTBASE_FOREACH (ViewLayer *, view_layer, &scene->view_layers) {
@@ -163,6 +163,12 @@ static void calculate_pending_parents(Depsgraph *graph)
 	                        &settings);
 }
 
+BLI_INLINE bool need_evaluate_operation(const OperationNode *op_node)
+{
+	return check_operation_node_visible((OperationNode *)op_node) &&
+	       (op_node->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0;
+}
+
 static void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 {
 	const bool do_stats = state->do_stats;
@@ -233,9 +239,26 @@ static void schedule_node(TaskPool *pool, Depsgraph *graph,
 	}
 }
 
+static bool operation_node_priority_compare(const OperationNode *a,
+                                            const OperationNode *b)
+{
+	return a->priority > b->priority;
+}
+
 static void schedule_graph(TaskPool *pool, Depsgraph *graph)
 {
+	/* Schedule operations which are ready to be evaluated in the order of
+	 * their priority, so the longest chains of operations start first. */
+	vector<OperationNode *> ready_nodes;
 	for (OperationNode *node : graph->operations) {
+		if (node->num_links_pending == 0 && need_evaluate_operation(node)) {
+			ready_nodes.push_back(node);
+		}
+	}
+	std::stable_sort(ready_nodes.begin(),
+	                 ready_nodes.end(),
+	                 operation_node_priority_compare);
+	for (OperationNode *node : ready_nodes) {
 		schedule_node(pool, graph, node, false, 0);
 	}
 }
@@ -139,6 +139,7 @@ const char *operationCodeAsString(OperationCode opcode)
 }
 
 OperationNode::OperationNode() :
+    priority(0.0),
     name_tag(-1),
     flag(0)
 {
@@ -239,6 +239,12 @@ struct OperationNode : public Node {
 	uint32_t num_links_pending;
 	bool scheduled;
 
+	/* Estimated cost of the longest chain of operations which starts at this
+	 * operation, calculated when relations are built.
+	 * Operations with higher value are on the critical path of the graph and
+	 * are scheduled first. */
+	double priority;
+
 	/* Identifier for the operation being performed. */
 	OperationCode opcode;
 	int name_tag;
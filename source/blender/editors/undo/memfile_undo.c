@@ -20,13 +20,17 @@
  * Wrapper between 'ED_undo.h' and 'BKE_undo_system.h' API's.
  */
 
+#include <stdio.h>
+
 #include "BLI_utildefines.h"
+#include "BLI_string.h"
 #include "BLI_sys_types.h"
 
 #include "DNA_object_enums.h"
 
 #include "BKE_blender_undo.h"
 #include "BKE_context.h"
+#include "BKE_global.h"
 #include "BKE_undo_system.h"
 
 #include "WM_api.h"
@@ -79,6 +83,17 @@ static bool memfile_undosys_step_encode(struct bContext *UNUSED(C), struct Main
 	us->data = BKE_memfile_undo_encode(bmain, us_prev ? us_prev->data : NULL);
 	us->step.data_size = us->data->undo_size;
 
+	if (G.debug & G_DEBUG) {
+		MemFileStats stats;
+		char size_step[15], size_unique[15], size_total[15];
+		BLO_memfile_stats_get(&stats);
+		BLI_str_format_byte_unit(size_step, (long long int)us->data->undo_size, true);
+		BLI_str_format_byte_unit(size_unique, (long long int)stats.size_unique, true);
+		BLI_str_format_byte_unit(size_total, (long long int)stats.size_total, true);
+		printf("%s: step adds %s, all steps use %s in %zu buffers (%s without de-duplication)\n",
+		       __func__, size_step, size_unique, stats.buffers_num, size_total);
+	}
+
 	return true;
 }
 
@@ -87,7 +102,10 @@ static void memfile_undosys_step_decode(struct bContext *C, struct Main *bmain,
 	ED_editors_exit(bmain, false);
 
 	MemFileUndoStep *us = (MemFileUndoStep *)us_p;
-	BKE_memfile_undo_decode(us->data, C);
+	/* Memfile of the current state, data-blocks unchanged since can be kept. */
+	UndoStack *ustack = ED_undo_stack_get();
+	MemFileUndoStep *us_current = (MemFileUndoStep *)ustack->step_active_memfile;
+	BKE_memfile_undo_decode(us->data, us_current ? us_current->data : NULL, C);
 
 	for (UndoStep *us_iter = us_p->next; us_iter; us_iter = us_iter->next) {
 		if (BKE_UNDOSYS_TYPE_IS_MEMFILE_SKIP(us_iter->type)) {
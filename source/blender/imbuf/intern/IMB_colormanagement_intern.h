@@ -111,4 +111,14 @@ void colorspace_set_default_role(char *colorspace, int size, int role);
 void colormanage_imbuf_set_default_spaces(struct ImBuf *ibuf);
 void colormanage_imbuf_make_linear(struct ImBuf *ibuf, const char *from_colorspace);
 
+/* ** Display transforms baked into a 3D LUT ** */
+
+struct ColormanageLut3D;
+
+/* NULL when the transform can't be baked within tolerance of the exact processor. */
+struct ColormanageLut3D *colormanage_lut3d_bake(struct OCIO_ConstProcessorRcPtr *processor);
+void colormanage_lut3d_apply(const struct ColormanageLut3D *lut, float *buffer, int width, int height,
+                             int channels, bool predivide);
+void colormanage_lut3d_free(struct ColormanageLut3D *lut);
+
 #endif  /* __IMB_COLORMANAGEMENT_INTERN_H__ */
@@ -96,10 +96,37 @@ static float imbuf_linear_srgb_to_xyz[3][3] = {{0.0f}};
  */
 static pthread_mutex_t processor_lock = BLI_MUTEX_INITIALIZER;
 
+/* Display transforms baked into 3D LUTs for byte display buffers, see colormanagement_lut.c.
+ * Entries are kept between redraws, so the transform is only baked again when the
+ * view settings change.
+ */
+#define DISPLAY_LUT_CACHE_SIZE 4
+/* Only bake for large buffers, for smaller ones the exact transform is cheaper. */
+#define DISPLAY_LUT_MIN_PIXELS (1024 * 1024)
+
+typedef struct DisplayLutCacheEntry {
+	struct DisplayLutCacheEntry *next, *prev;
+
+	char look[MAX_COLORSPACE_NAME];
+	char view[MAX_COLORSPACE_NAME];
+	char display[MAX_COLORSPACE_NAME];
+	float exposure, gamma;
+
+	/* NULL when the transform couldn't be baked within tolerance. */
+	struct ColormanageLut3D *lut;
+	/* Number of processors using the LUT, entries in use are not freed. */
+	int users;
+} DisplayLutCacheEntry;
+
+static ListBase global_display_luts = {NULL, NULL};
+static pthread_mutex_t display_lut_lock = BLI_MUTEX_INITIALIZER;
+
 typedef struct ColormanageProcessor {
 	OCIO_ConstProcessorRcPtr *processor;
 	CurveMapping *curve_mapping;
 	bool is_data_result;
+	/* Baked display transform, used instead of the processor when set. */
+	DisplayLutCacheEntry *display_lut;
 } ColormanageProcessor;
 
 static struct global_glsl_state {
@@ -560,6 +587,8 @@ static void colormanage_load_config(OCIO_ConstConfigRcPtr *config)
 	invert_m3_m3(imbuf_linear_srgb_to_xyz, imbuf_xyz_to_linear_srgb);
 }
 
+static void display_lut_cache_free(void);
+
 static void colormanage_free_config(void)
 {
 	ColorSpace *colorspace;
@@ -614,6 +643,9 @@ static void colormanage_free_config(void)
 	BLI_freelistN(&global_looks);
 	global_tot_looks = 0;
 
+	/* free baked display transforms */
+	display_lut_cache_free();
+
 	OCIO_exit();
 }
 
@@ -941,6 +973,101 @@ static OCIO_ConstProcessorRcPtr *display_to_scene_linear_processor(ColorManagedD
 	return (OCIO_ConstProcessorRcPtr *) display->to_scene_linear;
 }
 
+/* Free least recently used entries which are not in use until the cache fits. */
+static void display_lut_cache_trim(void)
+{
+	DisplayLutCacheEntry *entry, *entry_prev;
+	int tot = BLI_listbase_count(&global_display_luts);
+
+	for (entry = global_display_luts.last; entry && tot > DISPLAY_LUT_CACHE_SIZE; entry = entry_prev) {
+		entry_prev = entry->prev;
+
+		if (entry->users == 0) {
+			if (entry->lut)
+				colormanage_lut3d_free(entry->lut);
+
+			BLI_freelinkN(&global_display_luts, entry);
+			tot--;
+		}
+	}
+}
+
+static void display_lut_cache_free(void)
+{
+	DisplayLutCacheEntry *entry;
+
+	for (entry = global_display_luts.first; entry; entry = entry->next) {
+		BLI_assert(entry->users == 0);
+
+		if (entry->lut)
+			colormanage_lut3d_free(entry->lut);
+	}
+
+	BLI_freelistN(&global_display_luts);
+}
+
+/* Get the baked display transform of the given settings, baking it from the processor
+ * when it's not in the cache yet and allow_bake is set.
+ * Returns NULL when there is no LUT, otherwise it's released with the processor.
+ */
+static DisplayLutCacheEntry *display_lut_acquire(OCIO_ConstProcessorRcPtr *processor,
+                                                 const ColorManagedViewSettings *view_settings,
+                                                 const ColorManagedDisplaySettings *display_settings,
+                                                 bool allow_bake)
+{
+	DisplayLutCacheEntry *entry;
+
+	BLI_mutex_lock(&display_lut_lock);
+
+	for (entry = global_display_luts.first; entry; entry = entry->next) {
+		if (STREQ(entry->look, view_settings->look) &&
+		    STREQ(entry->view, view_settings->view_transform) &&
+		    STREQ(entry->display, display_settings->display_device) &&
+		    entry->exposure == view_settings->exposure &&
+		    entry->gamma == view_settings->gamma)
+		{
+			break;
+		}
+	}
+
+	if (entry) {
+		/* move to the front, the least recently used entries are freed first */
+		BLI_remlink(&global_display_luts, entry);
+		BLI_addhead(&global_display_luts, entry);
+	}
+	else if (allow_bake) {
+		entry = MEM_callocN(sizeof(DisplayLutCacheEntry), "display lut cache entry");
+
+		BLI_strncpy(entry->look, view_settings->look, sizeof(entry->look));
+		BLI_strncpy(entry->view, view_settings->view_transform, sizeof(entry->view));
+		BLI_strncpy(entry->display, display_settings->display_device, sizeof(entry->display));
+		entry->exposure = view_settings->exposure;
+		entry->gamma = view_settings->gamma;
+		entry->lut = colormanage_lut3d_bake((struct OCIO_ConstProcessorRcPtr *) processor);
+
+		BLI_addhead(&global_display_luts, entry);
+		display_lut_cache_trim();
+	}
+
+	if (entry && entry->lut) {
+		entry->users++;
+	}
+	else {
+		entry = NULL;
+	}
+
+	BLI_mutex_unlock(&display_lut_lock);
+
+	return entry;
+}
+
+static void display_lut_release(DisplayLutCacheEntry *entry)
+{
+	BLI_mutex_lock(&display_lut_lock);
+	entry->users--;
+	BLI_mutex_unlock(&display_lut_lock);
+}
+
 void IMB_colormanagement_init_default_view_settings(
         ColorManagedViewSettings *view_settings,
         const ColorManagedDisplaySettings *display_settings)
@@ -1574,6 +1701,15 @@ static void colormanage_display_buffer_process_ex(ImBuf *ibuf, float *display_bu
 	if (skip_transform == false)
 		cm_processor = IMB_colormanagement_display_processor_new(view_settings, display_settings);
 
+	/* byte display buffers don't need the precision of the exact transform,
+	 * use the baked one when possible */
+	if (cm_processor && cm_processor->processor && display_buffer == NULL && ibuf->channels >= 3 &&
+	    (view_settings->flag & COLORMANAGE_VIEW_USE_CURVES) == 0)
+	{
+		cm_processor->display_lut = display_lut_acquire(cm_processor->processor, view_settings, display_settings,
+		                                                (size_t)ibuf->x * ibuf->y >= DISPLAY_LUT_MIN_PIXELS);
+	}
+
 	display_buffer_apply_threaded(ibuf, ibuf->rect_float, (unsigned char *) ibuf->rect,
 	                              display_buffer, display_buffer_byte, cm_processor);
 
@@ -3352,7 +3488,10 @@ void IMB_colormanagement_processor_apply(ColormanageProcessor *cm_processor, flo
 		}
 	}
 
-	if (cm_processor->processor && channels >= 3) {
+	if (cm_processor->display_lut && channels >= 3) {
+		colormanage_lut3d_apply(cm_processor->display_lut->lut, buffer, width, height, channels, predivide);
+	}
+	else if (cm_processor->processor && channels >= 3) {
 		OCIO_PackedImageDesc *img;
 
 		/* apply OCIO processor */
@@ -3395,6 +3534,8 @@ void IMB_colormanagement_processor_free(ColormanageProcessor *cm_processor)
 		curvemapping_free(cm_processor->curve_mapping);
 	if (cm_processor->processor)
 		OCIO_processorRelease(cm_processor->processor);
+	if (cm_processor->display_lut)
+		display_lut_release(cm_processor->display_lut);
 
 	MEM_freeN(cm_processor);
 }
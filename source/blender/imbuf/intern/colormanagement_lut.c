@@ -0,0 +1,450 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2019 by Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup imbuf
+ *
+ * Display transforms baked into a 3D LUT.
+ *
+ * Evaluating the full OCIO display transform for every pixel of every redraw is
+ * expensive, so for byte display buffers the transform is sampled on a grid once
+ * and pixels are evaluated with tetrahedral interpolation.
+ *
+ * Scene linear values are unbounded, so the grid is laid out on a shaper: input is
+ * clamped to [0, domain_max] and mapped to grid coordinates through the bits of the
+ * float, which is a piecewise linear approximation of log2 that is cheap to evaluate
+ * and exactly invertible. domain_max is where the transform of a gray ramp saturates,
+ * the offset added before the shaper is chosen to fit the transform along the gray axis.
+ *
+ * Every baked LUT is compared against the exact processor on random samples, when
+ * it isn't within LUT3D_TOLERANCE the transform is not baked and the exact path is used.
+ */
+
+#include <float.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math_base.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_colormanagement_intern.h"
+
+#include <ocio_capi.h>
+
+/* Number of grid points along every axis. */
+#define LUT3D_SIZE 65
+
+/* Largest difference with the exact transform in display space, which is less than
+ * one step in the byte display buffers the LUT is used for. */
+#define LUT3D_TOLERANCE (1.0f / 255.0f)
+#define LUT3D_VALIDATE_SAMPLES 8192
+
+/* Gray ramp used to find where the transform saturates, in powers of two. */
+#define LUT3D_PROBE_MIN_EXP -8
+#define LUT3D_PROBE_MAX_EXP 16
+
+/* Range of shaper offsets relative to the domain, in negative powers of two. */
+#define LUT3D_OFFSET_MIN_EXP 4
+#define LUT3D_OFFSET_MAX_EXP 28
+
+typedef struct ColormanageLut3D {
+	/* Shaper: input is clamped to [0, domain_max], offset is added so zero has a
+	 * finite position and the bits of the result are scaled to grid coordinates. */
+	float domain_max;
+	float offset;
+	int bits_min;
+	float scale;
+
+	/* LUT3D_SIZE^3 RGB entries padded to 4 floats, blue varies fastest. */
+	float *table;
+} ColormanageLut3D;
+
+BLI_INLINE int lut3d_float_as_int(float f)
+{
+	union { float f; int i; } u;
+	u.f = f;
+	return u.i;
+}
+
+BLI_INLINE float lut3d_int_as_float(int i)
+{
+	union { float f; int i; } u;
+	u.i = i;
+	return u.f;
+}
+
+static void lut3d_shaper_init(ColormanageLut3D *lut, float domain_max, float offset)
+{
+	lut->domain_max = domain_max;
+	lut->offset = offset;
+	lut->bits_min = lut3d_float_as_int(offset);
+	lut->scale = (float)(LUT3D_SIZE - 1) / (float)(lut3d_float_as_int(domain_max + offset) - lut->bits_min);
+}
+
+/* Input value at grid coordinate t, inverse of the shaper. */
+static float lut3d_shaper_inverse(const ColormanageLut3D *lut, float t)
+{
+	return lut3d_int_as_float(lut->bits_min + (int)(t / lut->scale + 0.5f)) - lut->offset;
+}
+
+BLI_INLINE void lut3d_evaluate(const ColormanageLut3D *lut, float pixel[3])
+{
+	const int stride_b = 4;
+	const int stride_g = LUT3D_SIZE * stride_b;
+	const int stride_r = LUT3D_SIZE * stride_g;
+	int index[4];
+	float fr, fg, fb, w1, w2, w3;
+	int offset1, offset2;
+
+#ifdef __SSE2__
+	/* max returns the second operand for NaN, so NaN is clamped to zero */
+	__m128 value = _mm_set_ps(0.0f, pixel[2], pixel[1], pixel[0]);
+	value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(lut->domain_max));
+	value = _mm_add_ps(value, _mm_set1_ps(lut->offset));
+
+	__m128i bits = _mm_sub_epi32(_mm_castps_si128(value), _mm_set1_epi32(lut->bits_min));
+	__m128 coord = _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(lut->scale));
+	__m128 cell = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(coord)), _mm_set1_ps((float)(LUT3D_SIZE - 2)));
+	float frac[4];
+
+	_mm_storeu_si128((__m128i *)index, _mm_cvttps_epi32(cell));
+	_mm_storeu_ps(frac, _mm_sub_ps(coord, cell));
+	fr = frac[0];
+	fg = frac[1];
+	fb = frac[2];
+#else
+	float frac[3];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		float value = pixel[i] > 0.0f ? pixel[i] : 0.0f;
+		float coord;
+
+		value = min_ff(value, lut->domain_max) + lut->offset;
+		coord = (float)(lut3d_float_as_int(value) - lut->bits_min) * lut->scale;
+		index[i] = min_ii((int)coord, LUT3D_SIZE - 2);
+		frac[i] = coord - (float)index[i];
+	}
+	fr = frac[0];
+	fg = frac[1];
+	fb = frac[2];
+#endif
+
+	/* tetrahedral interpolation, walk from the lowest to the highest corner of the cell
+	 * along the axes in order of decreasing fraction */
+	if (fr > fg) {
+		if (fg > fb) {
+			offset1 = stride_r; offset2 = stride_r + stride_g;
+			w1 = fr; w2 = fg; w3 = fb;
+		}
+		else if (fr > fb) {
+			offset1 = stride_r; offset2 = stride_r + stride_b;
+			w1 = fr; w2 = fb; w3 = fg;
+		}
+		else {
+			offset1 = stride_b; offset2 = stride_r + stride_b;
+			w1 = fb; w2 = fr; w3 = fg;
+		}
+	}
+	else {
+		if (fb > fg) {
+			offset1 = stride_b; offset2 = stride_g + stride_b;
+			w1 = fb; w2 = fg; w3 = fr;
+		}
+		else if (fb > fr) {
+			offset1 = stride_g; offset2 = stride_g + stride_b;
+			w1 = fg; w2 = fb; w3 = fr;
+		}
+		else {
+			offset1 = stride_g; offset2 = stride_r + stride_g;
+			w1 = fg; w2 = fr; w3 = fb;
+		}
+	}
+
+	{
+		const float *c0 = lut->table + (index[0] * stride_r + index[1] * stride_g + index[2] * stride_b);
+		const float *c1 = c0 + offset1;
+		const float *c2 = c0 + offset2;
+		const float *c3 = c0 + (stride_r + stride_g + stride_b);
+#ifdef __SSE2__
+		__m128 v0 = _mm_loadu_ps(c0);
+		__m128 v1 = _mm_loadu_ps(c1);
+		__m128 v2 = _mm_loadu_ps(c2);
+		__m128 v3 = _mm_loadu_ps(c3);
+		__m128 result = _mm_add_ps(v0, _mm_mul_ps(_mm_set1_ps(w1), _mm_sub_ps(v1, v0)));
+		float rgb[4];
+
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(w2), _mm_sub_ps(v2, v1)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(w3), _mm_sub_ps(v3, v2)));
+
+		/* don't write the fourth lane, it can be the next pixel of a 3 channel buffer */
+		_mm_storeu_ps(rgb, result);
+		copy_v3_v3(pixel, rgb);
+#else
+		for (i = 0; i < 3; i++) {
+			pixel[i] = c0[i] + w1 * (c1[i] - c0[i]) + w2 * (c2[i] - c1[i]) + w3 * (c3[i] - c2[i]);
+		}
+#endif
+	}
+}
+
+/* Smallest power of two input where the gray ramp reaches the value it has at the
+ * end of the probed range, larger values are clamped to it. */
+static float lut3d_probe_domain(OCIO_ConstProcessorRcPtr *processor)
+{
+	const int tot = LUT3D_PROBE_MAX_EXP - LUT3D_PROBE_MIN_EXP + 1;
+	float pixels[LUT3D_PROBE_MAX_EXP - LUT3D_PROBE_MIN_EXP + 1][4];
+	OCIO_PackedImageDesc *img;
+	int i, c;
+
+	for (i = 0; i < tot; i++) {
+		float value = ldexpf(1.0f, LUT3D_PROBE_MIN_EXP + i);
+		copy_v3_fl(pixels[i], value);
+		pixels[i][3] = 1.0f;
+	}
+
+	img = OCIO_createOCIO_PackedImageDesc((float *)pixels, tot, 1, 4, sizeof(float),
+	                                      4 * sizeof(float), (size_t)tot * 4 * sizeof(float));
+	OCIO_processorApply(processor, img);
+	OCIO_PackedImageDescRelease(img);
+
+	for (i = 0; i < tot; i++) {
+		bool saturated = true;
+
+		for (c = 0; c < 3; c++) {
+			if (fabsf(clamp_f(pixels[i][c], 0.0f, 1.0f) - clamp_f(pixels[tot - 1][c], 0.0f, 1.0f)) > 1e-5f) {
+				saturated = false;
+				break;
+			}
+		}
+
+		if (saturated) {
+			return ldexpf(1.0f, LUT3D_PROBE_MIN_EXP + i);
+		}
+	}
+
+	return ldexpf(1.0f, LUT3D_PROBE_MAX_EXP);
+}
+
+/* Choose the shaper offset with the smallest interpolation error along the gray axis.
+ * A small offset spends more of the grid on dark values which suits log-like transforms,
+ * a large one suits gamma curves. */
+static void lut3d_shaper_choose(ColormanageLut3D *lut, OCIO_ConstProcessorRcPtr *processor, float domain_max)
+{
+	const int tot = 2 * LUT3D_SIZE - 1;
+	float pixels[2 * LUT3D_SIZE - 1][4];
+	float best_offset = 0.0f, best_error = FLT_MAX;
+	int exp, i, c;
+
+	for (exp = LUT3D_OFFSET_MIN_EXP; exp <= LUT3D_OFFSET_MAX_EXP; exp += 4) {
+		OCIO_PackedImageDesc *img;
+		float error = 0.0f;
+
+		/* grid points at even, cell centers at odd indices */
+		lut3d_shaper_init(lut, domain_max, ldexpf(domain_max, -exp));
+		for (i = 0; i < tot; i++) {
+			copy_v3_fl(pixels[i], lut3d_shaper_inverse(lut, 0.5f * (float)i));
+			pixels[i][3] = 1.0f;
+		}
+
+		img = OCIO_createOCIO_PackedImageDesc((float *)pixels, tot, 1, 4, sizeof(float),
+		                                      4 * sizeof(float), (size_t)tot * 4 * sizeof(float));
+		OCIO_processorApply(processor, img);
+		OCIO_PackedImageDescRelease(img);
+
+		for (i = 1; i < tot; i += 2) {
+			for (c = 0; c < 3; c++) {
+				const float a = clamp_f(pixels[i - 1][c], 0.0f, 1.0f);
+				const float b = clamp_f(pixels[i + 1][c], 0.0f, 1.0f);
+				const float mid = clamp_f(pixels[i][c], 0.0f, 1.0f);
+				error = max_ff(error, fabsf(mid - 0.5f * (a + b)));
+			}
+		}
+
+		if (error < best_error) {
+			best_error = error;
+			best_offset = ldexpf(domain_max, -exp);
+		}
+	}
+
+	lut3d_shaper_init(lut, domain_max, best_offset);
+}
+
+typedef struct Lut3DBakeData {
+	OCIO_ConstProcessorRcPtr *processor;
+	ColormanageLut3D *lut;
+	float grid[LUT3D_SIZE];
+} Lut3DBakeData;
+
+/* Every scanline holds the blue axis of one red and green grid coordinate. */
+static void lut3d_bake_scanlines(void *data_v, int start_scanline, int num_scanlines)
+{
+	Lut3DBakeData *data = (Lut3DBakeData *)data_v;
+	float *table = data->lut->table + (size_t)start_scanline * LUT3D_SIZE * 4;
+	OCIO_PackedImageDesc *img;
+	int scanline, b;
+
+	for (scanline = start_scanline; scanline < start_scanline + num_scanlines; scanline++) {
+		const int r = scanline / LUT3D_SIZE;
+		const int g = scanline % LUT3D_SIZE;
+		float *entry = data->lut->table + (size_t)scanline * LUT3D_SIZE * 4;
+
+		for (b = 0; b < LUT3D_SIZE; b++, entry += 4) {
+			entry[0] = data->grid[r];
+			entry[1] = data->grid[g];
+			entry[2] = data->grid[b];
+			entry[3] = 1.0f;
+		}
+	}
+
+	img = OCIO_createOCIO_PackedImageDesc(table, LUT3D_SIZE, num_scanlines, 4, sizeof(float),
+	                                      4 * sizeof(float), LUT3D_SIZE * 4 * sizeof(float));
+	OCIO_processorApply(data->processor, img);
+	OCIO_PackedImageDescRelease(img);
+}
+
+static void lut3d_bake_table(ColormanageLut3D *lut, OCIO_ConstProcessorRcPtr *processor)
+{
+	Lut3DBakeData data;
+	int i;
+
+	data.processor = processor;
+	data.lut = lut;
+	for (i = 0; i < LUT3D_SIZE; i++) {
+		data.grid[i] = lut3d_shaper_inverse(lut, (float)i);
+	}
+
+	IMB_processor_apply_threaded_scanlines(LUT3D_SIZE * LUT3D_SIZE, lut3d_bake_scanlines, &data);
+}
+
+/* Compare the LUT with the exact transform on random samples distributed along the
+ * shaper, with some samples outside of the domain to check clamping is harmless. */
+static bool lut3d_validate(const ColormanageLut3D *lut, OCIO_ConstProcessorRcPtr *processor)
+{
+	float *exact = MEM_mallocN(sizeof(float) * 4 * LUT3D_VALIDATE_SAMPLES, "lut3d validate exact");
+	float *baked = MEM_mallocN(sizeof(float) * 4 * LUT3D_VALIDATE_SAMPLES, "lut3d validate baked");
+	RNG *rng = BLI_rng_new(0);
+	OCIO_PackedImageDesc *img;
+	bool valid = true;
+	int i, c;
+
+	for (i = 0; i < LUT3D_VALIDATE_SAMPLES; i++) {
+		for (c = 0; c < 3; c++) {
+			const int kind = BLI_rng_get_int(rng) % 16;
+			const float u = BLI_rng_get_float(rng);
+
+			if (kind == 0) {
+				exact[i * 4 + c] = -0.1f * u * lut->domain_max;
+			}
+			else if (kind == 1) {
+				exact[i * 4 + c] = (1.0f + 3.0f * u) * lut->domain_max;
+			}
+			else {
+				exact[i * 4 + c] = lut3d_shaper_inverse(lut, u * (float)(LUT3D_SIZE - 1));
+			}
+		}
+		exact[i * 4 + 3] = 1.0f;
+	}
+	BLI_rng_free(rng);
+
+	memcpy(baked, exact, sizeof(float) * 4 * LUT3D_VALIDATE_SAMPLES);
+	colormanage_lut3d_apply(lut, baked, LUT3D_VALIDATE_SAMPLES, 1, 4, false);
+
+	img = OCIO_createOCIO_PackedImageDesc(exact, LUT3D_VALIDATE_SAMPLES, 1, 4, sizeof(float),
+	                                      4 * sizeof(float), LUT3D_VALIDATE_SAMPLES * 4 * sizeof(float));
+	OCIO_processorApply(processor, img);
+	OCIO_PackedImageDescRelease(img);
+
+	for (i = 0; i < LUT3D_VALIDATE_SAMPLES && valid; i++) {
+		for (c = 0; c < 3; c++) {
+			/* byte display buffers are clamped, differences outside [0, 1] are invisible */
+			const float a = clamp_f(exact[i * 4 + c], 0.0f, 1.0f);
+			const float b = clamp_f(baked[i * 4 + c], 0.0f, 1.0f);
+
+			if (!(fabsf(a - b) <= LUT3D_TOLERANCE)) {
+				valid = false;
+				break;
+			}
+		}
+	}
+
+	MEM_freeN(exact);
+	MEM_freeN(baked);
+
+	return valid;
+}
+
+ColormanageLut3D *colormanage_lut3d_bake(struct OCIO_ConstProcessorRcPtr *processor_v)
+{
+	OCIO_ConstProcessorRcPtr *processor = (OCIO_ConstProcessorRcPtr *) processor_v;
+	ColormanageLut3D *lut;
+
+	lut = MEM_callocN(sizeof(ColormanageLut3D), "colormanage lut3d");
+	lut->table = MEM_mallocN_aligned(sizeof(float) * 4 * LUT3D_SIZE * LUT3D_SIZE * LUT3D_SIZE, 16,
+	                                 "colormanage lut3d table");
+
+	lut3d_shaper_choose(lut, processor, lut3d_probe_domain(processor));
+	lut3d_bake_table(lut, processor);
+
+	if (!lut3d_validate(lut, processor)) {
+		colormanage_lut3d_free(lut);
+		return NULL;
+	}
+
+	return lut;
+}
+
+void colormanage_lut3d_apply(const ColormanageLut3D *lut, float *buffer, int width, int height,
+                             int channels, bool predivide)
+{
+	const size_t tot = (size_t)width * height;
+	float *pixel = buffer;
+	size_t i;
+
+	BLI_assert(channels >= 3);
+
+	for (i = 0; i < tot; i++, pixel += channels) {
+		/* same as OCIO_processorApply_predivide */
+		if (predivide && channels == 4 && pixel[3] != 1.0f && pixel[3] != 0.0f) {
+			const float alpha = pixel[3];
+
+			mul_v3_fl(pixel, 1.0f / alpha);
+			lut3d_evaluate(lut, pixel);
+			mul_v3_fl(pixel, alpha);
+		}
+		else {
+			lut3d_evaluate(lut, pixel);
+		}
+	}
+}
+
+void colormanage_lut3d_free(ColormanageLut3D *lut)
+{
+	MEM_freeN(lut->table);
+	MEM_freeN(lut);
+}
@@ -30,6 +30,7 @@
 #include "BLI_string.h"
 #include "BLI_fileops.h"
 #include "BLI_ghash.h"
+#include "BLI_threads.h"
 
 #include "IMB_indexer.h"
 #include "IMB_anim.h"
@@ -442,6 +443,9 @@ typedef struct IndexBuildContext {
 
 #ifdef WITH_FFMPEG
 
+/* Number of decoded frames a proxy output may fall behind before decoding waits for it. */
+#define PROXY_OUTPUT_MAX_QUEUED_FRAMES 8
+
 struct proxy_output_ctx {
 	AVFormatContext *of;
 	AVStream *st;
@@ -453,6 +457,13 @@ struct proxy_output_ctx {
 	int proxy_size;
 	int orig_height;
 	struct anim *anim;
+
+	/* Every output scales and encodes in its own thread, fed with
+	 * references to the decoded frames through this queue. */
+	ThreadQueue *queued_frames;
+	ThreadMutex queue_mutex;
+	ThreadCondition queue_cond;
+	int num_queued_frames;
 };
 
 // work around stupid swscaler 16 bytes alignment bug...
@@ -573,6 +584,10 @@ static struct proxy_output_ctx *alloc_proxy_output_ffmpeg(
 		return 0;
 	}
 
+	rv->queued_frames = BLI_thread_queue_init();
+	BLI_mutex_init(&rv->queue_mutex);
+	BLI_condition_init(&rv->queue_cond);
+
 	return rv;
 }
 
@@ -638,6 +653,54 @@ static int add_to_proxy_output_ffmpeg(
 	}
 }
 
+/* runs in its own thread, until the queue is told not to wait for more frames */
+static void *proxy_output_thread_ffmpeg(void *ctx_v)
+{
+	struct proxy_output_ctx *ctx = ctx_v;
+	AVFrame *frame;
+
+	while ((frame = BLI_thread_queue_pop(ctx->queued_frames))) {
+		add_to_proxy_output_ffmpeg(ctx, frame);
+		av_frame_free(&frame);
+
+		BLI_mutex_lock(&ctx->queue_mutex);
+		ctx->num_queued_frames--;
+		BLI_condition_notify_one(&ctx->queue_cond);
+		BLI_mutex_unlock(&ctx->queue_mutex);
+	}
+
+	return NULL;
+}
+
+static void queue_proxy_output_ffmpeg(struct proxy_output_ctx *ctx, AVFrame *frame)
+{
+	AVFrame *frame_ref;
+
+	if (!ctx) {
+		return;
+	}
+
+	BLI_mutex_lock(&ctx->queue_mutex);
+	while (ctx->num_queued_frames >= PROXY_OUTPUT_MAX_QUEUED_FRAMES) {
+		BLI_condition_wait(&ctx->queue_cond, &ctx->queue_mutex);
+	}
+	BLI_mutex_unlock(&ctx->queue_mutex);
+
+	/* only references the decoded picture, the decoder allocates a new one for the next frame */
+	frame_ref = av_frame_clone(frame);
+	if (!frame_ref) {
+		fprintf(stderr, "Couldn't reference proxy frame %d for '%s'\n",
+		        ctx->cfra, ctx->of->filename);
+		return;
+	}
+
+	BLI_mutex_lock(&ctx->queue_mutex);
+	ctx->num_queued_frames++;
+	BLI_mutex_unlock(&ctx->queue_mutex);
+
+	BLI_thread_queue_push(ctx->queued_frames, frame_ref);
+}
+
 static void free_proxy_output_ffmpeg(struct proxy_output_ctx *ctx,
                                      int rollback)
 {
@@ -672,6 +735,10 @@ static void free_proxy_output_ffmpeg(struct proxy_output_ctx *ctx,
 		av_free(ctx->frame);
 	}
 
+	BLI_thread_queue_free(ctx->queued_frames);
+	BLI_mutex_end(&ctx->queue_mutex);
+	BLI_condition_end(&ctx->queue_cond);
+
 	get_proxy_filename(ctx->anim, ctx->proxy_size,
 	                   fname_tmp, true);
 
@@ -688,6 +755,15 @@ static void free_proxy_output_ffmpeg(struct proxy_output_ctx *ctx,
 	MEM_freeN(ctx);
 }
 
+/* Seek position for the frames decoded from a packet, see index_rebuild_ffmpeg_proc_decoded_frame(). */
+typedef struct FFmpegSeekState {
+	unsigned long long seek_pos;
+	unsigned long long last_seek_pos;
+	unsigned long long seek_pos_dts;
+	unsigned long long seek_pos_pts;
+	unsigned long long last_seek_pos_dts;
+} FFmpegSeekState;
+
 typedef struct FFmpegIndexBuilderContext {
 	int anim_type;
 
@@ -706,11 +782,14 @@ typedef struct FFmpegIndexBuilderContext {
 	IMB_Timecode_Type tcs_in_use;
 	IMB_Proxy_Size proxy_sizes_in_use;
 
-	unsigned long long seek_pos;
-	unsigned long long last_seek_pos;
-	unsigned long long seek_pos_dts;
-	unsigned long long seek_pos_pts;
-	unsigned long long last_seek_pos_dts;
+	FFmpegSeekState seek;
+
+	/* Frame threading returns a frame only after the packets of the next frames have been read,
+	 * so the seek state of the last packets is kept and the one of the packet a frame was
+	 * actually decoded from is used for it. */
+	FFmpegSeekState *seek_history;
+	int seek_history_len, seek_history_first, seek_history_used;
+
 	unsigned long long start_pts;
 	double frame_rate;
 	double pts_time_base;
@@ -778,12 +857,24 @@ static IndexBuildContext *index_ffmpeg_create_context(struct anim *anim, IMB_Tim
 
 	context->iCodecCtx->workaround_bugs = 1;
 
+	/* decode in parallel, decoded frames are passed on to the proxy outputs as references */
+	context->iCodecCtx->thread_count = BLI_system_thread_count();
+	context->iCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	context->iCodecCtx->refcounted_frames = 1;
+
 	if (avcodec_open2(context->iCodecCtx, context->iCodec, NULL) < 0) {
 		avformat_close_input(&context->iFormatCtx);
 		MEM_freeN(context);
 		return NULL;
 	}
 
+	context->seek_history_len = 1;
+	if (context->iCodecCtx->active_thread_type & FF_THREAD_FRAME) {
+		context->seek_history_len += context->iCodecCtx->thread_count - 1;
+	}
+	context->seek_history = MEM_callocN(sizeof(FFmpegSeekState) * context->seek_history_len,
+	                                    "FFmpeg index seek history");
+
 	for (i = 0; i < num_proxy_sizes; i++) {
 		if (proxy_sizes_in_use & proxy_sizes[i]) {
 			context->proxy_ctx[i] = alloc_proxy_output_ffmpeg(
@@ -833,21 +924,48 @@ static void index_rebuild_ffmpeg_finish(FFmpegIndexBuilderContext *context, int
 	avcodec_close(context->iCodecCtx);
 	avformat_close_input(&context->iFormatCtx);
 
+	MEM_freeN(context->seek_history);
 	MEM_freeN(context);
 }
 
+/* remember the seek state after reading a video packet */
+static void index_rebuild_ffmpeg_push_seek_state(FFmpegIndexBuilderContext *context)
+{
+	int index;
+
+	if (context->seek_history_used == context->seek_history_len) {
+		context->seek_history_first = (context->seek_history_first + 1) % context->seek_history_len;
+		context->seek_history_used--;
+	}
+
+	index = (context->seek_history_first + context->seek_history_used) % context->seek_history_len;
+	context->seek_history[index] = context->seek;
+	context->seek_history_used++;
+}
+
+/* forget the oldest seek state, when flushing the frames still in the decoder */
+static void index_rebuild_ffmpeg_pop_seek_state(FFmpegIndexBuilderContext *context)
+{
+	if (context->seek_history_used > 1) {
+		context->seek_history_first = (context->seek_history_first + 1) % context->seek_history_len;
+		context->seek_history_used--;
+	}
+}
+
 static void index_rebuild_ffmpeg_proc_decoded_frame(
         FFmpegIndexBuilderContext *context,
         AVPacket *curr_packet,
         AVFrame *in_frame)
 {
 	int i;
-	unsigned long long s_pos = context->seek_pos;
-	unsigned long long s_dts = context->seek_pos_dts;
+	const FFmpegSeekState *seek = (context->seek_history_used) ?
+	        &context->seek_history[context->seek_history_first] : &context->seek;
+	unsigned long long s_pos = seek->seek_pos;
+	unsigned long long s_dts = seek->seek_pos_dts;
 	unsigned long long pts = av_get_pts_from_frame(context->iFormatCtx, in_frame);
 
 	for (i = 0; i < context->num_proxy_sizes; i++) {
-		add_to_proxy_output_ffmpeg(context->proxy_ctx[i], in_frame);
+		queue_proxy_output_ffmpeg(context->proxy_ctx[i], in_frame);
 	}
 
 	if (!context->start_pts_set) {
@@ -866,9 +984,9 @@ static void index_rebuild_ffmpeg_proc_decoded_frame(
 	 * but located before the P-Frame within
 	 * the stream */
 
-	if (pts < context->seek_pos_pts) {
-		s_pos = context->last_seek_pos;
-		s_dts = context->last_seek_pos_dts;
+	if (pts < seek->seek_pos_pts) {
+		s_pos = seek->last_seek_pos;
+		s_dts = seek->last_seek_pos_dts;
 	}
 
 	for (i = 0; i < context->num_indexers; i++) {
@@ -896,11 +1014,26 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
 	AVFrame *in_frame = 0;
 	AVPacket next_packet;
 	uint64_t stream_size;
+	ListBase proxy_threads = {NULL, NULL};
+	int i, num_proxy_threads = 0;
 
 	memset(&next_packet, 0, sizeof(AVPacket));
 
 	in_frame = av_frame_alloc();
 
+	for (i = 0; i < context->num_proxy_sizes; i++) {
+		if (context->proxy_ctx[i]) {
+			num_proxy_threads++;
+		}
+	}
+
+	BLI_threadpool_init(&proxy_threads, proxy_output_thread_ffmpeg, num_proxy_threads);
+	for (i = 0; i < context->num_proxy_sizes; i++) {
+		if (context->proxy_ctx[i]) {
+			BLI_threadpool_insert(&proxy_threads, context->proxy_ctx[i]);
+		}
+	}
+
 	stream_size = avio_size(context->iFormatCtx->pb);
 
 	context->frame_rate = av_q2d(av_get_r_frame_rate_compat(context->iFormatCtx, context->iStream));
@@ -923,13 +1056,15 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
 
 		if (next_packet.stream_index == context->videoStream) {
 			if (next_packet.flags & AV_PKT_FLAG_KEY) {
-				context->last_seek_pos = context->seek_pos;
-				context->last_seek_pos_dts = context->seek_pos_dts;
-				context->seek_pos = next_packet.pos;
-				context->seek_pos_dts = next_packet.dts;
-				context->seek_pos_pts = next_packet.pts;
+				context->seek.last_seek_pos = context->seek.seek_pos;
+				context->seek.last_seek_pos_dts = context->seek.seek_pos_dts;
+				context->seek.seek_pos = next_packet.pos;
+				context->seek.seek_pos_dts = next_packet.dts;
+				context->seek.seek_pos_pts = next_packet.pts;
 			}
 
+			index_rebuild_ffmpeg_push_seek_state(context);
+
 			avcodec_decode_video2(
 			        context->iCodecCtx, in_frame, &frame_finished,
 			        &next_packet);
@@ -938,6 +1073,7 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
 		if (frame_finished) {
 			index_rebuild_ffmpeg_proc_decoded_frame(
 				context, &next_packet, in_frame);
+			av_frame_unref(in_frame);
 		}
 		av_free_packet(&next_packet);
 	}
@@ -961,13 +1097,23 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
 				&next_packet);
 
 			if (frame_finished) {
+				index_rebuild_ffmpeg_pop_seek_state(context);
 				index_rebuild_ffmpeg_proc_decoded_frame(
 					context, &next_packet, in_frame);
+				av_frame_unref(in_frame);
 			}
 		} while (frame_finished);
 	}
 
-	av_free(in_frame);
+	/* let the proxy outputs finish the frames still queued */
+	for (i = 0; i < context->num_proxy_sizes; i++) {
+		if (context->proxy_ctx[i]) {
+			BLI_thread_queue_nowait(context->proxy_ctx[i]->queued_frames);
+		}
+	}
+	BLI_threadpool_end(&proxy_threads);
+
+	av_frame_free(&in_frame);
 
 	return 1;
 }
@@ -1119,7 +1265,9 @@ static void index_rebuild_fallback(FallbackIndexBuilderContext *context,
 
 				struct ImBuf *s_ibuf = IMB_dupImBuf(tmp_ibuf);
 
-				IMB_scalefastImBuf(s_ibuf, x, y);
+				if (x != s_ibuf->x || y != s_ibuf->y) {
+					IMB_scaleImBuf_threaded(s_ibuf, x, y);
+				}
 
 				IMB_convert_rgba_to_abgr(s_ibuf);
 
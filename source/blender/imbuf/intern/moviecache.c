@@ -18,12 +18,24 @@
  */
 
 /** \file
- * \ingroup bke
+ * \ingroup imbuf
+ *
+ * Items of a cache are spread over shards, each with its own hash and lock,
+ * so threads looking up or adding different frames don't wait for each other.
+ *
+ * The memory limit is shared by all caches: items are registered in one global #MEM_CacheLimiter,
+ * which is only locked when adding or freeing items. Looking up an item only locks its shard.
+ * Instead of re-ordering the limiter queue, accesses are tracked with a global counter,
+ * the least recently used items are freed first.
+ *
+ * Lock order is #limitor_lock then a shard lock, nothing is allocated or freed with a shard locked.
+ * Segments of cached frames are guarded by their own lock, they're only freed when computed again.
  */
 
 #undef DEBUG_MESSAGES
 
 #include <stdlib.h> /* for qsort */
+#include <limits.h>
 #include <memory.h>
 
 #include "MEM_guardedalloc.h"
@@ -32,9 +44,10 @@
 #include "BLI_string.h"
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
-#include "BLI_mempool.h"
 #include "BLI_threads.h"
 
+#include "atomic_ops.h"
+
 #include "IMB_moviecache.h"
 
 #include "IMB_imbuf_types.h"
@@ -50,13 +63,27 @@
 #  define PRINT(format, ...)
 #endif
 
+/* Number of shards of each cache, must be a power of two. */
+#define MOVIECACHE_SHARDS 16
+
 static MEM_CacheLimiterC *limitor = NULL;
 static pthread_mutex_t limitor_lock = BLI_MUTEX_INITIALIZER;
 
+/* Incremented on every access, items store its value to find the least recently used ones. */
+static uint64_t moviecache_access_clock = 0;
+
+typedef struct MovieCacheShard {
+	/** Created on first use, most image caches only ever hold a single item. */
+	GHash *hash;
+	SpinLock lock;
+	/** Buffers of items were freed by the cache limiter, their keys are still in the hash. */
+	bool has_unused_keys;
+} MovieCacheShard;
+
 typedef struct MovieCache {
 	char name[64];
 
-	GHash *hash;
+	MovieCacheShard shards[MOVIECACHE_SHARDS];
 	GHashHashFP hashfp;
 	GHashCmpFP cmpfp;
 	MovieCacheGetKeyDataFP getdatafp;
@@ -65,28 +92,35 @@ typedef struct MovieCache {
 	MovieCacheGetItemPriorityFP getitempriorityfp;
 	MovieCachePriorityDeleterFP prioritydeleterfp;
 
-	struct BLI_mempool *keys_pool;
-	struct BLI_mempool *items_pool;
-	struct BLI_mempool *userkeys_pool;
-
 	int keysize;
 
+	/** Only accessed with #limitor_lock held. */
 	void *last_userkey;
 
-	int totseg, *points, proxy, render_flags;  /* for visual statistics optimization */
-	int pad;
+	/** Guards the segments below (for visual statistics optimization). */
+	SpinLock segments_lock;
+	int totseg, *points, proxy, render_flags;
+	/** Items were added or freed since #points were computed. */
+	bool segments_outdated;
 } MovieCache;
 
 typedef struct MovieCacheKey {
 	MovieCache *cache_owner;
+	/** Points to the data following this struct (or any data, for a lookup). */
 	void *userkey;
 } MovieCacheKey;
 
 typedef struct MovieCacheItem {
 	MovieCache *cache_owner;
+	MovieCacheShard *shard;
+	MovieCacheKey *key;
+	/** Next item removed from the shard, until removed items are freed. */
+	struct MovieCacheItem *removed_next;
 	ImBuf *ibuf;
 	MEM_CacheLimiterHandleC *c_handle;
 	void *priority_data;
+	/** Value of #moviecache_access_clock when last put or accessed. */
+	uint64_t last_access;
 } MovieCacheItem;
 
 static unsigned int moviecache_hashhash(const void *keyv)
@@ -104,55 +138,118 @@ static bool moviecache_hashcmp(const void *av, const void *bv)
 	return a->cache_owner->cmpfp(a->userkey, b->userkey);
 }
 
-static void moviecache_keyfree(void *val)
+static MovieCacheShard *moviecache_shard_get(MovieCache *cache, void *userkey)
 {
-	MovieCacheKey *key = val;
+	return &cache->shards[cache->hashfp(userkey) & (MOVIECACHE_SHARDS - 1)];
+}
 
-	BLI_mempool_free(key->cache_owner->userkeys_pool, key->userkey);
+/* Segments are computed again on next access, they may still be in use until then. */
+static void moviecache_segments_tag_outdated(MovieCache *cache)
+{
+	BLI_spin_lock(&cache->segments_lock);
+	cache->segments_outdated = true;
+	BLI_spin_unlock(&cache->segments_lock);
+}
 
-	BLI_mempool_free(key->cache_owner->keys_pool, key);
+static void moviecache_item_touch(MovieCacheItem *item)
+{
+	item->last_access = atomic_add_and_fetch_uint64(&moviecache_access_clock, 1);
 }
 
-static void moviecache_valfree(void *val)
+/* Free an item removed from its shard, the shard must not be locked. */
+static void moviecache_item_free(MovieCacheItem *item)
 {
-	MovieCacheItem *item = (MovieCacheItem *)val;
+	MovieCacheKey *key = item->key;
 	MovieCache *cache = item->cache_owner;
+	ImBuf *ibuf;
 
 	PRINT("%s: cache '%s' free item %p buffer %p\n", __func__, cache->name, item, item->ibuf);
 
-	if (item->ibuf) {
+	/* The cache limiter may be destroying the item at the same time. */
+	BLI_mutex_lock(&limitor_lock);
+	ibuf = item->ibuf;
+	if (ibuf) {
 		MEM_CacheLimiter_unmanage(item->c_handle);
-		IMB_freeImBuf(item->ibuf);
+		item->ibuf = NULL;
+	}
+	BLI_mutex_unlock(&limitor_lock);
+
+	if (ibuf) {
+		IMB_freeImBuf(ibuf);
 	}
 
 	if (item->priority_data && cache->prioritydeleterfp) {
 		cache->prioritydeleterfp(item->priority_data);
 	}
 
-	BLI_mempool_free(item->cache_owner->items_pool, item);
+	MEM_freeN(item);
+	MEM_freeN(key);
 }
 
-static void check_unused_keys(MovieCache *cache)
+/**
+ * Remove the items of a shard for which \a remove_cb returns true, then free them.
+ * \a remove_cb is called with the shard locked, it must not allocate, free or lock anything.
+ * Removed items are chained through the items themselves, so nothing is allocated either.
+ */
+static void moviecache_shard_remove(
+        MovieCacheShard *shard,
+        bool (*remove_cb)(MovieCacheKey *key, MovieCacheItem *item, void *userdata), void *userdata)
 {
+	MovieCacheItem *removed = NULL;
 	GHashIterator gh_iter;
 
-	BLI_ghashIterator_init(&gh_iter, cache->hash);
+	BLI_spin_lock(&shard->lock);
 
-	while (!BLI_ghashIterator_done(&gh_iter)) {
-		const MovieCacheKey *key = BLI_ghashIterator_getKey(&gh_iter);
-		const MovieCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
-		bool remove;
+	if (shard->hash) {
+		BLI_ghashIterator_init(&gh_iter, shard->hash);
 
-		BLI_ghashIterator_step(&gh_iter);
+		while (!BLI_ghashIterator_done(&gh_iter)) {
+			MovieCacheKey *key = BLI_ghashIterator_getKey(&gh_iter);
+			MovieCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
 
-		remove = !item->ibuf;
+			BLI_ghashIterator_step(&gh_iter);
 
-		if (remove) {
-			PRINT("%s: cache '%s' remove item %p without buffer\n", __func__, cache->name, item);
+			if (remove_cb(key, item, userdata)) {
+				BLI_ghash_remove(shard->hash, key, NULL, NULL);
+				item->removed_next = removed;
+				removed = item;
+			}
 		}
+	}
+
+	BLI_spin_unlock(&shard->lock);
+
+	while (removed) {
+		MovieCacheItem *item = removed;
+		removed = item->removed_next;
+		moviecache_item_free(item);
+	}
+}
 
-		if (remove)
-			BLI_ghash_remove(cache->hash, key, moviecache_keyfree, moviecache_valfree);
+static bool moviecache_remove_unused_cb(MovieCacheKey *UNUSED(key), MovieCacheItem *item, void *UNUSED(userdata))
+{
+	if (item->ibuf == NULL) {
+		PRINT("%s: cache '%s' remove item %p without buffer\n", __func__, item->cache_owner->name, item);
+		return true;
+	}
+	return false;
+}
+
+static bool moviecache_remove_all_cb(MovieCacheKey *UNUSED(key), MovieCacheItem *UNUSED(item), void *UNUSED(userdata))
+{
+	return true;
+}
+
+static void check_unused_keys(MovieCache *cache)
+{
+	for (int i = 0; i < MOVIECACHE_SHARDS; i++) {
+		MovieCacheShard *shard = &cache->shards[i];
+
+		/* Unlocked read, worst case the keys are removed next time. */
+		if (shard->has_unused_keys) {
+			shard->has_unused_keys = false;
+			moviecache_shard_remove(shard, moviecache_remove_unused_cb, NULL);
+		}
 	}
 }
 
@@ -163,25 +260,29 @@ static int compare_int(const void *av, const void *bv)
 	return *a - *b;
 }
 
+/* Called by the cache limiter, with #limitor_lock held. */
 static void IMB_moviecache_destructor(void *p)
 {
 	MovieCacheItem *item = (MovieCacheItem *)p;
 
 	if (item && item->ibuf) {
 		MovieCache *cache = item->cache_owner;
+		MovieCacheShard *shard = item->shard;
+		ImBuf *ibuf;
 
 		PRINT("%s: cache '%s' destroy item %p buffer %p\n", __func__, cache->name, item, item->ibuf);
 
-		IMB_freeImBuf(item->ibuf);
-
+		BLI_spin_lock(&shard->lock);
+		ibuf = item->ibuf;
 		item->ibuf = NULL;
 		item->c_handle = NULL;
+		shard->has_unused_keys = true;
+		BLI_spin_unlock(&shard->lock);
+
+		IMB_freeImBuf(ibuf);
 
 		/* force cached segments to be updated */
-		if (cache->points) {
-			MEM_freeN(cache->points);
-			cache->points = NULL;
-		}
+		moviecache_segments_tag_outdated(cache);
 	}
 }
 
@@ -238,16 +339,20 @@ static size_t get_item_size(void *p)
 	return size;
 }
 
-static int get_item_priority(void *item_v, int default_priority)
+static int get_item_priority(void *item_v, int UNUSED(default_priority))
 {
 	MovieCacheItem *item = (MovieCacheItem *) item_v;
 	MovieCache *cache = item->cache_owner;
 	int priority;
 
 	if (!cache->getitempriorityfp) {
-		PRINT("%s: cache '%s' item %p use default priority %d\n", __func__, cache-> name, item, default_priority);
+		/* Least recently used items have the lowest priority. */
+		const uint64_t age = moviecache_access_clock - item->last_access;
+		priority = (age > INT_MAX) ? -INT_MAX : -(int)age;
+
+		PRINT("%s: cache '%s' item %p use access priority %d\n", __func__, cache-> name, item, priority);
 
-		return default_priority;
+		return priority;
 	}
 
 	priority = cache->getitempriorityfp(cache->last_userkey, item->priority_data);
@@ -297,10 +402,10 @@ MovieCache *IMB_moviecache_create(const char *name, int keysize, GHashHashFP has
 
 	BLI_strncpy(cache->name, name, sizeof(cache->name));
 
-	cache->keys_pool = BLI_mempool_create(sizeof(MovieCacheKey), 0, 64, BLI_MEMPOOL_NOP);
-	cache->items_pool = BLI_mempool_create(sizeof(MovieCacheItem), 0, 64, BLI_MEMPOOL_NOP);
-	cache->userkeys_pool = BLI_mempool_create(keysize, 0, 64, BLI_MEMPOOL_NOP);
-	cache->hash = BLI_ghash_new(moviecache_hashhash, moviecache_hashcmp, "MovieClip ImBuf cache hash");
+	for (int i = 0; i < MOVIECACHE_SHARDS; i++) {
+		BLI_spin_init(&cache->shards[i].lock);
+	}
+	BLI_spin_init(&cache->segments_lock);
 
 	cache->keysize = keysize;
 	cache->hashfp = hashfp;
@@ -326,119 +431,131 @@ void IMB_moviecache_set_priority_callback(struct MovieCache *cache, MovieCacheGe
 	cache->prioritydeleterfp = prioritydeleterfp;
 }
 
-static void do_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf, bool need_lock)
+void IMB_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf)
 {
+	MovieCacheShard *shard = moviecache_shard_get(cache, userkey);
 	MovieCacheKey *key;
-	MovieCacheItem *item;
-
-	if (!limitor)
-		IMB_moviecache_init();
+	MovieCacheItem *item, *item_prev = NULL;
+	void **key_p, **item_p;
 
 	IMB_refImBuf(ibuf);
 
-	key = BLI_mempool_alloc(cache->keys_pool);
+	key = MEM_mallocN(sizeof(MovieCacheKey) + (size_t)cache->keysize, "MovieCacheKey");
 	key->cache_owner = cache;
-	key->userkey = BLI_mempool_alloc(cache->userkeys_pool);
+	key->userkey = key + 1;
 	memcpy(key->userkey, userkey, cache->keysize);
 
-	item = BLI_mempool_alloc(cache->items_pool);
+	item = MEM_mallocN(sizeof(MovieCacheItem), "MovieCacheItem");
 
 	PRINT("%s: cache '%s' put %p, item %p\n", __func__, cache-> name, ibuf, item);
 
 	item->ibuf = ibuf;
 	item->cache_owner = cache;
-	item->c_handle = NULL;
+	item->shard = shard;
+	item->key = key;
+	item->removed_next = NULL;
 	item->priority_data = NULL;
+	moviecache_item_touch(item);
 
 	if (cache->getprioritydatafp) {
 		item->priority_data = cache->getprioritydatafp(userkey);
 	}
 
-	BLI_ghash_reinsert(cache->hash, key, item, moviecache_keyfree, moviecache_valfree);
+	/* Referenced, so the limiter can't destroy it before it's added to the shard. */
+	BLI_mutex_lock(&limitor_lock);
+	if (!limitor) {
+		IMB_moviecache_init();
+	}
+	item->c_handle = MEM_CacheLimiter_insert(limitor, item);
+	MEM_CacheLimiter_ref(item->c_handle);
+	BLI_mutex_unlock(&limitor_lock);
 
-	if (cache->last_userkey) {
-		memcpy(cache->last_userkey, userkey, cache->keysize);
+	BLI_spin_lock(&shard->lock);
+	if (shard->hash == NULL) {
+		shard->hash = BLI_ghash_new(moviecache_hashhash, moviecache_hashcmp, "MovieClip ImBuf cache hash");
+	}
+	if (BLI_ghash_ensure_p_ex(shard->hash, key, &key_p, &item_p)) {
+		item_prev = *item_p;
 	}
+	*key_p = key;
+	*item_p = item;
+	BLI_spin_unlock(&shard->lock);
 
-	if (need_lock)
-		BLI_mutex_lock(&limitor_lock);
+	if (item_prev) {
+		moviecache_item_free(item_prev);
+	}
 
-	item->c_handle = MEM_CacheLimiter_insert(limitor, item);
+	BLI_mutex_lock(&limitor_lock);
+
+	if (cache->last_userkey) {
+		memcpy(cache->last_userkey, userkey, cache->keysize);
+	}
 
-	MEM_CacheLimiter_ref(item->c_handle);
 	MEM_CacheLimiter_enforce_limits(limitor);
 	MEM_CacheLimiter_unref(item->c_handle);
 
-	if (need_lock)
-		BLI_mutex_unlock(&limitor_lock);
+	BLI_mutex_unlock(&limitor_lock);
+
+	moviecache_segments_tag_outdated(cache);
 
 	/* cache limiter can't remove unused keys which points to destroyed values */
 	check_unused_keys(cache);
-
-	if (cache->points) {
-		MEM_freeN(cache->points);
-		cache->points = NULL;
-	}
-}
-
-void IMB_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf)
-{
-	do_moviecache_put(cache, userkey, ibuf, true);
 }
 
 bool IMB_moviecache_put_if_possible(MovieCache *cache, void *userkey, ImBuf *ibuf)
 {
 	size_t mem_in_use, mem_limit, elem_size;
-	bool result = false;
 
 	elem_size = IMB_get_size_in_memory(ibuf);
 	mem_limit = MEM_CacheLimiter_get_maximum();
 
 	BLI_mutex_lock(&limitor_lock);
-	mem_in_use = MEM_CacheLimiter_get_memory_in_use(limitor);
+	mem_in_use = limitor ? MEM_CacheLimiter_get_memory_in_use(limitor) : 0;
+	BLI_mutex_unlock(&limitor_lock);
 
+	/* Another thread may add items meanwhile, the limit is still enforced when putting. */
 	if (mem_in_use + elem_size <= mem_limit) {
-		do_moviecache_put(cache, userkey, ibuf, false);
-		result = true;
+		IMB_moviecache_put(cache, userkey, ibuf);
+		return true;
 	}
 
-	BLI_mutex_unlock(&limitor_lock);
-
-	return result;
+	return false;
 }
 
 ImBuf *IMB_moviecache_get(MovieCache *cache, void *userkey)
 {
+	MovieCacheShard *shard = moviecache_shard_get(cache, userkey);
 	MovieCacheKey key;
 	MovieCacheItem *item;
+	ImBuf *ibuf = NULL;
 
 	key.cache_owner = cache;
 	key.userkey = userkey;
-	item = (MovieCacheItem *)BLI_ghash_lookup(cache->hash, &key);
-
-	if (item) {
-		if (item->ibuf) {
-			BLI_mutex_lock(&limitor_lock);
-			MEM_CacheLimiter_touch(item->c_handle);
-			BLI_mutex_unlock(&limitor_lock);
 
-			IMB_refImBuf(item->ibuf);
-
-			return item->ibuf;
-		}
+	BLI_spin_lock(&shard->lock);
+	item = shard->hash ? (MovieCacheItem *)BLI_ghash_lookup(shard->hash, &key) : NULL;
+	if (item && item->ibuf) {
+		moviecache_item_touch(item);
+		ibuf = item->ibuf;
+		IMB_refImBuf(ibuf);
 	}
+	BLI_spin_unlock(&shard->lock);
 
-	return NULL;
+	return ibuf;
 }
 
 bool IMB_moviecache_has_frame(MovieCache *cache, void *userkey)
 {
+	MovieCacheShard *shard = moviecache_shard_get(cache, userkey);
 	MovieCacheKey key;
 	MovieCacheItem *item;
 
 	key.cache_owner = cache;
 	key.userkey = userkey;
-	item = (MovieCacheItem *)BLI_ghash_lookup(cache->hash, &key);
+
+	BLI_spin_lock(&shard->lock);
+	item = shard->hash ? (MovieCacheItem *)BLI_ghash_lookup(shard->hash, &key) : NULL;
+	BLI_spin_unlock(&shard->lock);
 
 	return item != NULL;
 }
@@ -447,14 +564,20 @@ void IMB_moviecache_free(MovieCache *cache)
 {
 	PRINT("%s: cache '%s' free\n", __func__, cache->name);
 
-	BLI_ghash_free(cache->hash, moviecache_keyfree, moviecache_valfree);
+	for (int i = 0; i < MOVIECACHE_SHARDS; i++) {
+		MovieCacheShard *shard = &cache->shards[i];
+
+		moviecache_shard_remove(shard, moviecache_remove_all_cb, NULL);
 
-	BLI_mempool_destroy(cache->keys_pool);
-	BLI_mempool_destroy(cache->items_pool);
-	BLI_mempool_destroy(cache->userkeys_pool);
+		if (shard->hash) {
+			BLI_ghash_free(shard->hash, NULL, NULL);
+		}
+		BLI_spin_end(&shard->lock);
+	}
 
 	if (cache->points)
 		MEM_freeN(cache->points);
+	BLI_spin_end(&cache->segments_lock);
 
 	if (cache->last_userkey)
 		MEM_freeN(cache->last_userkey);
@@ -462,68 +585,116 @@ void IMB_moviecache_free(MovieCache *cache)
 	MEM_freeN(cache);
 }
 
-void IMB_moviecache_cleanup(MovieCache *cache, bool (cleanup_check_cb) (ImBuf *ibuf, void *userkey, void *userdata), void *userdata)
-{
-	GHashIterator gh_iter;
+typedef struct MovieCacheCleanupData {
+	bool (*cleanup_check_cb) (ImBuf *ibuf, void *userkey, void *userdata);
+	void *userdata;
+} MovieCacheCleanupData;
 
-	check_unused_keys(cache);
-
-	BLI_ghashIterator_init(&gh_iter, cache->hash);
+static bool moviecache_remove_cleanup_cb(MovieCacheKey *key, MovieCacheItem *item, void *userdata)
+{
+	MovieCacheCleanupData *data = userdata;
 
-	while (!BLI_ghashIterator_done(&gh_iter)) {
-		MovieCacheKey *key = BLI_ghashIterator_getKey(&gh_iter);
-		MovieCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
+	if (data->cleanup_check_cb(item->ibuf, key->userkey, data->userdata)) {
+		PRINT("%s: cache '%s' remove item %p\n", __func__, item->cache_owner->name, item);
+		return true;
+	}
+	return false;
+}
 
-		BLI_ghashIterator_step(&gh_iter);
+void IMB_moviecache_cleanup(MovieCache *cache, bool (cleanup_check_cb) (ImBuf *ibuf, void *userkey, void *userdata), void *userdata)
+{
+	MovieCacheCleanupData data = {cleanup_check_cb, userdata};
 
-		if (cleanup_check_cb(item->ibuf, key->userkey, userdata)) {
-			PRINT("%s: cache '%s' remove item %p\n", __func__, cache->name, item);
+	check_unused_keys(cache);
 
-			BLI_ghash_remove(cache->hash, key, moviecache_keyfree, moviecache_valfree);
-		}
+	for (int i = 0; i < MOVIECACHE_SHARDS; i++) {
+		moviecache_shard_remove(&cache->shards[i], moviecache_remove_cleanup_cb, &data);
 	}
 }
 
-/* get segments of cached frames. useful for debugging cache policies */
+/**
+ * Get segments of cached frames. useful for debugging cache policies.
+ *
+ * The returned points are owned by the cache, they stay valid until the next call
+ * (segments are only freed here, when computed again).
+ */
 void IMB_moviecache_get_cache_segments(MovieCache *cache, int proxy, int render_flags, int *totseg_r, int **points_r)
 {
+	int *points_prev;
+
 	*totseg_r = 0;
 	*points_r = NULL;
 
 	if (!cache->getdatafp)
 		return;
 
-	if (cache->proxy != proxy || cache->render_flags != render_flags) {
-		if (cache->points)
-			MEM_freeN(cache->points);
-
-		cache->points = NULL;
-	}
-
-	if (cache->points) {
+	BLI_spin_lock(&cache->segments_lock);
+	if (cache->points && !cache->segments_outdated &&
+	    cache->proxy == proxy && cache->render_flags == render_flags)
+	{
 		*totseg_r = cache->totseg;
 		*points_r = cache->points;
+		BLI_spin_unlock(&cache->segments_lock);
+		return;
 	}
-	else {
-		int totframe = BLI_ghash_len(cache->hash);
-		int *frames = MEM_callocN(totframe * sizeof(int), "movieclip cache frames");
-		int a, totseg = 0;
+	points_prev = cache->points;
+	cache->points = NULL;
+	cache->totseg = 0;
+	cache->segments_outdated = false;
+	BLI_spin_unlock(&cache->segments_lock);
+
+	if (points_prev)
+		MEM_freeN(points_prev);
+
+	{
+		int *frames = NULL;
+		int a, totframe = 0, frames_len = 0, totseg = 0;
 		GHashIterator gh_iter;
 
-		a = 0;
-		GHASH_ITER(gh_iter, cache->hash) {
-			MovieCacheKey *key = BLI_ghashIterator_getKey(&gh_iter);
-			MovieCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
-			int framenr, curproxy, curflags;
+		for (int i = 0; i < MOVIECACHE_SHARDS; i++) {
+			MovieCacheShard *shard = &cache->shards[i];
+			int shard_len;
 
-			if (item->ibuf) {
-				cache->getdatafp(key->userkey, &framenr, &curproxy, &curflags);
+			/* Grow the array without the shard locked, frames added meanwhile are
+			 * skipped, adding them tags the segments as outdated. */
+			BLI_spin_lock(&shard->lock);
+			shard_len = shard->hash ? (int)BLI_ghash_len(shard->hash) : 0;
+			BLI_spin_unlock(&shard->lock);
 
-				if (curproxy == proxy && curflags == render_flags)
-					frames[a++] = framenr;
+			if (shard_len == 0)
+				continue;
+
+			if (totframe + shard_len > frames_len) {
+				frames_len = totframe + shard_len;
+				frames = MEM_reallocN_id(frames, frames_len * sizeof(int), "movieclip cache frames");
 			}
+
+			BLI_spin_lock(&shard->lock);
+
+			if (shard->hash) {
+				GHASH_ITER(gh_iter, shard->hash) {
+					MovieCacheKey *key = BLI_ghashIterator_getKey(&gh_iter);
+					MovieCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
+					int framenr, curproxy, curflags;
+
+					if (totframe == frames_len)
+						break;
+
+					if (item->ibuf) {
+						cache->getdatafp(key->userkey, &framenr, &curproxy, &curflags);
+
+						if (curproxy == proxy && curflags == render_flags)
+							frames[totframe++] = framenr;
+					}
+				}
+			}
+
+			BLI_spin_unlock(&shard->lock);
 		}
 
+		if (frames == NULL)
+			return;
+
 		qsort(frames, totframe, sizeof(int), compare_int);
 
 		/* count */
@@ -557,49 +728,79 @@ void IMB_moviecache_get_cache_segments(MovieCache *cache, int proxy, int render_
 			*totseg_r = totseg;
 			*points_r = points;
 
+			BLI_spin_lock(&cache->segments_lock);
+			points_prev = cache->points;
 			cache->totseg = totseg;
 			cache->points = points;
 			cache->proxy = proxy;
 			cache->render_flags = render_flags;
+			BLI_spin_unlock(&cache->segments_lock);
+
+			if (points_prev)
+				MEM_freeN(points_prev);
 		}
 
 		MEM_freeN(frames);
 	}
 }
 
+/* Iterators don't lock the shards, the cache must not be modified by other threads meanwhile. */
+typedef struct MovieCacheIter {
+	MovieCache *cache;
+	int shard;
+	GHashIterator iter;
+} MovieCacheIter;
+
+/* Continue with the next shard holding items, if the current one is done. */
+static void moviecache_iter_skip_empty(MovieCacheIter *iter)
+{
+	while (BLI_ghashIterator_done(&iter->iter) && ++iter->shard < MOVIECACHE_SHARDS) {
+		GHash *hash = iter->cache->shards[iter->shard].hash;
+
+		if (hash) {
+			BLI_ghashIterator_init(&iter->iter, hash);
+		}
+	}
+}
+
 struct MovieCacheIter *IMB_moviecacheIter_new(MovieCache *cache)
 {
-	GHashIterator *iter;
+	MovieCacheIter *iter = MEM_callocN(sizeof(MovieCacheIter), "MovieCacheIter");
 
 	check_unused_keys(cache);
-	iter = BLI_ghashIterator_new(cache->hash);
 
-	return (struct MovieCacheIter *) iter;
+	iter->cache = cache;
+	iter->shard = -1;
+	/* A zeroed iterator is done, so the first shard with items is picked. */
+	moviecache_iter_skip_empty(iter);
+
+	return iter;
 }
 
 void IMB_moviecacheIter_free(struct MovieCacheIter *iter)
 {
-	BLI_ghashIterator_free((GHashIterator *) iter);
+	MEM_freeN(iter);
 }
 
 bool IMB_moviecacheIter_done(struct MovieCacheIter *iter)
 {
-	return BLI_ghashIterator_done((GHashIterator *) iter);
+	return iter->shard >= MOVIECACHE_SHARDS;
 }
 
 void IMB_moviecacheIter_step(struct MovieCacheIter *iter)
 {
-	BLI_ghashIterator_step((GHashIterator *) iter);
+	BLI_ghashIterator_step(&iter->iter);
+	moviecache_iter_skip_empty(iter);
 }
 
 ImBuf *IMB_moviecacheIter_getImBuf(struct MovieCacheIter *iter)
 {
-	MovieCacheItem *item = BLI_ghashIterator_getValue((GHashIterator *) iter);
+	MovieCacheItem *item = BLI_ghashIterator_getValue(&iter->iter);
 	return item->ibuf;
 }
 
 void *IMB_moviecacheIter_getUserKey(struct MovieCacheIter *iter)
 {
-	MovieCacheKey *key = BLI_ghashIterator_getKey((GHashIterator *) iter);
+	MovieCacheKey *key = BLI_ghashIterator_getKey(&iter->iter);
 	return key->userkey;
 }
@@ -249,7 +249,11 @@ typedef struct ID {
 	int us;
 	int icon_id;
 	int recalc;
-	char _pad[4];
+	/**
+	 * Accumulated recalc flags since the last memfile undo push,
+	 * a data-block without any can be kept as it is on undo.
+	 */
+	int recalc_after_undo_push;
 	IDProperty *properties;
 
 	/** Reference linked ID which this one overrides. */
@@ -523,6 +527,12 @@ enum {
 	/* Datablock was not allocated by standard system (BKE_libblock_alloc), do not free its memory
 	 * (usual type-specific freeing is called though). */
 	LIB_TAG_NOT_ALLOCATED     = 1 << 18,
+
+	/* RESET_NEVER tag library which linked datablocks were not read yet (lazy library loading),
+	 * they are place-holders (see LIB_TAG_MISSING) until the library is reloaded. */
+	LIB_TAG_LAZY              = 1 << 19,
+	/* Datablock was kept from the previous state by global undo, instead of being read again. */
+	LIB_TAG_UNDO_OLD_ID_REUSED = 1 << 20,
 };
 
 /* Tag given ID for an update in all the dependency graphs. */
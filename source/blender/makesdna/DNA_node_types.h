@@ -508,6 +508,7 @@ typedef struct bNodeTree {
 
 /* tree is localized copy, free when deleting node groups */
 /* #define NTREE_IS_LOCALIZED			(1 << 5) */
+#define NTREE_COM_FULL_FRAME		(1 << 6)	/* compositor: buffer every operation and execute full frames */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
@@ -554,6 +554,8 @@ typedef struct UserDef {
 	char pythondir[768];
 	char sounddir[768];
 	char i18ndir[768];
+	/** Directory of the persistent sequencer cache, disabled when empty. 1024 = FILE_MAX. */
+	char sequencer_disk_cache_dir[1024];
 	/** 1024 = FILE_MAX. */
 	char image_editor[1024];
 	/** 1024 = FILE_MAX. */
@@ -644,6 +646,9 @@ typedef struct UserDef {
 	char _pad14[2];
 	int memcachelimit;
 	int prefetchframes;
+	/** Size of the persistent sequencer cache (in gigabytes). */
+	int sequencer_disk_cache_size_limit;
+	char _pad15[4];
 	/** Control the rotation step of the view when PAD2, PAD4, PAD6&PAD8 is use. */
 	float pad_rot_angle;
 	char _pad12[2];
@@ -849,6 +849,12 @@ static IDProperty *rna_IDPropertyWrapPtr_idprops(PointerRNA *ptr, bool UNUSED(cr
 	return ptr->data;
 }
 
+static int rna_Library_is_lazy_get(PointerRNA *ptr)
+{
+	Library *lib = (Library *)ptr->data;
+	return (lib->id.tag & LIB_TAG_LAZY) != 0;
+}
+
 static void rna_Library_version_get(PointerRNA *ptr, int *value)
 {
 	Library *lib = (Library *)ptr->data;
@@ -1331,6 +1337,13 @@ static void rna_def_library(BlenderRNA *brna)
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
 	RNA_def_property_flag(prop, PROP_THICK_WRAP);
 
+	prop = RNA_def_property(srna, "is_lazy", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_funcs(prop, "rna_Library_is_lazy_get", NULL);
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Is Lazy",
+	                         "Some linked data-blocks of this library were not read yet, they are read when "
+	                         "a scene being evaluated uses them, or when the library is reloaded");
+
 	func = RNA_def_function(srna, "reload", "WM_lib_reload");
 	RNA_def_function_flag(func, FUNC_USE_REPORTS | FUNC_USE_CONTEXT);
 	RNA_def_function_ui_description(func, "Reload this library and all its linked data-blocks");
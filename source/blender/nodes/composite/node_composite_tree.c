@@ -288,6 +288,11 @@ void ntreeCompositTagRender(Scene *curscene)
 			}
 		}
 	}
+
+#ifdef WITH_COMPOSITOR
+	/* cached results may depend on the previous render result */
+	COM_clearCaches();
+#endif
 }
 
 static int node_animation_properties(bNodeTree *ntree, bNode *node)
@@ -159,6 +159,7 @@ void		WM_recover_last_session(struct bContext *C, struct ReportList *reports);
 void		WM_file_tag_modified(void);
 
 void        WM_lib_reload(struct Library *lib, struct bContext *C, struct ReportList *reports);
+void        WM_lib_lazy_ensure(struct Main *bmain, struct Scene *scene, struct ReportList *reports);
 
 			/* mouse cursors */
 void		WM_cursor_set(struct wmWindow *win, int curs);
@@ -85,6 +85,7 @@
 #include "RNA_enum_types.h"
 
 #include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
 
 /* Motion in pixels allowed before we don't consider single/double click,
  * or detect the start of a tweak event. */
@@ -338,6 +339,10 @@ void wm_event_do_depsgraph(bContext *C)
 		 * across visible view layers and has overrides on it.
 		 */
 		Depsgraph *depsgraph = BKE_scene_get_depsgraph(scene, view_layer, true);
+		/* Read place-holders of lazy libraries before relations are built from them. */
+		if (DEG_graph_relations_need_update(depsgraph)) {
+			WM_lib_lazy_ensure(bmain, scene, NULL);
+		}
 		DEG_make_active(depsgraph);
 		BKE_scene_graph_update_tagged(depsgraph, bmain);
 	}
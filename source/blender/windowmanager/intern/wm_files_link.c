@@ -41,6 +41,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_bitmap.h"
 #include "BLI_linklist.h"
+#include "BLI_linklist_stack.h"
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_utildefines.h"
@@ -52,6 +53,7 @@
 #include "BKE_global.h"
 #include "BKE_layer.h"
 #include "BKE_library.h"
+#include "BKE_library_query.h"
 #include "BKE_library_remap.h"
 #include "BKE_main.h"
 #include "BKE_report.h"
@@ -592,9 +594,13 @@ static int wm_lib_relocate_invoke(bContext *C, wmOperator *op, const wmEvent *UN
 	return OPERATOR_CANCELLED;
 }
 
+/**
+ * \param ids_only: When not NULL, only reload those IDs of \a library (place-holders of a lazy library).
+ */
 static void lib_relocate_do(
         Main *bmain,
-        Library *library, WMLinkAppendData *lapp_data, ReportList *reports, const bool do_reload)
+        Library *library, WMLinkAppendData *lapp_data, ReportList *reports, const bool do_reload,
+        GSet *ids_only)
 {
 	ListBase *lbarray[MAX_LIBARRAY];
 	int lba_idx;
@@ -613,8 +619,9 @@ static void lib_relocate_do(
 			continue;
 		}
 
-		for (; id; id = id->next) {
-			if (id->lib == library) {
+		for (ID *id_next; id; id = id_next) {
+			id_next = id->next;
+			if (id->lib == library && (ids_only == NULL || BLI_gset_haskey(ids_only, id))) {
 				WMLinkAppendDataItem *item;
 
 				/* We remove it from current Main, and add it to items to link... */
@@ -803,13 +810,158 @@ void WM_lib_reload(Library *lib, bContext *C, ReportList *reports)
 
 	wm_link_append_data_library_add(lapp_data, lib->filepath);
 
-	lib_relocate_do(CTX_data_main(C), lib, lapp_data, reports, true);
+	/* Linked data-blocks of a lazy library are read now, the tag must be cleared first so that
+	 * reading the library (and the libraries it links to) is not deferred again. */
+	lib->id.tag &= ~LIB_TAG_LAZY;
+
+	lib_relocate_do(CTX_data_main(C), lib, lapp_data, reports, true, NULL);
 
 	wm_link_append_data_free(lapp_data);
 
 	WM_event_add_notifier(C, NC_WINDOW, NULL);
 }
 
+/* Lazy libraries, see #BLO_read_lazy_libraries_set. */
+
+typedef struct LazyIDsCollectData {
+	GSet *visited;
+	BLI_LINKSTACK_DECLARE(todo, ID *);
+	/* Place-holders of lazy libraries used by the scene. */
+	LinkNode *lazy_ids;
+} LazyIDsCollectData;
+
+static bool wm_lib_id_is_lazy(const ID *id)
+{
+	return id->lib && (id->lib->id.tag & LIB_TAG_LAZY) && (id->tag & LIB_TAG_MISSING);
+}
+
+static int wm_lib_lazy_ids_collect_cb(void *user_data, ID *UNUSED(id_self), ID **id_pointer, int cb_flag)
+{
+	LazyIDsCollectData *data = user_data;
+	ID *id = *id_pointer;
+
+	if (id == NULL || (cb_flag & IDWALK_CB_LOOPBACK) || !BLI_gset_add(data->visited, id)) {
+		return IDWALK_RET_NOP;
+	}
+
+	if (wm_lib_id_is_lazy(id)) {
+		BLI_linklist_prepend(&data->lazy_ids, id);
+	}
+	else {
+		BLI_LINKSTACK_PUSH(data->todo, id);
+	}
+	return IDWALK_RET_NOP;
+}
+
+/* Place-holders of lazy libraries reachable from the scene, skipping the \a missing ones. */
+static LinkNode *wm_lib_lazy_ids_collect(Main *bmain, Scene *scene, GSet *missing)
+{
+	LazyIDsCollectData data = {NULL};
+	ID *id;
+
+	data.visited = BLI_gset_ptr_new(__func__);
+	BLI_LINKSTACK_INIT(data.todo);
+
+	BLI_gset_add(data.visited, &scene->id);
+	BLI_LINKSTACK_PUSH(data.todo, &scene->id);
+	while ((id = BLI_LINKSTACK_POP(data.todo))) {
+		BKE_library_foreach_ID_link(bmain, id, wm_lib_lazy_ids_collect_cb, &data, IDWALK_READONLY);
+	}
+
+	BLI_LINKSTACK_FREE(data.todo);
+	BLI_gset_free(data.visited, NULL);
+
+	/* Data-blocks not found in their library stay place-holders. */
+	LinkNode *lazy_ids = NULL;
+	for (LinkNode *link = data.lazy_ids; link; link = link->next) {
+		if (!BLI_gset_haskey(missing, link->link)) {
+			BLI_linklist_prepend(&lazy_ids, link->link);
+		}
+	}
+	BLI_linklist_free(data.lazy_ids, NULL);
+
+	return lazy_ids;
+}
+
+static void wm_lib_lazy_tag_update(Main *bmain, Library *lib, GSet *missing)
+{
+	ID *id;
+
+	FOREACH_MAIN_ID_BEGIN(bmain, id)
+	{
+		if (id->lib == lib && wm_lib_id_is_lazy(id) && !BLI_gset_haskey(missing, id)) {
+			return;
+		}
+	}
+	FOREACH_MAIN_ID_END;
+
+	lib->id.tag &= ~LIB_TAG_LAZY;
+}
+
+/**
+ * Read the place-holders of lazy libraries used by \a scene, so that it can be evaluated.
+ * The data-blocks of a library that the scene doesn't use stay place-holders.
+ */
+void WM_lib_lazy_ensure(Main *bmain, Scene *scene, ReportList *reports)
+{
+	Library *lib;
+
+	for (lib = bmain->libraries.first; lib; lib = lib->id.next) {
+		if (lib->id.tag & LIB_TAG_LAZY) {
+			break;
+		}
+	}
+	if (lib == NULL) {
+		return;
+	}
+
+	GSet *missing = BLI_gset_ptr_new(__func__);
+	LinkNode *lazy_ids;
+
+	/* Reading data-blocks can make more place-holders reachable (e.g. the materials of a mesh),
+	 * so keep going until all the scene uses is read, one library at a time. */
+	while ((lazy_ids = wm_lib_lazy_ids_collect(bmain, scene, missing))) {
+		lib = ((ID *)lazy_ids->link)->lib;
+
+		if (!BLI_exists(lib->filepath)) {
+			BKE_reportf(reports, RPT_WARNING,
+			            "Cannot read lazy library '%s' from invalid path '%s'", lib->id.name, lib->filepath);
+			lib->id.tag &= ~LIB_TAG_LAZY;
+			lib->id.tag |= LIB_TAG_MISSING;
+			BLI_linklist_free(lazy_ids, NULL);
+			continue;
+		}
+
+		GSet *ids = BLI_gset_ptr_new(__func__);
+		for (LinkNode *link = lazy_ids; link; link = link->next) {
+			if (((ID *)link->link)->lib == lib) {
+				BLI_gset_add(ids, link->link);
+			}
+		}
+		BLI_linklist_free(lazy_ids, NULL);
+
+		WMLinkAppendData *lapp_data = wm_link_append_data_new(
+		        BLO_LIBLINK_USE_PLACEHOLDERS | BLO_LIBLINK_FORCE_INDIRECT);
+		wm_link_append_data_library_add(lapp_data, lib->filepath);
+
+		lib_relocate_do(bmain, lib, lapp_data, reports, true, ids);
+
+		for (LinkNode *itemlink = lapp_data->items.list; itemlink; itemlink = itemlink->next) {
+			WMLinkAppendDataItem *item = itemlink->link;
+			if (item->new_id && (item->new_id->tag & LIB_TAG_MISSING)) {
+				BLI_gset_add(missing, item->new_id);
+			}
+		}
+
+		wm_link_append_data_free(lapp_data);
+		BLI_gset_free(ids, NULL);
+
+		wm_lib_lazy_tag_update(bmain, lib, missing);
+	}
+
+	BLI_gset_free(missing, NULL);
+}
+
 static int wm_lib_relocate_exec_do(bContext *C, wmOperator *op, bool do_reload)
 {
 	Library *lib;
@@ -913,7 +1065,9 @@ static int wm_lib_relocate_exec_do(bContext *C, wmOperator *op, bool do_reload)
 			lapp_data->flag |= BLO_LIBLINK_USE_PLACEHOLDERS | BLO_LIBLINK_FORCE_INDIRECT;
 		}
 
-		lib_relocate_do(bmain, lib, lapp_data, op->reports, do_reload);
+		lib->id.tag &= ~LIB_TAG_LAZY;
+
+		lib_relocate_do(bmain, lib, lapp_data, op->reports, do_reload, NULL);
 
 		wm_link_append_data_free(lapp_data);
 
@@ -43,7 +43,7 @@
 #include "BLI_mempool.h"
 #include "BLI_system.h"
 
-#include "BLO_readfile.h"  /* only for BLO_has_bfile_extension */
+#include "BLO_readfile.h"
 
 #include "BKE_blender_version.h"
 #include "BKE_context.h"
@@ -498,6 +498,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 	BLI_argsPrintArgDoc(ba, "--render-output");
 	BLI_argsPrintArgDoc(ba, "--engine");
 	BLI_argsPrintArgDoc(ba, "--threads");
+	BLI_argsPrintArgDoc(ba, "--task-work-stealing");
 
 	printf("\n");
 	printf("Format Options:\n");
@@ -583,6 +584,8 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 	BLI_argsPrintArgDoc(ba, "--factory-startup");
 	BLI_argsPrintArgDoc(ba, "--enable-static-override");
 	BLI_argsPrintArgDoc(ba, "--enable-event-simulate");
+	BLI_argsPrintArgDoc(ba, "--blend-read-mmap");
+	BLI_argsPrintArgDoc(ba, "--lazy-libraries");
 	printf("\n");
 	BLI_argsPrintArgDoc(ba, "--env-system-datafiles");
 	BLI_argsPrintArgDoc(ba, "--env-system-scripts");
@@ -1044,6 +1047,26 @@ static int arg_handle_enable_event_simulate(int UNUSED(argc), const char **UNUSE
 	return 0;
 }
 
+static const char arg_handle_blend_read_mmap_set_doc[] =
+"\n\tMemory map uncompressed blend files when loading them,\n"
+"\tdata-blocks are then converted using multiple threads."
+;
+static int arg_handle_blend_read_mmap_set(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+	BLO_read_use_mmap_set(true);
+	return 0;
+}
+
+static const char arg_handle_lazy_libraries_set_doc[] =
+"\n\tDon't read linked libraries when loading blend files,\n"
+"\tlinked data-blocks are place-holders until a scene being evaluated or rendered uses them."
+;
+static int arg_handle_lazy_libraries_set(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+	BLO_read_lazy_libraries_set(true);
+	return 0;
+}
+
 static const char arg_handle_env_system_set_doc_datafiles[] =
 "\n\tSet the "STRINGIFY_ARG (BLENDER_SYSTEM_DATAFILES)" environment variable.";
 static const char arg_handle_env_system_set_doc_scripts[] =
@@ -1365,6 +1388,16 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
 	}
 }
 
+static const char arg_handle_task_work_stealing_set_doc[] =
+"\n\tUse per-thread work-stealing task queues instead of a single global queue\n"
+"\tfor the task scheduler (reduces threading overhead on systems with many cores)."
+;
+static int arg_handle_task_work_stealing_set(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+	BLI_task_scheduler_work_stealing_set(true);
+	return 0;
+}
+
 static const char arg_handle_verbosity_set_doc[] =
 "<verbose>\n"
 "\tSet logging verbosity level."
@@ -1460,6 +1493,7 @@ static int arg_handle_render_frame(int argc, const char **argv, void *data)
 			re = RE_NewSceneRender(scene);
 			BLI_threaded_malloc_begin();
 			BKE_reports_init(&reports, RPT_STORE);
+			WM_lib_lazy_ensure(bmain, scene, &reports);
 			RE_SetReports(re, &reports);
 			for (int i = 0; i < frames_range_len; i++) {
 				/* We could pass in frame ranges,
@@ -1502,6 +1536,7 @@ static int arg_handle_render_animation(int UNUSED(argc), const char **UNUSED(arg
 		ReportList reports;
 		BLI_threaded_malloc_begin();
 		BKE_reports_init(&reports, RPT_STORE);
+		WM_lib_lazy_ensure(bmain, scene, &reports);
 		RE_SetReports(re, &reports);
 		RE_BlenderAnim(re, bmain, scene, NULL, NULL, scene->r.sfra, scene->r.efra, scene->r.frame_step);
 		RE_SetReports(re, NULL);
@@ -1986,6 +2021,8 @@ void main_args_setup(bContext *C, bArgs *ba)
 	BLI_argsAdd(ba, 1, NULL, "--factory-startup", CB(arg_handle_factory_startup_set), NULL);
 	BLI_argsAdd(ba, 1, NULL, "--enable-static-override", CB(arg_handle_enable_static_override), NULL);
 	BLI_argsAdd(ba, 1, NULL, "--enable-event-simulate", CB(arg_handle_enable_event_simulate), NULL);
+	BLI_argsAdd(ba, 1, NULL, "--blend-read-mmap", CB(arg_handle_blend_read_mmap_set), NULL);
+	BLI_argsAdd(ba, 1, NULL, "--lazy-libraries", CB(arg_handle_lazy_libraries_set), NULL);
 
 	/* TODO, add user env vars? */
 	BLI_argsAdd(ba, 1, NULL, "--env-system-datafiles", CB_EX(arg_handle_env_system_set, datafiles), NULL);
@@ -2026,6 +2063,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
 	BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
 	BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+	BLI_argsAdd(ba, 1, NULL, "--task-work-stealing", CB(arg_handle_task_work_stealing_set), NULL);
 	BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #undef CB
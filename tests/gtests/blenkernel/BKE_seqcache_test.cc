@@ -0,0 +1,185 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "DNA_scene_types.h"
+#include "DNA_sequence_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BKE_appdir.h"
+#include "BKE_sequencer.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+}
+
+#define IMAGE_SIZE 64
+#define NUM_FRAMES 32
+
+/* Color strips are stored on disk, their frames are told apart by their pixels. */
+class SeqDiskCacheTest : public testing::Test
+{
+public:
+	Scene scene;
+	Sequence seq;
+	SolidColorVars *colorvars;
+	SeqRenderData context;
+
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		IMB_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		IMB_exit();
+		BLI_threadapi_exit();
+	}
+
+	void SetUp()
+	{
+		memset(&scene, 0, sizeof(scene));
+		memset(&seq, 0, sizeof(seq));
+		memset(&context, 0, sizeof(context));
+
+		colorvars = (SolidColorVars *)MEM_callocN(sizeof(SolidColorVars), __func__);
+		seq.type = SEQ_TYPE_COLOR;
+		seq.len = NUM_FRAMES;
+		seq.effectdata = colorvars;
+
+		context.scene = &scene;
+		context.rectx = IMAGE_SIZE;
+		context.recty = IMAGE_SIZE;
+		context.preview_render_size = 100;
+
+		BKE_tempdir_init(NULL);
+		BLI_join_dirfile(U.sequencer_disk_cache_dir, sizeof(U.sequencer_disk_cache_dir),
+		                 BKE_tempdir_base(), "blender_seqcache_test");
+		BLI_delete(U.sequencer_disk_cache_dir, true, true);
+		U.sequencer_disk_cache_size_limit = 1;
+	}
+
+	void TearDown()
+	{
+		BKE_sequencer_cache_destruct();
+		BLI_delete(U.sequencer_disk_cache_dir, true, true);
+		U.sequencer_disk_cache_dir[0] = '\0';
+		MEM_freeN(colorvars);
+	}
+
+	static ImBuf *frame_image(int frame)
+	{
+		ImBuf *ibuf = IMB_allocImBuf(IMAGE_SIZE, IMAGE_SIZE, 32, IB_rectfloat);
+		float *px = ibuf->rect_float;
+		for (int i = 0; i < IMAGE_SIZE * IMAGE_SIZE * 4; i++) {
+			px[i] = (float)(frame * 7 + i % 31) / 16.0f;
+		}
+		return ibuf;
+	}
+
+	static void expect_frame_image(ImBuf *ibuf, int frame)
+	{
+		ImBuf *ibuf_expected = frame_image(frame);
+		ASSERT_TRUE(ibuf != NULL);
+		ASSERT_TRUE(ibuf->rect_float != NULL);
+		EXPECT_EQ(ibuf->x, IMAGE_SIZE);
+		EXPECT_EQ(ibuf->y, IMAGE_SIZE);
+		EXPECT_EQ(memcmp(ibuf->rect_float, ibuf_expected->rect_float,
+		                 sizeof(float) * IMAGE_SIZE * IMAGE_SIZE * 4), 0);
+		IMB_freeImBuf(ibuf_expected);
+	}
+};
+
+TEST_F(SeqDiskCacheTest, ReadAfterWrite)
+{
+	ImBuf *ibuf = frame_image(3);
+	BKE_sequencer_cache_put(&context, &seq, 3.0f, SEQ_STRIPELEM_IBUF, ibuf);
+	IMB_freeImBuf(ibuf);
+
+	/* Frees the memory cache, queued images are written before. */
+	BKE_sequencer_cache_destruct();
+
+	ibuf = BKE_sequencer_cache_get(&context, &seq, 3.0f, SEQ_STRIPELEM_IBUF);
+	expect_frame_image(ibuf, 3);
+	IMB_freeImBuf(ibuf);
+
+	/* Other frames, and edited strips, aren't read. */
+	EXPECT_EQ(BKE_sequencer_cache_get(&context, &seq, 4.0f, SEQ_STRIPELEM_IBUF), (ImBuf *)NULL);
+	colorvars->col[0] = 1.0f;
+	BKE_sequencer_cache_cleanup_sequence(&seq);
+	EXPECT_EQ(BKE_sequencer_cache_get(&context, &seq, 3.0f, SEQ_STRIPELEM_IBUF), (ImBuf *)NULL);
+}
+
+typedef struct SeqCacheThreadData {
+	SeqRenderData *context;
+	/* Same content, the second strip is never in the memory cache. */
+	Sequence *seq_put, *seq_get;
+} SeqCacheThreadData;
+
+static void seqcache_put_get_func(void *__restrict userdata,
+                                  const int frame,
+                                  const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	SeqCacheThreadData *data = (SeqCacheThreadData *)userdata;
+	ImBuf *ibuf = SeqDiskCacheTest::frame_image(frame);
+	BKE_sequencer_cache_put(data->context, data->seq_put, (float)frame, SEQ_STRIPELEM_IBUF, ibuf);
+	IMB_freeImBuf(ibuf);
+
+	/* Not read while it's written, either complete or not found. */
+	ibuf = BKE_sequencer_cache_get(data->context, data->seq_get, (float)frame, SEQ_STRIPELEM_IBUF);
+	if (ibuf) {
+		SeqDiskCacheTest::expect_frame_image(ibuf, frame);
+		IMB_freeImBuf(ibuf);
+	}
+}
+
+TEST_F(SeqDiskCacheTest, ThreadedPutGet)
+{
+	Sequence seq_get = seq;
+	SeqCacheThreadData data = {&context, &seq, &seq_get};
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.min_iter_per_thread = 1;
+
+	BLI_task_parallel_range(0, NUM_FRAMES, &data, seqcache_put_get_func, &settings);
+
+	BKE_sequencer_cache_destruct();
+
+	/* Frames are dropped when writing can't keep up, the others are complete. */
+	int frames_num = 0;
+	for (int frame = 0; frame < NUM_FRAMES; frame++) {
+		ImBuf *ibuf = BKE_sequencer_cache_get(&context, &seq_get, (float)frame, SEQ_STRIPELEM_IBUF);
+		if (ibuf) {
+			expect_frame_image(ibuf, frame);
+			IMB_freeImBuf(ibuf);
+			frames_num++;
+		}
+	}
+	EXPECT_GT(frames_num, 0);
+
+	/* No temporary file is left. */
+	struct direntry *filelist;
+	unsigned int filelist_num = BLI_filelist_dir_contents(U.sequencer_disk_cache_dir, &filelist);
+	int files_num = 0;
+	for (unsigned int i = 0; i < filelist_num; i++) {
+		if (FILENAME_IS_CURRPAR(filelist[i].relname)) {
+			continue;
+		}
+		EXPECT_TRUE(BLI_str_endswith(filelist[i].relname, ".bseq"));
+		files_num++;
+	}
+	BLI_filelist_free(filelist, filelist_num);
+	EXPECT_EQ(files_num, frames_num);
+}
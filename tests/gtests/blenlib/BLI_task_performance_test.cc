@@ -0,0 +1,94 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "atomic_ops.h"
+
+extern "C" {
+#include "BLI_math_base.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+}
+
+/* Measures scheduling overhead of lots of tiny tasks pushed from other tasks,
+ * which is the pattern used by dependency graph evaluation. Compares the single
+ * global queue against per-thread work-stealing deques for 1..N threads. */
+
+#define TREE_DEPTH 12
+#define TREE_BRANCHING 3
+/* Amount of fake work done by every task. */
+#define TASK_WORK_ITERATIONS 64
+
+typedef struct TreeBenchData {
+	uint32_t num_tasks;
+	float sum;
+} TreeBenchData;
+
+static void task_tree_bench_func(TaskPool *__restrict pool, void *taskdata, int thread_id)
+{
+	const int depth = POINTER_AS_INT(taskdata);
+	TreeBenchData *data = (TreeBenchData *)BLI_task_pool_userdata(pool);
+
+	float value = (float)depth;
+	for (int i = 0; i < TASK_WORK_ITERATIONS; i++) {
+		value = value * 0.5f + 1.0f;
+	}
+	if (value < 0.0f) {
+		/* Never happens, only here to avoid the loop above being optimized out. */
+		data->sum += value;
+	}
+	atomic_add_and_fetch_uint32(&data->num_tasks, 1);
+
+	if (depth == TREE_DEPTH) {
+		return;
+	}
+	BLI_task_pool_delayed_push_begin(pool, thread_id);
+	for (int i = 0; i < TREE_BRANCHING; i++) {
+		BLI_task_pool_push_from_thread(
+		        pool, task_tree_bench_func, POINTER_FROM_INT(depth + 1), false, TASK_PRIORITY_HIGH, thread_id);
+	}
+	BLI_task_pool_delayed_push_end(pool, thread_id);
+}
+
+static double task_tree_bench_run(const int num_threads, const int flag)
+{
+	TreeBenchData data = {0, 0.0f};
+	TaskScheduler *scheduler = BLI_task_scheduler_create_ex(num_threads, flag);
+	TaskPool *pool = BLI_task_pool_create_suspended(scheduler, &data);
+
+	const double time_start = PIL_check_seconds_timer();
+	BLI_task_pool_push(pool, task_tree_bench_func, POINTER_FROM_INT(0), false, TASK_PRIORITY_HIGH);
+	BLI_task_pool_work_and_wait(pool);
+	const double time = PIL_check_seconds_timer() - time_start;
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(scheduler);
+
+	EXPECT_GT(data.num_tasks, 0);
+	return time;
+}
+
+TEST(task, TreeScaling)
+{
+	BLI_threadapi_init();
+
+	int num_tasks = 0;
+	for (int depth = 0, num = 1; depth <= TREE_DEPTH; depth++, num *= TREE_BRANCHING) {
+		num_tasks += num;
+	}
+
+	const int max_threads = BLI_system_thread_count();
+	printf("\n========== TASK TREE SCALING (%d tasks) ==========\n", num_tasks);
+	printf("Threads    Global queue    Work stealing\n");
+	for (int num_threads = 1; ; num_threads = min_ii(num_threads * 2, max_threads)) {
+		const double time_global = task_tree_bench_run(num_threads, 0);
+		const double time_stealing = task_tree_bench_run(num_threads, TASK_SCHEDULER_WORK_STEALING);
+		printf("%4d       %9.4fs      %9.4fs\n", num_threads, time_global, time_stealing);
+		if (num_threads == max_threads) {
+			break;
+		}
+	}
+}
@@ -8,6 +8,7 @@
 extern "C" {
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 };
 
@@ -74,3 +75,98 @@ TEST(task, MempoolIter)
 
 	BLI_mempool_destroy(mempool);
 }
+
+/* Task tree, each task pushes its children from the thread it is running on,
+ * similar to how dependency graph schedules its nodes. */
+
+#define TREE_DEPTH 10
+#define TREE_BRANCHING 3
+
+static void task_tree_func(TaskPool *__restrict pool, void *taskdata, int thread_id)
+{
+	const int depth = POINTER_AS_INT(taskdata);
+	uint32_t *count = (uint32_t *)BLI_task_pool_userdata(pool);
+
+	atomic_add_and_fetch_uint32(count, 1);
+
+	if (depth == TREE_DEPTH) {
+		return;
+	}
+	BLI_task_pool_delayed_push_begin(pool, thread_id);
+	for (int i = 0; i < TREE_BRANCHING; i++) {
+		BLI_task_pool_push_from_thread(
+		        pool, task_tree_func, POINTER_FROM_INT(depth + 1), false, TASK_PRIORITY_HIGH, thread_id);
+	}
+	BLI_task_pool_delayed_push_end(pool, thread_id);
+}
+
+static void task_tree_run(const int flag)
+{
+	uint32_t count = 0;
+	uint32_t expected_count = 0;
+	for (int depth = 0, num = 1; depth <= TREE_DEPTH; depth++, num *= TREE_BRANCHING) {
+		expected_count += num;
+	}
+
+	BLI_threadapi_init();
+	TaskScheduler *scheduler = BLI_task_scheduler_create_ex(4, flag);
+	TaskPool *pool = BLI_task_pool_create_suspended(scheduler, &count);
+
+	BLI_task_pool_push(pool, task_tree_func, POINTER_FROM_INT(0), false, TASK_PRIORITY_HIGH);
+	BLI_task_pool_work_wait_and_reset(pool);
+	EXPECT_EQ(count, expected_count);
+
+	/* Pool must be re-usable after reset, same as depsgraph evaluation does. */
+	count = 0;
+	BLI_task_pool_push(pool, task_tree_func, POINTER_FROM_INT(0), false, TASK_PRIORITY_HIGH);
+	BLI_task_pool_work_and_wait(pool);
+	EXPECT_EQ(count, expected_count);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(scheduler);
+}
+
+TEST(task, TreeGlobalQueue)
+{
+	task_tree_run(0);
+}
+
+TEST(task, TreeWorkStealing)
+{
+	task_tree_run(TASK_SCHEDULER_WORK_STEALING);
+}
+
+/* Single task pushing more tasks than a work-stealing deque can hold, none of
+ * them is to be lost when the deque overflows. */
+
+#define WIDE_NUM_TASKS 10000
+
+static void task_wide_leaf_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int UNUSED(thread_id))
+{
+	uint32_t *count = (uint32_t *)BLI_task_pool_userdata(pool);
+	atomic_add_and_fetch_uint32(count, 1);
+}
+
+static void task_wide_root_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int thread_id)
+{
+	for (int i = 0; i < WIDE_NUM_TASKS; i++) {
+		BLI_task_pool_push_from_thread(
+		        pool, task_wide_leaf_func, NULL, false, TASK_PRIORITY_HIGH, thread_id);
+	}
+}
+
+TEST(task, WideWorkStealing)
+{
+	uint32_t count = 0;
+
+	BLI_threadapi_init();
+	TaskScheduler *scheduler = BLI_task_scheduler_create_ex(4, TASK_SCHEDULER_WORK_STEALING);
+	TaskPool *pool = BLI_task_pool_create_suspended(scheduler, &count);
+
+	BLI_task_pool_push(pool, task_wide_root_func, NULL, false, TASK_PRIORITY_HIGH);
+	BLI_task_pool_work_and_wait(pool);
+	EXPECT_EQ(count, WIDE_NUM_TASKS);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(scheduler);
+}
@@ -0,0 +1,160 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_genfile.h"
+#include "DNA_ID.h"
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_appdir.h"
+#include "BKE_collection.h"
+#include "BKE_global.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "DEG_depsgraph.h"
+
+#include "IMB_imbuf.h"
+
+#include "WM_api.h"
+}
+
+class LazyLibraryTest : public testing::Test
+{
+protected:
+	char lib_filepath[FILE_MAX];
+	char filepath[FILE_MAX];
+
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		DNA_sdna_current_init();
+		IMB_init();
+		DEG_register_node_types();
+		BKE_tempdir_init(NULL);
+	}
+
+	static void TearDownTestCase()
+	{
+		BKE_tempdir_session_purge();
+		DEG_free_node_types();
+		IMB_exit();
+		DNA_sdna_current_free();
+		BLI_threadapi_exit();
+	}
+
+	virtual void SetUp()
+	{
+		BLI_make_file_string("/", lib_filepath, BKE_tempdir_session(), "blenloader_test_lazy_lib.blend");
+		BLI_make_file_string("/", filepath, BKE_tempdir_session(), "blenloader_test_lazy.blend");
+	}
+
+	virtual void TearDown()
+	{
+		BLI_delete(filepath, false, false);
+		BLI_delete(lib_filepath, false, false);
+		BLO_read_lazy_libraries_set(false);
+	}
+
+	/* Library with two mesh objects, "Used" and "Unused". */
+	void write_library()
+	{
+		Main *bmain = BKE_main_new();
+		const char *names[] = {"Used", "Unused"};
+		for (int i = 0; i < ARRAY_SIZE(names); i++) {
+			Mesh *mesh = BKE_mesh_add(bmain, names[i]);
+			Object *ob = BKE_object_add_only_object(bmain, OB_MESH, names[i]);
+			ob->data = mesh;
+			id_fake_user_set(&ob->id);
+		}
+		ASSERT_TRUE(BLO_write_file(bmain, lib_filepath, 0, NULL, NULL));
+		BKE_main_free(bmain);
+	}
+
+	/* File linking "Used" into "Scene" and "Unused" into "SceneOther". */
+	void write_file()
+	{
+		Main *bmain = BKE_main_new();
+		BLI_strncpy(bmain->name, filepath, sizeof(bmain->name));
+		Scene *scene = BKE_scene_add(bmain, "Scene");
+		Scene *scene_other = BKE_scene_add(bmain, "SceneOther");
+
+		BlendHandle *bh = BLO_blendhandle_from_file(lib_filepath, NULL);
+		ASSERT_NE(bh, (BlendHandle *)NULL);
+		Main *mainl = BLO_library_link_begin(bmain, &bh, lib_filepath);
+		Object *ob_used = (Object *)BLO_library_link_named_part(mainl, &bh, ID_OB, "Used");
+		Object *ob_unused = (Object *)BLO_library_link_named_part(mainl, &bh, ID_OB, "Unused");
+		BLO_library_link_end(mainl, &bh, 0, bmain, NULL, NULL, NULL);
+		BLO_blendhandle_close(bh);
+		ASSERT_NE(ob_used, (Object *)NULL);
+		ASSERT_NE(ob_unused, (Object *)NULL);
+
+		BKE_collection_object_add(bmain, scene->master_collection, ob_used);
+		BKE_collection_object_add(bmain, scene_other->master_collection, ob_unused);
+
+		ASSERT_TRUE(BLO_write_file(bmain, filepath, 0, NULL, NULL));
+		BKE_main_free(bmain);
+	}
+
+	static bool object_is_read(Main *bmain, const char *name)
+	{
+		Object *ob = (Object *)BKE_libblock_find_name(bmain, ID_OB, name);
+		EXPECT_NE(ob, (Object *)NULL);
+		if (ob == NULL || (ob->id.tag & LIB_TAG_MISSING)) {
+			return false;
+		}
+		EXPECT_NE(ob->data, (void *)NULL);
+		EXPECT_EQ(((ID *)ob->data)->tag & LIB_TAG_MISSING, 0);
+		return true;
+	}
+};
+
+TEST_F(LazyLibraryTest, ReadOnFirstUse)
+{
+	write_library();
+	write_file();
+
+	BLO_read_lazy_libraries_set(true);
+	BlendFileData *bfd = BLO_read_from_file(filepath, BLO_READ_SKIP_USERDEF, NULL);
+	ASSERT_NE(bfd, (BlendFileData *)NULL);
+	Main *bmain = bfd->main;
+	/* Reading tags data-blocks for update in the global main. */
+	G_MAIN = bmain;
+
+	Library *lib = (Library *)bmain->libraries.first;
+	ASSERT_NE(lib, (Library *)NULL);
+	EXPECT_NE(lib->id.tag & LIB_TAG_LAZY, 0);
+	EXPECT_FALSE(object_is_read(bmain, "Used"));
+	EXPECT_FALSE(object_is_read(bmain, "Unused"));
+
+	/* Only the data-blocks used by the scene are read. */
+	WM_lib_lazy_ensure(bmain, (Scene *)BKE_libblock_find_name(bmain, ID_SCE, "Scene"), NULL);
+	EXPECT_TRUE(object_is_read(bmain, "Used"));
+	EXPECT_FALSE(object_is_read(bmain, "Unused"));
+	EXPECT_NE(lib->id.tag & LIB_TAG_LAZY, 0);
+
+	/* The library is no longer lazy once all its data-blocks are read. */
+	WM_lib_lazy_ensure(bmain, (Scene *)BKE_libblock_find_name(bmain, ID_SCE, "SceneOther"), NULL);
+	EXPECT_TRUE(object_is_read(bmain, "Used"));
+	EXPECT_TRUE(object_is_read(bmain, "Unused"));
+	EXPECT_EQ(lib->id.tag & LIB_TAG_LAZY, 0);
+
+	G_MAIN = NULL;
+	BLO_blendfiledata_free(bfd);
+}
@@ -0,0 +1,158 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_genfile.h"
+#include "DNA_ID.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_appdir.h"
+#include "BKE_customdata.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "IMB_imbuf.h"
+}
+
+/* Meshes large enough for the file to span multiple windows of parallel
+ * DNA reconstruction when memory mapped. */
+#define NUM_MESHES 8
+#define NUM_VERTS_PER_MESH (1 << 20)
+
+class BlendfileReadTest : public testing::Test
+{
+protected:
+	char filepath[FILE_MAX];
+
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		DNA_sdna_current_init();
+		IMB_init();
+		BKE_tempdir_init(NULL);
+	}
+
+	static void TearDownTestCase()
+	{
+		BKE_tempdir_session_purge();
+		IMB_exit();
+		DNA_sdna_current_free();
+		BLI_threadapi_exit();
+	}
+
+	virtual void SetUp()
+	{
+		BLI_make_file_string("/", filepath, BKE_tempdir_session(), "blenloader_test_read.blend");
+	}
+
+	virtual void TearDown()
+	{
+		BLI_delete(filepath, false, false);
+		BLO_read_use_mmap_set(false);
+	}
+
+	void write_file(const int write_flags)
+	{
+		Main *bmain = BKE_main_new();
+		for (int i = 0; i < NUM_MESHES; i++) {
+			char name[MAX_ID_NAME - 2];
+			BLI_snprintf(name, sizeof(name), "Mesh%d", i);
+			Mesh *mesh = BKE_mesh_add(bmain, name);
+			mesh->totvert = NUM_VERTS_PER_MESH;
+			mesh->mvert = (MVert *)CustomData_add_layer(
+			        &mesh->vdata, CD_MVERT, CD_CALLOC, NULL, mesh->totvert);
+			for (int v = 0; v < mesh->totvert; v++) {
+				mesh->mvert[v].co[0] = (float)i;
+				mesh->mvert[v].co[1] = (float)v;
+			}
+		}
+		ASSERT_TRUE(BLO_write_file(bmain, filepath, write_flags, NULL, NULL));
+		BKE_main_free(bmain);
+	}
+
+	static int check_mesh(const Mesh *mesh, const int index)
+	{
+		EXPECT_EQ(mesh->totvert, NUM_VERTS_PER_MESH);
+		if (mesh->totvert != NUM_VERTS_PER_MESH || mesh->mvert == NULL) {
+			return -1;
+		}
+		int num_mismatch = 0;
+		for (int v = 0; v < mesh->totvert; v++) {
+			if (mesh->mvert[v].co[0] != (float)index || mesh->mvert[v].co[1] != (float)v) {
+				num_mismatch++;
+			}
+		}
+		return num_mismatch;
+	}
+
+	void check_file_read()
+	{
+		BlendFileData *bfd = BLO_read_from_file(filepath, BLO_READ_SKIP_USERDEF, NULL);
+		ASSERT_NE(bfd, (BlendFileData *)NULL);
+		EXPECT_EQ(BLI_listbase_count(&bfd->main->meshes), NUM_MESHES);
+		int i = 0;
+		LISTBASE_FOREACH (Mesh *, mesh, &bfd->main->meshes) {
+			EXPECT_EQ(check_mesh(mesh, i), 0);
+			i++;
+		}
+		BLO_blendfiledata_free(bfd);
+	}
+
+	void check_file_link()
+	{
+		Main *bmain = BKE_main_new();
+		BLI_strncpy(bmain->name, "/blenloader_test_link.blend", sizeof(bmain->name));
+		BlendHandle *bh = BLO_blendhandle_from_file(filepath, NULL);
+		ASSERT_NE(bh, (BlendHandle *)NULL);
+		Main *mainl = BLO_library_link_begin(bmain, &bh, filepath);
+		ID *id = BLO_library_link_named_part(mainl, &bh, ID_ME, "Mesh5");
+		EXPECT_NE(id, (ID *)NULL);
+		BLO_library_link_end(mainl, &bh, 0, bmain, NULL, NULL, NULL);
+		BLO_blendhandle_close(bh);
+
+		EXPECT_EQ(BLI_listbase_count(&bmain->meshes), 1);
+		Mesh *mesh = (Mesh *)bmain->meshes.first;
+		ASSERT_NE(mesh, (Mesh *)NULL);
+		EXPECT_STREQ(mesh->id.name + 2, "Mesh5");
+		EXPECT_EQ(check_mesh(mesh, 5), 0);
+		BKE_main_free(bmain);
+	}
+};
+
+TEST_F(BlendfileReadTest, Buffered)
+{
+	write_file(0);
+	check_file_read();
+}
+
+TEST_F(BlendfileReadTest, MemoryMapped)
+{
+	write_file(0);
+	BLO_read_use_mmap_set(true);
+	check_file_read();
+}
+
+TEST_F(BlendfileReadTest, CompressedFrames)
+{
+	write_file(G_FILE_COMPRESS);
+	check_file_read();
+}
+
+TEST_F(BlendfileReadTest, CompressedFramesLink)
+{
+	write_file(G_FILE_COMPRESS);
+	check_file_link();
+}
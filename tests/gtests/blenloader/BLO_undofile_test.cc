@@ -0,0 +1,206 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "DNA_genfile.h"
+#include "DNA_mesh_types.h"
+
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+
+#include "BLO_readfile.h"
+#include "BLO_undofile.h"
+#include "BLO_writefile.h"
+}
+
+#define CHUNK_SIZE 1024
+
+/* Chunks filled with their value from \a values. */
+static void memfile_fill(MemFile *memfile, MemFile *memfile_compare, const char *values)
+{
+	char buf[CHUNK_SIZE];
+	MemFileChunk *compchunk = memfile_compare ? (MemFileChunk *)memfile_compare->chunks.first : NULL;
+	for (const char *value = values; *value; value++) {
+		memset(buf, *value, sizeof(buf));
+		memfile_chunk_add(memfile, buf, sizeof(buf), &compchunk);
+	}
+}
+
+static void expect_no_buffers()
+{
+	MemFileStats stats;
+	BLO_memfile_stats_get(&stats);
+	EXPECT_EQ(stats.buffers_num, 0);
+	EXPECT_EQ(stats.size_unique, 0);
+	EXPECT_EQ(stats.size_total, 0);
+}
+
+class MemFileTest : public testing::Test
+{
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		DNA_sdna_current_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		DNA_sdna_current_free();
+		BLI_threadapi_exit();
+	}
+};
+
+TEST_F(MemFileTest, SharedAcrossPositions)
+{
+	MemFile memfile_a = {{NULL}};
+	MemFile memfile_b = {{NULL}};
+
+	memfile_fill(&memfile_a, NULL, "abc");
+	/* Every chunk moved by one, only the first one is new. */
+	memfile_fill(&memfile_b, &memfile_a, "xabc");
+	EXPECT_EQ(memfile_a.size, 3 * CHUNK_SIZE);
+	EXPECT_EQ(memfile_b.size, CHUNK_SIZE);
+
+	MemFileStats stats;
+	BLO_memfile_stats_get(&stats);
+	EXPECT_EQ(stats.buffers_num, 4);
+	EXPECT_EQ(stats.size_unique, 4 * CHUNK_SIZE);
+	EXPECT_EQ(stats.size_total, 7 * CHUNK_SIZE);
+
+	BLO_memfile_free(&memfile_a);
+	BLO_memfile_free(&memfile_b);
+	expect_no_buffers();
+}
+
+/* Memory files sharing buffers, written and freed from several threads at once. */
+
+static void memfile_thread_func(void *__restrict UNUSED(userdata),
+                                const int UNUSED(iter),
+                                const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	for (int i = 0; i < 100; i++) {
+		MemFile memfile_a = {{NULL}};
+		MemFile memfile_b = {{NULL}};
+		memfile_fill(&memfile_a, NULL, "abcdefgh");
+		memfile_fill(&memfile_b, NULL, "hgfedcba");
+		BLO_memfile_free(&memfile_a);
+		BLO_memfile_free(&memfile_b);
+	}
+}
+
+TEST_F(MemFileTest, Threads)
+{
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.min_iter_per_thread = 1;
+	BLI_task_parallel_range(0, 16, NULL, memfile_thread_func, &settings);
+	expect_no_buffers();
+}
+
+/* Written data-blocks share chunks, and are still found to be identical
+ * when a data-block sorting first is added. */
+
+#define NUM_MESHES 200
+
+TEST_F(MemFileTest, WriteSmallIDs)
+{
+	Main *bmain = BKE_main_new();
+	for (int i = 0; i < NUM_MESHES; i++) {
+		char name[MAX_ID_NAME - 2];
+		BLI_snprintf(name, sizeof(name), "Mesh%d", i);
+		BKE_mesh_add(bmain, name);
+	}
+
+	MemFile memfile_a = {{NULL}};
+	MemFile memfile_b = {{NULL}};
+	ASSERT_TRUE(BLO_write_file_mem(bmain, NULL, &memfile_a, 0));
+	BKE_mesh_add(bmain, "AMesh");
+	ASSERT_TRUE(BLO_write_file_mem(bmain, &memfile_a, &memfile_b, 0));
+
+	EXPECT_EQ(memfile_a.ids_len, NUM_MESHES);
+	EXPECT_EQ(memfile_b.ids_len, NUM_MESHES + 1);
+	/* Chunks hold several data-blocks. */
+	EXPECT_LT(memfile_a.chunks_len, NUM_MESHES / 2);
+	/* Only the chunks around the new mesh are stored again. */
+	EXPECT_LT(memfile_b.size, memfile_a.size / 4);
+
+	GSet *ids_identical = BLO_memfile_identical_ids_get(&memfile_a, &memfile_b);
+	ASSERT_NE(ids_identical, (GSet *)NULL);
+	EXPECT_GT(BLI_gset_len(ids_identical), NUM_MESHES * 3 / 4);
+	EXPECT_FALSE(BLI_gset_haskey(ids_identical, bmain->meshes.first));
+	BLI_gset_free(ids_identical, NULL);
+
+	BLO_memfile_free(&memfile_a);
+	BLO_memfile_free(&memfile_b);
+	BKE_main_free(bmain);
+	expect_no_buffers();
+}
+
+/* Undo keeps the meshes which are identical in both steps and not tagged since the current one. */
+
+static void memfile_undo_push(Main *bmain, MemFile *memfile_prev, MemFile *memfile)
+{
+	for (Mesh *me = (Mesh *)bmain->meshes.first; me; me = (Mesh *)me->id.next) {
+		me->id.recalc_after_undo_push = 0;
+	}
+	ASSERT_TRUE(BLO_write_file_mem(bmain, memfile_prev, memfile, 0));
+}
+
+TEST_F(MemFileTest, ReadReusesUnchangedIDs)
+{
+	Main *bmain = BKE_main_new();
+	Mesh *meshes[NUM_MESHES];
+	for (int i = 0; i < NUM_MESHES; i++) {
+		char name[MAX_ID_NAME - 2];
+		BLI_snprintf(name, sizeof(name), "Mesh%d", i);
+		meshes[i] = BKE_mesh_add(bmain, name);
+	}
+	Mesh *me_pushed = meshes[NUM_MESHES / 4];
+	Mesh *me_tagged = meshes[NUM_MESHES * 3 / 4];
+
+	MemFile memfile_a = {{NULL}};
+	MemFile memfile_b = {{NULL}};
+	memfile_undo_push(bmain, NULL, &memfile_a);
+	/* Changed and pushed. */
+	me_pushed->smoothresh = 1.0f;
+	memfile_undo_push(bmain, &memfile_a, &memfile_b);
+	/* Changed and tagged for update, without a push. */
+	me_tagged->smoothresh = 1.0f;
+	me_tagged->id.recalc_after_undo_push |= ID_RECALC_GEOMETRY;
+
+	BlendFileData *bfd = BLO_read_from_memfile(bmain, "", &memfile_a, &memfile_b, BLO_READ_SKIP_NONE, NULL);
+	ASSERT_NE(bfd, (BlendFileData *)NULL);
+	EXPECT_EQ(BLI_listbase_count(&bfd->main->meshes), NUM_MESHES);
+
+	int reused_num = 0;
+	for (Mesh *me = (Mesh *)bfd->main->meshes.first; me; me = (Mesh *)me->id.next) {
+		const bool is_reused = (me->id.tag & LIB_TAG_UNDO_OLD_ID_REUSED) != 0;
+		reused_num += is_reused;
+		/* All meshes are back to the state of the undo step. */
+		EXPECT_NE(me->smoothresh, 1.0f);
+		EXPECT_EQ(me->id.recalc_after_undo_push != 0, !is_reused);
+		if (STREQ(me->id.name, me_pushed->id.name) || STREQ(me->id.name, me_tagged->id.name)) {
+			EXPECT_FALSE(is_reused);
+		}
+	}
+	EXPECT_GT(reused_num, NUM_MESHES * 3 / 4);
+	/* Kept meshes were moved out of the old main. */
+	EXPECT_EQ(BLI_listbase_count(&bmain->meshes), NUM_MESHES - reused_num);
+
+	BLO_blendfiledata_free(bfd);
+	BLO_memfile_free(&memfile_a);
+	BLO_memfile_free(&memfile_b);
+	BKE_main_free(bmain);
+	expect_no_buffers();
+}
@@ -0,0 +1,183 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "COM_MemoryBuffer.h"
+#include "COM_ResultCache.h"
+
+#include "MEM_CacheLimiterC-Api.h"
+
+extern "C" {
+#include "BLI_rect.h"
+#include "BLI_threads.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+#include "IMB_moviecache.h"
+}
+
+#define BUFFER_SIZE 64
+#define BUFFER_BYTES (sizeof(float) * COM_NUM_CHANNELS_COLOR * BUFFER_SIZE * BUFFER_SIZE)
+
+class ResultCacheTest : public testing::Test
+{
+public:
+	size_t memory_limit;
+
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		IMB_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		IMB_exit();
+		BLI_threadapi_exit();
+	}
+
+	void SetUp()
+	{
+		memory_limit = MEM_CacheLimiter_get_maximum();
+	}
+
+	void TearDown()
+	{
+		ResultCache::clear();
+		MEM_CacheLimiter_set_maximum(memory_limit);
+	}
+};
+
+static ResultKey create_key(int value)
+{
+	ResultKey key;
+	key.addString("result");
+	key.addInt(value);
+	return key;
+}
+
+static MemoryBuffer *create_buffer(DataType datatype, float value)
+{
+	rcti rect;
+	BLI_rcti_init(&rect, 0, BUFFER_SIZE, 0, BUFFER_SIZE);
+	MemoryBuffer *buffer = new MemoryBuffer(datatype, &rect);
+	const int size = BUFFER_SIZE * BUFFER_SIZE * buffer->get_num_channels();
+	float *data = buffer->getBuffer();
+	for (int i = 0; i < size; i++) {
+		data[i] = value;
+	}
+	return buffer;
+}
+
+static unsigned int frame_hash(const void *key)
+{
+	return *(const int *)key;
+}
+
+static bool frame_cmp(const void *a, const void *b)
+{
+	return *(const int *)a != *(const int *)b;
+}
+
+static bool has_result(int value)
+{
+	MemoryBuffer *buffer = ResultCache::acquire(create_key(value), COM_DT_COLOR, BUFFER_SIZE, BUFFER_SIZE);
+	const bool found = (buffer != NULL);
+	delete buffer;
+	return found;
+}
+
+TEST_F(ResultCacheTest, Key)
+{
+	EXPECT_EQ(create_key(1).getHash(), create_key(1).getHash());
+	EXPECT_NE(create_key(1).getHash(), create_key(2).getHash());
+	EXPECT_TRUE(create_key(1).isValid());
+
+	/* results depending on untracked data invalidate all keys after them */
+	ResultKey input = create_key(1);
+	input.invalidate();
+	ResultKey key = create_key(2);
+	key.addKey(input);
+	EXPECT_FALSE(key.isValid());
+
+	ResultCache::store(key, create_buffer(COM_DT_COLOR, 1.0f));
+	EXPECT_EQ(NULL, ResultCache::acquire(key, COM_DT_COLOR, BUFFER_SIZE, BUFFER_SIZE));
+}
+
+TEST_F(ResultCacheTest, StoreAcquire)
+{
+	MEM_CacheLimiter_set_maximum(0);
+
+	ResultCache::store(create_key(1), create_buffer(COM_DT_COLOR, 0.5f));
+	ResultCache::store(create_key(2), create_buffer(COM_DT_VALUE, 0.25f));
+
+	MemoryBuffer *buffer = ResultCache::acquire(create_key(1), COM_DT_COLOR, BUFFER_SIZE, BUFFER_SIZE);
+	ASSERT_TRUE(buffer != NULL);
+	EXPECT_TRUE(buffer->isImBufWrapper());
+	EXPECT_EQ(BUFFER_SIZE, buffer->getWidth());
+	EXPECT_EQ(BUFFER_SIZE, buffer->getHeight());
+	EXPECT_EQ(COM_NUM_CHANNELS_COLOR, buffer->get_num_channels());
+	const float *data = buffer->getBuffer();
+	for (int i = 0; i < BUFFER_SIZE * BUFFER_SIZE * COM_NUM_CHANNELS_COLOR; i++) {
+		ASSERT_EQ(0.5f, data[i]);
+	}
+
+	/* storing a buffer read from the cache keeps the entry */
+	ResultCache::store(create_key(1), buffer);
+	EXPECT_TRUE(has_result(1));
+
+	buffer = ResultCache::acquire(create_key(2), COM_DT_VALUE, BUFFER_SIZE, BUFFER_SIZE);
+	ASSERT_TRUE(buffer != NULL);
+	EXPECT_EQ(COM_NUM_CHANNELS_VALUE, buffer->get_num_channels());
+	EXPECT_EQ(0.25f, buffer->getBuffer()[0]);
+	delete buffer;
+
+	/* results only match buffers of the same size and type */
+	EXPECT_EQ(NULL, ResultCache::acquire(create_key(1), COM_DT_COLOR, BUFFER_SIZE, BUFFER_SIZE / 2));
+	EXPECT_EQ(NULL, ResultCache::acquire(create_key(2), COM_DT_COLOR, BUFFER_SIZE, BUFFER_SIZE));
+	EXPECT_EQ(NULL, ResultCache::acquire(create_key(3), COM_DT_COLOR, BUFFER_SIZE, BUFFER_SIZE));
+
+	ResultCache::clear();
+	EXPECT_FALSE(has_result(1));
+}
+
+TEST_F(ResultCacheTest, ClearWhileAcquired)
+{
+	ResultCache::store(create_key(1), create_buffer(COM_DT_COLOR, 0.5f));
+	MemoryBuffer *buffer = ResultCache::acquire(create_key(1), COM_DT_COLOR, BUFFER_SIZE, BUFFER_SIZE);
+	ASSERT_TRUE(buffer != NULL);
+
+	/* an execution reading the result keeps it alive */
+	ResultCache::clear();
+	EXPECT_EQ(0.5f, buffer->getBuffer()[0]);
+	delete buffer;
+}
+
+/* Compositor results and other movie caches are limited together. */
+TEST_F(ResultCacheTest, SharedMemoryLimit)
+{
+	MEM_CacheLimiter_set_maximum(3 * BUFFER_BYTES + BUFFER_BYTES / 2);
+
+	MovieCache *moviecache = IMB_moviecache_create("test", sizeof(int), frame_hash, frame_cmp);
+	int frame = 1;
+	ImBuf *ibuf = IMB_allocImBuf(BUFFER_SIZE, BUFFER_SIZE, 32, IB_rectfloat);
+	IMB_moviecache_put(moviecache, &frame, ibuf);
+	IMB_freeImBuf(ibuf);
+
+	for (int i = 1; i <= 4; i++) {
+		ResultCache::store(create_key(i), create_buffer(COM_DT_COLOR, (float)i));
+	}
+
+	/* least recently used buffers are freed first, no matter which cache they're in */
+	ibuf = IMB_moviecache_get(moviecache, &frame);
+	EXPECT_EQ(NULL, ibuf);
+	if (ibuf) {
+		IMB_freeImBuf(ibuf);
+	}
+	EXPECT_FALSE(has_result(1));
+	EXPECT_TRUE(has_result(2));
+	EXPECT_TRUE(has_result(3));
+	EXPECT_TRUE(has_result(4));
+
+	IMB_moviecache_free(moviecache);
+}
@@ -0,0 +1,218 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <math.h>
+#include <vector>
+
+#include "COM_RowEvaluator.h"
+
+#include "COM_AlphaOverKeyOperation.h"
+#include "COM_AlphaOverPremultiplyOperation.h"
+#include "COM_BrightnessOperation.h"
+#include "COM_ConvertOperation.h"
+#include "COM_MixOperation.h"
+
+#define ROW_X 3
+#define ROW_LENGTH 200
+
+static int num_channels(DataType datatype)
+{
+	switch (datatype) {
+		case COM_DT_VALUE:
+			return COM_NUM_CHANNELS_VALUE;
+		case COM_DT_VECTOR:
+			return COM_NUM_CHANNELS_VECTOR;
+		default:
+			return COM_NUM_CHANNELS_COLOR;
+	}
+}
+
+/* Leaf with a different value for every pixel, in a range that needs clamping.
+ * Only writes the channels of its data type, like other operations. */
+class GradientOperation : public NodeOperation {
+private:
+	float m_offset;
+
+public:
+	GradientOperation(DataType datatype, float offset) : m_offset(offset)
+	{
+		this->addOutputSocket(datatype);
+	}
+
+	void executePixelSampled(float output[4], float x, float y, PixelSampler /*sampler*/)
+	{
+		const float scale[4][2] = {{0.37f, 0.11f}, {0.13f, 0.29f}, {0.07f, 0.53f}, {0.05f, 0.31f}};
+		const int channels = num_channels(this->getOutputSocket()->getDataType());
+		for (int channel = 0; channel < channels; channel++) {
+			const float value = this->m_offset + x * scale[channel][0] + y * scale[channel][1];
+			output[channel] = (channel == 3) ? fmodf(value, 1.0f) : fmodf(value, 1.5f) - 0.2f;
+		}
+	}
+};
+
+/* Operation reading the rows, as buffer writers do. */
+class RowReaderOperation : public NodeOperation {
+public:
+	RowReaderOperation(NodeOperation *input)
+	{
+		this->addInputSocket(input->getOutputSocket()->getDataType());
+		this->getInputSocket(0)->setLink(input->getOutputSocket());
+	}
+};
+
+class RowEvaluatorTest : public testing::Test
+{
+public:
+	std::vector<NodeOperation *> operations;
+
+	void TearDown()
+	{
+		for (unsigned int index = 0; index < operations.size(); index++) {
+			operations[index]->deinitExecution();
+			delete operations[index];
+		}
+		operations.clear();
+	}
+
+	NodeOperation *add(NodeOperation *operation)
+	{
+		operations.push_back(operation);
+		return operation;
+	}
+
+	/* Link unconnected inputs to gradients, then initialize all operations. */
+	void init_execution()
+	{
+		const unsigned int num_operations = operations.size();
+		for (unsigned int index = 0; index < num_operations; index++) {
+			NodeOperation *operation = operations[index];
+			for (unsigned int socket = 0; socket < operation->getNumberOfInputSockets(); socket++) {
+				NodeOperationInput *input = operation->getInputSocket(socket);
+				if (!input->isConnected()) {
+					NodeOperation *gradient = add(new GradientOperation(input->getDataType(), 0.1f * operations.size()));
+					input->setLink(gradient->getOutputSocket());
+				}
+			}
+		}
+		for (unsigned int index = 0; index < operations.size(); index++) {
+			operations[index]->initExecution();
+		}
+	}
+
+	/* Rows must match the operation read pixel by pixel. */
+	void check_rows(NodeOperation *operation)
+	{
+		RowReaderOperation reader(operation);
+		RowEvaluator rows(&reader);
+		const int channels = num_channels(operation->getOutputSocket()->getDataType());
+
+		for (int y = 0; y < 4; y++) {
+			rows.execute(ROW_X, y, ROW_LENGTH);
+			const float *row = rows.getInputRow(0);
+			for (int i = 0; i < ROW_LENGTH; i++) {
+				float expected[4];
+				operation->readSampled(expected, ROW_X + i, y, COM_PS_NEAREST);
+				for (int channel = 0; channel < channels; channel++) {
+					ASSERT_NEAR(expected[channel], row[i * COM_NUM_CHANNELS_COLOR + channel], 1e-6f)
+					        << "pixel " << ROW_X + i << ", " << y << " channel " << channel;
+				}
+			}
+		}
+	}
+
+	void check_mix(MixBaseOperation *operation)
+	{
+		for (int flags = 0; flags < 4; flags++) {
+			operation->setUseClamp(flags & 1);
+			operation->setUseValueAlphaMultiply(flags & 2);
+			check_rows(operation);
+		}
+	}
+};
+
+TEST_F(RowEvaluatorTest, Mix)
+{
+	MixBaseOperation *mix_add = (MixBaseOperation *)add(new MixAddOperation());
+	MixBaseOperation *mix_blend = (MixBaseOperation *)add(new MixBlendOperation());
+	MixBaseOperation *mix_multiply = (MixBaseOperation *)add(new MixMultiplyOperation());
+	MixBaseOperation *mix_screen = (MixBaseOperation *)add(new MixScreenOperation());
+	MixBaseOperation *mix_subtract = (MixBaseOperation *)add(new MixSubtractOperation());
+	init_execution();
+
+	check_mix(mix_add);
+	check_mix(mix_blend);
+	check_mix(mix_multiply);
+	check_mix(mix_screen);
+	check_mix(mix_subtract);
+}
+
+TEST_F(RowEvaluatorTest, AlphaOver)
+{
+	NodeOperation *alpha_over_key = add(new AlphaOverKeyOperation());
+	NodeOperation *alpha_over_premultiply = add(new AlphaOverPremultiplyOperation());
+	init_execution();
+
+	check_rows(alpha_over_key);
+	check_rows(alpha_over_premultiply);
+}
+
+TEST_F(RowEvaluatorTest, Brightness)
+{
+	BrightnessOperation *brightness = (BrightnessOperation *)add(new BrightnessOperation());
+	BrightnessOperation *brightness_premultiply = (BrightnessOperation *)add(new BrightnessOperation());
+	brightness->setUsePremultiply(false);
+	brightness_premultiply->setUsePremultiply(true);
+	init_execution();
+
+	check_rows(brightness);
+	check_rows(brightness_premultiply);
+}
+
+TEST_F(RowEvaluatorTest, Convert)
+{
+	std::vector<NodeOperation *> converts;
+	converts.push_back(add(new ConvertValueToColorOperation()));
+	converts.push_back(add(new ConvertColorToValueOperation()));
+	converts.push_back(add(new ConvertColorToBWOperation()));
+	converts.push_back(add(new ConvertColorToVectorOperation()));
+	converts.push_back(add(new ConvertValueToVectorOperation()));
+	converts.push_back(add(new ConvertVectorToColorOperation()));
+	converts.push_back(add(new ConvertVectorToValueOperation()));
+	init_execution();
+
+	for (unsigned int index = 0; index < converts.size(); index++) {
+		check_rows(converts[index]);
+	}
+}
+
+/* An operation read by several others is calculated once, before all of them. */
+TEST_F(RowEvaluatorTest, SharedInput)
+{
+	NodeOperation *shared = add(new MixMultiplyOperation());
+	NodeOperation *convert = add(new ConvertColorToValueOperation());
+	NodeOperation *brightness = add(new BrightnessOperation());
+	NodeOperation *mix = add(new MixAddOperation());
+	convert->getInputSocket(0)->setLink(shared->getOutputSocket());
+	brightness->getInputSocket(0)->setLink(shared->getOutputSocket());
+	mix->getInputSocket(0)->setLink(convert->getOutputSocket());
+	mix->getInputSocket(1)->setLink(brightness->getOutputSocket());
+	mix->getInputSocket(2)->setLink(shared->getOutputSocket());
+	init_execution();
+
+	check_rows(mix);
+}
+
+/* Long chains are evaluated without recursion. */
+TEST_F(RowEvaluatorTest, Chain)
+{
+	NodeOperation *last = add(new GradientOperation(COM_DT_COLOR, 0.0f));
+	for (int index = 0; index < 1000; index++) {
+		NodeOperation *brightness = add(new BrightnessOperation());
+		brightness->getInputSocket(0)->setLink(last->getOutputSocket());
+		last = brightness;
+	}
+	init_execution();
+
+	check_rows(last);
+}
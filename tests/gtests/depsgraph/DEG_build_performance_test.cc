@@ -0,0 +1,117 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_genfile.h"
+#include "DNA_layer_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_collection.h"
+#include "BKE_global.h"
+#include "BKE_layer.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "IMB_imbuf.h"
+
+#include "PIL_time.h"
+}
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+
+/* Measures relations rebuild time of a set-dressing like scene: lots of
+ * collections of objects instancing the same mesh, with one collection being
+ * excluded from the view layer, which tags relations for update. */
+
+#define NUM_COLLECTIONS 200
+#define NUM_OBJECTS_PER_COLLECTION 100
+#define NUM_REBUILDS 5
+
+class DepsgraphBuildPerformanceTest : public testing::Test
+{
+protected:
+	Main *bmain;
+	Scene *scene;
+	ViewLayer *view_layer;
+
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		DNA_sdna_current_init();
+		IMB_init();
+		DEG_register_node_types();
+	}
+
+	static void TearDownTestCase()
+	{
+		DEG_free_node_types();
+		IMB_exit();
+		DNA_sdna_current_free();
+		BLI_threadapi_exit();
+	}
+
+	virtual void SetUp()
+	{
+		char name[MAX_ID_NAME - 2];
+		bmain = BKE_main_new();
+		scene = BKE_scene_add(bmain, "Scene");
+		view_layer = BKE_view_layer_default_view(scene);
+		for (int i = 0; i < NUM_COLLECTIONS; i++) {
+			BLI_snprintf(name, sizeof(name), "Collection%d", i);
+			Collection *collection = BKE_collection_add(bmain, scene->master_collection, name);
+			Mesh *mesh = BKE_mesh_add(bmain, name);
+			for (int j = 0; j < NUM_OBJECTS_PER_COLLECTION; j++) {
+				BLI_snprintf(name, sizeof(name), "Object%d.%d", i, j);
+				Object *ob = BKE_object_add_only_object(bmain, OB_MESH, name);
+				ob->data = mesh;
+				id_us_plus(&mesh->id);
+				BKE_collection_object_add(bmain, collection, ob);
+			}
+		}
+		BKE_layer_collection_sync(scene, view_layer);
+	}
+
+	virtual void TearDown()
+	{
+		BKE_main_free(bmain);
+	}
+};
+
+TEST_F(DepsgraphBuildPerformanceTest, ToggleCollection)
+{
+	Depsgraph *depsgraph = DEG_graph_new(scene, view_layer, DAG_EVAL_VIEWPORT);
+
+	double start_time = PIL_check_seconds_timer();
+	DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+	printf("Initial build: %f seconds.\n", PIL_check_seconds_timer() - start_time);
+
+	Collection *collection = (Collection *)((CollectionChild *)scene->master_collection->children.first)->collection;
+	LayerCollection *layer_collection = BKE_layer_collection_first_from_scene_collection(view_layer, collection);
+	ASSERT_NE(layer_collection, (LayerCollection *)NULL);
+
+	double total_time = 0.0;
+	for (int i = 0; i < NUM_REBUILDS; i++) {
+		layer_collection->flag ^= LAYER_COLLECTION_EXCLUDE;
+		BKE_layer_collection_sync(scene, view_layer);
+		DEG_graph_tag_relations_update(depsgraph);
+		start_time = PIL_check_seconds_timer();
+		DEG_graph_relations_update(depsgraph, bmain, scene, view_layer);
+		total_time += PIL_check_seconds_timer() - start_time;
+	}
+	printf("Rebuild after toggling collection: %f seconds on average.\n",
+	       total_time / NUM_REBUILDS);
+
+	DEG_graph_free(depsgraph);
+}
@@ -0,0 +1,84 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Measure time needed to load a big uncompressed .blend file.
+#
+# Usage:
+#   blender --background --factory-startup [--blend-read-mmap] \
+#       --python tests/python/bl_blendfile_load_benchmark.py -- \
+#       [--file existing.blend] [--objects 2000] [--subdivisions 6] [--iterations 5]
+#
+# Without --file a file is generated in a temporary directory first.
+# Run with and without --blend-read-mmap to compare both reading modes.
+
+import argparse
+import os
+import sys
+import tempfile
+import time
+
+import bpy
+
+
+def create_file(filepath, num_objects, subdivisions):
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    for i in range(num_objects):
+        # Unique meshes, so the file has many big data-blocks to reconstruct.
+        bpy.ops.mesh.primitive_ico_sphere_add(
+            subdivisions=subdivisions,
+            location=(i % 50, i // 50, 0.0),
+        )
+        obj = bpy.context.active_object
+        obj.name = "Object.%05d" % i
+        obj.modifiers.new("Subsurf", 'SUBSURF')
+        material = bpy.data.materials.new("Material.%05d" % i)
+        obj.data.materials.append(material)
+    bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=False)
+
+
+def main():
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--file", default="")
+    parser.add_argument("--objects", type=int, default=2000)
+    parser.add_argument("--subdivisions", type=int, default=6)
+    parser.add_argument("--iterations", type=int, default=5)
+    args = parser.parse_args(argv)
+
+    with tempfile.TemporaryDirectory() as temp_dir:
+        filepath = args.file
+        if not filepath:
+            filepath = os.path.join(temp_dir, "load_benchmark.blend")
+            create_file(filepath, args.objects, args.subdivisions)
+
+        timings = []
+        for _ in range(args.iterations):
+            start_time = time.perf_counter()
+            bpy.ops.wm.open_mainfile(filepath=filepath, load_ui=False)
+            timings.append(time.perf_counter() - start_time)
+
+        timings.sort()
+        print("Load %r (%.1f MB):" % (filepath, os.path.getsize(filepath) / (1024.0 * 1024.0)))
+        print("  min %.4f sec, median %.4f sec, max %.4f sec" %
+              (timings[0], timings[len(timings) // 2], timings[-1]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,201 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Compare noise of Cycles light sampling with and without the light tree,
+# in a street scene lit by many small lights.
+#
+# Usage:
+#   blender --background --factory-startup \
+#       --python tests/python/cycles_many_lights_benchmark.py -- \
+#       [--lights 2000] [--windows 500] [--samples 16,64,256] [--reference-samples 4096]
+#
+# A reference image is rendered first, then every sample count is rendered with
+# the flat light distribution and with the light tree. For each the time and
+# the RMSE against the reference are printed, along with the number of samples
+# the flat distribution needs to reach the noise level of the light tree.
+
+import argparse
+import math
+import os
+import random
+import sys
+import tempfile
+import time
+
+import bpy
+
+
+def create_scene(num_lights, num_windows, resolution):
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    scene = bpy.context.scene
+    random.seed(0)
+
+    scene.render.engine = 'CYCLES'
+    scene.render.resolution_x = resolution[0]
+    scene.render.resolution_y = resolution[1]
+    scene.render.resolution_percentage = 100
+    scene.render.image_settings.file_format = 'OPEN_EXR'
+    scene.render.image_settings.color_depth = '32'
+
+    cscene = scene.cycles
+    cscene.progressive = 'PATH'
+    cscene.device = 'CPU'
+    cscene.max_bounces = 2
+    cscene.light_sampling_threshold = 0.0
+    cscene.sample_clamp_indirect = 0.0
+    cscene.use_animated_seed = False
+
+    world = bpy.data.worlds.new("World")
+    world.color = (0.0, 0.0, 0.0)
+    scene.world = world
+
+    # Street grid, with blocks of buildings in between.
+    bpy.ops.mesh.primitive_plane_add(size=400.0)
+    block_size = 16.0
+    street_width = 8.0
+    pitch = block_size + street_width
+    num_blocks = 8
+
+    window_material = bpy.data.materials.new("Window")
+    window_material.use_nodes = True
+    nodes = window_material.node_tree.nodes
+    nodes.clear()
+    emission = nodes.new('ShaderNodeEmission')
+    emission.inputs["Color"].default_value = (1.0, 0.7, 0.4, 1.0)
+    emission.inputs["Strength"].default_value = 4.0
+    output = nodes.new('ShaderNodeOutputMaterial')
+    window_material.node_tree.links.new(emission.outputs["Emission"], output.inputs["Surface"])
+
+    offset = -0.5 * num_blocks * pitch
+    for i in range(num_blocks):
+        for j in range(num_blocks):
+            height = random.uniform(8.0, 40.0)
+            bpy.ops.mesh.primitive_cube_add(
+                location=(offset + i * pitch, offset + j * pitch, 0.5 * height),
+            )
+            bpy.context.active_object.scale = (0.5 * block_size, 0.5 * block_size, 0.5 * height)
+
+    # Lit windows on the building facades, as emissive mesh lights.
+    for _ in range(num_windows):
+        i = random.randrange(num_blocks)
+        j = random.randrange(num_blocks)
+        side = random.choice((-1.0, 1.0))
+        x = offset + i * pitch + side * (0.5 * block_size + 0.01)
+        y = offset + j * pitch + random.uniform(-0.4, 0.4) * block_size
+        bpy.ops.mesh.primitive_plane_add(
+            size=1.0,
+            location=(x, y, random.uniform(2.0, 8.0)),
+            rotation=(0.0, math.pi * 0.5, 0.0),
+        )
+        bpy.context.active_object.data.materials.append(window_material)
+
+    # Street lights, small and dim, most of them far from any given point.
+    for n in range(num_lights):
+        light = bpy.data.lights.new("Light.%05d" % n, 'POINT')
+        light.energy = random.uniform(5.0, 50.0)
+        light.shadow_soft_size = 0.1
+        light.color = (1.0, random.uniform(0.6, 1.0), random.uniform(0.3, 0.8))
+        obj = bpy.data.objects.new(light.name, light)
+        street = random.randrange(num_blocks + 1)
+        along = random.uniform(-0.5, 0.5) * num_blocks * pitch
+        across = offset + (street - 0.5) * pitch
+        if random.random() < 0.5:
+            obj.location = (across, along, random.uniform(3.0, 6.0))
+        else:
+            obj.location = (along, across, random.uniform(3.0, 6.0))
+        scene.collection.objects.link(obj)
+
+    camera = bpy.data.cameras.new("Camera")
+    camera_object = bpy.data.objects.new("Camera", camera)
+    camera_object.location = (offset - 0.5 * pitch, offset - 0.5 * pitch, 12.0)
+    camera_object.rotation_euler = (math.radians(75.0), 0.0, math.radians(-45.0))
+    scene.collection.objects.link(camera_object)
+    scene.camera = camera_object
+
+
+def render(filepath, samples, use_light_tree, seed=0):
+    scene = bpy.context.scene
+    scene.cycles.samples = samples
+    scene.cycles.seed = seed
+    scene.cycles.use_light_tree = use_light_tree
+    scene.render.filepath = filepath
+
+    start_time = time.perf_counter()
+    bpy.ops.render.render(write_still=True)
+    elapsed = time.perf_counter() - start_time
+
+    image = bpy.data.images.load(filepath)
+    pixels = image.pixels[:]
+    bpy.data.images.remove(image)
+
+    return pixels, elapsed
+
+
+def rmse(pixels, reference):
+    error = 0.0
+    for i in range(0, len(pixels), 4):
+        for c in range(3):
+            error += (pixels[i + c] - reference[i + c]) ** 2
+    return math.sqrt(error / (3 * len(pixels) // 4))
+
+
+def main():
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--lights", type=int, default=2000)
+    parser.add_argument("--windows", type=int, default=500)
+    parser.add_argument("--samples", default="16,64,256")
+    parser.add_argument("--reference-samples", type=int, default=4096)
+    parser.add_argument("--resolution", default="320x180")
+    args = parser.parse_args(argv)
+
+    sample_counts = [int(samples) for samples in args.samples.split(",")]
+    resolution = [int(size) for size in args.resolution.split("x")]
+
+    create_scene(args.lights, args.windows, resolution)
+
+    with tempfile.TemporaryDirectory() as temp_dir:
+        # Different seed, so the noise of the reference isn't correlated with the others.
+        reference, elapsed = render(
+            os.path.join(temp_dir, "reference.exr"), args.reference_samples, True, seed=1)
+        print("Reference: %d samples, %.2f sec" % (args.reference_samples, elapsed))
+
+        results = {}
+        for use_light_tree in (False, True):
+            method = "tree" if use_light_tree else "flat"
+            for samples in sample_counts:
+                filepath = os.path.join(temp_dir, "%s_%d.exr" % (method, samples))
+                pixels, elapsed = render(filepath, samples, use_light_tree)
+                results[method, samples] = (rmse(pixels, reference), elapsed)
+
+        print("Lights: %d, windows: %d" % (args.lights, args.windows))
+        print("%8s  %12s %10s  %12s %10s  %s" %
+              ("samples", "flat rmse", "flat sec", "tree rmse", "tree sec", "flat samples for tree noise"))
+        for samples in sample_counts:
+            flat_error, flat_time = results["flat", samples]
+            tree_error, tree_time = results["tree", samples]
+            # Noise goes down with the square root of the number of samples.
+            equal_noise_samples = samples * (flat_error / tree_error) ** 2 if tree_error > 0.0 else float("inf")
+            print("%8d  %12.6f %10.2f  %12.6f %10.2f  %.0f" %
+                  (samples, flat_error, flat_time, tree_error, tree_time, equal_noise_samples))
+
+
+if __name__ == "__main__":
+    main()